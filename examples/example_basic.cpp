@@ -13,6 +13,7 @@
  *   - Running queries with query() and getting results
  *   - Using scalar() for single values
  *   - Iterating over result rows
+ *   - Streaming rows with open_cursor()/for_each()
  *
  * This is the pattern for standalone CLI tools that manage the IDA lifecycle.
  *
@@ -120,10 +121,35 @@ int main(int argc, char* argv[]) {
         "FROM funcs WHERE rowid = 0"
     );
     if (!first_func.empty()) {
-        std::cout << "First function: " << first_func.rows[0][1]
-                  << " at " << first_func.rows[0][0] << "\n";
+        std::cout << "First function: " << first_func.row(0)[1]
+                  << " at " << first_func.row(0)[0] << "\n";
     }
 
+    // ==========================================================================
+    // Example 5: Streaming rows (constant memory, early abort)
+    // ==========================================================================
+
+    std::cout << "\n=== Streaming ===\n";
+
+    // Pull cursor: rows arrive as SQLite produces them
+    auto cursor = session.open_cursor("SELECT address, size FROM funcs");
+    int64_t total_size = 0;
+    while (cursor.next()) {
+        total_size += cursor.row().int64(1);
+    }
+    std::cout << "Code bytes in functions: " << total_size << "\n";
+
+    // Callback: return false to stop the scan
+    int nonzero = 0;
+    auto summary = session.for_each(
+        "SELECT value FROM bytes",
+        [&](const idasql::CursorRow& row) {
+            if (row.int64(0) != 0) ++nonzero;
+            return nonzero < 1000;
+        });
+    std::cout << "Scanned " << summary.rows << " bytes"
+              << (summary.aborted ? " (stopped early)" : "") << "\n";
+
     // Cleanup (optional - destructor handles it)
     session.close();
 
@@ -86,10 +86,10 @@ int main(int argc, char* argv[]) {
         return 1;
     }
 
-    std::string addr1 = funcs.rows[0][0];
-    std::string name1 = funcs.rows[0][1];
-    std::string addr2 = funcs.rows[1][0];
-    std::string name2 = funcs.rows[1][1];
+    std::string addr1 = funcs.row(0)[0];
+    std::string name1 = funcs.row(0)[1];
+    std::string addr2 = funcs.row(1)[0];
+    std::string name2 = funcs.row(1)[1];
 
     // Insert a software breakpoint at the first function
     auto r1 = session.query(
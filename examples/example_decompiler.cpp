@@ -49,7 +49,7 @@ int main(int argc, char* argv[]) {
 
     // Try to decompile a function to check if Hex-Rays is available
     auto test = session.query("SELECT decompile((SELECT address FROM funcs WHERE rowid = 0)) as code");
-    if (!test.success || test.empty() || test.rows[0][0].find("Decompiler") != std::string::npos) {
+    if (!test.success || test.empty() || test.scalar().find("Decompiler") != std::string::npos) {
         std::cerr << "Warning: Hex-Rays decompiler may not be available.\n";
         std::cerr << "Some queries may fail or return empty results.\n\n";
     }
@@ -78,8 +78,8 @@ void plugin_main() {
         "FROM funcs"
     );
     if (totals.row_count() > 0) {
-        std::cout << "Processed " << totals.rows[0][0] << " functions\n";
-        std::cout << "Total code size: " << totals.rows[0][1] << " bytes\n";
+        std::cout << "Processed " << totals.row(0)[0] << " functions\n";
+        std::cout << "Total code size: " << totals.row(0)[1] << " bytes\n";
     }
 }
 
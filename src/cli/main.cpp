@@ -35,6 +35,7 @@
 #include <xsql/query_script.hpp>
 #include <xsql/thinclient/server.hpp>
 #include "../common/http_server.hpp"
+#include "../common/ipc_server.hpp"
 #include "../common/idasql_commands.hpp"
 #include "../common/pin_commands.hpp"
 #include <idasql/autostart_pin.hpp>
@@ -162,8 +163,8 @@ struct idapython_runtime_guard_t {
 };
 
 static void add_query_result_rows(TablePrinter& printer, const idasql::QueryResult& result) {
-    for (const auto& row : result.rows) {
-        printer.add_row(result.columns, row.values);
+    for (const auto& row : result) {
+        printer.add_row(result.columns, row.values());
     }
 }
 
@@ -254,15 +255,15 @@ static void run_repl(idasql::Database& db) {
             callbacks.get_tables = [&db]() -> std::string {
                 std::stringstream ss;
                 auto result = db.query("SELECT name FROM sqlite_master WHERE type='table' ORDER BY name");
-                for (const auto& row : result.rows) {
-                    if (row.size() > 0) ss << row[0] << "\n";
+                for (const auto& row : result) {
+                    if (row.size() > 0) ss << row.cell(0).bytes() << "\n";
                 }
                 return ss.str();
             };
             callbacks.get_schema = [&db](const std::string& table) -> std::string {
                 auto result = db.query("SELECT sql FROM sqlite_master WHERE name='" + table + "'");
-                if (result.success && !result.rows.empty() && result.rows[0].size() > 0) {
-                    return std::string(result.rows[0][0]);
+                if (result.success && !result.empty() && result.column_count() > 0) {
+                    return result.scalar();
                 }
                 return "Table not found: " + table;
             };
@@ -303,11 +304,20 @@ static void run_repl(idasql::Database& db) {
                 }
 
                 // SQL executor - will be called on main thread via wait()
-                idasql::QueryCallback sql_cb = [&db](const std::string& sql) -> std::string {
-                    auto result = idasql::run_sql_script(db, sql);
-                    return xsql::script_result_to_text(result);
+                idasql::QueryCallback sql_cb = [&db](const std::string& sql,
+                                                     const idasql::QueryParams& params) -> std::string {
+                    auto script = idasql::run_typed_script(sql, params,
+                        [&db](const std::string& stmt, const idasql::QueryParams& p) {
+                            return db.query(stmt, p);
+                        });
+                    return idasql::format_typed_script_json(script);
                 };
 
+                g_mcp_server->set_cursor_executor(
+                    [&db](const std::string& sql, const idasql::QueryParams& params) {
+                        return db.open_cursor(sql, params);
+                    });
+
                 // Start with use_queue=true for CLI mode (main thread execution)
                 int port = g_mcp_server->start(req_port, sql_cb, addr, true);
                 if (port <= 0) {
@@ -386,16 +396,20 @@ static void run_repl(idasql::Database& db) {
 
                 // SQL executor - called on main thread via run_until_stopped()
                 idasql::HTTPStatementExecutor sql_cb =
-                    [&db](const std::string& stmt, xsql::ScriptStatementResult& out) {
-                        idasql::QueryResult r = db.query(stmt);
-                        out.columns = r.columns;
-                        out.rows.reserve(r.rows.size());
-                        for (const auto& row : r.rows) out.rows.push_back(row.values);
-                        out.elapsed_ms = static_cast<double>(r.elapsed_ms);
-                        out.success = r.success;
-                        out.error = r.error;
+                    [&db](const std::string& stmt, const idasql::QueryParams& params) {
+                        return db.query(stmt, params);
                     };
 
+                g_repl_http_server->set_stream_executor(
+                    [&db](const std::string& stmt, const idasql::QueryParams& params,
+                          const idasql::RowCallback& on_row) {
+                        return db.for_each(stmt.c_str(), params, on_row);
+                    });
+                g_repl_http_server->set_cursor_executor(
+                    [&db](const std::string& sql, const idasql::QueryParams& params) {
+                        return db.open_cursor(sql, params);
+                    });
+
                 // Start with use_queue=true (CLI mode)
                 int port = g_repl_http_server->start(req_port, sql_cb, addr, true);
                 if (port <= 0) {
@@ -512,16 +526,16 @@ static std::vector<std::string> parse_table_list(const std::string& spec) {
     return tables;
 }
 
-// Export tables to SQL file
+// Export tables to a SQL or columnar file
 static bool export_to_sql(idasql::Database& db, const char* path,
-                          const std::string& table_spec) {
+                          const std::string& table_spec, idasql::ExportFormat format) {
     std::vector<std::string> tables;
     if (!(table_spec.empty() || table_spec == "*")) {
         tables = parse_table_list(table_spec);
     }
 
     std::string error;
-    if (!db.export_tables(tables, path, error)) {
+    if (!db.export_tables(tables, path, error, format)) {
         std::cerr << "Error: " << error << "\n";
         return false;
     }
@@ -578,21 +592,25 @@ static void http_signal_handler(int) {
 }
 
 
-// CLI --http server, on the shared libxsql thinclient (use_queue=true: queries
-// run on this main thread via run_until_stopped, for Hex-Rays thread affinity).
+// CLI --http server (use_queue=true: queries run on this main thread via
+// run_until_stopped, for Hex-Rays thread affinity).
 static int run_http_mode(idasql::Database& db, int port, const std::string& bind_addr, const std::string& auth_token) {
     idasql::IDAHTTPServer server;
     idasql::HTTPStatementExecutor exec =
-        [&db](const std::string& stmt, xsql::ScriptStatementResult& out) {
-            idasql::QueryResult r = db.query(stmt);
-            out.columns = r.columns;
-            out.rows.reserve(r.rows.size());
-            for (const auto& row : r.rows) out.rows.push_back(row.values);
-            out.elapsed_ms = static_cast<double>(r.elapsed_ms);
-            out.success = r.success;
-            out.error = r.error;
+        [&db](const std::string& stmt, const idasql::QueryParams& params) {
+            return db.query(stmt, params);
         };
 
+    server.set_stream_executor(
+        [&db](const std::string& stmt, const idasql::QueryParams& params,
+              const idasql::RowCallback& on_row) {
+            return db.for_each(stmt.c_str(), params, on_row);
+        });
+    server.set_cursor_executor(
+        [&db](const std::string& sql, const idasql::QueryParams& params) {
+            return db.open_cursor(sql, params);
+        });
+
     int actual_port = server.start(port, exec, bind_addr, /*use_queue=*/true, auth_token);
     if (actual_port < 0) {
         std::cerr << "Error: Failed to start HTTP server\n";
@@ -627,6 +645,49 @@ static int run_http_mode(idasql::Database& db, int port, const std::string& bind
     return 0;
 }
 
+// CLI --ipc server: same main-thread queue as --http, over a Unix-domain
+// socket with results in a shared-memory ring.
+static int run_ipc_mode(idasql::Database& db, const std::string& path, const std::string& auth_token) {
+    idasql::IDAIPCServer server;
+    std::string error;
+    const bool started = server.start(
+        path,
+        [&db](const std::string& sql, const idasql::QueryParams& params) {
+            return db.open_cursor(sql, params);
+        },
+        /*use_queue=*/true, auth_token, &error);
+    if (!started) {
+        std::cerr << "Error: Failed to start IPC server: " << error << "\n";
+        return 1;
+    }
+
+    g_http_stop_requested.store(false);
+    auto old_handler = std::signal(SIGINT, http_signal_handler);
+#ifdef _WIN32
+    auto old_break = std::signal(SIGBREAK, http_signal_handler);
+#else
+    auto old_term = std::signal(SIGTERM, http_signal_handler);
+#endif
+    server.set_interrupt_check([]() { return g_http_stop_requested.load(); });
+
+    std::cout << "IDASQL IPC server: " << path << "\n";
+    std::cout << "Database: " << db.info() << "\n";
+    std::cout << "Press Ctrl+C to stop.\n\n";
+    std::cout.flush();
+
+    server.run_until_stopped();
+    server.stop();
+
+    std::signal(SIGINT, old_handler);
+#ifdef _WIN32
+    std::signal(SIGBREAK, old_break);
+#else
+    std::signal(SIGTERM, old_term);
+#endif
+    std::cout << "\nIPC server stopped.\n";
+    return 0;
+}
+
 
 // ============================================================================
 // Main
@@ -651,15 +712,21 @@ static void print_usage() {
               << "  -s <file>            IDA database (.idb/.i64) OR raw binary (.exe/.dll/firmware/etc.)\n"
               << "                       — raw binaries trigger fresh idalib analysis and string-list rebuild\n"
               << "                       — legacy 32-bit .idb files upgrade to .i64 and require an explicit reopen\n"
-              << "  --token <token>      Auth token for HTTP/MCP server mode (if server requires it)\n"
+              << "  --token <token>      Auth token for HTTP/MCP/IPC server mode (if server requires it)\n"
               << "  -q <sql>             Execute SQL query or semicolon-separated script\n"
               << "  -f <file>            Execute SQL from file\n"
               << "  -i                   Interactive REPL mode\n"
               << "  -w, --write          Save database on exit (persist changes)\n"
               << "  --export <file>      Export tables to SQL file (local mode only)\n"
               << "  --export-tables=X    Tables to export: * (all, default) or table1,table2,...\n"
+              << "  --export-format=F    sql (default) or columnar (typed binary columns;\n"
+              << "                       * = the core snapshot tables)\n"
               << "  --http [port]        Start HTTP REST server (default: 8080, local mode only)\n"
               << "  --bind <addr>        Bind address for HTTP/MCP server (default: 127.0.0.1)\n"
+#ifndef _WIN32
+              << "  --ipc <path>         Serve local clients on a Unix-domain socket; results\n"
+              << "                       come back in a shared-memory ring (see README)\n"
+#endif
 #ifdef IDASQL_HAS_MCP
               << "  --mcp [port]         Start MCP server (default: random port, use in -i mode)\n"
               << "                       Or use .mcp start in interactive mode\n"
@@ -672,6 +739,7 @@ static void print_usage() {
               << "  idasql -s test.i64 -i\n"
               << "  idasql -s test.i64 --export dump.sql\n"
               << "  idasql -s test.i64 --http 8080\n"
+              << "  idasql -s test.i64 --ipc /tmp/idasql.sock --token secret\n"
               << "  idasql -s sample.exe --http            # raw PE: idalib auto-analyzes, then serves SQL (default port 8080)\n"
               << "  idasql -s firmware.bin -q \"SELECT * FROM welcome\"\n"
 #ifdef IDASQL_HAS_MCP
@@ -704,12 +772,14 @@ int main(int argc, char* argv[]) {
     std::string sql_file;
     std::string export_file;
     std::string export_tables = "*";  // Default: all tables
+    idasql::ExportFormat export_format = idasql::ExportFormat::Sql;
     std::string auth_token;           // --token for HTTP/MCP mode
     std::string bind_addr;            // --bind for HTTP/MCP mode
     bool interactive = false;
     bool write_mode = false;          // -w/--write to save on exit
     bool http_mode = false;
     int http_port = 8080;
+    std::string ipc_path;             // --ipc socket path
     bool mcp_mode = false;
     int mcp_port = 0;                 // 0 = random port
 
@@ -731,6 +801,14 @@ int main(int argc, char* argv[]) {
             export_file = argv[++i];
         } else if (strncmp(argv[i], "--export-tables=", 16) == 0) {
             export_tables = argv[i] + 16;
+        } else if (strncmp(argv[i], "--export-format=", 16) == 0) {
+            const std::string format = argv[i] + 16;
+            if (format == "columnar") {
+                export_format = idasql::ExportFormat::Columnar;
+            } else if (format != "sql") {
+                std::cerr << "Error: Unknown export format: " << format << "\n";
+                return 1;
+            }
         } else if (strcmp(argv[i], "--http") == 0) {
             http_mode = true;
             if (i + 1 < argc && argv[i + 1][0] != '-') {
@@ -747,6 +825,8 @@ int main(int argc, char* argv[]) {
             std::cerr << "Error: MCP mode not available. Rebuild with -DIDASQL_WITH_MCP=ON\n";
             return 1;
 #endif
+        } else if (strcmp(argv[i], "--ipc") == 0 && i + 1 < argc) {
+            ipc_path = argv[++i];
         } else if (strcmp(argv[i], "--bind") == 0 && i + 1 < argc) {
             bind_addr = argv[++i];
         } else if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0) {
@@ -766,9 +846,9 @@ int main(int argc, char* argv[]) {
         return 1;
     }
 
-    bool has_action = !query.empty() || !sql_file.empty() || interactive || !export_file.empty() || http_mode || mcp_mode;
+    bool has_action = !query.empty() || !sql_file.empty() || interactive || !export_file.empty() || http_mode || !ipc_path.empty() || mcp_mode;
     if (!has_action) {
-        std::cerr << "Error: Specify -q, -f, -i, --export, --http";
+        std::cerr << "Error: Specify -q, -f, -i, --export, --http, --ipc";
 #ifdef IDASQL_HAS_MCP
         std::cerr << ", or --mcp";
 #endif
@@ -829,17 +909,33 @@ int main(int argc, char* argv[]) {
         return http_result;
     }
 
+    // IPC server mode
+    if (!ipc_path.empty()) {
+        int ipc_result = run_ipc_mode(db, ipc_path, auth_token);
+        save_if_requested();
+        db.close();
+        return ipc_result;
+    }
+
     // MCP server mode (standalone, not interactive REPL)
 #ifdef IDASQL_HAS_MCP
     if (mcp_mode) {
         // SQL executor - will be called on main thread via wait()
-        idasql::QueryCallback sql_cb = [&db](const std::string& sql) -> std::string {
-            auto result = idasql::run_sql_script(db, sql);
-            return xsql::script_result_to_text(result);
+        idasql::QueryCallback sql_cb = [&db](const std::string& sql,
+                                             const idasql::QueryParams& params) -> std::string {
+            auto script = idasql::run_typed_script(sql, params,
+                [&db](const std::string& stmt, const idasql::QueryParams& p) {
+                    return db.query(stmt, p);
+                });
+            return idasql::format_typed_script_json(script);
         };
 
         // Create and start MCP server with use_queue=true
         idasql::IDAMCPServer mcp_server;
+        mcp_server.set_cursor_executor(
+            [&db](const std::string& sql, const idasql::QueryParams& params) {
+                return db.open_cursor(sql, params);
+            });
         int port = mcp_server.start(mcp_port, sql_cb,
                                     bind_addr.empty() ? "127.0.0.1" : bind_addr, true);
         if (port <= 0) {
@@ -886,7 +982,7 @@ int main(int argc, char* argv[]) {
     // Execute based on mode
     if (!export_file.empty()) {
         // Export mode
-        if (!export_to_sql(db, export_file.c_str(), export_tables)) {
+        if (!export_to_sql(db, export_file.c_str(), export_tables, export_format)) {
             result = 1;
         }
     } else if (!query.empty()) {
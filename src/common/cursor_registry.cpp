@@ -0,0 +1,199 @@
+// Copyright (c) 2024-2026 Elias Bachaalany
+// SPDX-License-Identifier: MPL-2.0
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#include "cursor_registry.hpp"
+#include "json_utils.hpp"
+
+#include <idasql/runtime_settings.hpp>
+
+#include <algorithm>
+#include <cstdio>
+
+namespace idasql {
+
+CursorRegistry::CursorRegistry() : rng_(std::random_device{}()) {}
+
+CursorRegistry::~CursorRegistry() {
+    clear();
+}
+
+bool CursorRegistry::fill_page(Entry& entry, size_t page_size, CursorPage& page) {
+    entry.cursor.restart_timeout();
+    const bool more = collect_cursor_page(entry.cursor, page.result, page_size, entry.position);
+    page.statement_index = entry.position.statement_index;
+    page.offset = entry.position.offset;
+    return more;
+}
+
+CursorPage CursorRegistry::open(QueryCursor cursor, const std::string& client, size_t page_size) {
+    std::vector<QueryCursor> closed;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        expire_idle(closed);
+    }
+
+    Entry entry;
+    entry.cursor = std::move(cursor);
+    entry.client = client;
+    entry.page_size = page_size;
+
+    CursorPage page;
+    const bool more = fill_page(entry, page_size, page);
+    if (!more) {
+        return page;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (runtime_settings().max_cursors() == 0) {
+            page.result.warnings.push_back(
+                "More rows remain but server-side cursors are disabled "
+                "(PRAGMA idasql.max_cursors = 0)");
+            closed.push_back(std::move(entry.cursor));
+        } else {
+            evict_for(client, closed);
+            page.cursor_id = make_id();
+            entry.last_used = clock::now();
+            cursors_.emplace(page.cursor_id, std::move(entry));
+        }
+    }
+    return page;
+}
+
+bool CursorRegistry::next(const std::string& id, const std::string& client, size_t page_size,
+                          CursorPage& page, std::string& error) {
+    Entry entry;
+    std::vector<QueryCursor> closed;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        expire_idle(closed);
+        auto it = cursors_.find(id);
+        if (it == cursors_.end() || it->second.client != client) {
+            error = "Unknown or expired cursor: " + id;
+            return false;
+        }
+        // Stepped outside the lock; a cursor is only ever used by one call.
+        entry = std::move(it->second);
+        cursors_.erase(it);
+    }
+
+    const bool more = fill_page(entry, page_size != 0 ? page_size : entry.page_size, page);
+    if (more) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        page.cursor_id = id;
+        entry.last_used = clock::now();
+        cursors_.emplace(id, std::move(entry));
+    }
+    return true;
+}
+
+bool CursorRegistry::close(const std::string& id, const std::string& client) {
+    QueryCursor cursor;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = cursors_.find(id);
+        if (it == cursors_.end() || it->second.client != client) {
+            return false;
+        }
+        cursor = std::move(it->second.cursor);
+        cursors_.erase(it);
+    }
+    return true;
+}
+
+void CursorRegistry::clear() {
+    std::map<std::string, Entry> closed;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::swap(closed, cursors_);
+    }
+}
+
+size_t CursorRegistry::size() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return cursors_.size();
+}
+
+void CursorRegistry::expire_idle(std::vector<QueryCursor>& out) {
+    const auto idle = std::chrono::milliseconds(runtime_settings().cursor_idle_ms());
+    const auto now = clock::now();
+    for (auto it = cursors_.begin(); it != cursors_.end();) {
+        if (now - it->second.last_used >= idle) {
+            out.push_back(std::move(it->second.cursor));
+            it = cursors_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+// Make room for one more cursor of client: close its least recently used.
+void CursorRegistry::evict_for(const std::string& client, std::vector<QueryCursor>& out) {
+    const size_t limit = runtime_settings().max_cursors();
+    for (;;) {
+        size_t owned = 0;
+        auto oldest = cursors_.end();
+        for (auto it = cursors_.begin(); it != cursors_.end(); ++it) {
+            if (it->second.client != client) continue;
+            ++owned;
+            if (oldest == cursors_.end() || it->second.last_used < oldest->second.last_used) {
+                oldest = it;
+            }
+        }
+        if (owned < limit || oldest == cursors_.end()) {
+            return;
+        }
+        out.push_back(std::move(oldest->second.cursor));
+        cursors_.erase(oldest);
+    }
+}
+
+std::string CursorRegistry::make_id() {
+    for (;;) {
+        char id[33];
+        std::snprintf(id, sizeof(id), "%016llx%016llx",
+                      static_cast<unsigned long long>(rng_()),
+                      static_cast<unsigned long long>(rng_()));
+        if (cursors_.find(id) == cursors_.end()) {
+            return id;
+        }
+    }
+}
+
+std::string cursor_page_to_json(const CursorPage& page) {
+    const QueryResult& r = page.result;
+    std::string out;
+    out.reserve(256);
+    out += "{\"success\":";
+    out += r.success ? "true" : "false";
+    out += ",\"statement_index\":";
+    out += std::to_string(page.statement_index);
+    out.push_back(',');
+    append_query_result_json_payload(out, r);
+    if (r.elapsed_ms <= 0) {
+        out += ",\"elapsed_ms\":0";
+    }
+    out += ",\"offset\":";
+    out += std::to_string(page.offset);
+    out += ",\"cursor_id\":";
+    if (page.cursor_id.empty()) {
+        out += "null";
+    } else {
+        append_json_string(out, page.cursor_id);
+    }
+    out += ",\"error\":";
+    if (r.success) {
+        out += "null";
+    } else {
+        append_json_string(out, r.error);
+    }
+    out.push_back('}');
+    if (tracing()) flush_trace();  // serialization runs after the query spans
+    return out;
+}
+
+} // namespace idasql
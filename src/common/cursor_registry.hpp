@@ -0,0 +1,123 @@
+// Copyright (c) 2024-2026 Elias Bachaalany
+// SPDX-License-Identifier: MPL-2.0
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#pragma once
+
+/**
+ * cursor_registry.hpp - Server-side query cursors for paged results
+ *
+ * HTTP /query?page_size=N and MCP idasql_query's page_size return the
+ * first N rows and, while more remain, a cursor id. The next page
+ * (/cursor/{id}/next, MCP idasql_cursor) continues the same prepared
+ * statement where it stopped instead of re-running the query with an
+ * OFFSET, so generator tables (bytes, ctree, ...) keep their position and
+ * nothing before the page is recomputed.
+ *
+ * An open cursor holds a live statement on the engine's connection, so
+ * each client may keep PRAGMA idasql.max_cursors of them (opening another
+ * closes its least recently used one) and cursors idle for longer than
+ * PRAGMA idasql.cursor_idle_ms are closed by the next cursor call. Every
+ * page gets the full PRAGMA idasql.query_timeout_ms.
+ *
+ * open/next/close/clear step or finalize statements, so they must run
+ * where queries run (the IDA thread); size() may be called from any thread.
+ */
+
+#include <idasql/query_cursor.hpp>
+#include <idasql/query_result.hpp>
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace idasql {
+
+// Opens a cursor over one SQL text (QueryEngine::open_cursor); called
+// through the CursorRunner.
+using CursorOpener =
+    std::function<QueryCursor(const std::string& sql, const QueryParams& params)>;
+
+// Runs work where cursors may be stepped and returns when it is done.
+// Empty when the caller already runs there (CLI queue mode).
+using CursorRunner = std::function<void(const std::function<void()>& work)>;
+
+struct CursorPage {
+    QueryResult result;          // this page's rows (one statement)
+    size_t statement_index = 0;  // statement the rows belong to
+    uint64_t offset = 0;         // rows of that statement before this page
+    std::string cursor_id;       // set while more rows remain
+};
+
+class CursorRegistry {
+public:
+    CursorRegistry();
+    ~CursorRegistry();
+
+    CursorRegistry(const CursorRegistry&) = delete;
+    CursorRegistry& operator=(const CursorRegistry&) = delete;
+
+    /**
+     * Take the first page of cursor. The cursor is kept (and its id set on
+     * the page) only when more rows remain.
+     */
+    CursorPage open(QueryCursor cursor, const std::string& client, size_t page_size);
+
+    /**
+     * Next page of an open cursor. page_size 0 keeps the size it was
+     * opened with. False with error for unknown, expired or other
+     * clients' cursors.
+     */
+    bool next(const std::string& id, const std::string& client, size_t page_size,
+              CursorPage& page, std::string& error);
+
+    /** Close a cursor early. False if client has no cursor id. */
+    bool close(const std::string& id, const std::string& client);
+
+    /** Close every cursor (server stop). */
+    void clear();
+
+    /** Open cursors, all clients. */
+    size_t size() const;
+
+private:
+    using clock = std::chrono::steady_clock;
+
+    struct Entry {
+        QueryCursor cursor;
+        std::string client;
+        size_t page_size = 0;
+        CursorPagePosition position;
+        clock::time_point last_used;
+    };
+
+    // Fill page from entry; returns true while entry has more rows.
+    static bool fill_page(Entry& entry, size_t page_size, CursorPage& page);
+
+    // Callers hold mutex_. Closed cursors are moved to out, so statements
+    // are finalized after the lock is released.
+    void expire_idle(std::vector<QueryCursor>& out);
+    void evict_for(const std::string& client, std::vector<QueryCursor>& out);
+    std::string make_id();
+
+    mutable std::mutex mutex_;
+    std::map<std::string, Entry> cursors_;
+    std::mt19937_64 rng_;
+};
+
+/**
+ * {"success", "statement_index", "columns", "rows", "row_count", "offset",
+ *  "elapsed_ms", "cursor_id" (null when exhausted), "error"}
+ */
+std::string cursor_page_to_json(const CursorPage& page);
+
+} // namespace idasql
@@ -0,0 +1,293 @@
+// Copyright (c) 2024-2026 Elias Bachaalany
+// SPDX-License-Identifier: MPL-2.0
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#pragma once
+
+/**
+ * fair_queue.hpp - Request classes and fair ordering of the IDA-thread queue
+ *
+ * In queue mode the HTTP, MCP and IPC servers hand every command to the one IDA
+ * thread. Served in arrival order, a batch client with hundreds of heavy
+ * queries outstanding sits in front of an analyst's one-row lookup.
+ * FairQueue orders pending commands instead:
+ *
+ * - Each request has a class (interactive, batch or background: HTTP
+ *   X-IDASQL-Priority header or ?priority=, MCP and IPC "priority";
+ *   interactive by default) and a client (HTTP X-IDASQL-Client or the
+ *   peer address, MCP "client" argument, IPC connection or hello "client").
+ * - Every (class, client) pair is a flow. Flows are served by start-time
+ *   fair queuing weighted by class (kClassWeights) and charged with the
+ *   time each command held the IDA thread, so a client running 2 s scans
+ *   falls behind one running 20 ms lookups. An idle flow keeps no credit,
+ *   and a class that is waiting alone gets every slot.
+ * - A client whose interactive command ran longer than
+ *   PRAGMA idasql.demote_after_ms is queued as batch until one of its
+ *   commands finishes within that time again.
+ * - Batch and background together hold at most three quarters of
+ *   PRAGMA idasql.max_queue, leaving room for interactive requests.
+ *
+ * Not thread-safe: servers call it under their queue mutex.
+ */
+
+#include <algorithm>
+#include <cctype>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace idasql {
+
+enum class RequestClass {
+    Interactive = 0,
+    Batch = 1,
+    Background = 2
+};
+
+constexpr size_t kRequestClassCount = 3;
+
+// Relative share of the IDA thread when every class is waiting.
+constexpr double kClassWeights[kRequestClassCount] = {16.0, 4.0, 1.0};
+
+// Charged when a command is taken, until its real time is known; also the
+// least any command costs.
+constexpr double kNominalCostMs = 1.0;
+
+inline const char* request_class_name(RequestClass request_class) {
+    switch (request_class) {
+        case RequestClass::Batch: return "batch";
+        case RequestClass::Background: return "background";
+        default: return "interactive";
+    }
+}
+
+// "interactive", "batch" or "background", any case.
+inline bool parse_request_class(std::string_view text, RequestClass& out) {
+    std::string name(text);
+    for (char& c : name) {
+        c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    }
+    if (name == "interactive") {
+        out = RequestClass::Interactive;
+    } else if (name == "batch") {
+        out = RequestClass::Batch;
+    } else if (name == "background") {
+        out = RequestClass::Background;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+struct RequestTag {
+    RequestClass request_class = RequestClass::Interactive;
+    std::string client;
+};
+
+// Single-flight key that only shares runs within one class (empty stays
+// empty): an interactive caller must not wait on a run still in the batch queue.
+inline std::string class_scoped_key(const std::string& key, RequestClass request_class) {
+    if (key.empty()) {
+        return key;
+    }
+    return key + '\0' + request_class_name(request_class);
+}
+
+// Where a dequeued command came from; hand it back to FairQueue::charge().
+struct QueueTicket {
+    std::string client;
+    RequestClass requested = RequestClass::Interactive;
+    RequestClass queued_as = RequestClass::Interactive;
+    double start = 0.0;
+};
+
+struct FairQueueStats {
+    size_t depth[kRequestClassCount] = {};
+    size_t demoted_clients = 0;
+    uint64_t demotions = 0;
+};
+
+template <typename T>
+class FairQueue {
+public:
+    using Item = std::shared_ptr<T>;
+
+    /**
+     * Queue item for tag. False when max_queue (0 = unbounded) has no room
+     * for its class.
+     */
+    bool push(Item item, const RequestTag& tag, size_t max_queue) {
+        RequestClass queued_as = tag.request_class;
+        if (queued_as == RequestClass::Interactive && demoted_.count(tag.client) != 0) {
+            queued_as = RequestClass::Batch;
+        }
+        if (max_queue > 0) {
+            if (size_ >= max_queue) {
+                return false;
+            }
+            const size_t deferrable = depth_[static_cast<size_t>(RequestClass::Batch)] +
+                                      depth_[static_cast<size_t>(RequestClass::Background)];
+            if (queued_as != RequestClass::Interactive && deferrable >= max_queue - max_queue / 4) {
+                return false;
+            }
+        }
+        Flow& flow = flows_[flow_key(queued_as, tag.client)];
+        flow.client = tag.client;
+        flow.queued_as = queued_as;
+        flow.items.push_back(Entry{std::move(item), next_seq_++, tag.request_class});
+        ++size_;
+        ++depth_[static_cast<size_t>(queued_as)];
+        return true;
+    }
+
+    /**
+     * Next command in weighted fair order, or nullptr. Ties go to the
+     * higher class, then to the earlier arrival.
+     */
+    Item pop(QueueTicket& ticket) {
+        Flow* best = nullptr;
+        double best_start = 0.0;
+        for (auto it = flows_.begin(); it != flows_.end();) {
+            Flow& flow = it->second;
+            if (flow.items.empty()) {
+                // Nothing queued and no charge ahead of the clock: forget it.
+                it = flow.finish <= vtime_ ? flows_.erase(it) : std::next(it);
+                continue;
+            }
+            const double start = std::max(vtime_, flow.finish);
+            if (!best || start < best_start ||
+                (start == best_start &&
+                 (flow.queued_as < best->queued_as ||
+                  (flow.queued_as == best->queued_as &&
+                   flow.items.front().seq < best->items.front().seq)))) {
+                best = &flow;
+                best_start = start;
+            }
+            ++it;
+        }
+        if (!best) {
+            return nullptr;
+        }
+
+        Entry entry = std::move(best->items.front());
+        best->items.pop_front();
+        --size_;
+        --depth_[static_cast<size_t>(best->queued_as)];
+        vtime_ = best_start;
+        best->finish = best_start + kNominalCostMs / weight(best->queued_as);
+        ticket.client = best->client;
+        ticket.requested = entry.requested;
+        ticket.queued_as = best->queued_as;
+        ticket.start = best_start;
+        return std::move(entry.item);
+    }
+
+    // Withdraw a command that has not been taken. False if it is not queued.
+    bool remove(const Item& item) {
+        for (auto& [key, flow] : flows_) {
+            auto it = std::find_if(flow.items.begin(), flow.items.end(),
+                                   [&](const Entry& entry) { return entry.item == item; });
+            if (it != flow.items.end()) {
+                --depth_[static_cast<size_t>(flow.queued_as)];
+                --size_;
+                flow.items.erase(it);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /**
+     * Charge the IDA-thread time of a command taken with ticket to its flow
+     * and update its client's demotion (demote_after_ms 0 = never demote).
+     */
+    void charge(const QueueTicket& ticket, double elapsed_ms, int demote_after_ms) {
+        Flow& flow = flows_[flow_key(ticket.queued_as, ticket.client)];
+        flow.client = ticket.client;
+        flow.queued_as = ticket.queued_as;
+        flow.finish = std::max(flow.finish, ticket.start +
+                               std::max(elapsed_ms, kNominalCostMs) / weight(ticket.queued_as));
+
+        if (demote_after_ms <= 0) {
+            demoted_.clear();
+        } else if (ticket.requested == RequestClass::Interactive) {
+            if (elapsed_ms > demote_after_ms) {
+                if (demoted_.insert(ticket.client).second) {
+                    ++demotions_;
+                }
+            } else {
+                demoted_.erase(ticket.client);
+            }
+        }
+    }
+
+    // Remove and return every queued command (server stop).
+    std::vector<Item> drain() {
+        std::vector<Item> out;
+        out.reserve(size_);
+        for (auto& [key, flow] : flows_) {
+            for (Entry& entry : flow.items) {
+                out.push_back(std::move(entry.item));
+            }
+        }
+        flows_.clear();
+        size_ = 0;
+        std::fill(std::begin(depth_), std::end(depth_), size_t{0});
+        return out;
+    }
+
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+
+    FairQueueStats stats() const {
+        FairQueueStats out;
+        std::copy(std::begin(depth_), std::end(depth_), std::begin(out.depth));
+        out.demoted_clients = demoted_.size();
+        out.demotions = demotions_;
+        return out;
+    }
+
+private:
+    struct Entry {
+        Item item;
+        uint64_t seq = 0;
+        RequestClass requested = RequestClass::Interactive;
+    };
+
+    struct Flow {
+        std::string client;
+        RequestClass queued_as = RequestClass::Interactive;
+        std::deque<Entry> items;
+        double finish = 0.0;  // virtual time this flow has been charged up to
+    };
+
+    static double weight(RequestClass request_class) {
+        return kClassWeights[static_cast<size_t>(request_class)];
+    }
+
+    static std::string flow_key(RequestClass request_class, const std::string& client) {
+        std::string key(1, static_cast<char>('0' + static_cast<int>(request_class)));
+        key.push_back('\0');
+        key += client;
+        return key;
+    }
+
+    std::map<std::string, Flow> flows_;
+    std::set<std::string> demoted_;
+    double vtime_ = 0.0;
+    uint64_t next_seq_ = 0;
+    size_t size_ = 0;
+    size_t depth_[kRequestClassCount] = {};
+    uint64_t demotions_ = 0;
+};
+
+} // namespace idasql
@@ -0,0 +1,248 @@
+// Copyright (c) 2024-2026 Elias Bachaalany
+// SPDX-License-Identifier: MPL-2.0
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#include "http_compression.hpp"
+
+#include <cctype>
+#include <cstdlib>
+
+#ifdef IDASQL_HAS_ZLIB
+#include <zlib.h>
+#endif
+#ifdef IDASQL_HAS_ZSTD
+#include <zstd.h>
+#endif
+
+namespace idasql {
+
+namespace {
+
+// zlib level 6 / zstd level 3: the codecs' defaults, well under link speed.
+#ifdef IDASQL_HAS_ZLIB
+constexpr int kGzipLevel = 6;
+#endif
+#ifdef IDASQL_HAS_ZSTD
+constexpr int kZstdLevel = 3;
+#endif
+
+constexpr size_t kOutChunk = 64 * 1024;
+
+std::string_view trim(std::string_view text) {
+    while (!text.empty() && std::isspace(static_cast<unsigned char>(text.front()))) {
+        text.remove_prefix(1);
+    }
+    while (!text.empty() && std::isspace(static_cast<unsigned char>(text.back()))) {
+        text.remove_suffix(1);
+    }
+    return text;
+}
+
+bool iequals(std::string_view a, std::string_view b) {
+    if (a.size() != b.size()) return false;
+    for (size_t i = 0; i < a.size(); ++i) {
+        if (std::tolower(static_cast<unsigned char>(a[i])) !=
+            std::tolower(static_cast<unsigned char>(b[i]))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+ContentEncoding negotiate_encoding(std::string_view accept_encoding) {
+    double gzip_q = 0.0;
+    double zstd_q = 0.0;
+    double any_q = 0.0;
+    bool gzip_listed = false;
+    bool zstd_listed = false;
+    while (!accept_encoding.empty()) {
+        const size_t comma = accept_encoding.find(',');
+        std::string_view item = accept_encoding.substr(0, comma);
+        accept_encoding = comma == std::string_view::npos
+            ? std::string_view() : accept_encoding.substr(comma + 1);
+
+        double q = 1.0;
+        const size_t semi = item.find(';');
+        if (semi != std::string_view::npos) {
+            std::string_view param = trim(item.substr(semi + 1));
+            if (param.size() > 2 && (param[0] == 'q' || param[0] == 'Q') && param[1] == '=') {
+                q = std::strtod(std::string(param.substr(2)).c_str(), nullptr);
+            }
+            item = item.substr(0, semi);
+        }
+        item = trim(item);
+        if (iequals(item, "gzip") || iequals(item, "x-gzip")) {
+            gzip_q = q;
+            gzip_listed = true;
+        } else if (iequals(item, "zstd")) {
+            zstd_q = q;
+            zstd_listed = true;
+        } else if (item == "*") {
+            any_q = q;
+        }
+    }
+    // "*" covers codings not listed by name.
+    if (!gzip_listed) gzip_q = any_q;
+    if (!zstd_listed) zstd_q = any_q;
+
+#ifndef IDASQL_HAS_ZLIB
+    gzip_q = 0.0;
+#endif
+#ifndef IDASQL_HAS_ZSTD
+    zstd_q = 0.0;
+#endif
+    if (zstd_q > 0.0 && zstd_q >= gzip_q) return ContentEncoding::Zstd;
+    if (gzip_q > 0.0) return ContentEncoding::Gzip;
+    return ContentEncoding::Identity;
+}
+
+const char* content_encoding_name(ContentEncoding encoding) {
+    switch (encoding) {
+        case ContentEncoding::Gzip: return "gzip";
+        case ContentEncoding::Zstd: return "zstd";
+        default: return "";
+    }
+}
+
+bool compress_body(ContentEncoding encoding, std::string_view body, std::string& out) {
+    out.clear();
+    StreamCompressor compressor(encoding);
+    return compressor.write(body, false, out) && compressor.finish(out);
+}
+
+// ============================================================================
+// StreamCompressor
+// ============================================================================
+
+struct StreamCompressor::Impl {
+    ContentEncoding encoding = ContentEncoding::Identity;
+    bool ok = false;
+#ifdef IDASQL_HAS_ZLIB
+    z_stream zs{};
+#endif
+#ifdef IDASQL_HAS_ZSTD
+    ZSTD_CCtx* zctx = nullptr;
+#endif
+
+#ifdef IDASQL_HAS_ZLIB
+    bool deflate_some(std::string_view data, int mode, std::string& out) {
+        zs.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+        zs.avail_in = static_cast<uInt>(data.size());
+        char buffer[kOutChunk];
+        for (;;) {
+            zs.next_out = reinterpret_cast<Bytef*>(buffer);
+            zs.avail_out = sizeof(buffer);
+            const int rc = deflate(&zs, mode);
+            if (rc == Z_STREAM_ERROR) {
+                return false;
+            }
+            out.append(buffer, sizeof(buffer) - zs.avail_out);
+            if (mode == Z_FINISH ? rc == Z_STREAM_END : (zs.avail_in == 0 && zs.avail_out != 0)) {
+                return true;
+            }
+        }
+    }
+#endif
+
+#ifdef IDASQL_HAS_ZSTD
+    bool zstd_some(std::string_view data, ZSTD_EndDirective mode, std::string& out) {
+        ZSTD_inBuffer in{data.data(), data.size(), 0};
+        char buffer[kOutChunk];
+        for (;;) {
+            ZSTD_outBuffer chunk{buffer, sizeof(buffer), 0};
+            const size_t remaining = ZSTD_compressStream2(zctx, &chunk, &in, mode);
+            if (ZSTD_isError(remaining)) {
+                return false;
+            }
+            out.append(buffer, chunk.pos);
+            const bool drained = mode == ZSTD_e_continue ? in.pos == in.size : remaining == 0;
+            if (drained) {
+                return true;
+            }
+        }
+    }
+#endif
+};
+
+StreamCompressor::StreamCompressor(ContentEncoding encoding) : impl_(std::make_unique<Impl>()) {
+    impl_->encoding = encoding;
+    switch (encoding) {
+#ifdef IDASQL_HAS_ZLIB
+        case ContentEncoding::Gzip:
+            // windowBits 15 + 16: gzip header and trailer.
+            impl_->ok = deflateInit2(&impl_->zs, kGzipLevel, Z_DEFLATED, 15 + 16, 8,
+                                     Z_DEFAULT_STRATEGY) == Z_OK;
+            break;
+#endif
+#ifdef IDASQL_HAS_ZSTD
+        case ContentEncoding::Zstd:
+            impl_->zctx = ZSTD_createCCtx();
+            impl_->ok = impl_->zctx != nullptr &&
+                !ZSTD_isError(ZSTD_CCtx_setParameter(impl_->zctx, ZSTD_c_compressionLevel,
+                                                     kZstdLevel));
+            break;
+#endif
+        case ContentEncoding::Identity:
+            impl_->ok = true;
+            break;
+        default:
+            break;
+    }
+}
+
+StreamCompressor::~StreamCompressor() {
+#ifdef IDASQL_HAS_ZLIB
+    if (impl_->encoding == ContentEncoding::Gzip && impl_->ok) {
+        deflateEnd(&impl_->zs);
+    }
+#endif
+#ifdef IDASQL_HAS_ZSTD
+    if (impl_->zctx) {
+        ZSTD_freeCCtx(impl_->zctx);
+    }
+#endif
+}
+
+bool StreamCompressor::write(std::string_view data, [[maybe_unused]] bool flush, std::string& out) {
+    if (!impl_->ok) {
+        return false;
+    }
+    switch (impl_->encoding) {
+#ifdef IDASQL_HAS_ZLIB
+        case ContentEncoding::Gzip:
+            return impl_->deflate_some(data, flush ? Z_SYNC_FLUSH : Z_NO_FLUSH, out);
+#endif
+#ifdef IDASQL_HAS_ZSTD
+        case ContentEncoding::Zstd:
+            return impl_->zstd_some(data, flush ? ZSTD_e_flush : ZSTD_e_continue, out);
+#endif
+        default:
+            out.append(data.data(), data.size());
+            return true;
+    }
+}
+
+bool StreamCompressor::finish([[maybe_unused]] std::string& out) {
+    if (!impl_->ok) {
+        return false;
+    }
+    switch (impl_->encoding) {
+#ifdef IDASQL_HAS_ZLIB
+        case ContentEncoding::Gzip:
+            return impl_->deflate_some({}, Z_FINISH, out);
+#endif
+#ifdef IDASQL_HAS_ZSTD
+        case ContentEncoding::Zstd:
+            return impl_->zstd_some({}, ZSTD_e_end, out);
+#endif
+        default:
+            return true;
+    }
+}
+
+} // namespace idasql
@@ -0,0 +1,72 @@
+// Copyright (c) 2024-2026 Elias Bachaalany
+// SPDX-License-Identifier: MPL-2.0
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#pragma once
+
+/**
+ * http_compression.hpp - Negotiated gzip/zstd response bodies
+ *
+ * Pseudocode, disassembly and JSON envelopes compress 5-10x, which matters
+ * for servers bound to 0.0.0.0 and used over slow links. The codecs are
+ * optional at build time (IDASQL_HAS_ZLIB, IDASQL_HAS_ZSTD); without them
+ * negotiate_encoding() always picks identity.
+ *
+ * Buffered bodies smaller than kMinCompressBytes are sent as is. Streamed
+ * bodies go through StreamCompressor, flushed at every chunk so the client
+ * can decode rows as they arrive.
+ */
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <string_view>
+
+namespace idasql {
+
+enum class ContentEncoding {
+    Identity,
+    Gzip,
+    Zstd
+};
+
+// Smaller buffered bodies are not worth a compressor (about one packet).
+constexpr size_t kMinCompressBytes = 1024;
+
+/**
+ * Best built-in encoding the client accepts (Accept-Encoding, q-values
+ * honoured; zstd wins ties).
+ */
+ContentEncoding negotiate_encoding(std::string_view accept_encoding);
+
+// Content-Encoding header value ("gzip", "zstd"; "" for identity).
+const char* content_encoding_name(ContentEncoding encoding);
+
+// Whole body in one go; false leaves out unspecified.
+bool compress_body(ContentEncoding encoding, std::string_view body, std::string& out);
+
+/**
+ * Incremental compressor for chunked responses. write() appends whatever
+ * compressed output is ready to out; with flush, everything written so
+ * far becomes decodable. finish() ends the stream.
+ */
+class StreamCompressor {
+public:
+    explicit StreamCompressor(ContentEncoding encoding);
+    ~StreamCompressor();
+
+    StreamCompressor(const StreamCompressor&) = delete;
+    StreamCompressor& operator=(const StreamCompressor&) = delete;
+
+    bool write(std::string_view data, bool flush, std::string& out);
+    bool finish(std::string& out);
+
+private:
+    struct Impl;
+    std::unique_ptr<Impl> impl_;
+};
+
+} // namespace idasql
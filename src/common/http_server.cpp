@@ -6,13 +6,45 @@
 // file, You can obtain one at https://mozilla.org/MPL/2.0/.
 
 #include "http_server.hpp"
+#include "fair_queue.hpp"
+#include "http_compression.hpp"
+#include "server_metrics.hpp"
+#include <idasql/cancel.hpp>
+#include <idasql/change_feed.hpp>
+#include <idasql/result_cache.hpp>
 #include <idasql/runtime_settings.hpp>
+#include <idasql/snapshot.hpp>
+#include "json_utils.hpp"
+#include "sql_script.hpp"
 #include "welcome_query.hpp"
 
+#include <httplib.h>
+#include <xsql/json.hpp>
+#include <xsql/thinclient/clipboard.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <mutex>
+#include <random>
 #include <sstream>
+#include <thread>
 
 namespace idasql {
 
+// /changes subscribers each hold an HTTP worker thread while they wait.
+constexpr int kMaxChangeSubscribers = 4;
+// Longest /changes long-poll wait.
+constexpr int kMaxChangeWaitMs = 60000;
+// Idle SSE streams get a comment line this often, so proxies keep them open.
+constexpr int kChangeKeepaliveMs = 15000;
+
+// stream=1 through a cursor: encoded bytes one dispatch may produce before
+// it hands the slot back and this thread sends them.
+constexpr size_t kStreamSliceBytes = 256 * 1024;
+
 static std::string build_http_help_text() {
     std::ostringstream out;
     out << "IDASQL HTTP REST API\n"
@@ -21,112 +53,1461 @@ static std::string build_http_help_text() {
         << "Endpoints:\n"
         << "  GET  /         - Welcome message\n"
         << "  GET  /help     - This documentation\n"
-        << "  POST /query    - Execute SQL (body = raw SQL, response = JSON)\n"
+        << "  POST /query    - Execute SQL (body = raw SQL or JSON, response = JSON)\n"
+        << "  POST /cursor/{id}/next - Next page of a /query?page_size=N cursor\n"
+        << "  DELETE /cursor/{id}    - Close a cursor early\n"
+        << "  GET  /changes  - Wait for IDB changes (long-poll JSON)\n"
+        << "  GET  /changes/stream - IDB changes as Server-Sent Events\n"
         << "  GET  /status   - Server health check\n"
+        << "  GET  /metrics  - Prometheus metrics (queue, latency, caches, RSS)\n"
         << "  POST /shutdown - Stop server\n\n"
         << "Discover Schema:\n"
         << "  SELECT name, type FROM sqlite_master WHERE type IN ('table','view') ORDER BY type, name;\n"
         << "  PRAGMA table_info(funcs);\n\n"
         << "Starter Query:\n"
         << "  SELECT * FROM welcome;\n\n"
+        << "Parameterized Queries (JSON body):\n"
+        << "  {\"sql\": \"SELECT * FROM pseudocode WHERE func_addr = ?\", \"params\": [4198400]}\n"
+        << "  params bind to ?, ?NNN, :name in order; numbers, strings, booleans, null.\n\n"
         << "Response Format (JSON envelope; single statement = array of one):\n"
         << "  {\"success\": true, \"statement_count\": N, \"results\": [\n"
         << "     {\"statement_index\": 0, \"success\": true, \"columns\": [...], \"rows\": [[...]],\n"
         << "      \"row_count\": N, \"elapsed_ms\": N, \"error\": null}],\n"
-        << "   \"row_count_total\": N, \"elapsed_ms_total\": N, \"first_error_index\": null}\n\n"
+        << "   \"row_count_total\": N, \"elapsed_ms_total\": N, \"first_error_index\": null}\n"
+        << "  Cells keep their SQL type: integers/reals are JSON numbers, NULL is null.\n\n"
         << "Query Options (query string):\n"
         << "  format=json|text|csv|tsv  (default json; text/csv/tsv are for terminal/\n"
-        << "                             pipe use - agents should consume json)\n\n"
+        << "                             pipe use - agents should consume json)\n"
+        << "  format=columnar           Binary typed column buffers, one frame per\n"
+        << "                            statement (int64/double stay binary; layout in\n"
+        << "                            idasql/columnar.hpp and the README)\n"
+        << "  continue_on_error=1       Run remaining statements after a failure\n"
+        << "  include_sql=1             Echo each statement's SQL in the envelope\n"
+        << "  explain=1                 Return the cost estimate instead of running\n"
+        << "                            (rejected when over PRAGMA idasql.max_query_cost)\n"
+        << "  snapshot=1                Read-only query against the snapshot file\n"
+        << "                            (PRAGMA idasql.snapshot), served in parallel\n"
+        << "                            without waiting for the IDA thread\n"
+        << "  stream=1                  Send rows as they are produced (chunked):\n"
+        << "                            format=json gives NDJSON, csv/tsv give rows;\n"
+        << "                            see Streaming below\n"
+        << "  page_size=N               Return the first N rows and a cursor_id while\n"
+        << "                            more remain; see Paging below\n"
+        << "  priority=interactive|batch|background\n"
+        << "                            Scheduling class (also X-IDASQL-Priority);\n"
+        << "                            see Scheduling below\n\n"
+        << "Streaming (stream=1):\n"
+        << "  NDJSON lines: {\"type\":\"columns\",\"statement_index\":i,\"columns\":[...]},\n"
+        << "  then one JSON array per row, then {\"type\":\"statement\",\"statement_index\":i,\n"
+        << "  \"success\",\"columns\",\"row_count\",\"elapsed_ms\",\"error\"} per statement, and a final\n"
+        << "  {\"type\":\"end\",\"success\",\"statement_count\",\"row_count_total\",\n"
+        << "  \"elapsed_ms_total\",\"first_error_index\",\"error\"}. CSV/TSV end with a\n"
+        << "  \"# idasql: success=... row_count_total=... elapsed_ms_total=...\" line.\n"
+        << "  The HTTP status is 200 once streaming starts: check the end record.\n\n"
+        << "Compression:\n"
+        << "  Send Accept-Encoding: zstd or gzip (curl --compressed) to get /query,\n"
+        << "  /cursor and /changes bodies of 1 KiB or more compressed; stream=1 and\n"
+        << "  /changes/stream are compressed incrementally, flushed per chunk/event.\n\n"
+        << "Result Cache (PRAGMA idasql.result_cache_mb = N, default 0 = off):\n"
+        << "  Repeated SELECT/WITH/VALUES texts with the same params and options are\n"
+        << "  answered from memory until the IDB changes (any rename, comment, patch,\n"
+        << "  xref, write statement or PRAGMA idasql.* assignment). Not for stream=1,\n"
+        << "  page_size or snapshot=1. Hits/misses: /status and idasql_stats.\n"
+        << "  Independently of the cache, identical cacheable reads that arrive while\n"
+        << "  one is running wait for it and share its result (queries_coalesced).\n\n"
+        << "Scheduling (queue mode):\n"
+        << "  Queued requests are ordered by class (interactive > batch > background,\n"
+        << "  weighted 16:4:1; default interactive) and, within a class, fairly per\n"
+        << "  client (X-IDASQL-Client header, else the peer address), charged by the\n"
+        << "  time each request held the IDA thread. A client whose interactive request\n"
+        << "  ran over PRAGMA idasql.demote_after_ms (default 5000, 0 = off) is queued as\n"
+        << "  batch until one of its requests finishes within it. Batch and background\n"
+        << "  may fill three quarters of PRAGMA idasql.max_queue.\n\n"
+        << "Paging (page_size=N, format=json):\n"
+        << "  {\"success\", \"statement_index\", \"columns\", \"rows\", \"row_count\",\n"
+        << "   \"offset\", \"elapsed_ms\", \"cursor_id\", \"error\"}. While cursor_id is not\n"
+        << "  null, POST /cursor/<cursor_id>/next[?page_size=N] returns the next page of\n"
+        << "  the same statement (no re-execution). A page holds rows of one statement;\n"
+        << "  offset counts that statement's earlier rows. Cursors idle longer than\n"
+        << "  PRAGMA idasql.cursor_idle_ms are closed; each client keeps at most\n"
+        << "  PRAGMA idasql.max_cursors (the least recently used is closed).\n\n"
+        << "Change Notifications (same feed as the idb_changes table):\n"
+        << "  GET /changes?since=N&timeout_ms=25000&limit=1000\n"
+        << "    Returns as soon as there are changes with seq > N (or at the timeout):\n"
+        << "    {\"success\": true, \"events\": [{\"seq\", \"time_ms\", \"kind\", \"address\",\n"
+        << "      \"func_addr\", \"target\", \"detail\"}], \"last_seq\": N, \"gap\": false,\n"
+        << "     \"coalesced\": N}. Pass last_seq as the next since.\n"
+        << "  GET /changes/stream?since=N  (or Last-Event-ID on reconnect)\n"
+        << "    SSE: \"event: change\" per event (id = seq), \"event: gap\" when events\n"
+        << "    were dropped before they were read. Without since, starts at new changes.\n"
+        << "  Repeated events for the same kind/address/target are coalesced; gap means\n"
+        << "  the subscriber fell more than the ring behind and should rescan.\n\n"
         << "Example:\n"
         << "  curl http://localhost:<port>/help\n"
         << "  " << format_query_curl_example("http://localhost:<port>") << "\n";
     return out.str();
 }
 
-static xsql::thinclient::http_query_server_config make_idasql_config(
-        int port, const std::string& bind_addr, bool use_queue) {
-    xsql::thinclient::http_query_server_config config;
-    config.tool_name = "idasql";
-    config.help_text = build_http_help_text();
-    config.port = port;
-    config.bind_address = bind_addr;
-    config.use_queue = use_queue;
-    config.queue_admission_timeout_ms_fn = []() {
-        return idasql::runtime_settings().queue_admission_timeout_ms();
+static std::string json_error(const std::string& message) {
+    std::string out = "{\"success\":false,\"error\":";
+    append_json_string(out, message);
+    out.push_back('}');
+    return out;
+}
+
+// Encoding for a streamed response; sets Content-Encoding before the
+// chunked provider starts. Vary is set either way (caches must not mix).
+static ContentEncoding begin_encoded_stream(const httplib::Request& req, httplib::Response& res) {
+    res.set_header("Vary", "Accept-Encoding");
+    const ContentEncoding encoding = negotiate_encoding(req.get_header_value("Accept-Encoding"));
+    if (encoding != ContentEncoding::Identity) {
+        res.set_header("Content-Encoding", content_encoding_name(encoding));
+    }
+    return encoding;
+}
+
+// Buffered result body, compressed when the client accepts it and it is at
+// least kMinCompressBytes (errors and small results stay plain).
+static void set_encoded_content(const httplib::Request& req, httplib::Response& res,
+                                std::string body, const char* content_type) {
+    res.set_header("Vary", "Accept-Encoding");
+    if (body.size() >= kMinCompressBytes) {
+        const ContentEncoding encoding = negotiate_encoding(req.get_header_value("Accept-Encoding"));
+        std::string compressed;
+        if (encoding != ContentEncoding::Identity && compress_body(encoding, body, compressed)) {
+            res.set_header("Content-Encoding", content_encoding_name(encoding));
+            body = std::move(compressed);
+        }
+    }
+    res.set_content(std::move(body), content_type);
+}
+
+// Request::is_connection_closed only exists in newer cpp-httplib releases.
+template <typename Req>
+static auto connection_closed(const Req& req, int) -> decltype(req.is_connection_closed(), bool()) {
+    return req.is_connection_closed && req.is_connection_closed();
+}
+
+template <typename Req>
+static bool connection_closed(const Req&, long) {
+    return false;
+}
+
+static bool query_flag(const httplib::Request& req, const char* name) {
+    if (!req.has_param(name)) return false;
+    const std::string value = req.get_param_value(name);
+    return value.empty() || value == "1" || value == "true" || value == "yes";
+}
+
+static bool query_uint(const httplib::Request& req, const char* name, uint64_t& out) {
+    if (!req.has_param(name)) return false;
+    const std::string value = req.get_param_value(name);
+    char* end = nullptr;
+    const unsigned long long parsed = std::strtoull(value.c_str(), &end, 10);
+    if (value.empty() || *end != '\0') return false;
+    out = static_cast<uint64_t>(parsed);
+    return true;
+}
+
+// Scheduling class from ?priority= or X-IDASQL-Priority (the query string
+// wins); client from X-IDASQL-Client, else the peer address.
+static bool request_tag(const httplib::Request& req, RequestTag& tag, std::string& error) {
+    const std::string priority = req.has_param("priority")
+        ? req.get_param_value("priority")
+        : req.get_header_value("X-IDASQL-Priority");
+    if (!priority.empty() && !parse_request_class(priority, tag.request_class)) {
+        error = "priority must be interactive, batch or background";
+        return false;
+    }
+    tag.client = req.has_header("X-IDASQL-Client") ? req.get_header_value("X-IDASQL-Client")
+                                                   : req.remote_addr;
+    return true;
+}
+
+// ============================================================================
+// Command queue (same admission semantics as IDAMCPServer)
+// ============================================================================
+
+struct HTTPPendingCommand {
+    std::function<void()> work;
+    // Installed while work runs; cancelled when the client goes away or the
+    // server stops, so table callbacks stop producing rows.
+    CancelTokenPtr cancel = std::make_shared<CancelToken>();
+    std::chrono::steady_clock::time_point queued_at = std::chrono::steady_clock::now();
+    bool started = false;
+    bool canceled = false;
+    bool completed = false;
+    std::mutex done_mutex;
+    std::condition_variable done_cv;
+};
+
+enum class HTTPDispatch {
+    Ok,
+    QueueFull,
+    TimedOut,
+    Stopped
+};
+
+// 503 for requests that never ran.
+static void set_dispatch_error(httplib::Response& res, HTTPDispatch status) {
+    res.status = 503;
+    switch (status) {
+        case HTTPDispatch::QueueFull:
+            res.set_content(json_error("HTTP queue is full (raise PRAGMA idasql.max_queue)"),
+                            "application/json");
+            break;
+        case HTTPDispatch::TimedOut:
+            res.set_content(json_error("HTTP request timed out in queue "
+                                       "(raise PRAGMA idasql.queue_admission_timeout_ms)"),
+                            "application/json");
+            break;
+        default:
+            res.set_content(json_error("HTTP server stopped"), "application/json");
+            break;
+    }
+}
+
+// /metrics outcome of a request that did not run.
+static RequestStatus dispatch_status(HTTPDispatch status) {
+    return status == HTTPDispatch::Stopped ? RequestStatus::Error : RequestStatus::Rejected;
+}
+
+static RequestStatus script_status(const TypedScriptResult& script) {
+    for (const auto& stmt : script.statements) {
+        if (stmt.result.timed_out) return RequestStatus::Timeout;
+    }
+    return script.success ? RequestStatus::Ok : RequestStatus::Error;
+}
+
+static RequestStatus page_status(const CursorPage& page) {
+    return page.result.timed_out ? RequestStatus::Timeout
+         : page.result.success ? RequestStatus::Ok : RequestStatus::Error;
+}
+
+// Time from arrival and body bytes sent (after compression) of a query
+// request, for /metrics.
+static void observe_http_request(std::chrono::steady_clock::time_point arrived,
+                                 RequestStatus status, const httplib::Response& res) {
+    server_metrics().observe_request(MetricsTransport::Http, status, seconds_since(arrived),
+                                     res.body.size());
+}
+
+// ============================================================================
+// stream=1 output
+// ============================================================================
+
+// Encodes rows as NDJSON (sep == 0) or CSV/TSV and writes them to the chunked
+// response in ~64 KiB pieces, each one flushed through the negotiated
+// compressor. A failed write (client gone) sticks, so row() returning false
+// stops the query. With defer_sends(true), row() and statement() only
+// encode and the owner sends the buffer with send(), so rows can be encoded
+// on the IDA thread and written from the HTTP thread.
+class HTTPStreamWriter {
+public:
+    HTTPStreamWriter(httplib::DataSink& sink, char sep, ContentEncoding encoding)
+        : sink_(sink), sep_(sep), encoding_(encoding), compressor_(encoding) {
+        buffer_.reserve(kFlushBytes + 4096);
+    }
+
+    template <typename Row>
+    bool row(size_t statement_index, const std::vector<std::string>& columns, const Row& row) {
+        if (row.index() == 0) {
+            begin_rows(statement_index, columns);
+        }
+        if (sep_ == 0) {
+            buffer_.push_back('[');
+            for (size_t c = 0; c < row.size(); ++c) {
+                if (c != 0) buffer_.push_back(',');
+                append_json_cell(buffer_, row.cell(c));
+            }
+            buffer_ += "]\n";
+        } else {
+            for (size_t c = 0; c < row.size(); ++c) {
+                if (c != 0) buffer_.push_back(sep_);
+                scratch_.clear();
+                row.cell(c).append_to(scratch_);
+                append_delimited_cell(buffer_, scratch_, sep_);
+            }
+            buffer_.push_back('\n');
+        }
+        return deferred_ || buffer_.size() < kFlushBytes || flush();
+    }
+
+    bool statement(size_t index, const std::string* sql, const StreamSummary& summary) {
+        if (sep_ != 0) {
+            return true;  // reported in the end line
+        }
+        buffer_ += "{\"type\":\"statement\",\"statement_index\":";
+        buffer_ += std::to_string(index);
+        if (sql) {
+            buffer_ += ",\"sql\":";
+            append_json_string(buffer_, *sql);
+        }
+        buffer_ += summary.success ? ",\"success\":true" : ",\"success\":false";
+        buffer_ += ",\"columns\":";
+        append_json_string_array(buffer_, summary.columns);
+        buffer_ += ",\"row_count\":";
+        buffer_ += std::to_string(summary.rows);
+        buffer_ += ",\"elapsed_ms\":";
+        buffer_ += std::to_string(summary.elapsed_ms);
+        if (summary.timed_out) {
+            buffer_ += ",\"timed_out\":true";
+        }
+        buffer_ += ",\"error\":";
+        if (summary.success) {
+            buffer_ += "null";
+        } else {
+            append_json_string(buffer_, summary.error);
+        }
+        buffer_ += "}\n";
+        return deferred_ || buffer_.size() < kFlushBytes || flush();
+    }
+
+    bool end(bool success, size_t statements, size_t rows, long long elapsed_ms,
+             int first_error_index, const std::string& error) {
+        if (sep_ == 0) {
+            buffer_ += success ? "{\"type\":\"end\",\"success\":true" : "{\"type\":\"end\",\"success\":false";
+            buffer_ += ",\"statement_count\":";
+            buffer_ += std::to_string(statements);
+            buffer_ += ",\"row_count_total\":";
+            buffer_ += std::to_string(rows);
+            buffer_ += ",\"elapsed_ms_total\":";
+            buffer_ += std::to_string(elapsed_ms);
+            buffer_ += ",\"first_error_index\":";
+            buffer_ += first_error_index < 0 ? "null" : std::to_string(first_error_index);
+            buffer_ += ",\"error\":";
+            if (error.empty()) {
+                buffer_ += "null";
+            } else {
+                append_json_string(buffer_, error);
+            }
+            buffer_ += "}\n";
+        } else {
+            if (rows_started_) buffer_.push_back('\n');
+            buffer_ += success ? "# idasql: success=true" : "# idasql: success=false";
+            buffer_ += " statement_count=" + std::to_string(statements);
+            buffer_ += " row_count_total=" + std::to_string(rows);
+            buffer_ += " elapsed_ms_total=" + std::to_string(elapsed_ms);
+            if (!error.empty()) {
+                buffer_ += " error=";
+                for (char c : error) buffer_.push_back((c == '\n' || c == '\r') ? ' ' : c);
+            }
+            buffer_.push_back('\n');
+        }
+        if (!flush(true)) {
+            return false;
+        }
+        sink_.done();
+        return true;
+    }
+
+    void defer_sends(bool deferred) { deferred_ = deferred; }
+    size_t buffered() const { return buffer_.size(); }
+    bool send() { return flush(); }
+
+    bool failed() const { return failed_; }
+    uint64_t bytes_sent() const { return bytes_sent_; }
+
+private:
+    static constexpr size_t kFlushBytes = 64 * 1024;
+
+    void begin_rows(size_t statement_index, const std::vector<std::string>& columns) {
+        if (sep_ == 0) {
+            buffer_ += "{\"type\":\"columns\",\"statement_index\":";
+            buffer_ += std::to_string(statement_index);
+            buffer_ += ",\"columns\":";
+            append_json_string_array(buffer_, columns);
+            buffer_ += "}\n";
+            return;
+        }
+        // Blank line between result sets, as in the buffered format.
+        if (rows_started_) buffer_.push_back('\n');
+        rows_started_ = true;
+        for (size_t c = 0; c < columns.size(); ++c) {
+            if (c != 0) buffer_.push_back(sep_);
+            append_delimited_cell(buffer_, columns[c], sep_);
+        }
+        buffer_.push_back('\n');
+    }
+
+    bool flush(bool last = false) {
+        if (failed_) {
+            return false;
+        }
+        const std::string* out = &buffer_;
+        if (encoding_ != ContentEncoding::Identity) {
+            compressed_.clear();
+            if (!compressor_.write(buffer_, true, compressed_) ||
+                (last && !compressor_.finish(compressed_))) {
+                failed_ = true;
+                return false;
+            }
+            out = &compressed_;
+        }
+        if (!out->empty() && !sink_.write(out->data(), out->size())) {
+            failed_ = true;
+            return false;
+        }
+        bytes_sent_ += out->size();
+        buffer_.clear();
+        return true;
+    }
+
+    httplib::DataSink& sink_;
+    char sep_;
+    ContentEncoding encoding_;
+    StreamCompressor compressor_;
+    std::string compressed_;
+    std::string buffer_;
+    std::string scratch_;
+    bool rows_started_ = false;
+    bool deferred_ = false;
+    bool failed_ = false;
+    uint64_t bytes_sent_ = 0;
+};
+
+class IDAHTTPServer::Impl {
+public:
+    httplib::Server server;
+    std::thread listen_thread;
+    HTTPStatementExecutor executor;
+    HTTPQueryCallback query_callback;  // legacy; set instead of executor
+    std::string auth_token;
+    bool use_queue = false;
+    std::atomic<bool> running{false};
+    int port = 0;
+    std::function<bool()> interrupt_check;
+
+    // Queue mode: commands run on the thread inside run_until_stopped().
+    std::mutex queue_mutex;
+    std::condition_variable queue_cv;
+    FairQueue<HTTPPendingCommand> pending;
+
+    // Direct mode: the executor is not concurrency-safe; one request at a time.
+    std::mutex exec_mutex;
+
+    // Direct mode, buffered scripts: statements run in slices inside
+    // script_runner; both empty when the embedder set none.
+    HTTPStatementExecutor script_statement;
+    CursorRunner script_runner;
+    TypedScriptResult run_script(const std::string& sql, const QueryParams& params,
+                                 bool continue_on_error);
+
+    HTTPDispatch dispatch(std::function<void()> work, std::function<bool()> client_gone,
+                          const RequestTag& tag);
+    HTTPDispatch run_on_snapshot_pool(const std::string& sql, const QueryParams& params,
+                                      bool continue_on_error, TypedScriptResult& script,
+                                      std::function<bool()> client_gone);
+    void complete_pending();
+    void publish_queue_depth();  // callers hold queue_mutex
+    void install_routes();
+    bool authorized(const httplib::Request& req, httplib::Response& res) const;
+    void handle_query(const httplib::Request& req, httplib::Response& res);
+
+    // stream=1; empty when the embedder set none (statements are buffered).
+    HTTPStreamExecutor stream_executor;
+    void handle_query_stream(const httplib::Request& req, httplib::Response& res,
+                             const std::string& sql, const QueryParams& params, char sep,
+                             bool continue_on_error, bool include_sql, bool snapshot,
+                             const RequestTag& tag);
+    HTTPDispatch stream_statement_slices(const std::string& stmt, const QueryParams& params,
+                                         size_t index, HTTPStreamWriter& writer,
+                                         StreamSummary& summary,
+                                         const std::function<bool()>& client_gone,
+                                         const RequestTag& tag);
+
+    // page_size=N and /cursor/{id}; cursor_opener is empty when the
+    // embedder set none.
+    CursorOpener cursor_opener;
+    CursorRunner cursor_runner;
+    CursorRegistry cursors;
+    void run_cursor_work(const std::function<void()>& work);
+    void handle_query_paged(const httplib::Request& req, httplib::Response& res,
+                            const std::string& sql, const QueryParams& params, size_t page_size,
+                            const RequestTag& tag);
+    void handle_cursor_next(const httplib::Request& req, httplib::Response& res);
+    void handle_cursor_close(const httplib::Request& req, httplib::Response& res);
+
+    // /changes and /changes/stream
+    std::atomic<int> change_subscribers{0};
+    bool admit_change_subscriber(httplib::Response& res);
+    void handle_changes(const httplib::Request& req, httplib::Response& res);
+    void handle_change_stream(const httplib::Request& req, httplib::Response& res);
+};
+
+HTTPDispatch IDAHTTPServer::Impl::dispatch(std::function<void()> work,
+                                           std::function<bool()> client_gone,
+                                           const RequestTag& tag) {
+    if (!running.load()) {
+        return HTTPDispatch::Stopped;
+    }
+    if (!use_queue) {
+        std::lock_guard<std::mutex> lock(exec_mutex);
+        work();
+        return HTTPDispatch::Ok;
+    }
+
+    auto cmd = std::make_shared<HTTPPendingCommand>();
+    cmd->work = std::move(work);
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        if (!pending.push(cmd, tag, runtime_settings().max_queue())) {
+            server_metrics().count_rejection(MetricsTransport::Http, RejectReason::QueueFull);
+            return HTTPDispatch::QueueFull;
+        }
+        publish_queue_depth();
+    }
+    queue_cv.notify_one();
+
+    std::unique_lock<std::mutex> lock(cmd->done_mutex);
+    const int timeout_ms = runtime_settings().queue_admission_timeout_ms();
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+    auto withdraw = [&]() {
+        // Not admitted yet: cancel and drop from the queue.
+        cmd->canceled = true;
+        lock.unlock();
+        std::lock_guard<std::mutex> qlock(queue_mutex);
+        pending.remove(cmd);
+        publish_queue_depth();
+    };
+
+    // Once started, the work item references the caller's stack, so wait for
+    // completion even if the server is stopping; cancelling makes that quick.
+    while (!cmd->completed) {
+        if (!cmd->started && !running.load()) {
+            withdraw();
+            return HTTPDispatch::Stopped;
+        }
+        if (cmd->started && (!running.load() || (client_gone && client_gone()))) {
+            cmd->cancel->cancel();
+        }
+        if (timeout_ms <= 0 || cmd->started) {
+            cmd->done_cv.wait_for(lock, std::chrono::milliseconds(100));
+            continue;
+        }
+        if (cmd->done_cv.wait_until(lock, deadline,
+                [&]() { return cmd->completed || cmd->started || !running.load(); })) {
+            continue;
+        }
+        withdraw();
+        server_metrics().count_rejection(MetricsTransport::Http, RejectReason::AdmissionTimeout);
+        return HTTPDispatch::TimedOut;
+    }
+    return cmd->canceled ? HTTPDispatch::Stopped : HTTPDispatch::Ok;
+}
+
+// snapshot=1: pool workers answer on this HTTP thread's behalf, so requests
+// run in parallel and never queue behind the IDA thread.
+HTTPDispatch IDAHTTPServer::Impl::run_on_snapshot_pool(const std::string& sql,
+                                                       const QueryParams& params,
+                                                       bool continue_on_error,
+                                                       TypedScriptResult& script,
+                                                       std::function<bool()> client_gone) {
+    if (!running.load()) {
+        return HTTPDispatch::Stopped;
+    }
+    // Same cancellation as queued work: client gone or server stopping.
+    // This thread checks it while it waits on each pool job.
+    auto abandon = [this, &client_gone]() {
+        return !running.load() || (client_gone && client_gone());
+    };
+    script = run_typed_script(sql, params,
+        [&abandon](const std::string& stmt, const QueryParams& stmt_params) {
+            return snapshot_pool().query(stmt, stmt_params, abandon);
+        },
+        continue_on_error);
+    return HTTPDispatch::Ok;
+}
+
+// Buffered scripts through dispatch(). The plugin's statement executor
+// hops to the IDA thread per statement; with a script executor a whole
+// slice of statements shares one hop.
+TypedScriptResult IDAHTTPServer::Impl::run_script(const std::string& sql, const QueryParams& params,
+                                                  bool continue_on_error) {
+    if (!use_queue && script_statement && script_runner) {
+        return run_typed_script_sliced(sql, params, script_statement, script_runner,
+                                       runtime_settings().script_slice_ms(), continue_on_error);
+    }
+    return run_typed_script(sql, params, executor, continue_on_error);
+}
+
+void IDAHTTPServer::Impl::complete_pending() {
+    std::vector<std::shared_ptr<HTTPPendingCommand>> drained;
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        drained = pending.drain();
+        publish_queue_depth();
+    }
+    for (auto& cmd : drained) {
+        {
+            std::lock_guard<std::mutex> lock(cmd->done_mutex);
+            cmd->canceled = true;
+            cmd->completed = true;
+        }
+        cmd->done_cv.notify_one();
+    }
+}
+
+void IDAHTTPServer::Impl::publish_queue_depth() {
+    server_metrics().set_queue_depth(MetricsTransport::Http, pending.stats());
+}
+
+bool IDAHTTPServer::Impl::authorized(const httplib::Request& req, httplib::Response& res) const {
+    if (auth_token.empty()) {
+        return true;
+    }
+    if (req.get_header_value("Authorization") == "Bearer " + auth_token) {
+        return true;
+    }
+    res.status = 401;
+    res.set_content(json_error("Unauthorized: missing or invalid bearer token"), "application/json");
+    return false;
+}
+
+void IDAHTTPServer::Impl::handle_query(const httplib::Request& req, httplib::Response& res) {
+    const auto arrived = std::chrono::steady_clock::now();
+    std::string sql = req.body;
+    QueryParams params;
+
+    // JSON body: {"sql": "...", "params": [...]}. Raw SQL never starts with '{'.
+    const auto first = sql.find_first_not_of(" \t\r\n");
+    if (first != std::string::npos && sql[first] == '{') {
+        xsql::json body = xsql::json::parse(req.body, nullptr, false);
+        if (body.is_discarded() || !body.is_object()) {
+            res.status = 400;
+            res.set_content(json_error("Invalid JSON request body"), "application/json");
+            return;
+        }
+        sql = body.value("sql", body.value("query", std::string()));
+        std::string error;
+        if (body.contains("params") && !query_params_from_json(body["params"], params, error)) {
+            res.status = 400;
+            res.set_content(json_error(error), "application/json");
+            return;
+        }
+    }
+    if (!has_sql_tokens(sql)) {
+        res.status = 400;
+        res.set_content(json_error("Empty query"), "application/json");
+        return;
+    }
+    if (query_flag(req, "explain")) {
+        sql = explain_cost_sql(sql);
+    }
+
+    const std::string format = req.has_param("format") ? req.get_param_value("format") : "json";
+    if (format != "json" && format != "text" && format != "csv" && format != "tsv" &&
+        format != "columnar") {
+        res.status = 400;
+        res.set_content(json_error("Unknown format: " + format), "application/json");
+        return;
+    }
+    const bool continue_on_error = query_flag(req, "continue_on_error");
+    const bool include_sql = query_flag(req, "include_sql");
+    RequestTag tag;
+    std::string tag_error;
+    if (!request_tag(req, tag, tag_error)) {
+        res.status = 400;
+        res.set_content(json_error(tag_error), "application/json");
+        return;
+    }
+
+    if (query_callback) {
+        if (!params.empty()) {
+            res.status = 400;
+            res.set_content(json_error("params are not supported by this server"), "application/json");
+            return;
+        }
+        std::string body;
+        const HTTPDispatch status = dispatch([&]() { body = query_callback(sql); },
+                                             [&req]() { return connection_closed(req, 0); }, tag);
+        if (status != HTTPDispatch::Ok) {
+            set_dispatch_error(res, status);
+            observe_http_request(arrived, dispatch_status(status), res);
+            return;
+        }
+        set_encoded_content(req, res, body, "application/json");
+        observe_http_request(arrived, envelope_status(body), res);
+        return;
+    }
+
+    if (req.has_param("page_size")) {
+        uint64_t page_size = 0;
+        if (!query_uint(req, "page_size", page_size) || page_size == 0) {
+            res.status = 400;
+            res.set_content(json_error("page_size must be a positive integer"), "application/json");
+            return;
+        }
+        if (format != "json" || query_flag(req, "stream") || query_flag(req, "snapshot")) {
+            res.status = 400;
+            res.set_content(json_error("page_size supports format=json without stream or snapshot"),
+                            "application/json");
+            return;
+        }
+        handle_query_paged(req, res, sql, params, static_cast<size_t>(page_size), tag);
+        return;
+    }
+
+    if (query_flag(req, "stream")) {
+        if (format == "text" || format == "columnar") {
+            res.status = 400;
+            res.set_content(json_error("stream=1 supports format=json, csv or tsv"), "application/json");
+            return;
+        }
+        const char sep = format == "csv" ? ',' : format == "tsv" ? '\t' : 0;
+        handle_query_stream(req, res, sql, params, sep, continue_on_error, include_sql,
+                            query_flag(req, "snapshot"), tag);
+        return;
+    }
+
+    const char* content_type = format == "text" ? "text/plain; charset=utf-8"
+                             : format == "columnar" ? kColumnarContentType
+                             : format == "csv" ? "text/csv; charset=utf-8"
+                             : format == "tsv" ? "text/tab-separated-values; charset=utf-8"
+                             : "application/json";
+
+    // A repeated read at an unchanged IDB epoch is answered here, without
+    // the IDA thread, and identical reads arriving while one runs share it.
+    // Snapshot reads are not tied to the epoch.
+    const bool snapshot = query_flag(req, "snapshot");
+    std::string cache_key;
+    if (!snapshot) {
+        std::string variant = "http:" + format;
+        if (continue_on_error) variant += ":continue_on_error";
+        if (include_sql) variant += ":include_sql";
+        cache_key = result_cache_key(variant, sql, params);
+    }
+    if (auto cached = result_cache().find(cache_key)) {
+        set_encoded_content(req, res, *cached, content_type);
+        observe_http_request(arrived, RequestStatus::Ok, res);
+        return;
+    }
+
+    HTTPDispatch status = HTTPDispatch::Ok;
+    RequestStatus outcome = RequestStatus::Ok;  // shared results are successes
+    std::shared_ptr<const std::string> body;
+    const FlightResult flight = single_flight().run(
+        class_scoped_key(cache_key, tag.request_class),
+        [&]() -> std::shared_ptr<const std::string> {
+            const uint64_t epoch = idb_epoch();
+            TypedScriptResult script;
+            status = snapshot
+                ? run_on_snapshot_pool(sql, params, continue_on_error, script,
+                                       [&req]() { return connection_closed(req, 0); })
+                : dispatch(
+                      [&]() { script = run_script(sql, params, continue_on_error); },
+                      [&req]() { return connection_closed(req, 0); }, tag);
+            if (status != HTTPDispatch::Ok) {
+                return nullptr;
+            }
+            outcome = script_status(script);
+            if (format == "text") {
+                body = std::make_shared<const std::string>(format_typed_script_text(script));
+            } else if (format == "columnar") {
+                body = std::make_shared<const std::string>(format_typed_script_columnar(script));
+            } else if (format == "csv") {
+                body = std::make_shared<const std::string>(format_typed_script_delimited(script, ','));
+            } else if (format == "tsv") {
+                body = std::make_shared<const std::string>(format_typed_script_delimited(script, '\t'));
+            } else {
+                body = std::make_shared<const std::string>(format_typed_script_json(script, include_sql));
+            }
+            if (!script.success) {
+                return nullptr;  // waiters run it themselves
+            }
+            result_cache().store(cache_key, epoch, body);
+            return body;
+        },
+        [this, &req]() { return !running.load() || connection_closed(req, 0); });
+
+    if (!flight.led) {
+        if (!flight.body) {
+            set_dispatch_error(res, HTTPDispatch::Stopped);
+            observe_http_request(arrived, RequestStatus::Error, res);
+            return;
+        }
+        body = flight.body;
+    } else if (status != HTTPDispatch::Ok) {
+        set_dispatch_error(res, status);
+        observe_http_request(arrived, dispatch_status(status), res);
+        return;
+    }
+    set_encoded_content(req, res, *body, content_type);
+    observe_http_request(arrived, outcome, res);
+}
+
+// Statements run one at a time through the usual dispatch (queue or direct).
+// With a cursor opener each statement is stepped a slice at a time
+// (stream_statement_slices) and this HTTP thread does every socket write;
+// otherwise the stream executor hands rows to the writer as they come off
+// the cursor, or the statement is buffered (snapshot pool).
+void IDAHTTPServer::Impl::handle_query_stream(const httplib::Request& req, httplib::Response& res,
+                                              const std::string& sql, const QueryParams& params,
+                                              char sep, bool continue_on_error, bool include_sql,
+                                              bool snapshot, const RequestTag& tag) {
+    const char* content_type = sep == ',' ? "text/csv; charset=utf-8"
+                             : sep == '\t' ? "text/tab-separated-values; charset=utf-8"
+                             : "application/x-ndjson";
+    const httplib::Request* request = &req;
+    const ContentEncoding encoding = begin_encoded_stream(req, res);
+    const auto arrived = std::chrono::steady_clock::now();
+    res.set_chunked_content_provider(
+        content_type,
+        [this, request, sql, params, sep, continue_on_error, include_sql, snapshot, tag, encoding,
+         arrived](size_t, httplib::DataSink& sink) {
+            HTTPStreamWriter writer(sink, sep, encoding);
+            auto observed = [&](RequestStatus status, bool result) {
+                server_metrics().observe_request(MetricsTransport::Http, status,
+                                                 seconds_since(arrived), writer.bytes_sent());
+                return result;
+            };
+            std::vector<std::string> statements;
+            std::string parse_error;
+            if (!split_sql_statements(sql, statements, parse_error)) {
+                return observed(RequestStatus::Error,
+                                writer.end(false, 0, 0, 0, -1, parse_error));
+            }
+
+            RequestStatus outcome = RequestStatus::Ok;
+            bool success = true;
+            int first_error_index = -1;
+            size_t rows_total = 0;
+            long long elapsed_total = 0;
+            std::string error;
+            for (size_t i = 0; i < statements.size(); ++i) {
+                const std::string& stmt = statements[i];
+                StreamSummary summary;
+                auto run = [&]() {
+                    if (!snapshot && stream_executor) {
+                        std::vector<std::string> columns;
+                        summary = stream_executor(stmt, params, [&](const CursorRow& row) {
+                            if (row.index() == 0) {
+                                columns.clear();
+                                for (size_t c = 0; c < row.size(); ++c) {
+                                    columns.push_back(row.column_name(c));
+                                }
+                            }
+                            return writer.row(i, columns, row);
+                        });
+                        return;
+                    }
+                    // Buffered per statement (snapshot pool, or no stream executor).
+                    QueryResult result = snapshot ? run_on_snapshot(stmt, params)
+                                                  : executor(stmt, params);
+                    for (const auto& row : result) {
+                        if (!writer.row(i, result.columns, row)) break;
+                    }
+                    summary.columns = result.columns;
+                    summary.rows = result.row_count();
+                    summary.success = result.success;
+                    summary.error = result.error;
+                    summary.timed_out = result.timed_out;
+                    summary.elapsed_ms = result.elapsed_ms;
+                };
+
+                HTTPDispatch status = HTTPDispatch::Ok;
+                auto client_gone = [request]() { return connection_closed(*request, 0); };
+                if (snapshot) {
+                    run();
+                } else if (cursor_opener) {
+                    status = stream_statement_slices(stmt, params, i, writer, summary,
+                                                     client_gone, tag);
+                } else {
+                    status = dispatch(run, client_gone, tag);
+                }
+                if (writer.failed()) {
+                    return observed(RequestStatus::Error, false);  // client went away
+                }
+                if (status != HTTPDispatch::Ok) {
+                    outcome = dispatch_status(status);
+                    error = status == HTTPDispatch::QueueFull
+                        ? "HTTP queue is full (raise PRAGMA idasql.max_queue)"
+                        : status == HTTPDispatch::TimedOut
+                        ? "HTTP request timed out in queue (raise PRAGMA idasql.queue_admission_timeout_ms)"
+                        : "HTTP server stopped";
+                    success = false;
+                    break;
+                }
+                if (!writer.statement(i, include_sql ? &stmt : nullptr, summary)) {
+                    return observed(RequestStatus::Error, false);
+                }
+                rows_total += summary.rows;
+                elapsed_total += summary.elapsed_ms;
+                if (summary.timed_out) {
+                    outcome = RequestStatus::Timeout;
+                }
+                if (!summary.success) {
+                    if (outcome == RequestStatus::Ok) outcome = RequestStatus::Error;
+                    success = false;
+                    if (first_error_index < 0) {
+                        first_error_index = static_cast<int>(i);
+                        error = summary.error;
+                    }
+                    if (!continue_on_error) break;
+                }
+            }
+            const bool ended = writer.end(success, statements.size(), rows_total, elapsed_total,
+                                          first_error_index, error);
+            return observed(outcome, ended);
+        });
+}
+
+// One statement of a stream, a dispatch per slice: the work steps the
+// cursor until kStreamSliceBytes are encoded (nothing touches the socket
+// there), then this thread sends them and queues the next slice. The cursor
+// stays open in between, so a slow client delays only its own next slice
+// and never holds the IDA thread.
+HTTPDispatch IDAHTTPServer::Impl::stream_statement_slices(const std::string& stmt,
+                                                          const QueryParams& params,
+                                                          size_t index, HTTPStreamWriter& writer,
+                                                          StreamSummary& summary,
+                                                          const std::function<bool()>& client_gone,
+                                                          const RequestTag& tag) {
+    // Each slice runs under its own command token, so the cursor chains to
+    // this one instead and a disconnect reaches it in any slice.
+    auto cancel = std::make_shared<CancelToken>();
+    auto abandon = [this, &client_gone, &cancel]() {
+        if (running.load() && !client_gone()) {
+            return false;
+        }
+        cancel->cancel();
+        return true;
     };
-    config.max_queue_fn = []() {
-        return idasql::runtime_settings().max_queue();
+
+    QueryCursor cursor;
+    bool opened = false;
+    bool finished = false;
+    auto slice = [&]() {
+        run_cursor_work([&]() {
+            if (!opened) {
+                CancelScope cancelling(cancel);
+                cursor = cursor_opener(stmt, params);
+                opened = true;
+            }
+            // The timeout only charges time inside SQLite, not the pauses.
+            while (writer.buffered() < kStreamSliceBytes) {
+                if (!cursor.next()) {
+                    finished = true;
+                    break;
+                }
+                ++summary.rows;
+                writer.row(index, cursor.columns(), cursor.row());
+            }
+            if (!finished) {
+                return;
+            }
+            summary.columns = cursor.columns();
+            summary.error = cursor.error();
+            summary.timed_out = cursor.timed_out();
+            summary.elapsed_ms = cursor.elapsed_ms();
+            summary.plan = cursor.plan();
+            if (summary.timed_out && summary.rows == 0) {
+                summary.error = query_timeout_error(summary.elapsed_ms);
+            }
+            summary.success = summary.error.empty();
+            cursor = QueryCursor();  // finalize where it was stepped
+        });
     };
-    config.status_fn = []() {
-        const auto settings = idasql::runtime_settings().snapshot();
-        return xsql::json{
+
+    writer.defer_sends(true);
+    HTTPDispatch status = HTTPDispatch::Ok;
+    while (!finished) {
+        status = dispatch(slice, abandon, tag);
+        if (status != HTTPDispatch::Ok || !writer.send()) {
+            break;
+        }
+    }
+    writer.defer_sends(false);
+    if (!opened || finished) {
+        return status;
+    }
+
+    // Left mid-statement: finalize the cursor where it was stepped. Once the
+    // server has stopped nothing runs there any more, so it is dropped here.
+    cursor.cancel();
+    auto release = [&]() { run_cursor_work([&]() { cursor = QueryCursor(); }); };
+    while (dispatch(release, {}, tag) != HTTPDispatch::Ok && running.load()) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));  // queue full
+    }
+    return status;
+}
+
+void IDAHTTPServer::Impl::run_cursor_work(const std::function<void()>& work) {
+    if (cursor_runner) {
+        cursor_runner(work);
+    } else {
+        work();
+    }
+}
+
+// Cursors belong to the address that opened them.
+void IDAHTTPServer::Impl::handle_query_paged(const httplib::Request& req, httplib::Response& res,
+                                             const std::string& sql, const QueryParams& params,
+                                             size_t page_size, const RequestTag& tag) {
+    if (!cursor_opener) {
+        res.status = 501;
+        res.set_content(json_error("page_size is not supported by this server"), "application/json");
+        return;
+    }
+    const auto arrived = std::chrono::steady_clock::now();
+    CursorPage page;
+    const HTTPDispatch status = dispatch(
+        [&]() {
+            run_cursor_work([&]() {
+                page = cursors.open(cursor_opener(sql, params), req.remote_addr, page_size);
+            });
+        },
+        [&req]() { return connection_closed(req, 0); }, tag);
+    if (status != HTTPDispatch::Ok) {
+        set_dispatch_error(res, status);
+        observe_http_request(arrived, dispatch_status(status), res);
+        return;
+    }
+    set_encoded_content(req, res, cursor_page_to_json(page), "application/json");
+    observe_http_request(arrived, page_status(page), res);
+}
+
+void IDAHTTPServer::Impl::handle_cursor_next(const httplib::Request& req, httplib::Response& res) {
+    const std::string id = req.matches[1];
+    uint64_t page_size = 0;
+    if (req.has_param("page_size") && (!query_uint(req, "page_size", page_size) || page_size == 0)) {
+        res.status = 400;
+        res.set_content(json_error("page_size must be a positive integer"), "application/json");
+        return;
+    }
+    RequestTag tag;
+    std::string error;
+    if (!request_tag(req, tag, error)) {
+        res.status = 400;
+        res.set_content(json_error(error), "application/json");
+        return;
+    }
+    const auto arrived = std::chrono::steady_clock::now();
+    CursorPage page;
+    bool found = false;
+    const HTTPDispatch status = dispatch(
+        [&]() {
+            run_cursor_work([&]() {
+                found = cursors.next(id, req.remote_addr, static_cast<size_t>(page_size), page, error);
+            });
+        },
+        [&req]() { return connection_closed(req, 0); }, tag);
+    if (status != HTTPDispatch::Ok) {
+        set_dispatch_error(res, status);
+        observe_http_request(arrived, dispatch_status(status), res);
+        return;
+    }
+    if (!found) {
+        res.status = 404;
+        res.set_content(json_error(error), "application/json");
+        return;
+    }
+    set_encoded_content(req, res, cursor_page_to_json(page), "application/json");
+    observe_http_request(arrived, page_status(page), res);
+}
+
+void IDAHTTPServer::Impl::handle_cursor_close(const httplib::Request& req, httplib::Response& res) {
+    const std::string id = req.matches[1];
+    RequestTag tag;
+    std::string error;
+    if (!request_tag(req, tag, error)) {
+        res.status = 400;
+        res.set_content(json_error(error), "application/json");
+        return;
+    }
+    bool closed = false;
+    const HTTPDispatch status = dispatch(
+        [&]() { run_cursor_work([&]() { closed = cursors.close(id, req.remote_addr); }); },
+        {}, tag);
+    if (status != HTTPDispatch::Ok) {
+        set_dispatch_error(res, status);
+        return;
+    }
+    if (!closed) {
+        res.status = 404;
+        res.set_content(json_error("Unknown or expired cursor: " + id), "application/json");
+        return;
+    }
+    res.set_content("{\"success\":true}", "application/json");
+}
+
+// Leaves a slot taken on success; the caller releases it.
+bool IDAHTTPServer::Impl::admit_change_subscriber(httplib::Response& res) {
+    if (change_subscribers.fetch_add(1) >= kMaxChangeSubscribers) {
+        change_subscribers.fetch_sub(1);
+        res.status = 503;
+        res.set_content(json_error("Too many change subscribers"), "application/json");
+        return false;
+    }
+    return true;
+}
+
+void IDAHTTPServer::Impl::handle_changes(const httplib::Request& req, httplib::Response& res) {
+    uint64_t since = 0;
+    uint64_t timeout_ms = 25000;
+    uint64_t limit = 1000;
+    query_uint(req, "since", since);
+    query_uint(req, "timeout_ms", timeout_ms);
+    query_uint(req, "limit", limit);
+    if (!admit_change_subscriber(res)) {
+        return;
+    }
+    const ChangeBatch batch = wait_for_changes(
+        since, static_cast<size_t>(limit),
+        static_cast<int>(std::min<uint64_t>(timeout_ms, kMaxChangeWaitMs)),
+        [this, &req]() { return !running.load() || connection_closed(req, 0); });
+    change_subscribers.fetch_sub(1);
+    set_encoded_content(req, res, change_batch_to_json(batch), "application/json");
+}
+
+// Server-Sent Events. Each stream reads the ring at its own pace: a slow
+// client only delays itself, and one that falls a ring behind gets a gap
+// event instead of an unbounded buffer.
+void IDAHTTPServer::Impl::handle_change_stream(const httplib::Request& req,
+                                               httplib::Response& res) {
+    uint64_t since = 0;
+    if (!query_uint(req, "since", since)) {
+        const std::string last_id = req.get_header_value("Last-Event-ID");
+        char* end = nullptr;
+        const unsigned long long parsed = std::strtoull(last_id.c_str(), &end, 10);
+        since = !last_id.empty() && *end == '\0' ? parsed : last_change_seq();
+    }
+    if (!admit_change_subscriber(res)) {
+        return;
+    }
+
+    // Owned by the content provider; releases the slot when the stream ends.
+    // Events are flushed through the compressor one batch at a time; the
+    // stream only ends when the client or server goes away, so it is never
+    // finished.
+    struct StreamState {
+        StreamState(std::atomic<int>& count, uint64_t start, ContentEncoding encoding)
+            : subscribers(count), cursor(start), compressor(encoding),
+              compressed(encoding != ContentEncoding::Identity) {}
+        ~StreamState() { subscribers.fetch_sub(1); }
+        std::atomic<int>& subscribers;
+        uint64_t cursor;
+        std::chrono::steady_clock::time_point last_write = std::chrono::steady_clock::now();
+        StreamCompressor compressor;
+        bool compressed;
+    };
+    auto state = std::make_shared<StreamState>(change_subscribers, since,
+                                               begin_encoded_stream(req, res));
+
+    res.set_header("Cache-Control", "no-cache");
+    res.set_chunked_content_provider(
+        "text/event-stream",
+        [this, state](size_t, httplib::DataSink& sink) {
+            if (!running.load() || !sink.is_writable()) {
+                return false;
+            }
+            const ChangeBatch batch = wait_for_changes(
+                state->cursor, 256, 1000,
+                [this, &sink]() { return !running.load() || !sink.is_writable(); });
+            std::string out;
+            if (batch.gap) {
+                out += "event: gap\ndata: {\"last_seq\":" + std::to_string(batch.last_seq) + "}\n\n";
+            }
+            for (const ChangeEvent& event : batch.events) {
+                out += "id: " + std::to_string(event.seq) + "\nevent: change\ndata: ";
+                append_change_event_json(out, event);
+                out += "\n\n";
+            }
+            state->cursor = batch.last_seq;
+
+            const auto now = std::chrono::steady_clock::now();
+            if (out.empty() && now - state->last_write >= std::chrono::milliseconds(kChangeKeepaliveMs)) {
+                out = ": keepalive\n\n";
+            }
+            if (out.empty()) {
+                return true;
+            }
+            state->last_write = now;
+            if (state->compressed) {
+                std::string encoded;
+                if (!state->compressor.write(out, true, encoded)) {
+                    return false;
+                }
+                out = std::move(encoded);
+            }
+            return sink.write(out.data(), out.size());
+        });
+}
+
+void IDAHTTPServer::Impl::install_routes() {
+    server.Get("/", [](const httplib::Request&, httplib::Response& res) {
+        std::string text = "IDASQL HTTP server\n\nTry:\n  " +
+            format_query_curl_example("http://localhost:<port>") + "\n\nSee GET /help for the API.\n";
+        res.set_content(text, "text/plain; charset=utf-8");
+    });
+
+    server.Get("/help", [](const httplib::Request&, httplib::Response& res) {
+        res.set_content(build_http_help_text(), "text/plain; charset=utf-8");
+    });
+
+    server.Get("/status", [this](const httplib::Request& req, httplib::Response& res) {
+        if (!authorized(req, res)) return;
+        const auto settings = runtime_settings().snapshot();
+        const ResultCacheStats cache = result_cache().stats();
+        size_t queued = 0;
+        FairQueueStats queue;
+        {
+            std::lock_guard<std::mutex> lock(queue_mutex);
+            queued = pending.size();
+            queue = pending.stats();
+        }
+        xsql::json status{
+            {"success", true},
+            {"status", "ok"},
+            {"tool", "idasql"},
             {"mode", "repl"},
+            {"queue_depth", queued},
+            {"queue_depth_by_class", {
+                {"interactive", queue.depth[static_cast<size_t>(RequestClass::Interactive)]},
+                {"batch", queue.depth[static_cast<size_t>(RequestClass::Batch)]},
+                {"background", queue.depth[static_cast<size_t>(RequestClass::Background)]}
+            }},
+            {"demoted_clients", queue.demoted_clients},
+            {"demotions", queue.demotions},
+            {"demote_after_ms", settings.demote_after_ms},
+            {"script_slice_ms", settings.script_slice_ms},
             {"query_timeout_ms", settings.query_timeout_ms},
             {"queue_admission_timeout_ms", settings.queue_admission_timeout_ms},
             {"max_queue", settings.max_queue},
+            {"statement_cache_size", settings.statement_cache_size},
+            {"max_query_cost", settings.max_query_cost},
+            {"max_query_memory_mb", settings.max_query_memory_mb},
+            {"spill_threshold_mb", settings.spill_threshold_mb},
+            {"cursor_idle_ms", settings.cursor_idle_ms},
+            {"max_cursors", settings.max_cursors},
+            {"open_cursors", cursors.size()},
+            {"result_cache_mb", settings.result_cache_mb},
+            {"result_cache", {
+                {"entries", cache.entries},
+                {"bytes", cache.bytes},
+                {"hits", cache.hits},
+                {"misses", cache.misses}
+            }},
+            {"queries_coalesced", single_flight().coalesced()},
+            {"idb_epoch", idb_epoch()},
+            {"snapshot", snapshot_pool().path()},
+            {"snapshot_workers", snapshot_pool().workers()},
+            {"change_seq", last_change_seq()},
+            {"change_subscribers", change_subscribers.load()},
             {"hints_enabled", settings.hints_enabled ? 1 : 0}
         };
-    };
-    return config;
+        res.set_content(status.dump(), "application/json");
+    });
+
+    server.Get("/metrics", [this](const httplib::Request& req, httplib::Response& res) {
+        if (!authorized(req, res)) return;
+        set_encoded_content(req, res, server_metrics().format(), kMetricsContentType);
+    });
+
+    server.Post("/query", [this](const httplib::Request& req, httplib::Response& res) {
+        if (!authorized(req, res)) return;
+        handle_query(req, res);
+    });
+
+    server.Post(R"(/cursor/([0-9a-f]+)/next)", [this](const httplib::Request& req, httplib::Response& res) {
+        if (!authorized(req, res)) return;
+        handle_cursor_next(req, res);
+    });
+
+    server.Delete(R"(/cursor/([0-9a-f]+))", [this](const httplib::Request& req, httplib::Response& res) {
+        if (!authorized(req, res)) return;
+        handle_cursor_close(req, res);
+    });
+
+    server.Get("/changes", [this](const httplib::Request& req, httplib::Response& res) {
+        if (!authorized(req, res)) return;
+        handle_changes(req, res);
+    });
+
+    server.Get("/changes/stream", [this](const httplib::Request& req, httplib::Response& res) {
+        if (!authorized(req, res)) return;
+        handle_change_stream(req, res);
+    });
+
+    server.Post("/shutdown", [this](const httplib::Request& req, httplib::Response& res) {
+        if (!authorized(req, res)) return;
+        res.set_content("{\"success\":true,\"message\":\"Shutting down\"}", "application/json");
+        running.store(false);
+        queue_cv.notify_all();
+        server.stop();
+    });
 }
 
-// Legacy: whole-script JSON callback (used by the in-process plugin).
-int IDAHTTPServer::start(int port, HTTPQueryCallback query_cb,
-                         const std::string& bind_addr, bool use_queue) {
-    if (impl_ && impl_->is_running()) {
-        return impl_->port();
-    }
-    bind_addr_ = bind_addr.empty() ? "127.0.0.1" : bind_addr;
-    auto config = make_idasql_config(port, bind_addr_, use_queue);
-    config.query_fn = std::move(query_cb);
-    impl_ = std::make_unique<xsql::thinclient::http_query_server>(config);
-    return impl_->start();
+// ============================================================================
+// IDAHTTPServer
+// ============================================================================
+
+IDAHTTPServer::IDAHTTPServer() = default;
+
+IDAHTTPServer::~IDAHTTPServer() {
+    stop();
 }
 
-// Preferred: single-statement executor (CLI). Enables continue_on_error/
-// include_sql and round-trip-free format=.
 int IDAHTTPServer::start(int port, HTTPStatementExecutor executor,
                          const std::string& bind_addr, bool use_queue,
                          const std::string& auth_token) {
-    if (impl_ && impl_->is_running()) {
-        return impl_->port();
+    if (is_running()) {
+        return impl_->port;
     }
+    stop();  // reap a server that shut itself down via /shutdown
+
     bind_addr_ = bind_addr.empty() ? "127.0.0.1" : bind_addr;
-    auto config = make_idasql_config(port, bind_addr_, use_queue);
-    config.statement_executor = std::move(executor);
-    // Non-queue servers (REPL/plugin background) run the executor on the HTTP
-    // worker; serialize so the non-concurrency-safe IDA DB handle is safe.
-    config.serialize_requests = !use_queue;
-    if (!auth_token.empty()) config.auth_token = auth_token;
-    impl_ = std::make_unique<xsql::thinclient::http_query_server>(config);
-    return impl_->start();
+    impl_ = std::make_unique<Impl>();
+    impl_->executor = std::move(executor);
+    impl_->query_callback = query_callback_;
+    impl_->use_queue = use_queue;
+    impl_->auth_token = auth_token;
+    impl_->stream_executor = stream_executor_;
+    impl_->cursor_opener = cursor_opener_;
+    impl_->cursor_runner = cursor_runner_;
+    impl_->script_statement = script_statement_;
+    impl_->script_runner = script_runner_;
+    impl_->install_routes();
+
+    bool bound = false;
+    if (port == 0) {
+        std::random_device rd;
+        std::mt19937 gen(rd());
+        std::uniform_int_distribution<> dis(8100, 8199);
+        for (int attempt = 0; attempt < 100 && !bound; ++attempt) {
+            port = dis(gen);
+            bound = impl_->server.bind_to_port(bind_addr_, port);
+        }
+    } else {
+        bound = impl_->server.bind_to_port(bind_addr_, port);
+    }
+    if (!bound) {
+        impl_.reset();
+        return -1;
+    }
+
+    impl_->port = port;
+    impl_->running.store(true);
+    Impl* impl = impl_.get();
+    impl_->listen_thread = std::thread([impl]() {
+        impl->server.listen_after_bind();
+        impl->running.store(false);
+        impl->queue_cv.notify_all();
+    });
+    impl_->server.wait_until_ready();
+    return port;
+}
+
+int IDAHTTPServer::start(int port, HTTPQueryCallback query_cb,
+                         const std::string& bind_addr, bool use_queue) {
+    query_callback_ = std::move(query_cb);
+    const int actual = start(port, HTTPStatementExecutor(), bind_addr, use_queue);
+    query_callback_ = nullptr;
+    return actual;
 }
 
 void IDAHTTPServer::run_until_stopped() {
-    if (impl_) impl_->run_until_stopped();
+    if (!impl_) return;
+    Impl& impl = *impl_;
+
+    while (impl.running.load()) {
+        if (impl.interrupt_check && impl.interrupt_check()) {
+            break;
+        }
+
+        std::shared_ptr<HTTPPendingCommand> cmd;
+        QueueTicket ticket;
+        {
+            std::unique_lock<std::mutex> lock(impl.queue_mutex);
+            if (impl.queue_cv.wait_for(
+                    lock,
+                    std::chrono::milliseconds(100),
+                    [&impl]() { return !impl.pending.empty() || !impl.running.load(); })) {
+                cmd = impl.pending.pop(ticket);
+                impl.publish_queue_depth();
+            }
+        }
+        if (!cmd) {
+            continue;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(cmd->done_mutex);
+            if (cmd->completed || cmd->canceled) {
+                cmd->completed = true;
+                cmd->done_cv.notify_one();
+                continue;
+            }
+            cmd->started = true;
+        }
+        server_metrics().observe_queue_wait(MetricsTransport::Http, seconds_since(cmd->queued_at));
+
+        const auto started = std::chrono::steady_clock::now();
+        try {
+            CancelScope cancelling(cmd->cancel);
+            cmd->work();
+        } catch (const std::exception&) {
+            // The work item records its own results; nothing to report here.
+        }
+        {
+            const std::chrono::duration<double, std::milli> held =
+                std::chrono::steady_clock::now() - started;
+            std::lock_guard<std::mutex> lock(impl.queue_mutex);
+            impl.pending.charge(ticket, held.count(), runtime_settings().demote_after_ms());
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(cmd->done_mutex);
+            cmd->completed = true;
+        }
+        cmd->done_cv.notify_one();
+    }
+
+    // Interrupted or shut down via /shutdown: release the port and workers.
+    stop();
 }
 
 void IDAHTTPServer::stop() {
-    if (impl_) {
-        impl_->stop();
-        impl_.reset();
+    if (!impl_) return;
+    impl_->running.store(false);
+    impl_->queue_cv.notify_all();
+    impl_->complete_pending();
+    impl_->server.stop();
+    if (impl_->listen_thread.joinable()) {
+        impl_->listen_thread.join();
     }
+    impl_.reset();
 }
 
 bool IDAHTTPServer::is_running() const {
-    return impl_ && impl_->is_running();
+    return impl_ && impl_->running.load();
 }
 
 int IDAHTTPServer::port() const {
-    return impl_ ? impl_->port() : 0;
+    return impl_ ? impl_->port : 0;
 }
 
 std::string IDAHTTPServer::url() const {
-    return impl_ ? impl_->url() : "";
+    if (!impl_) return "";
+    return "http://" + xsql::thinclient::format_url_host(bind_addr_) + ":" + std::to_string(impl_->port);
 }
 
 void IDAHTTPServer::set_interrupt_check(std::function<bool()> check) {
-    if (impl_) impl_->set_interrupt_check(std::move(check));
+    if (impl_) impl_->interrupt_check = std::move(check);
+}
+
+void IDAHTTPServer::set_stream_executor(HTTPStreamExecutor executor) {
+    stream_executor_ = std::move(executor);
+}
+
+void IDAHTTPServer::set_cursor_executor(CursorOpener open, CursorRunner run) {
+    cursor_opener_ = std::move(open);
+    cursor_runner_ = std::move(run);
+}
+
+void IDAHTTPServer::set_script_executor(HTTPStatementExecutor statement, CursorRunner run) {
+    script_statement_ = std::move(statement);
+    script_runner_ = std::move(run);
 }
 
 std::string format_http_info(int port, const std::string& stop_hint) {
@@ -147,7 +1528,16 @@ std::string format_http_status(int port, bool running) {
 }
 
 std::string format_http_status(int port, bool running, const std::string& bind_addr) {
-    return xsql::thinclient::format_http_status(port, running, bind_addr);
+    std::ostringstream ss;
+    if (running) {
+        const std::string rendered_host = xsql::thinclient::format_url_host(bind_addr);
+        ss << "HTTP server running on port " << port << "\n";
+        ss << "URL: http://" << rendered_host << ":" << port << "\n";
+    } else {
+        ss << "HTTP server not running\n";
+        ss << "Use '.http start' to start\n";
+    }
+    return ss.str();
 }
 
 } // namespace idasql
@@ -8,19 +8,44 @@
 #pragma once
 
 /**
- * http_server.hpp - HTTP REST server wrapper for IDASQL
+ * http_server.hpp - HTTP REST server for IDASQL
  *
  * IDAHTTPServer - HTTP REST server for IDASQL REPL
  *
- * Thin wrapper over xsql::thinclient::http_query_server.
- * Keeps a stable API for CLI and plugin callers.
+ * Owns its cpp-httplib router so /query can take typed inputs (JSON body
+ * with bound "params") and return typed results. Same command queue
+ * pattern as IDAMCPServer.
+ *
+ * This replaced a thin wrapper over xsql::thinclient::http_query_server.
+ * The thinclient (upstream, in libxsql) hands executors raw SQL text and
+ * fills a string-typed ScriptStatementResult. It has no hook for bound
+ * params, typed cells, streaming, cursors, request classes, compression or
+ * extra routes. Its contract is kept: GET /, /help and /status (same
+ * fields, plus more), POST /query with a raw SQL body and the same JSON
+ * envelope and format= options, POST /shutdown, bearer auth, queue and
+ * direct modes with their admission limits, and the legacy whole-script
+ * callback.
+ *
+ * /query?stream=1 writes rows to the socket as they come off the cursor
+ * (NDJSON, CSV or TSV with chunked transfer encoding). With a cursor
+ * opener, the IDA thread steps each statement a bounded slice at a time
+ * and the HTTP thread sends it between slices. Without one, the stream
+ * executor writes rows as they are produced. Failing both, each statement
+ * is buffered before it streams.
+ *
+ * /query?page_size=N returns one page and a cursor id while rows remain;
+ * /cursor/{id}/next continues it (cursor_registry.hpp). Needs a cursor
+ * opener.
  *
  * Usage modes:
  * 1. CLI (idalib): Call run_until_stopped() to process commands on main thread
  * 2. Plugin: Use execute_sync() wrapper in callbacks (no run_until_stopped() needed)
  */
 
-#include <xsql/thinclient/http_query_server.hpp>
+#include <idasql/query_cursor.hpp>
+#include <idasql/query_result.hpp>
+
+#include "cursor_registry.hpp"
 
 #include <string>
 #include <functional>
@@ -28,47 +53,54 @@
 
 namespace idasql {
 
-// Legacy callback: SQL script in, JSON string out. Used by the in-process
-// plugin, which marshals whole-script execution to IDA's main thread via
-// execute_sync and returns the serialized envelope itself.
+// Legacy callback: SQL script in, JSON envelope out, as the thinclient
+// wrapper took it. /query then only accepts SQL without params; the
+// callback owns formatting, so format=, stream and page_size do not apply.
 using HTTPQueryCallback = std::function<std::string(const std::string& sql)>;
 
-// Preferred path (CLI): a single-statement executor. The thinclient owns
-// multi-statement orchestration, query-string options (continue_on_error/
-// include_sql), and output formatting (json/text/csv/tsv) from the ScriptResult.
+// Single-statement executor. The server owns multi-statement orchestration,
+// query-string options (continue_on_error/include_sql) and output formatting
+// (json/text/csv/tsv). params are bound to every statement that takes them.
 using HTTPStatementExecutor =
-    std::function<void(const std::string& sql, xsql::ScriptStatementResult& out)>;
+    std::function<QueryResult(const std::string& sql, const QueryParams& params)>;
+
+// Single-statement streaming executor for /query?stream=1: hands each row to
+// on_row as it is produced (false stops the query). Runs where the
+// statement executor would, and must not buffer the rows.
+using HTTPStreamExecutor = std::function<StreamSummary(
+    const std::string& sql, const QueryParams& params, const RowCallback& on_row)>;
 
 class IDAHTTPServer {
 public:
-    IDAHTTPServer() = default;
-    ~IDAHTTPServer() { stop(); }
+    IDAHTTPServer();
+    ~IDAHTTPServer();
 
     // Non-copyable
     IDAHTTPServer(const IDAHTTPServer&) = delete;
     IDAHTTPServer& operator=(const IDAHTTPServer&) = delete;
 
     /**
-     * Start HTTP server on given port with callbacks
+     * Start HTTP server on given port with a statement executor
      *
      * @param port Port to listen on (0 = random port 8100-8199)
-     * @param query_cb SQL query callback (returns JSON string)
+     * @param executor Single-statement executor
      * @param bind_addr Address to bind to (default: localhost only)
-     * @param use_queue If true, callbacks are queued for main thread (CLI mode)
-     *                  If false, callbacks called directly (plugin mode with execute_sync)
+     * @param use_queue If true, statements are queued for the main thread (CLI mode)
+     *                  If false, the executor runs on the HTTP worker, one
+     *                  request at a time (plugin mode with execute_sync)
+     * @param auth_token If set, requests must send "Authorization: Bearer <token>"
      * @return Actual port used, or -1 on failure
      */
-    int start(int port, HTTPQueryCallback query_cb,
-              const std::string& bind_addr = "127.0.0.1",
-              bool use_queue = false);
-
-    // Preferred overload: drive the server with a single-statement executor
-    // (enables continue_on_error/include_sql and round-trip-free format=).
     int start(int port, HTTPStatementExecutor executor,
               const std::string& bind_addr = "127.0.0.1",
               bool use_queue = false,
               const std::string& auth_token = "");
 
+    // Legacy overload: whole scripts through a JSON-returning callback.
+    int start(int port, HTTPQueryCallback query_cb,
+              const std::string& bind_addr = "127.0.0.1",
+              bool use_queue = false);
+
     /**
      * Block until server stops, processing commands on the calling thread.
      * Only needed when use_queue=true (CLI mode).
@@ -93,9 +125,33 @@ public:
     /** Set interrupt check function (called during wait loop) */
     void set_interrupt_check(std::function<bool()> check);
 
+    /** Set the row-by-row executor used by /query?stream=1 when no cursor executor is set (before start) */
+    void set_stream_executor(HTTPStreamExecutor executor);
+
+    /**
+     * Set how /query?page_size=N opens server-side cursors (before start).
+     * run moves cursor work to the IDA thread; leave it empty in queue mode.
+     */
+    void set_cursor_executor(CursorOpener open, CursorRunner run = {});
+
+    /**
+     * Set how direct mode runs buffered /query scripts (before start):
+     * statement executes in place and run carries as many statements as
+     * fit in PRAGMA idasql.script_slice_ms to the IDA thread per call,
+     * instead of one hop per statement through the statement executor.
+     */
+    void set_script_executor(HTTPStatementExecutor statement, CursorRunner run);
+
 private:
-    std::unique_ptr<xsql::thinclient::http_query_server> impl_;
+    class Impl;
+    std::unique_ptr<Impl> impl_;
     std::string bind_addr_{"127.0.0.1"};
+    HTTPStreamExecutor stream_executor_;
+    CursorOpener cursor_opener_;
+    CursorRunner cursor_runner_;
+    HTTPStatementExecutor script_statement_;
+    CursorRunner script_runner_;
+    HTTPQueryCallback query_callback_;
 };
 
 /**
@@ -199,8 +199,12 @@ inline CommandResult handle_command(
                      "  .mcp stop                Stop MCP server\n"
                      "  .mcp help                Show this help\n"
                      "\n"
-                     "The MCP server exposes one tool:\n"
-                     "  idasql_query  - Execute SQL query directly\n"
+                     "The MCP server exposes these tools:\n"
+                     "  idasql_query   - Execute SQL query directly\n"
+                     "  idasql_cursor  - Next page of a paged idasql_query\n"
+                     "  idasql_changes - Wait for database changes\n"
+                     "  idasql_batch   - Many statements in one call and one IDA-thread slot\n"
+                     "  idasql_metrics - Queue, latency and cache metrics (Prometheus text)\n"
                      "\n"
                      "Connect with Claude Desktop by adding to config:\n"
                      "  {\"mcpServers\": {\"idasql\": {\"url\": \"http://127.0.0.1:<port>/sse\"}}}\n";
@@ -0,0 +1,909 @@
+// Copyright (c) 2024-2026 Elias Bachaalany
+// SPDX-License-Identifier: MPL-2.0
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#include "ipc_server.hpp"
+#include "fair_queue.hpp"
+#include <idasql/cancel.hpp>
+#include <idasql/columnar.hpp>
+#include <idasql/runtime_settings.hpp>
+#include "json_utils.hpp"
+#include "server_metrics.hpp"
+
+#include <xsql/json.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#ifndef _WIN32
+#include <cerrno>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+namespace idasql {
+
+#ifndef _WIN32
+
+namespace {
+
+// Ring header layout (see ipc_server.hpp).
+constexpr size_t kRingHeaderBytes = 64;
+constexpr size_t kRingWritePos = 16;
+constexpr size_t kRingReadPos = 32;
+constexpr size_t kMinRingBytes = 64 * 1024;
+constexpr char kRingMagic[8] = {'I', 'D', 'A', 'S', 'Q', 'L', 'R', '1'};
+
+constexpr int kIPCProtocol = 1;
+// Longest control message a client may send.
+constexpr size_t kMaxIPCMessage = 16 * 1024 * 1024;
+// Rows per batch when the query does not say.
+constexpr size_t kDefaultBatchRows = 65536;
+// Connections served at once; each holds a thread and a ring.
+constexpr size_t kMaxIPCClients = 16;
+
+#ifdef MSG_NOSIGNAL
+constexpr int kSendFlags = MSG_NOSIGNAL;
+#else
+constexpr int kSendFlags = 0;
+#endif
+
+bool send_all(int fd, const char* data, size_t size) {
+    while (size > 0) {
+        const ssize_t n = ::send(fd, data, size, kSendFlags);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        data += n;
+        size -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+bool recv_all(int fd, char* out, size_t size) {
+    while (size > 0) {
+        const ssize_t n = ::recv(fd, out, size, 0);
+        if (n == 0) {
+            return false;
+        }
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        out += n;
+        size -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+void encode_length(char out[4], size_t size) {
+    const uint32_t v = static_cast<uint32_t>(size);
+    out[0] = static_cast<char>(v & 0xff);
+    out[1] = static_cast<char>((v >> 8) & 0xff);
+    out[2] = static_cast<char>((v >> 16) & 0xff);
+    out[3] = static_cast<char>((v >> 24) & 0xff);
+}
+
+// One length-prefixed message; attach_fd rides along with the length
+// bytes (SCM_RIGHTS).
+bool send_message(int fd, const std::string& payload, int attach_fd = -1) {
+    char length[4];
+    encode_length(length, payload.size());
+    if (attach_fd < 0) {
+        return send_all(fd, length, sizeof(length)) && send_all(fd, payload.data(), payload.size());
+    }
+
+    iovec iov{length, sizeof(length)};
+    alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int))] = {};
+    msghdr msg{};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+    cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+    std::memcpy(CMSG_DATA(cmsg), &attach_fd, sizeof(int));
+    ssize_t n;
+    do {
+        n = ::sendmsg(fd, &msg, kSendFlags);
+    } while (n < 0 && errno == EINTR);
+    if (n < 0) {
+        return false;
+    }
+    if (static_cast<size_t>(n) < sizeof(length) &&
+        !send_all(fd, length + n, sizeof(length) - static_cast<size_t>(n))) {
+        return false;
+    }
+    return send_all(fd, payload.data(), payload.size());
+}
+
+bool recv_message(int fd, std::string& out) {
+    unsigned char length[4];
+    if (!recv_all(fd, reinterpret_cast<char*>(length), sizeof(length))) {
+        return false;
+    }
+    const size_t size = static_cast<size_t>(length[0]) | (static_cast<size_t>(length[1]) << 8) |
+                        (static_cast<size_t>(length[2]) << 16) |
+                        (static_cast<size_t>(length[3]) << 24);
+    if (size > kMaxIPCMessage) {
+        return false;
+    }
+    out.resize(size);
+    return size == 0 || recv_all(fd, out.data(), size);
+}
+
+// The peer closed its end (pending input does not count); fd -1 never is.
+bool peer_closed(int fd) {
+    if (fd < 0) {
+        return false;
+    }
+    pollfd p{fd, POLLIN, 0};
+    if (::poll(&p, 1, 0) <= 0) {
+        return false;
+    }
+    if (p.revents & (POLLHUP | POLLERR | POLLNVAL)) {
+        return true;
+    }
+    char byte;
+    return ::recv(fd, &byte, 1, MSG_PEEK | MSG_DONTWAIT) == 0;
+}
+
+// String member of a message, or empty when missing or not a string.
+std::string text_field(const xsql::json& message, const char* name) {
+    auto it = message.find(name);
+    return it != message.end() && it->is_string() ? it->get<std::string>() : std::string();
+}
+
+std::string event_error(const xsql::json& id, const std::string& error) {
+    return xsql::json{{"id", id}, {"event", "error"}, {"error", error}}.dump();
+}
+
+// Shared-memory ring the server writes columnar frames into and the
+// client reads in place. The name is unlinked right away; the client
+// gets the mapping through the descriptor passed at hello.
+class ResultRing {
+public:
+    ResultRing() = default;
+    ~ResultRing() {
+        if (base_) ::munmap(base_, kRingHeaderBytes + capacity_);
+        if (fd_ >= 0) ::close(fd_);
+    }
+
+    ResultRing(const ResultRing&) = delete;
+    ResultRing& operator=(const ResultRing&) = delete;
+
+    bool create(size_t capacity, std::string& error) {
+        static std::atomic<uint64_t> next_id{0};
+        const std::string name = "/idasql-" + std::to_string(::getpid()) + "-" +
+                                 std::to_string(next_id.fetch_add(1));
+        fd_ = ::shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+        if (fd_ < 0) {
+            error = std::string("shm_open failed: ") + std::strerror(errno);
+            return false;
+        }
+        ::shm_unlink(name.c_str());
+        capacity_ = std::max(capacity, kMinRingBytes) & ~size_t{7};
+        const size_t bytes = kRingHeaderBytes + capacity_;
+        if (::ftruncate(fd_, static_cast<off_t>(bytes)) != 0) {
+            error = std::string("ftruncate failed: ") + std::strerror(errno);
+            return false;
+        }
+        void* base = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+        if (base == MAP_FAILED) {
+            error = std::string("mmap failed: ") + std::strerror(errno);
+            return false;
+        }
+        base_ = static_cast<char*>(base);
+        std::memcpy(base_, kRingMagic, sizeof(kRingMagic));
+        const uint64_t capacity64 = capacity_;
+        std::memcpy(base_ + 8, &capacity64, sizeof(capacity64));
+        position(kRingWritePos).store(0, std::memory_order_release);
+        position(kRingReadPos).store(0, std::memory_order_release);
+        return true;
+    }
+
+    int fd() const { return fd_; }
+    size_t capacity() const { return capacity_; }
+
+    /**
+     * Copy frame (at most capacity() bytes) into the ring, waiting while
+     * the client has not released enough. offset is where it landed in the
+     * mapping, release the read position that frees it. False when stop()
+     * fired or the client's read position is corrupt.
+     */
+    bool write(const std::string& frame, uint64_t& offset, uint64_t& release,
+               const std::function<bool()>& stop) {
+        const uint64_t size = (frame.size() + 7) & ~uint64_t{7};
+        const uint64_t lap_left = capacity_ - written_ % capacity_;
+        const uint64_t skip = size > lap_left ? lap_left : 0;
+        for (int spins = 0;; ++spins) {
+            const uint64_t read = position(kRingReadPos).load(std::memory_order_acquire);
+            if (read > written_) {
+                return false;
+            }
+            if (capacity_ - (written_ - read) >= skip + size) {
+                break;
+            }
+            if (stop && stop()) {
+                return false;
+            }
+            // Spin briefly for a client reading right behind us, then back off.
+            if (spins < 64) {
+                std::this_thread::yield();
+            } else {
+                std::this_thread::sleep_for(std::chrono::microseconds(200));
+            }
+        }
+        written_ += skip;
+        char* at = base_ + kRingHeaderBytes + written_ % capacity_;
+        std::memcpy(at, frame.data(), frame.size());
+        std::memset(at + frame.size(), 0, size - frame.size());
+        offset = kRingHeaderBytes + written_ % capacity_;
+        written_ += size;
+        release = written_;
+        position(kRingWritePos).store(written_, std::memory_order_release);
+        return true;
+    }
+
+private:
+    std::atomic_ref<uint64_t> position(size_t at) {
+        return std::atomic_ref<uint64_t>(*reinterpret_cast<uint64_t*>(base_ + at));
+    }
+
+    int fd_ = -1;
+    char* base_ = nullptr;
+    size_t capacity_ = 0;
+    uint64_t written_ = 0;
+};
+
+struct IPCQuery {
+    xsql::json id;
+    std::string sql;
+    QueryParams params;
+    size_t batch_rows = kDefaultBatchRows;
+    RequestTag tag;
+    std::chrono::steady_clock::time_point arrived = std::chrono::steady_clock::now();
+};
+
+} // namespace
+
+struct IPCPendingCommand {
+    std::function<void()> work;
+    // Installed while work runs; cancelled when the client goes away or the
+    // server stops, so table callbacks stop producing rows.
+    CancelTokenPtr cancel = std::make_shared<CancelToken>();
+    bool started = false;
+    bool canceled = false;
+    bool completed = false;
+    std::chrono::steady_clock::time_point queued_at = std::chrono::steady_clock::now();
+    std::mutex done_mutex;
+    std::condition_variable done_cv;
+};
+
+enum class IPCDispatch {
+    Ok,
+    QueueFull,
+    TimedOut,
+    Stopped
+};
+
+static const char* dispatch_failure(IPCDispatch status) {
+    return status == IPCDispatch::QueueFull ? "Server busy: query queue is full"
+         : status == IPCDispatch::TimedOut ? "Server busy: queue admission timed out"
+         : "Server stopping";
+}
+
+class IDAIPCServer::Impl {
+public:
+    struct Connection {
+        int fd = -1;
+        uint64_t serial = 0;
+        std::thread thread;
+        std::atomic<bool> finished{false};
+    };
+
+    std::string path;
+    int listen_fd = -1;
+    std::thread accept_thread;
+    CursorOpener opener;
+    CursorRunner runner;
+    std::string auth_token;
+    size_t ring_bytes = kDefaultIPCRingBytes;
+    bool use_queue = false;
+    std::atomic<bool> running{false};
+    std::function<bool()> interrupt_check;
+
+    std::mutex connections_mutex;
+    std::vector<std::shared_ptr<Connection>> connections;
+    uint64_t next_serial = 0;
+
+    // Queue mode: commands run on the thread inside run_until_stopped().
+    std::mutex queue_mutex;
+    std::condition_variable queue_cv;
+    FairQueue<IPCPendingCommand> pending;
+
+    // Direct mode: the opener is not concurrency-safe; one query at a time.
+    std::mutex exec_mutex;
+
+    void accept_loop();
+    void reap_connections(bool all);
+    void serve(const std::shared_ptr<Connection>& conn);
+    bool handshake(int fd, std::string& client, std::unique_ptr<ResultRing>& ring);
+    IPCDispatch dispatch(std::function<void()> work, int fd, const RequestTag& tag,
+                         CancelTokenPtr cancel = nullptr);
+    IPCDispatch run_query(int fd, ResultRing& ring, const IPCQuery& query);
+    void complete_pending();
+};
+
+void IDAIPCServer::Impl::accept_loop() {
+    while (running.load()) {
+        pollfd p{listen_fd, POLLIN, 0};
+        const int ready = ::poll(&p, 1, 100);
+        reap_connections(false);
+        if (ready <= 0 || !(p.revents & POLLIN)) {
+            continue;
+        }
+        const int fd = ::accept(listen_fd, nullptr, nullptr);
+        if (fd < 0) {
+            continue;
+        }
+        ::fcntl(fd, F_SETFD, FD_CLOEXEC);
+#ifdef SO_NOSIGPIPE
+        int one = 1;
+        ::setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &one, sizeof(one));
+#endif
+        std::lock_guard<std::mutex> lock(connections_mutex);
+        if (connections.size() >= kMaxIPCClients) {
+            send_message(fd, xsql::json{{"ok", false}, {"error", "Too many connections"}}.dump());
+            ::close(fd);
+            continue;
+        }
+        auto conn = std::make_shared<Connection>();
+        conn->fd = fd;
+        conn->serial = ++next_serial;
+        conn->thread = std::thread([this, conn]() {
+            serve(conn);
+            ::shutdown(conn->fd, SHUT_RDWR);
+            conn->finished.store(true);
+        });
+        connections.push_back(std::move(conn));
+    }
+}
+
+void IDAIPCServer::Impl::reap_connections(bool all) {
+    std::vector<std::shared_ptr<Connection>> done;
+    {
+        std::lock_guard<std::mutex> lock(connections_mutex);
+        for (auto it = connections.begin(); it != connections.end();) {
+            if (all || (*it)->finished.load()) {
+                if (all) ::shutdown((*it)->fd, SHUT_RDWR);
+                done.push_back(std::move(*it));
+                it = connections.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+    for (auto& conn : done) {
+        if (conn->thread.joinable()) conn->thread.join();
+        ::close(conn->fd);
+    }
+}
+
+bool IDAIPCServer::Impl::handshake(int fd, std::string& client,
+                                   std::unique_ptr<ResultRing>& ring) {
+    std::string message;
+    if (!recv_message(fd, message)) {
+        return false;
+    }
+    xsql::json hello = xsql::json::parse(message, nullptr, false);
+    if (hello.is_discarded() || !hello.is_object() || text_field(hello, "op") != "hello") {
+        send_message(fd, xsql::json{{"ok", false}, {"error", "Expected hello"}}.dump());
+        return false;
+    }
+    if (!auth_token.empty() && text_field(hello, "token") != auth_token) {
+        send_message(fd, xsql::json{{"ok", false}, {"error", "Unauthorized: missing or invalid token"}}.dump());
+        return false;
+    }
+    const std::string named = text_field(hello, "client");
+    if (!named.empty()) {
+        client = named;
+    }
+
+    ring = std::make_unique<ResultRing>();
+    std::string error;
+    if (!ring->create(ring_bytes, error)) {
+        send_message(fd, xsql::json{{"ok", false}, {"error", error}}.dump());
+        return false;
+    }
+    const xsql::json reply = {
+        {"ok", true},
+        {"protocol", kIPCProtocol},
+        {"ring_bytes", ring->capacity()},
+        {"data_offset", kRingHeaderBytes},
+    };
+    return send_message(fd, reply.dump(), ring->fd());
+}
+
+void IDAIPCServer::Impl::serve(const std::shared_ptr<Connection>& conn) {
+    const int fd = conn->fd;
+    std::string client = "ipc:" + std::to_string(conn->serial);
+    std::unique_ptr<ResultRing> ring;
+    if (!handshake(fd, client, ring)) {
+        return;
+    }
+
+    std::string message;
+    while (running.load() && recv_message(fd, message)) {
+        xsql::json request = xsql::json::parse(message, nullptr, false);
+        if (request.is_discarded() || !request.is_object()) {
+            if (!send_message(fd, event_error(nullptr, "Invalid JSON message"))) return;
+            continue;
+        }
+        const std::string op = text_field(request, "op");
+        const xsql::json id = request.contains("id") ? request["id"] : xsql::json();
+        if (op == "ping") {
+            if (!send_message(fd, xsql::json{{"id", id}, {"event", "pong"}}.dump())) return;
+            continue;
+        }
+        if (op != "query") {
+            if (!send_message(fd, event_error(id, "Unknown op: " + op))) return;
+            continue;
+        }
+
+        IPCQuery query;
+        query.id = id;
+        query.sql = text_field(request, "sql");
+        query.tag.client = client;
+        std::string error;
+        if (request.contains("params") && !query_params_from_json(request["params"], query.params, error)) {
+            if (!send_message(fd, event_error(id, error))) return;
+            continue;
+        }
+        if (request.contains("batch_rows")) {
+            const xsql::json& rows = request["batch_rows"];
+            if (!rows.is_number_unsigned() || rows.get<uint64_t>() == 0) {
+                if (!send_message(fd, event_error(id, "batch_rows must be a positive integer"))) return;
+                continue;
+            }
+            query.batch_rows = static_cast<size_t>(rows.get<uint64_t>());
+        }
+        if (request.contains("priority")) {
+            const xsql::json& priority = request["priority"];
+            if (!priority.is_string() ||
+                !parse_request_class(priority.get<std::string>(), query.tag.request_class)) {
+                if (!send_message(fd, event_error(id, "priority must be interactive, batch or background"))) return;
+                continue;
+            }
+        }
+        if (query.sql.find_first_not_of(" \t\r\n;") == std::string::npos) {
+            if (!send_message(fd, event_error(id, "Empty query"))) return;
+            continue;
+        }
+
+        const IPCDispatch status = run_query(fd, *ring, query);
+        if (status != IPCDispatch::Ok) {
+            server_metrics().observe_request(
+                MetricsTransport::Ipc,
+                status == IPCDispatch::Stopped ? RequestStatus::Error : RequestStatus::Rejected,
+                seconds_since(query.arrived), 0);
+            if (!send_message(fd, event_error(id, dispatch_failure(status)))) {
+                return;
+            }
+        }
+    }
+}
+
+// fd is the client to watch (-1: none); cancel, when given, is the token
+// the work runs under, shared by every page of one query.
+IPCDispatch IDAIPCServer::Impl::dispatch(std::function<void()> work, int fd,
+                                         const RequestTag& tag, CancelTokenPtr cancel) {
+    if (!running.load()) {
+        return IPCDispatch::Stopped;
+    }
+    if (!use_queue) {
+        std::lock_guard<std::mutex> lock(exec_mutex);
+        if (runner) {
+            runner(work);
+        } else {
+            work();
+        }
+        return IPCDispatch::Ok;
+    }
+
+    auto cmd = std::make_shared<IPCPendingCommand>();
+    cmd->work = std::move(work);
+    if (cancel) {
+        cmd->cancel = std::move(cancel);
+    }
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        if (!pending.push(cmd, tag, runtime_settings().max_queue())) {
+            server_metrics().count_rejection(MetricsTransport::Ipc, RejectReason::QueueFull);
+            return IPCDispatch::QueueFull;
+        }
+        server_metrics().set_queue_depth(MetricsTransport::Ipc, pending.stats());
+    }
+    queue_cv.notify_one();
+
+    std::unique_lock<std::mutex> lock(cmd->done_mutex);
+    const int timeout_ms = runtime_settings().queue_admission_timeout_ms();
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+    auto withdraw = [&]() {
+        cmd->canceled = true;
+        lock.unlock();
+        std::lock_guard<std::mutex> qlock(queue_mutex);
+        pending.remove(cmd);
+        server_metrics().set_queue_depth(MetricsTransport::Ipc, pending.stats());
+    };
+
+    // Once started, the work item references this thread's stack, so wait
+    // for completion even if the server is stopping.
+    while (!cmd->completed) {
+        if (!cmd->started && (!running.load() || peer_closed(fd))) {
+            withdraw();
+            return IPCDispatch::Stopped;
+        }
+        if (cmd->started && (!running.load() || peer_closed(fd))) {
+            cmd->cancel->cancel();
+        }
+        if (timeout_ms <= 0 || cmd->started) {
+            cmd->done_cv.wait_for(lock, std::chrono::milliseconds(100));
+            continue;
+        }
+        if (cmd->done_cv.wait_until(lock, std::min(deadline, std::chrono::steady_clock::now() +
+                                                                 std::chrono::milliseconds(100)),
+                [&]() { return cmd->completed || cmd->started || !running.load(); })) {
+            continue;
+        }
+        if (std::chrono::steady_clock::now() < deadline) {
+            continue;
+        }
+        withdraw();
+        server_metrics().count_rejection(MetricsTransport::Ipc, RejectReason::AdmissionTimeout);
+        return IPCDispatch::TimedOut;
+    }
+    return cmd->canceled ? IPCDispatch::Stopped : IPCDispatch::Ok;
+}
+
+// Runs on the connection thread, a dispatch per page: the work steps the
+// cursor for at most batch_rows rows of one statement and encodes them as
+// a columnar frame, then this thread copies the frame into the ring
+// (waiting there while the client catches up) and announces it on the
+// socket. The cursor stays open between pages, so a slow reader delays
+// only its own next page and never holds the IDA thread. Returns the
+// failure when no page could be produced at all.
+IPCDispatch IDAIPCServer::Impl::run_query(int fd, ResultRing& ring, const IPCQuery& query) {
+    const auto started = std::chrono::steady_clock::now();
+    const std::function<bool()> stop = [this, fd]() {
+        return !running.load() || peer_closed(fd);
+    };
+    // Every page runs under this token, so the cursor chains to it and a
+    // disconnect reaches whichever page is running.
+    const CancelTokenPtr cancel = std::make_shared<CancelToken>();
+
+    QueryCursor cursor;
+    bool opened = false;
+    bool more = true;
+    CursorPagePosition position;
+    QueryResult page;
+    std::string frame;
+    const ColumnarSink sink = [&frame](const char* data, size_t size) {
+        frame.append(data, size);
+        return true;
+    };
+    auto produce = [&]() {
+        CancelScope cancelling(cancel);
+        if (!opened) {
+            cursor = opener(query.sql, query.params);
+            opened = true;
+        }
+        more = collect_cursor_page(cursor, page, query.batch_rows, position);
+        frame.clear();
+        if (page.row_count() != 0 || !page.columns.empty()) {
+            write_columnar_frame(sink, static_cast<uint32_t>(position.statement_index), "", page);
+        }
+        if (!more) {
+            cursor = QueryCursor();  // finalize where it was stepped
+        }
+    };
+
+    uint64_t rows = 0;
+    uint64_t batches = 0;
+    uint64_t bytes = 0;
+    bool delivered = true;
+    IPCDispatch status = IPCDispatch::Ok;
+    while (more) {
+        status = dispatch(produce, fd, query.tag, cancel);
+        if (status != IPCDispatch::Ok) {
+            break;
+        }
+        if (frame.empty()) {
+            break;
+        }
+        xsql::json event = {
+            {"id", query.id},
+            {"event", "batch"},
+            {"statement_index", position.statement_index},
+            {"row_offset", position.offset},
+            {"rows", page.row_count()},
+            {"length", frame.size()},
+        };
+        if (frame.size() <= ring.capacity()) {
+            uint64_t offset = 0;
+            uint64_t release = 0;
+            delivered = ring.write(frame, offset, release, stop);
+            event["offset"] = offset;
+            event["release"] = release;
+            delivered = delivered && send_message(fd, event.dump());
+        } else {
+            event["inline"] = true;
+            delivered = send_message(fd, event.dump()) && send_message(fd, frame);
+        }
+        if (!delivered) {
+            break;
+        }
+        rows += page.row_count();
+        bytes += frame.size();
+        ++batches;
+        if (!page.success) {
+            break;
+        }
+    }
+
+    if (opened && more) {
+        // Left mid-query: finalize the cursor where it was stepped. Once the
+        // server has stopped nothing runs there any more, so it is dropped
+        // here.
+        cancel->cancel();
+        auto release = [&cursor]() { cursor = QueryCursor(); };
+        while (dispatch(release, -1, query.tag) != IPCDispatch::Ok && running.load()) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));  // queue full
+        }
+    }
+    if (status != IPCDispatch::Ok && !opened) {
+        return status;
+    }
+
+    const std::chrono::duration<double, std::milli> elapsed =
+        std::chrono::steady_clock::now() - started;
+    std::string error = status != IPCDispatch::Ok ? dispatch_failure(status) : page.error;
+    if (!delivered && error.empty()) {
+        error = "Client stopped reading";
+    }
+    const bool success = status == IPCDispatch::Ok && delivered && page.success;
+    xsql::json done = {
+        {"id", query.id},
+        {"event", "done"},
+        {"success", success},
+        {"error", error.empty() ? xsql::json() : xsql::json(error)},
+        {"rows", rows},
+        {"batches", batches},
+        {"timed_out", page.timed_out},
+        {"elapsed_ms", static_cast<int64_t>(elapsed.count())},
+    };
+    send_message(fd, done.dump());
+    server_metrics().observe_request(
+        MetricsTransport::Ipc,
+        page.timed_out ? RequestStatus::Timeout
+            : success ? RequestStatus::Ok : RequestStatus::Error,
+        seconds_since(query.arrived), bytes);
+    return IPCDispatch::Ok;
+}
+
+void IDAIPCServer::Impl::complete_pending() {
+    std::vector<std::shared_ptr<IPCPendingCommand>> drained;
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        drained = pending.drain();
+        server_metrics().set_queue_depth(MetricsTransport::Ipc, pending.stats());
+    }
+    for (auto& cmd : drained) {
+        {
+            std::lock_guard<std::mutex> lock(cmd->done_mutex);
+            cmd->canceled = true;
+            cmd->completed = true;
+        }
+        cmd->done_cv.notify_one();
+    }
+}
+
+#else // _WIN32
+
+class IDAIPCServer::Impl {
+public:
+    std::atomic<bool> running{false};
+};
+
+#endif // _WIN32
+
+// ============================================================================
+// IDAIPCServer
+// ============================================================================
+
+IDAIPCServer::IDAIPCServer() = default;
+
+IDAIPCServer::~IDAIPCServer() {
+    stop();
+}
+
+bool IDAIPCServer::start(const std::string& path, CursorOpener open, bool use_queue,
+                         const std::string& auth_token, std::string* error) {
+#ifdef _WIN32
+    (void)path; (void)open; (void)use_queue; (void)auth_token;
+    if (error) *error = "Unix-domain socket transport is not supported on Windows";
+    return false;
+#else
+    auto fail = [error](const std::string& message) {
+        if (error) *error = message;
+        return false;
+    };
+    if (is_running()) {
+        return true;
+    }
+    stop();
+
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    if (path.empty() || path.size() >= sizeof(addr.sun_path)) {
+        return fail("Socket path must be 1-" + std::to_string(sizeof(addr.sun_path) - 1) +
+                    " bytes");
+    }
+    std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+
+    // Replace a socket left by a server that did not shut down cleanly, but
+    // never some other file.
+    struct stat st{};
+    if (::lstat(path.c_str(), &st) == 0) {
+        if (!S_ISSOCK(st.st_mode)) {
+            return fail(path + " exists and is not a socket");
+        }
+        ::unlink(path.c_str());
+    }
+
+    const int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return fail(std::string("socket failed: ") + std::strerror(errno));
+    }
+    ::fcntl(fd, F_SETFD, FD_CLOEXEC);
+    if (::bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 ||
+        ::chmod(path.c_str(), 0600) != 0 || ::listen(fd, 16) != 0) {
+        const std::string message = std::string("Cannot listen on ") + path + ": " + std::strerror(errno);
+        ::close(fd);
+        ::unlink(path.c_str());
+        return fail(message);
+    }
+
+    path_ = path;
+    impl_ = std::make_unique<Impl>();
+    impl_->path = path;
+    impl_->listen_fd = fd;
+    impl_->opener = std::move(open);
+    impl_->runner = cursor_runner_;
+    impl_->auth_token = auth_token;
+    impl_->ring_bytes = ring_bytes_;
+    impl_->use_queue = use_queue;
+    impl_->running.store(true);
+    Impl* impl = impl_.get();
+    impl_->accept_thread = std::thread([impl]() { impl->accept_loop(); });
+    return true;
+#endif
+}
+
+void IDAIPCServer::run_until_stopped() {
+#ifndef _WIN32
+    if (!impl_) return;
+    Impl& impl = *impl_;
+
+    while (impl.running.load()) {
+        if (impl.interrupt_check && impl.interrupt_check()) {
+            break;
+        }
+
+        std::shared_ptr<IPCPendingCommand> cmd;
+        QueueTicket ticket;
+        {
+            std::unique_lock<std::mutex> lock(impl.queue_mutex);
+            if (impl.queue_cv.wait_for(
+                    lock,
+                    std::chrono::milliseconds(100),
+                    [&impl]() { return !impl.pending.empty() || !impl.running.load(); })) {
+                cmd = impl.pending.pop(ticket);
+                server_metrics().set_queue_depth(MetricsTransport::Ipc, impl.pending.stats());
+            }
+        }
+        if (!cmd) {
+            continue;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(cmd->done_mutex);
+            if (cmd->completed || cmd->canceled) {
+                cmd->completed = true;
+                cmd->done_cv.notify_one();
+                continue;
+            }
+            cmd->started = true;
+        }
+        server_metrics().observe_queue_wait(MetricsTransport::Ipc, seconds_since(cmd->queued_at));
+
+        const auto started = std::chrono::steady_clock::now();
+        try {
+            CancelScope cancelling(cmd->cancel);
+            cmd->work();
+        } catch (const std::exception&) {
+            // The work item reports its own outcome; nothing to add here.
+        }
+        {
+            const std::chrono::duration<double, std::milli> held =
+                std::chrono::steady_clock::now() - started;
+            std::lock_guard<std::mutex> lock(impl.queue_mutex);
+            impl.pending.charge(ticket, held.count(), runtime_settings().demote_after_ms());
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(cmd->done_mutex);
+            cmd->completed = true;
+        }
+        cmd->done_cv.notify_one();
+    }
+
+    stop();
+#endif
+}
+
+void IDAIPCServer::stop() {
+#ifndef _WIN32
+    if (!impl_) return;
+    impl_->running.store(false);
+    impl_->queue_cv.notify_all();
+    impl_->complete_pending();
+    if (impl_->accept_thread.joinable()) {
+        impl_->accept_thread.join();
+    }
+    impl_->reap_connections(true);
+    ::close(impl_->listen_fd);
+    ::unlink(impl_->path.c_str());
+#endif
+    impl_.reset();
+}
+
+bool IDAIPCServer::is_running() const {
+    return impl_ && impl_->running.load();
+}
+
+void IDAIPCServer::set_interrupt_check(std::function<bool()> check) {
+#ifndef _WIN32
+    if (impl_) impl_->interrupt_check = std::move(check);
+#else
+    (void)check;
+#endif
+}
+
+void IDAIPCServer::set_cursor_runner(CursorRunner run) {
+    cursor_runner_ = std::move(run);
+}
+
+void IDAIPCServer::set_ring_bytes(size_t bytes) {
+    ring_bytes_ = bytes;
+}
+
+} // namespace idasql
@@ -0,0 +1,127 @@
+// Copyright (c) 2024-2026 Elias Bachaalany
+// SPDX-License-Identifier: MPL-2.0
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#pragma once
+
+/**
+ * ipc_server.hpp - Local Unix-domain socket transport for IDASQL
+ *
+ * IDAIPCServer serves scripts and tools on the same machine without
+ * HTTP: control messages travel over a Unix-domain socket (mode 0600) and
+ * result rows come back as columnar frames (columnar.hpp) written into a
+ * shared-memory ring the client maps. A round trip costs two small socket
+ * writes, and bulk rows are read in place (numpy.frombuffer on the
+ * mapping) instead of being copied through a socket and parsed.
+ *
+ * Messages in both directions are a u32 little-endian length followed by
+ * that many bytes: a JSON object, or the raw bytes announced by the JSON
+ * message before it.
+ *
+ *   C: {"op":"hello", "token":"...", "client":"name"}
+ *   S: {"ok":true, "protocol":1, "ring_bytes":N, "data_offset":64}
+ *      with the ring's file descriptor attached (SCM_RIGHTS); map it
+ *      shared, read/write, data_offset + ring_bytes long.
+ *      On a bad token: {"ok":false, "error":"..."} and the socket closes.
+ *   C: {"op":"ping"}                      S: {"event":"pong"}
+ *   C: {"op":"query", "id":..., "sql":"...", "params":[...],
+ *       "batch_rows":N, "priority":"interactive|batch|background"}
+ *   S: {"id":..., "event":"batch", "statement_index":i, "row_offset":r,
+ *       "rows":n, "offset":o, "length":len, "release":p}   (zero or more)
+ *      The frame is at byte o of the mapping, contiguous. Store p into
+ *      the ring's read position once done with it (frames in order).
+ *      A frame larger than the ring has "inline":true and no offset; its
+ *      bytes follow as the next message.
+ *   S: {"id":..., "event":"done", "success":b, "error":..., "rows":N,
+ *       "batches":N, "timed_out":b, "elapsed_ms":N}
+ *      or {"id":..., "event":"error", "error":"..."} when it never ran
+ *      (queue full, admission timeout, server stopping).
+ *
+ * Ring header (little-endian): "IDASQLR1", u64 ring_bytes, u64 write
+ * position at byte 16 (server), u64 read position at byte 32 (client).
+ * Positions only grow; a frame starts at data_offset + position %
+ * ring_bytes and never wraps (the writer skips to the next lap instead).
+ * Each page is produced in its own turn on the IDA thread and copied into
+ * the ring by the connection thread. While the ring is full only that
+ * thread waits for the client and the cursor stays paused, so a slow
+ * reader slows its own query, not the IDA thread, and no buffer grows.
+ * Closing the connection cancels its running query.
+ *
+ * One query runs per connection at a time; queries go through the same
+ * fair queue as HTTP (fair_queue.hpp). POSIX only: start() fails on
+ * Windows.
+ */
+
+#include "cursor_registry.hpp"
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <string>
+
+namespace idasql {
+
+// Default result ring per connection.
+constexpr size_t kDefaultIPCRingBytes = 64 * 1024 * 1024;
+
+class IDAIPCServer {
+public:
+    IDAIPCServer();
+    ~IDAIPCServer();
+
+    // Non-copyable
+    IDAIPCServer(const IDAIPCServer&) = delete;
+    IDAIPCServer& operator=(const IDAIPCServer&) = delete;
+
+    /**
+     * Listen on a Unix-domain socket
+     *
+     * @param path Socket path; a stale socket file there is replaced
+     * @param open Opens the cursor a query's batches are read from
+     * @param use_queue If true, queries are queued for the thread inside
+     *                  run_until_stopped() (CLI mode). If false, they run on
+     *                  the connection thread through the cursor runner, one
+     *                  at a time (plugin mode with execute_sync)
+     * @param auth_token If set, "hello" must carry it
+     * @param error Why the server did not start
+     * @return true when listening
+     */
+    bool start(const std::string& path, CursorOpener open, bool use_queue = false,
+               const std::string& auth_token = "", std::string* error = nullptr);
+
+    /**
+     * Block until server stops, processing queries on the calling thread.
+     * Only needed when use_queue=true (CLI mode).
+     */
+    void run_until_stopped();
+
+    /** Stop the server and remove the socket file */
+    void stop();
+
+    /** Check if server is running */
+    bool is_running() const;
+
+    /** Socket path the server listens on */
+    const std::string& path() const { return path_; }
+
+    /** Set interrupt check function (called during wait loop) */
+    void set_interrupt_check(std::function<bool()> check);
+
+    /** Where direct-mode queries run (before start); empty = connection thread */
+    void set_cursor_runner(CursorRunner run);
+
+    /** Result ring size per connection (before start) */
+    void set_ring_bytes(size_t bytes);
+
+private:
+    class Impl;
+    std::unique_ptr<Impl> impl_;
+    std::string path_;
+    CursorRunner cursor_runner_;
+    size_t ring_bytes_ = kDefaultIPCRingBytes;
+};
+
+} // namespace idasql
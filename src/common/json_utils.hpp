@@ -11,8 +11,12 @@
 
 #pragma once
 
+#include <idasql/change_feed.hpp>
 #include <idasql/database.hpp>
+#include <idasql/trace.hpp>
 
+#include <cmath>
+#include <cstdint>
 #include <string>
 #include <string_view>
 
@@ -196,24 +200,122 @@ inline void append_json_string_array(std::string& out, const std::vector<std::st
     out.push_back(']');
 }
 
+// Emit a cell as its native JSON type: integers and reals as numbers, NULL as
+// null, text (and blob bytes) as strings.
+inline void append_json_cell(std::string& out, const CellView& cell) {
+    switch (cell.type()) {
+        case CellType::Null:
+            out += "null";
+            break;
+        case CellType::Integer:
+            cell.append_to(out);
+            break;
+        case CellType::Real:
+            if (std::isfinite(cell.as_double())) {
+                cell.append_to(out);
+            } else {
+                out += "null";
+            }
+            break;
+        case CellType::Text:
+        case CellType::Blob:
+            append_json_string(out, cell.bytes());
+            break;
+    }
+}
+
+// {"tables":[{"table","access","filter_calls","rows","functions","bytes"}],
+//  "functions_decompiled":N,"memory_bytes":N}
+inline void append_query_plan_json(std::string& out, const QueryPlan& plan) {
+    out += "{\"tables\":[";
+    for (size_t i = 0; i < plan.tables.size(); ++i) {
+        const TableAccess& access = plan.tables[i];
+        if (i != 0) out.push_back(',');
+        out += "{\"table\":";
+        append_json_string(out, access.table);
+        out += ",\"access\":\"";
+        out += table_access_name(access.kind);
+        out += "\",\"filter_calls\":";
+        out += std::to_string(access.filter_calls);
+        out += ",\"rows\":";
+        out += std::to_string(access.rows);
+        out += ",\"functions\":";
+        out += std::to_string(access.functions);
+        out += ",\"bytes\":";
+        out += std::to_string(access.bytes);
+        out.push_back('}');
+    }
+    out += "],\"functions_decompiled\":";
+    out += std::to_string(plan.functions_decompiled);
+    out += ",\"memory_bytes\":";
+    out += std::to_string(plan.memory.peak);
+    out.push_back('}');
+}
+
+// {"seq","time_ms","kind","address","func_addr","target","detail"}
+inline void append_change_event_json(std::string& out, const ChangeEvent& event) {
+    out += "{\"seq\":";
+    out += std::to_string(event.seq);
+    out += ",\"time_ms\":";
+    out += std::to_string(event.time_ms);
+    out += ",\"kind\":";
+    append_json_string(out, event.kind);
+    out += ",\"address\":";
+    out += std::to_string(event.address);
+    out += ",\"func_addr\":";
+    out += std::to_string(event.func_addr);
+    out += ",\"target\":";
+    out += std::to_string(event.target);
+    out += ",\"detail\":";
+    append_json_string(out, event.detail);
+    out.push_back('}');
+}
+
+// {"success":true,"events":[...],"last_seq":N,"gap":bool,"coalesced":N}
+inline std::string change_batch_to_json(const ChangeBatch& batch) {
+    std::string out = "{\"success\":true,\"events\":[";
+    for (size_t i = 0; i < batch.events.size(); ++i) {
+        if (i != 0) out.push_back(',');
+        append_change_event_json(out, batch.events[i]);
+    }
+    out += "],\"last_seq\":";
+    out += std::to_string(batch.last_seq);
+    out += batch.gap ? ",\"gap\":true" : ",\"gap\":false";
+    out += ",\"coalesced\":";
+    out += std::to_string(batch.coalesced);
+    out.push_back('}');
+    return out;
+}
+
 inline void append_query_result_json_payload(std::string& out, const QueryResult& result) {
+    TraceSpan span("serialize", "json");
+    const size_t start_size = out.size();
     out += "\"columns\":";
     append_json_string_array(out, result.columns);
 
     out += ",\"rows\":[";
-    for (size_t i = 0; i < result.rows.size(); ++i) {
-        if (i != 0) out.push_back(',');
-        append_json_string_array(out, result.rows[i].values);
+    for (const auto& row : result) {
+        if (row.index() != 0) out.push_back(',');
+        out.push_back('[');
+        for (size_t c = 0; c < row.size(); ++c) {
+            if (c != 0) out.push_back(',');
+            append_json_cell(out, row.cell(c));
+        }
+        out.push_back(']');
     }
     out.push_back(']');
 
     out += ",\"row_count\":";
-    out += std::to_string(result.rows.size());
+    out += std::to_string(result.row_count());
 
     if (!result.warnings.empty()) {
         out += ",\"warnings\":";
         append_json_string_array(out, result.warnings);
     }
+    if (!result.plan.empty()) {
+        out += ",\"plan\":";
+        append_query_plan_json(out, result.plan);
+    }
     if (result.timed_out) {
         out += ",\"timed_out\":true";
     }
@@ -224,6 +326,8 @@ inline void append_query_result_json_payload(std::string& out, const QueryResult
         out += ",\"elapsed_ms\":";
         out += std::to_string(result.elapsed_ms);
     }
+    span.arg("rows", static_cast<int64_t>(result.row_count()));
+    span.arg("bytes", static_cast<int64_t>(out.size() - start_size));
 }
 
 inline std::string query_result_to_json_safe(const QueryResult& result) {
@@ -241,9 +345,46 @@ inline std::string query_result_to_json_safe(const QueryResult& result) {
     }
 
     out.push_back('}');
+    if (tracing()) flush_trace();  // serialization runs after the query span
     return out;
 }
 
+// Convert a JSON "params" array into bound values. Integers, reals, strings,
+// booleans (0/1) and null are accepted; anything else is an error. JsonT is
+// any nlohmann-compatible json type (xsql::json, fastmcpp's Json).
+template <typename JsonT>
+bool query_params_from_json(const JsonT& value, QueryParams& out, std::string& error) {
+    out.clear();
+    if (value.is_null()) {
+        return true;
+    }
+    if (!value.is_array()) {
+        error = "params must be a JSON array";
+        return false;
+    }
+    out.reserve(value.size());
+    for (size_t i = 0; i < value.size(); ++i) {
+        const auto& item = value[i];
+        if (item.is_null()) {
+            out.emplace_back();
+        } else if (item.is_boolean()) {
+            out.emplace_back(item.template get<bool>() ? 1 : 0);
+        } else if (item.is_number_unsigned()) {
+            out.emplace_back(item.template get<uint64_t>());
+        } else if (item.is_number_integer()) {
+            out.emplace_back(item.template get<int64_t>());
+        } else if (item.is_number_float()) {
+            out.emplace_back(item.template get<double>());
+        } else if (item.is_string()) {
+            out.emplace_back(item.template get<std::string>());
+        } else {
+            error = "params[" + std::to_string(i) + "] must be a number, string, boolean or null";
+            return false;
+        }
+    }
+    return true;
+}
+
 // Multi-statement JSON emission goes through idasql::run_sql_script (see
 // sql_script.hpp) + xsql::script_result_to_json. The per-statement helper
 // query_result_to_json_safe above is for internal callers working with a
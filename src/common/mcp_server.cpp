@@ -7,6 +7,11 @@
 
 #include "mcp_server.hpp"
 #include "idasql_version.hpp"
+#include "json_utils.hpp"
+#include "server_metrics.hpp"
+#include "sql_script.hpp"
+#include <idasql/change_feed.hpp>
+#include <idasql/result_cache.hpp>
 #include <idasql/runtime_settings.hpp>
 
 #include <fastmcpp/mcp/handler.hpp>
@@ -30,6 +35,118 @@ static bool starts_with_text(const std::string& value, const char* prefix) {
     return value.rfind(prefix, 0) == 0;
 }
 
+// Query callbacks return the JSON script envelope, or "Error: ..." when
+// the request never reached the engine.
+static bool is_error_result(const std::string& value) {
+    return starts_with_text(value, "Error: ") || starts_with_text(value, "{\"success\":false");
+}
+
+// MCP sessions are not told apart: the server's cursors share one quota.
+static constexpr const char* kMCPCursorClient = "mcp";
+
+// Scheduling class and client from the "priority" and "client" arguments.
+static bool mcp_request_tag(const Json& args, RequestTag& tag, std::string& error) {
+    const std::string priority = args.value("priority", std::string());
+    if (!priority.empty() && !parse_request_class(priority, tag.request_class)) {
+        error = "priority must be interactive, batch or background";
+        return false;
+    }
+    tag.client = args.value("client", std::string(kMCPCursorClient));
+    return true;
+}
+
+static Json priority_schema() {
+    return {
+        {"type", "string"},
+        {"enum", Json::array({"interactive", "batch", "background"})},
+        {"description", "Scheduling class on the IDA thread (default interactive); "
+                        "use batch or background for bulk work"}
+    };
+}
+
+static Json client_schema() {
+    return {
+        {"type", "string"},
+        {"description", "Caller identity for fair sharing of the IDA thread within a class"}
+    };
+}
+
+// idasql_batch: statements per call and the longest budget.
+static constexpr size_t kMaxBatchStatements = 100;
+static constexpr int kMaxBatchBudgetMs = 3600 * 1000;
+
+struct MCPBatchItem {
+    std::string sql;
+    QueryParams params;
+    std::string cache_key;
+    std::shared_ptr<const std::string> body;  // envelope, or "Error: ..."
+    bool skipped = false;                     // not started within the budget
+};
+
+// {"sql": "...", "params": [...]} or a plain SQL string.
+static bool parse_batch_item(const Json& value, MCPBatchItem& item, std::string& error) {
+    if (value.is_string()) {
+        item.sql = value.get<std::string>();
+    } else if (value.is_object()) {
+        item.sql = value.value("sql", value.value("query", std::string()));
+        if (value.contains("params") && !query_params_from_json(value["params"], item.params, error)) {
+            return false;
+        }
+    } else {
+        error = "expected a SQL string or {\"sql\", \"params\"} object";
+        return false;
+    }
+    if (!has_sql_tokens(item.sql)) {
+        error = "empty statement";
+        return false;
+    }
+    return true;
+}
+
+// {"success", "statement_count", "completed", "budget_exhausted",
+//  "elapsed_ms", "results": [{"index", "success", "result" | "error",
+//  "skipped"}]}; result is the statement's idasql_query envelope.
+static std::string batch_to_json(const std::vector<MCPBatchItem>& items, long long elapsed_ms) {
+    bool success = true;
+    size_t completed = 0;
+    bool exhausted = false;
+    std::string results = "[";
+    for (size_t i = 0; i < items.size(); ++i) {
+        const MCPBatchItem& item = items[i];
+        if (i > 0) results.push_back(',');
+        results += "{\"index\":" + std::to_string(i);
+        if (item.skipped || !item.body) {
+            success = false;
+            exhausted = exhausted || item.skipped;
+            results += ",\"success\":false,\"skipped\":true,\"error\":";
+            append_json_string(results, item.skipped ? "Batch time budget exhausted before this statement"
+                                                     : "Statement was not run");
+        } else if (starts_with_text(*item.body, "Error: ")) {
+            success = false;
+            ++completed;
+            results += ",\"success\":false,\"skipped\":false,\"error\":";
+            append_json_string(results, std::string_view(*item.body).substr(7));
+        } else {
+            const bool ok = !is_error_result(*item.body);
+            success = success && ok;
+            ++completed;
+            results += ok ? ",\"success\":true" : ",\"success\":false";
+            results += ",\"skipped\":false,\"result\":";
+            results += *item.body;
+        }
+        results.push_back('}');
+    }
+    results.push_back(']');
+
+    std::string out = success ? "{\"success\":true" : "{\"success\":false";
+    out += ",\"statement_count\":" + std::to_string(items.size());
+    out += ",\"completed\":" + std::to_string(completed);
+    out += exhausted ? ",\"budget_exhausted\":true" : ",\"budget_exhausted\":false";
+    out += ",\"elapsed_ms\":" + std::to_string(elapsed_ms);
+    out += ",\"results\":" + results + "}";
+    return out;
+}
+
 class IDAMCPServer::Impl {
 public:
     fastmcpp::tools::ToolManager tool_manager;
@@ -42,7 +159,10 @@ IDAMCPServer::~IDAMCPServer() {
     stop();
 }
 
-MCPQueueResult IDAMCPServer::queue_and_wait(MCPPendingCommand::Type type, const std::string& input) {
+MCPQueueResult IDAMCPServer::queue_and_wait(MCPPendingCommand::Type type, const std::string& input,
+                                            const QueryParams& params,
+                                            std::function<std::string()> work,
+                                            const RequestTag& tag) {
     if (!running_.load()) {
         return {false, "Error: MCP server is not running"};
     }
@@ -50,15 +170,17 @@ MCPQueueResult IDAMCPServer::queue_and_wait(MCPPendingCommand::Type type, const
     auto cmd = std::make_shared<MCPPendingCommand>();
     cmd->type = type;
     cmd->input = input;
+    cmd->params = params;
+    cmd->work = std::move(work);
     cmd->completed = false;
 
     {
         std::lock_guard<std::mutex> lock(queue_mutex_);
-        const size_t max_queue = idasql::runtime_settings().max_queue();
-        if (max_queue > 0 && pending_commands_.size() >= max_queue) {
-            return {false, "Error: MCP queue is full (raise PRAGMA idasql.max_queue)"};
+        if (!pending_commands_.push(cmd, tag, idasql::runtime_settings().max_queue())) {
+            server_metrics().count_rejection(MetricsTransport::Mcp, RejectReason::QueueFull);
+            return {false, "Error: MCP queue is full (raise PRAGMA idasql.max_queue)", true};
         }
-        pending_commands_.push_back(cmd);
+        server_metrics().set_queue_depth(MetricsTransport::Mcp, pending_commands_.stats());
     }
     queue_cv_.notify_one();
 
@@ -94,28 +216,51 @@ MCPQueueResult IDAMCPServer::queue_and_wait(MCPPendingCommand::Type type, const
                 lock.unlock();
                 {
                     std::lock_guard<std::mutex> qlock(queue_mutex_);
-                    auto it = std::find(pending_commands_.begin(), pending_commands_.end(), cmd);
-                    if (it != pending_commands_.end()) {
-                        pending_commands_.erase(it);
-                    }
+                    pending_commands_.remove(cmd);
+                    server_metrics().set_queue_depth(MetricsTransport::Mcp, pending_commands_.stats());
                 }
-                return {false, "Error: MCP request timed out in queue (raise PRAGMA idasql.queue_admission_timeout_ms)"};
+                server_metrics().count_rejection(MetricsTransport::Mcp, RejectReason::AdmissionTimeout);
+                return {false, "Error: MCP request timed out in queue (raise PRAGMA idasql.queue_admission_timeout_ms)",
+                        true};
             }
         }
     }
 
     if (!cmd->completed) {
+        // Still running on the main thread: stop its table callbacks early.
+        cmd->cancel->cancel();
         if (!running_.load()) {
             return {false, "Error: MCP server stopped"};
         }
         return {false, "Error: MCP request timed out in queue (raise PRAGMA idasql.queue_admission_timeout_ms)"};
     }
 
-    // Convention: query callbacks return "Error: ..." on failure
-    bool ok = !starts_with_text(cmd->result, "Error: ");
+    bool ok = !is_error_result(cmd->result);
     return {ok, cmd->result};
 }
 
+MCPQueueResult IDAMCPServer::run_cursor_work(std::function<std::string()> work,
+                                             const RequestTag& tag) {
+    if (!cursor_opener_) {
+        return {false, "Error: paging is not supported by this server"};
+    }
+    auto on_ida_thread = [this, work]() {
+        std::string out;
+        if (cursor_runner_) {
+            cursor_runner_([&]() { out = work(); });
+        } else {
+            out = work();
+        }
+        return out;
+    };
+    if (use_queue_.load()) {
+        return queue_and_wait(MCPPendingCommand::Type::Cursor, std::string(), {}, on_ida_thread, tag);
+    }
+    std::string out = on_ida_thread();
+    const bool ok = !is_error_result(out);
+    return {ok, std::move(out)};
+}
+
 int IDAMCPServer::start(int port, QueryCallback query_cb,
                         const std::string& bind_addr, bool use_queue) {
     if (running_.load()) {
@@ -141,7 +286,28 @@ int IDAMCPServer::start(int port, QueryCallback query_cb,
             {"query", {
                 {"type", "string"},
                 {"description", "SQL query or semicolon-separated script to execute against the IDA database"}
-            }}
+            }},
+            {"params", {
+                {"type", "array"},
+                {"items", {{"type", {"integer", "number", "string", "boolean", "null"}}}},
+                {"description", "Optional values bound to ?, ?NNN or :name placeholders, in order"}
+            }},
+            {"explain", {
+                {"type", "boolean"},
+                {"description", "Return the pre-execution cost estimate instead of running the query"}
+            }},
+            {"snapshot", {
+                {"type", "boolean"},
+                {"description", "Run read-only against the snapshot file (PRAGMA idasql.snapshot) "
+                                "in parallel, without waiting for the IDA thread"}
+            }},
+            {"page_size", {
+                {"type", "integer"},
+                {"description", "Return at most this many rows plus a cursor_id while more remain; "
+                                "fetch the rest with idasql_cursor (not with snapshot)"}
+            }},
+            {"priority", priority_schema()},
+            {"client", client_schema()}
         }},
         {"required", Json::array({"query"})}
     };
@@ -154,6 +320,7 @@ int IDAMCPServer::start(int port, QueryCallback query_cb,
         query_input_schema,
         Json(),
         [this](const Json& args) -> Json {
+            const auto arrived = std::chrono::steady_clock::now();
             std::string query = args.value("query", "");
             if (query.empty()) {
                 return Json{
@@ -163,30 +330,92 @@ int IDAMCPServer::start(int port, QueryCallback query_cb,
                     {"isError", true}
                 };
             }
+            if (args.value("explain", false)) {
+                query = explain_cost_sql(query);
+            }
+
+            QueryParams params;
+            std::string params_error;
+            RequestTag tag;
+            if (!mcp_request_tag(args, tag, params_error) ||
+                (args.contains("params") &&
+                 !query_params_from_json(args["params"], params, params_error))) {
+                return Json{
+                    {"content", Json::array({
+                        Json{{"type", "text"}, {"text", "Error: " + params_error}}
+                    })},
+                    {"isError", true}
+                };
+            }
 
             std::string result;
             bool success = true;
-
-            if (use_queue_.load()) {
-                auto qr = queue_and_wait(MCPPendingCommand::Type::Query, query);
+            bool rejected = false;
+            const size_t page_size = args.value("page_size", static_cast<size_t>(0));
+
+            if (page_size > 0 && !args.value("snapshot", false)) {
+                // One cursor for the whole text; pages never mix statements.
+                auto qr = run_cursor_work([this, query, params, page_size]() {
+                    return cursor_page_to_json(
+                        cursors_.open(cursor_opener_(query, params), kMCPCursorClient, page_size));
+                }, tag);
                 result = qr.payload;
                 success = qr.success;
+                rejected = qr.rejected;
+            } else if (args.value("snapshot", false)) {
+                // Pool workers answer directly; nothing runs on the IDA thread.
+                auto script = run_typed_script(query, params, run_on_snapshot);
+                result = format_typed_script_json(script);
+                success = script.success;
             } else {
-                if (!query_cb_) {
-                    return Json{
-                        {"content", Json::array({
-                            Json{{"type", "text"}, {"text", "Error: query callback not set"}}
-                        })},
-                        {"isError", true}
-                    };
-                }
-                result = query_cb_(query);
-                // Convention: query callbacks return "Error: ..." on failure
-                if (starts_with_text(result, "Error: ")) {
-                    success = false;
+                // A repeated read at an unchanged IDB epoch skips the IDA
+                // thread; identical reads arriving while one runs share it.
+                const std::string cache_key = result_cache_key("mcp", query, params);
+                if (auto cached = result_cache().find(cache_key)) {
+                    result = *cached;
+                } else {
+                    if (!use_queue_.load() && !query_cb_) {
+                        return Json{
+                            {"content", Json::array({
+                                Json{{"type", "text"}, {"text", "Error: query callback not set"}}
+                            })},
+                            {"isError", true}
+                        };
+                    }
+                    const FlightResult flight = single_flight().run(
+                        class_scoped_key(cache_key, tag.request_class),
+                        [&]() -> std::shared_ptr<const std::string> {
+                            const uint64_t epoch = idb_epoch();
+                            if (use_queue_.load()) {
+                                auto qr = queue_and_wait(MCPPendingCommand::Type::Query, query,
+                                                         params, {}, tag);
+                                result = std::move(qr.payload);
+                                success = qr.success;
+                                rejected = qr.rejected;
+                            } else {
+                                result = query_cb_(query, params);
+                            }
+                            if (is_error_result(result)) {
+                                success = false;
+                            }
+                            if (!success) {
+                                return nullptr;
+                            }
+                            auto body = std::make_shared<const std::string>(result);
+                            result_cache().store(cache_key, epoch, body);
+                            return body;
+                        },
+                        [this]() { return !running_.load(); });
+                    if (!flight.led) {
+                        result = flight.body ? *flight.body : "Error: MCP server stopped";
+                        success = flight.body != nullptr;
+                    }
                 }
             }
 
+            server_metrics().observe_request(MetricsTransport::Mcp,
+                                             rejected ? RequestStatus::Rejected : envelope_status(result),
+                                             seconds_since(arrived), result.size());
             return Json{
                 {"content", Json::array({
                     Json{{"type", "text"}, {"text", result}}
@@ -195,11 +424,290 @@ int IDAMCPServer::start(int port, QueryCallback query_cb,
             };
         }
     };
-    sql_query_tool.set_description("Execute a SQL query or semicolon-separated script against the IDA database and return results");
+    sql_query_tool.set_description("Execute a SQL query or semicolon-separated script against the IDA database; "
+                                   "returns the JSON result envelope (rows, warnings, per-table scan plan)");
     impl_->tool_manager.register_tool(sql_query_tool);
 
+    Json cursor_input_schema = {
+        {"type", "object"},
+        {"properties", {
+            {"cursor", {
+                {"type", "string"},
+                {"description", "cursor_id returned by idasql_query with page_size (or by a previous page)"}
+            }},
+            {"page_size", {
+                {"type", "integer"},
+                {"description", "Rows in this page (default: the size the cursor was opened with)"}
+            }},
+            {"close", {
+                {"type", "boolean"},
+                {"description", "Close the cursor instead of reading the next page"}
+            }},
+            {"priority", priority_schema()},
+            {"client", client_schema()}
+        }},
+        {"required", Json::array({"cursor"})}
+    };
+    fastmcpp::tools::Tool cursor_tool{
+        "idasql_cursor",
+        cursor_input_schema,
+        Json(),
+        [this](const Json& args) -> Json {
+            const auto arrived = std::chrono::steady_clock::now();
+            const std::string id = args.value("cursor", "");
+            const size_t page_size = args.value("page_size", static_cast<size_t>(0));
+            const bool close = args.value("close", false);
+            RequestTag tag;
+            std::string tag_error;
+            if (!mcp_request_tag(args, tag, tag_error)) {
+                return Json{
+                    {"content", Json::array({
+                        Json{{"type", "text"}, {"text", "Error: " + tag_error}}
+                    })},
+                    {"isError", true}
+                };
+            }
+            auto qr = run_cursor_work([this, id, page_size, close]() -> std::string {
+                if (close) {
+                    return cursors_.close(id, kMCPCursorClient)
+                        ? "{\"success\":true}"
+                        : "Error: Unknown or expired cursor: " + id;
+                }
+                CursorPage page;
+                std::string error;
+                if (!cursors_.next(id, kMCPCursorClient, page_size, page, error)) {
+                    return "Error: " + error;
+                }
+                return cursor_page_to_json(page);
+            }, tag);
+            server_metrics().observe_request(MetricsTransport::Mcp,
+                                             qr.rejected ? RequestStatus::Rejected : envelope_status(qr.payload),
+                                             seconds_since(arrived), qr.payload.size());
+            return Json{
+                {"content", Json::array({
+                    Json{{"type", "text"}, {"text", qr.payload}}
+                })},
+                {"isError", !qr.success}
+            };
+        }
+    };
+    cursor_tool.set_description("Read the next page of an idasql_query page_size cursor (same statement, "
+                                "no re-execution) or close it; cursor_id is null on the last page");
+    impl_->tool_manager.register_tool(cursor_tool);
+
+    // Many small lookups in one call: one queue admission and one slot on
+    // the IDA thread for all of them instead of a round trip each.
+    Json batch_input_schema = {
+        {"type", "object"},
+        {"properties", {
+            {"statements", {
+                {"type", "array"},
+                {"items", {
+                    {"oneOf", Json::array({
+                        Json{{"type", "string"}},
+                        Json{
+                            {"type", "object"},
+                            {"properties", {
+                                {"sql", {{"type", "string"}}},
+                                {"params", {
+                                    {"type", "array"},
+                                    {"items", {{"type", {"integer", "number", "string", "boolean", "null"}}}}
+                                }}
+                            }},
+                            {"required", Json::array({"sql"})}
+                        }
+                    })}
+                }},
+                {"description", "SQL texts, or {sql, params} objects, run in order (at most 100); "
+                                "each entry may itself be a semicolon-separated script"}
+            }},
+            {"budget_ms", {
+                {"type", "integer"},
+                {"description", "Overall time budget including the queue wait; statements not started "
+                                "in time are reported as skipped and a running one stops with "
+                                "timed_out (default: none, each statement keeps the query timeout)"}
+            }},
+            {"priority", priority_schema()},
+            {"client", client_schema()}
+        }},
+        {"required", Json::array({"statements"})}
+    };
+    fastmcpp::tools::Tool batch_tool{
+        "idasql_batch",
+        batch_input_schema,
+        Json(),
+        [this](const Json& args) -> Json {
+            auto fail = [](const std::string& message) {
+                return Json{
+                    {"content", Json::array({
+                        Json{{"type", "text"}, {"text", "Error: " + message}}
+                    })},
+                    {"isError", true}
+                };
+            };
+            const auto arrived = std::chrono::steady_clock::now();
+            if (!args.contains("statements") || !args["statements"].is_array() ||
+                args["statements"].empty()) {
+                return fail("statements must be a non-empty array");
+            }
+            const Json& statements = args["statements"];
+            if (statements.size() > kMaxBatchStatements) {
+                return fail("at most " + std::to_string(kMaxBatchStatements) + " statements per batch");
+            }
+            RequestTag tag;
+            std::string error;
+            if (!mcp_request_tag(args, tag, error)) {
+                return fail(error);
+            }
+            const int budget_ms = std::clamp(args.value("budget_ms", 0), 0, kMaxBatchBudgetMs);
+
+            auto items = std::make_shared<std::vector<MCPBatchItem>>(statements.size());
+            for (size_t i = 0; i < statements.size(); ++i) {
+                MCPBatchItem& item = (*items)[i];
+                if (!parse_batch_item(statements[i], item, error)) {
+                    return fail("statements[" + std::to_string(i) + "]: " + error);
+                }
+                // Same key and body as idasql_query: cached reads skip the slot.
+                item.cache_key = result_cache_key("mcp", item.sql, item.params);
+                item.body = result_cache().find(item.cache_key);
+            }
+
+            // Runs where queries run; owns items, so a waiter that gives up
+            // (server stopping) leaves nothing dangling.
+            auto work = [this, items, arrived, budget_ms]() -> std::string {
+                const uint64_t epoch = idb_epoch();
+                const auto deadline = arrived + std::chrono::milliseconds(budget_ms);
+                auto budget = std::make_shared<CancelToken>(current_cancel_token());
+                if (budget_ms > 0) {
+                    budget->set_deadline(deadline);
+                }
+                CancelScope cancelling(budget);
+                const QueryCallback& run = batch_cb_ ? batch_cb_ : query_cb_;
+                for (MCPBatchItem& item : *items) {
+                    if (item.body) {
+                        continue;
+                    }
+                    if (budget->expired() ||
+                        (budget_ms > 0 && std::chrono::steady_clock::now() >= deadline)) {
+                        item.skipped = true;
+                        continue;
+                    }
+                    std::string body;
+                    try {
+                        body = run ? run(item.sql, item.params) : "Error: query callback not set";
+                    } catch (const std::exception& e) {
+                        body = std::string("Error: ") + e.what();
+                    }
+                    item.body = std::make_shared<const std::string>(std::move(body));
+                    if (!is_error_result(*item.body)) {
+                        result_cache().store(item.cache_key, epoch, item.body);
+                    }
+                }
+                const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+                    std::chrono::steady_clock::now() - arrived);
+                return batch_to_json(*items, elapsed.count());
+            };
+
+            std::string result;
+            bool ran = true;
+            bool rejected = false;
+            const bool all_cached = std::all_of(items->begin(), items->end(),
+                                                [](const MCPBatchItem& item) { return item.body != nullptr; });
+            if (all_cached) {
+                result = work();
+            } else if (use_queue_.load()) {
+                auto qr = queue_and_wait(MCPPendingCommand::Type::Batch, std::string(), {}, work, tag);
+                result = std::move(qr.payload);
+                ran = !starts_with_text(result, "Error: ");
+                rejected = qr.rejected;
+            } else if (batch_runner_) {
+                batch_runner_([&]() { result = work(); });
+            } else {
+                result = work();
+            }
+            server_metrics().observe_request(MetricsTransport::Mcp,
+                                             rejected ? RequestStatus::Rejected : envelope_status(result),
+                                             seconds_since(arrived), result.size());
+            // Statement failures are reported per entry; isError means the
+            // batch itself did not run (queue full, timed out, stopped).
+            return Json{
+                {"content", Json::array({
+                    Json{{"type", "text"}, {"text", result}}
+                })},
+                {"isError", !ran}
+            };
+        }
+    };
+    batch_tool.set_description("Run up to 100 SQL statements (each with optional params) in one call and one "
+                               "IDA-thread slot; returns per-statement envelopes and errors, with an optional "
+                               "overall time budget_ms");
+    impl_->tool_manager.register_tool(batch_tool);
+
+    // The SSE transport only answers requests, so changes are delivered by a
+    // call that blocks until they happen rather than by unsolicited messages.
+    Json changes_input_schema = {
+        {"type", "object"},
+        {"properties", {
+            {"since", {
+                {"type", "integer"},
+                {"description", "Return changes with seq greater than this (last_seq of the previous call; 0 = all retained)"}
+            }},
+            {"timeout_ms", {
+                {"type", "integer"},
+                {"description", "Wait up to this long for the first change (default 25000, max 60000)"}
+            }},
+            {"limit", {
+                {"type", "integer"},
+                {"description", "Read at most this many changes (default 1000)"}
+            }}
+        }}
+    };
+    fastmcpp::tools::Tool changes_tool{
+        "idasql_changes",
+        changes_input_schema,
+        Json(),
+        [this](const Json& args) -> Json {
+            const uint64_t since = args.value("since", static_cast<uint64_t>(0));
+            const int timeout_ms = std::clamp(args.value("timeout_ms", 25000), 0, 60000);
+            const size_t limit = args.value("limit", static_cast<size_t>(1000));
+            const ChangeBatch batch = wait_for_changes(since, limit, timeout_ms,
+                                                       [this]() { return !running_.load(); });
+            return Json{
+                {"content", Json::array({
+                    Json{{"type", "text"}, {"text", change_batch_to_json(batch)}}
+                })},
+                {"isError", false}
+            };
+        }
+    };
+    changes_tool.set_description("Wait for IDB changes (renames, comments, functions, types, patches, xrefs) "
+                                 "after a sequence number; returns events plus last_seq for the next call");
+    impl_->tool_manager.register_tool(changes_tool);
+
+    // Same text as HTTP GET /metrics; the SSE transport serves no extra routes.
+    fastmcpp::tools::Tool metrics_tool{
+        "idasql_metrics",
+        Json{{"type", "object"}, {"properties", Json::object()}},
+        Json(),
+        [](const Json&) -> Json {
+            return Json{
+                {"content", Json::array({
+                    Json{{"type", "text"}, {"text", server_metrics().format()}}
+                })},
+                {"isError", false}
+            };
+        }
+    };
+    metrics_tool.set_description("Server metrics in Prometheus text format: queue depth and wait, request "
+                                 "latency by outcome, rejections, rows, timeouts, cache hit rates, memory");
+    impl_->tool_manager.register_tool(metrics_tool);
+
     std::unordered_map<std::string, std::string> descriptions = {
-        {"idasql_query", "Execute a SQL query or semicolon-separated script against the IDA database and return results"}
+        {"idasql_query", "Execute a SQL query or semicolon-separated script against the IDA database and return results"},
+        {"idasql_cursor", "Fetch the next page of a paged idasql_query result or close its cursor"},
+        {"idasql_batch", "Execute many small SQL statements in one round trip and return each statement's result"},
+        {"idasql_changes", "Block until the IDA database changes after a given sequence number and return the changes"},
+        {"idasql_metrics", "Return queue, latency, cache and memory metrics in Prometheus text format"}
     };
 
     auto handler = fastmcpp::mcp::make_mcp_handler(
@@ -243,16 +751,15 @@ void IDAMCPServer::run_until_stopped() {
         }
 
         std::shared_ptr<MCPPendingCommand> cmd;
+        QueueTicket ticket;
         {
             std::unique_lock<std::mutex> lock(queue_mutex_);
             if (queue_cv_.wait_for(
                     lock,
                     std::chrono::milliseconds(100),
                     [this]() { return !pending_commands_.empty() || !running_.load(); })) {
-                if (!pending_commands_.empty()) {
-                    cmd = pending_commands_.front();
-                    pending_commands_.pop_front();
-                }
+                cmd = pending_commands_.pop(ticket);
+                server_metrics().set_queue_depth(MetricsTransport::Mcp, pending_commands_.stats());
             }
         }
 
@@ -266,6 +773,7 @@ void IDAMCPServer::run_until_stopped() {
             if (!cmd->completed && !cmd->canceled) {
                 cmd->started = true;
                 should_execute = true;
+                server_metrics().observe_queue_wait(MetricsTransport::Mcp, seconds_since(cmd->queued_at));
             } else if (!cmd->completed && cmd->canceled) {
                 cmd->completed = true;
             }
@@ -277,15 +785,28 @@ void IDAMCPServer::run_until_stopped() {
         }
 
         std::string result;
+        const auto started = std::chrono::steady_clock::now();
         try {
             if (cmd->type == MCPPendingCommand::Type::Query && query_cb_) {
-                result = query_cb_(cmd->input);
+                CancelScope cancelling(cmd->cancel);
+                result = query_cb_(cmd->input, cmd->params);
+            } else if ((cmd->type == MCPPendingCommand::Type::Cursor ||
+                        cmd->type == MCPPendingCommand::Type::Batch) && cmd->work) {
+                CancelScope cancelling(cmd->cancel);
+                result = cmd->work();
             } else {
                 result = "Error: No handler for command type";
             }
         } catch (const std::exception& e) {
             result = std::string("Error: ") + e.what();
         }
+        {
+            const std::chrono::duration<double, std::milli> held =
+                std::chrono::steady_clock::now() - started;
+            std::lock_guard<std::mutex> lock(queue_mutex_);
+            pending_commands_.charge(ticket, held.count(),
+                                     idasql::runtime_settings().demote_after_ms());
+        }
 
         {
             std::lock_guard<std::mutex> lock(cmd->done_mutex);
@@ -296,6 +817,10 @@ void IDAMCPServer::run_until_stopped() {
         }
         cmd->done_cv.notify_one();
     }
+
+    // Cursors hold statements on the engine; release them on this thread
+    // while it is still open.
+    cursors_.clear();
 }
 
 void IDAMCPServer::stop() {
@@ -308,18 +833,28 @@ void IDAMCPServer::stop() {
     }
 
     impl_.reset();
+    cursors_.clear();
+}
+
+void IDAMCPServer::set_cursor_executor(CursorOpener open, CursorRunner run) {
+    cursor_opener_ = std::move(open);
+    cursor_runner_ = std::move(run);
+}
+
+void IDAMCPServer::set_batch_executor(QueryCallback run, CursorRunner runner) {
+    batch_cb_ = std::move(run);
+    batch_runner_ = std::move(runner);
 }
 
 void IDAMCPServer::complete_pending_commands(const std::string& result) {
-    std::deque<std::shared_ptr<MCPPendingCommand>> pending;
+    std::vector<std::shared_ptr<MCPPendingCommand>> pending;
     {
         std::lock_guard<std::mutex> lock(queue_mutex_);
-        std::swap(pending, pending_commands_);
+        pending = pending_commands_.drain();
+        server_metrics().set_queue_depth(MetricsTransport::Mcp, pending_commands_.stats());
     }
 
-    while (!pending.empty()) {
-        auto cmd = pending.front();
-        pending.pop_front();
+    for (const auto& cmd : pending) {
         if (!cmd) {
             continue;
         }
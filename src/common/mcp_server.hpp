@@ -13,16 +13,23 @@
  * IDAMCPServer - MCP server for IDASQL
  *
  * Thread-safe MCP server using command queue pattern.
- * Tool handlers queue commands for execution on the main thread.
+ * Tool handlers queue commands for execution on the main thread, in the
+ * fair order of fair_queue.hpp (tool arguments "priority" and "client").
  *
  * Usage modes:
  * 1. CLI (idalib): Call run_until_stopped() to process commands on main thread
  * 2. Plugin: Use execute_sync() wrapper in callbacks (no run_until_stopped() needed)
  */
 
+#include <idasql/cancel.hpp>
+#include <idasql/query_result.hpp>
+
+#include "cursor_registry.hpp"
+#include "fair_queue.hpp"
+
 #include <atomic>
+#include <chrono>
 #include <condition_variable>
-#include <deque>
 #include <functional>
 #include <memory>
 #include <mutex>
@@ -30,19 +37,27 @@
 
 namespace idasql {
 
-// SQL callback for handling requests.
-using QueryCallback = std::function<std::string(const std::string& sql)>;
+// SQL callback for handling requests. params are bound to every statement
+// that takes parameters (empty when the client sent none).
+using QueryCallback = std::function<std::string(const std::string& sql, const QueryParams& params)>;
 
 // Internal command structure for cross-thread execution.
 struct MCPPendingCommand {
-    enum class Type { Query };
+    enum class Type { Query, Cursor, Batch };
 
     Type type = Type::Query;
     std::string input;
+    QueryParams params;
+    // Type::Cursor: page work returning the JSON page. Type::Batch: every
+    // statement of an idasql_batch call, returning its JSON envelope.
+    std::function<std::string()> work;
     std::string result;
+    // Installed while the command runs; cancelled if the waiter gives up.
+    CancelTokenPtr cancel = std::make_shared<CancelToken>();
     bool started = false;
     bool canceled = false;
     bool completed = false;
+    std::chrono::steady_clock::time_point queued_at = std::chrono::steady_clock::now();
     std::mutex done_mutex;
     std::condition_variable done_cv;
 };
@@ -50,6 +65,8 @@ struct MCPPendingCommand {
 struct MCPQueueResult {
     bool success;
     std::string payload;
+    // Refused before running: queue full or admission timeout.
+    bool rejected = false;
 };
 
 class IDAMCPServer {
@@ -110,11 +127,29 @@ public:
      */
     void set_interrupt_check(std::function<bool()> check);
 
+    /**
+     * Set how idasql_query's page_size opens server-side cursors (before
+     * start). run moves cursor work to the IDA thread; leave it empty in
+     * queue mode.
+     */
+    void set_cursor_executor(CursorOpener open, CursorRunner run = {});
+
+    /**
+     * Set how idasql_batch runs its statements in one slot (before start).
+     * run executes one text where queries run, without marshaling; runner
+     * moves the whole batch there. Leave both empty in queue mode; without
+     * them a direct-mode batch calls the query callback per statement.
+     */
+    void set_batch_executor(QueryCallback run, CursorRunner runner = {});
+
     /**
      * Queue a command for execution on the main thread.
      * Called by MCP tool handlers when use_queue=true.
      */
-    MCPQueueResult queue_and_wait(MCPPendingCommand::Type type, const std::string& input);
+    MCPQueueResult queue_and_wait(MCPPendingCommand::Type type, const std::string& input,
+                                  const QueryParams& params = {},
+                                  std::function<std::string()> work = {},
+                                  const RequestTag& tag = {});
 
 private:
     std::function<bool()> interrupt_check_;
@@ -126,10 +161,19 @@ private:
     // Command queue for cross-thread execution (CLI mode)
     std::mutex queue_mutex_;
     std::condition_variable queue_cv_;
-    std::deque<std::shared_ptr<MCPPendingCommand>> pending_commands_;
+    FairQueue<MCPPendingCommand> pending_commands_;
 
     // Callback stored for execution.
     QueryCallback query_cb_;
+    CursorOpener cursor_opener_;
+    CursorRunner cursor_runner_;
+    CursorRegistry cursors_;
+    QueryCallback batch_cb_;
+    CursorRunner batch_runner_;
+
+    // Page work (idasql_query page_size, idasql_cursor): queued in CLI
+    // mode, run directly otherwise.
+    MCPQueueResult run_cursor_work(std::function<std::string()> work, const RequestTag& tag);
 
     // Forward declaration - impl hides fastmcpp.
     class Impl;
@@ -0,0 +1,292 @@
+// Copyright (c) 2024-2026 Elias Bachaalany
+// SPDX-License-Identifier: MPL-2.0
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#include "server_metrics.hpp"
+#include <idasql/result_cache.hpp>
+#include <idasql/vtable_stats.hpp>
+
+#include <cstdio>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#include <psapi.h>
+#elif defined(__APPLE__)
+#include <mach/mach.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace idasql {
+
+namespace {
+
+const char* transport_name(size_t transport) {
+    switch (static_cast<MetricsTransport>(transport)) {
+        case MetricsTransport::Mcp: return "mcp";
+        case MetricsTransport::Ipc: return "ipc";
+        default: return "http";
+    }
+}
+
+const char* status_name(size_t status) {
+    switch (static_cast<RequestStatus>(status)) {
+        case RequestStatus::Error: return "error";
+        case RequestStatus::Timeout: return "timeout";
+        case RequestStatus::Rejected: return "rejected";
+        default: return "ok";
+    }
+}
+
+const char* reason_name(size_t reason) {
+    return static_cast<RejectReason>(reason) == RejectReason::AdmissionTimeout
+        ? "admission_timeout" : "queue_full";
+}
+
+// Shortest round-trip text for a bucket bound or sum ("0.0025", "60").
+std::string format_number(double value) {
+    char buffer[32];
+    std::snprintf(buffer, sizeof(buffer), "%.9g", value);
+    return buffer;
+}
+
+uint64_t load(const std::atomic<uint64_t>& value) {
+    return value.load(std::memory_order_relaxed);
+}
+
+void append_header(std::string& out, const char* name, const char* type, const char* help) {
+    out += "# HELP ";
+    out += name;
+    out.push_back(' ');
+    out += help;
+    out += "\n# TYPE ";
+    out += name;
+    out.push_back(' ');
+    out += type;
+    out.push_back('\n');
+}
+
+void append_sample(std::string& out, const char* name, const std::string& labels, uint64_t value) {
+    out += name;
+    if (!labels.empty()) {
+        out.push_back('{');
+        out += labels;
+        out.push_back('}');
+    }
+    out.push_back(' ');
+    out += std::to_string(value);
+    out.push_back('\n');
+}
+
+// Metric with one unlabelled sample.
+void append_single(std::string& out, const char* name, const char* type, const char* help,
+                   uint64_t value) {
+    append_header(out, name, type, help);
+    append_sample(out, name, std::string(), value);
+}
+
+std::string transport_label(size_t transport) {
+    return std::string("transport=\"") + transport_name(transport) + "\"";
+}
+
+} // namespace
+
+// ============================================================================
+// LatencyHistogram
+// ============================================================================
+
+void LatencyHistogram::observe(double seconds) {
+    if (seconds < 0) {
+        seconds = 0;
+    }
+    size_t bucket = 0;
+    while (bucket < kLatencyBucketCount && seconds > kLatencyBuckets[bucket]) {
+        ++bucket;
+    }
+    buckets_[bucket].fetch_add(1, std::memory_order_relaxed);
+    count_.fetch_add(1, std::memory_order_relaxed);
+    sum_us_.fetch_add(static_cast<uint64_t>(seconds * 1e6), std::memory_order_relaxed);
+}
+
+void LatencyHistogram::format(std::string& out, const char* name, const std::string& labels) const {
+    const std::string bucket_name = std::string(name) + "_bucket";
+    const std::string prefix = labels.empty() ? std::string() : labels + ",";
+    // Buckets are counted individually and published cumulatively; a
+    // concurrent observe() may make _count run one ahead of +Inf.
+    uint64_t cumulative = 0;
+    for (size_t i = 0; i < kLatencyBucketCount; ++i) {
+        cumulative += load(buckets_[i]);
+        append_sample(out, bucket_name.c_str(),
+                      prefix + "le=\"" + format_number(kLatencyBuckets[i]) + "\"", cumulative);
+    }
+    cumulative += load(buckets_[kLatencyBucketCount]);
+    append_sample(out, bucket_name.c_str(), prefix + "le=\"+Inf\"", cumulative);
+
+    out += name;
+    out += "_sum";
+    if (!labels.empty()) {
+        out += "{" + labels + "}";
+    }
+    out += " " + format_number(static_cast<double>(load(sum_us_)) / 1e6) + "\n";
+    append_sample(out, (std::string(name) + "_count").c_str(), labels, load(count_));
+}
+
+// ============================================================================
+// ServerMetrics
+// ============================================================================
+
+ServerMetrics& ServerMetrics::instance() {
+    static ServerMetrics metrics;
+    return metrics;
+}
+
+void ServerMetrics::set_queue_depth(MetricsTransport transport, const FairQueueStats& queue) {
+    PerTransport& t = transports_[static_cast<size_t>(transport)];
+    for (size_t c = 0; c < kRequestClassCount; ++c) {
+        t.queue_depth[c].store(queue.depth[c], std::memory_order_relaxed);
+    }
+}
+
+void ServerMetrics::observe_queue_wait(MetricsTransport transport, double seconds) {
+    transports_[static_cast<size_t>(transport)].queue_wait.observe(seconds);
+}
+
+void ServerMetrics::observe_request(MetricsTransport transport, RequestStatus status,
+                                    double seconds, uint64_t bytes) {
+    PerTransport& t = transports_[static_cast<size_t>(transport)];
+    t.requests[static_cast<size_t>(status)].observe(seconds);
+    t.bytes.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+void ServerMetrics::count_rejection(MetricsTransport transport, RejectReason reason) {
+    transports_[static_cast<size_t>(transport)]
+        .rejections[static_cast<size_t>(reason)]
+        .fetch_add(1, std::memory_order_relaxed);
+}
+
+std::string ServerMetrics::format() const {
+    std::string out;
+    out.reserve(16 * 1024);
+
+    append_header(out, "idasql_queue_depth", "gauge",
+                  "Commands waiting for the IDA thread, by request class.");
+    for (size_t t = 0; t < kMetricsTransportCount; ++t) {
+        for (size_t c = 0; c < kRequestClassCount; ++c) {
+            append_sample(out, "idasql_queue_depth",
+                          transport_label(t) + ",class=\"" +
+                              request_class_name(static_cast<RequestClass>(c)) + "\"",
+                          load(transports_[t].queue_depth[c]));
+        }
+    }
+
+    append_header(out, "idasql_queue_wait_seconds", "histogram",
+                  "Time a command waited in the queue before the IDA thread took it.");
+    for (size_t t = 0; t < kMetricsTransportCount; ++t) {
+        transports_[t].queue_wait.format(out, "idasql_queue_wait_seconds", transport_label(t));
+    }
+
+    append_header(out, "idasql_request_duration_seconds", "histogram",
+                  "Query request latency from arrival to response, by outcome.");
+    for (size_t t = 0; t < kMetricsTransportCount; ++t) {
+        for (size_t s = 0; s < kRequestStatusCount; ++s) {
+            transports_[t].requests[s].format(
+                out, "idasql_request_duration_seconds",
+                transport_label(t) + ",status=\"" + status_name(s) + "\"");
+        }
+    }
+
+    append_header(out, "idasql_response_bytes_total", "counter",
+                  "Response body bytes sent for query requests.");
+    for (size_t t = 0; t < kMetricsTransportCount; ++t) {
+        append_sample(out, "idasql_response_bytes_total", transport_label(t),
+                      load(transports_[t].bytes));
+    }
+
+    append_header(out, "idasql_admission_rejections_total", "counter",
+                  "Requests refused before running (queue full or admission timeout).");
+    for (size_t t = 0; t < kMetricsTransportCount; ++t) {
+        for (size_t r = 0; r < kRejectReasonCount; ++r) {
+            append_sample(out, "idasql_admission_rejections_total",
+                          transport_label(t) + ",reason=\"" + reason_name(r) + "\"",
+                          load(transports_[t].rejections[r]));
+        }
+    }
+
+    const EngineStats& engine = engine_stats();
+    append_single(out, "idasql_rows_returned_total", "counter",
+                  "Rows produced by finished query cursors.", load(engine.rows_returned));
+    append_single(out, "idasql_query_timeouts_total", "counter",
+                  "Queries stopped by PRAGMA idasql.query_timeout_ms or a request deadline.",
+                  load(engine.query_timeouts));
+    append_single(out, "idasql_decompile_cache_hits_total", "counter",
+                  "Hex-Rays decompilations served from the cache.", load(engine.decompile_cache_hits));
+    append_single(out, "idasql_decompile_cache_misses_total", "counter",
+                  "Hex-Rays decompilations that had to run.", load(engine.decompile_cache_misses));
+    append_single(out, "idasql_statement_cache_hits_total", "counter",
+                  "Prepared statements reused.", load(engine.statement_cache_hits));
+    append_single(out, "idasql_statement_cache_misses_total", "counter",
+                  "Statements prepared from scratch.", load(engine.statement_cache_misses));
+    append_single(out, "idasql_result_cache_hits_total", "counter",
+                  "Reads answered from the result cache.", load(engine.result_cache_hits));
+    append_single(out, "idasql_result_cache_misses_total", "counter",
+                  "Cacheable reads that were not cached.", load(engine.result_cache_misses));
+    append_single(out, "idasql_queries_coalesced_total", "counter",
+                  "Reads served by an identical read that was already running.",
+                  load(engine.queries_coalesced));
+    append_single(out, "idasql_result_cache_bytes", "gauge",
+                  "Bytes held by the result cache.", result_cache().stats().bytes);
+    append_single(out, "process_resident_memory_bytes", "gauge",
+                  "Resident memory size in bytes.", process_resident_bytes());
+    return out;
+}
+
+RequestStatus envelope_status(const std::string& body) {
+    if (body.rfind("{\"success\":", 0) != 0) {
+        return RequestStatus::Error;  // "Error: ..." or not an envelope
+    }
+    // Quotes inside JSON strings are escaped, so this only matches a key.
+    if (body.find("\"timed_out\":true") != std::string::npos) {
+        return RequestStatus::Timeout;
+    }
+    return body.rfind("{\"success\":true", 0) == 0 ? RequestStatus::Ok : RequestStatus::Error;
+}
+
+uint64_t process_resident_bytes() {
+#if defined(_WIN32)
+    PROCESS_MEMORY_COUNTERS counters{};
+    if (K32GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        return static_cast<uint64_t>(counters.WorkingSetSize);
+    }
+    return 0;
+#elif defined(__APPLE__)
+    mach_task_basic_info_data_t info{};
+    mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+    if (task_info(mach_task_self(), MACH_TASK_BASIC_INFO,
+                  reinterpret_cast<task_info_t>(&info), &count) == KERN_SUCCESS) {
+        return static_cast<uint64_t>(info.resident_size);
+    }
+    return 0;
+#else
+    // /proc/self/statm: size resident shared ... in pages.
+    FILE* file = std::fopen("/proc/self/statm", "r");
+    if (!file) {
+        return 0;
+    }
+    unsigned long long size = 0;
+    unsigned long long resident = 0;
+    const int read = std::fscanf(file, "%llu %llu", &size, &resident);
+    std::fclose(file);
+    if (read != 2) {
+        return 0;
+    }
+    return static_cast<uint64_t>(resident) * static_cast<uint64_t>(::sysconf(_SC_PAGESIZE));
+#endif
+}
+
+} // namespace idasql
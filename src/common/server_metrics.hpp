@@ -0,0 +1,137 @@
+// Copyright (c) 2024-2026 Elias Bachaalany
+// SPDX-License-Identifier: MPL-2.0
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#pragma once
+
+/**
+ * server_metrics.hpp - Operational metrics of the IDASQL servers
+ *
+ * /status reports how a server is configured; these report how it is
+ * doing. The HTTP, MCP and IPC servers record into one process-wide
+ * registry, rendered in the Prometheus text exposition format (0.0.4) by
+ * HTTP GET /metrics and the MCP idasql_metrics tool:
+ *
+ *   idasql_queue_depth{transport,class}                  gauge
+ *   idasql_queue_wait_seconds{transport}                 histogram, queued
+ *                                                        until the IDA thread
+ *                                                        took it
+ *   idasql_request_duration_seconds{transport,status}    histogram, status =
+ *                                                        ok|error|timeout|rejected
+ *   idasql_response_bytes_total{transport}               counter
+ *   idasql_admission_rejections_total{transport,reason}  counter, reason =
+ *                                                        queue_full|admission_timeout
+ *
+ * plus engine counters read when scraped (rows returned, query timeouts,
+ * decompile/result/statement cache hits and misses, coalesced reads) and
+ * process_resident_memory_bytes. Server series are never reset; the
+ * engine counters restart at PRAGMA idasql.stats_reset, which scrapers
+ * treat as an ordinary counter reset.
+ */
+
+#include "fair_queue.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace idasql {
+
+enum class MetricsTransport {
+    Http = 0,
+    Mcp = 1,
+    Ipc = 2
+};
+
+constexpr size_t kMetricsTransportCount = 3;
+
+enum class RequestStatus {
+    Ok = 0,
+    Error = 1,
+    Timeout = 2,
+    Rejected = 3
+};
+
+constexpr size_t kRequestStatusCount = 4;
+
+enum class RejectReason {
+    QueueFull = 0,
+    AdmissionTimeout = 1
+};
+
+constexpr size_t kRejectReasonCount = 2;
+
+constexpr const char* kMetricsContentType = "text/plain; version=0.0.4; charset=utf-8";
+
+// Upper bounds (seconds) shared by every latency histogram: interactive
+// lookups land in the first buckets, full decompiles in the last.
+constexpr double kLatencyBuckets[] = {0.0005, 0.001, 0.0025, 0.005, 0.01, 0.025, 0.05,
+                                      0.1, 0.25, 0.5, 1.0, 2.5, 5.0, 10.0, 30.0, 60.0};
+constexpr size_t kLatencyBucketCount = sizeof(kLatencyBuckets) / sizeof(kLatencyBuckets[0]);
+
+class LatencyHistogram {
+public:
+    void observe(double seconds);
+
+    // Appends the _bucket/_sum/_count lines for name{labels}.
+    void format(std::string& out, const char* name, const std::string& labels) const;
+
+private:
+    std::atomic<uint64_t> buckets_[kLatencyBucketCount + 1] = {};  // last = +Inf only
+    std::atomic<uint64_t> count_{0};
+    std::atomic<uint64_t> sum_us_{0};
+};
+
+class ServerMetrics {
+public:
+    static ServerMetrics& instance();
+
+    ServerMetrics(const ServerMetrics&) = delete;
+    ServerMetrics& operator=(const ServerMetrics&) = delete;
+
+    // Current depth per class; servers call it under their queue mutex
+    // after every change.
+    void set_queue_depth(MetricsTransport transport, const FairQueueStats& queue);
+    void observe_queue_wait(MetricsTransport transport, double seconds);
+    void observe_request(MetricsTransport transport, RequestStatus status, double seconds,
+                         uint64_t bytes);
+    void count_rejection(MetricsTransport transport, RejectReason reason);
+
+    // The whole exposition, engine counters included.
+    std::string format() const;
+
+private:
+    ServerMetrics() = default;
+
+    struct PerTransport {
+        std::atomic<uint64_t> queue_depth[kRequestClassCount] = {};
+        LatencyHistogram queue_wait;
+        LatencyHistogram requests[kRequestStatusCount];
+        std::atomic<uint64_t> bytes{0};
+        std::atomic<uint64_t> rejections[kRejectReasonCount] = {};
+    };
+
+    PerTransport transports_[kMetricsTransportCount];
+};
+
+inline ServerMetrics& server_metrics() {
+    return ServerMetrics::instance();
+}
+
+inline double seconds_since(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Status of a JSON script envelope (format_typed_script_json) or an
+// "Error: ..." reply.
+RequestStatus envelope_status(const std::string& body);
+
+// Resident set size of this process in bytes; 0 when unknown.
+uint64_t process_resident_bytes();
+
+} // namespace idasql
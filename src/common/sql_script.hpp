@@ -13,48 +13,382 @@
  * idasql callers (CLI, HTTP, MCP, plugin) all dispatch SQL through this
  * single helper. The output is xsql::ScriptResult — the canonical
  * always-array envelope — formatted via xsql::script_result_to_json
- * or xsql::script_result_to_text. No idasql-side multi-statement glue.
+ * or xsql::script_result_to_text.
+ *
+ * The HTTP server needs typed per-statement results (native JSON numbers,
+ * bound parameters), so it uses run_typed_script() and the format_* helpers
+ * below instead; they emit the same envelope shape.
  */
 
+#include <idasql/columnar.hpp>
 #include <idasql/database.hpp>
+#include <idasql/snapshot.hpp>
 
 #include <xsql/query_script.hpp>
 
+#include "json_utils.hpp"
+
+#include <cctype>
+#include <chrono>
 #include <functional>
 #include <string>
+#include <string_view>
+#include <vector>
+
+#include <sqlite3.h>
 
 namespace idasql {
 
 using SqlExecutor = std::function<QueryResult(const std::string& sql)>;
 
+// Render a typed QueryResult into xsql's string-based statement envelope.
+// This is the single place cells are formatted as text on the script path.
+inline void fill_script_statement_result(const QueryResult& r,
+                                         xsql::ScriptStatementResult& out)
+{
+    out.columns = r.columns;
+    out.rows.reserve(r.row_count());
+    for (const auto& row : r) {
+        out.rows.push_back(row.values());
+    }
+    out.elapsed_ms = static_cast<double>(r.elapsed_ms);
+    out.success = r.success;
+    out.error = r.error;
+}
+
 inline xsql::ScriptResult run_sql_script(const std::string& sql,
                                          const SqlExecutor& exec,
                                          const xsql::ScriptOptions& options = {})
 {
     return xsql::run_script(sql, options,
         [&exec](const std::string& stmt, xsql::ScriptStatementResult& out) {
-            QueryResult r = exec(stmt);
-
-            out.columns = r.columns;
-            out.rows.reserve(r.rows.size());
-            for (const auto& row : r.rows) {
-                out.rows.push_back(row.values);
-            }
-            out.elapsed_ms = static_cast<double>(r.elapsed_ms);
-            out.success = r.success;
-            out.error = r.error;
+            fill_script_statement_result(exec(stmt), out);
         });
 }
 
 // Convenience for the common case: executor wraps Database::query.
+// params are bound to every statement that takes parameters.
 inline xsql::ScriptResult run_sql_script(Database& db,
                                          const std::string& sql,
+                                         const QueryParams& params = {},
                                          const xsql::ScriptOptions& options = {})
 {
     return run_sql_script(
         sql,
-        [&db](const std::string& stmt) { return db.query(stmt); },
+        [&db, &params](const std::string& stmt) { return db.query(stmt, params); },
         options);
 }
 
+// ============================================================================
+// Typed scripts (HTTP)
+// ============================================================================
+
+// True if text holds anything besides whitespace, comments and ';'.
+inline bool has_sql_tokens(const std::string& text) {
+    for (size_t i = 0; i < text.size(); ++i) {
+        const char c = text[i];
+        if (c == ';' || std::isspace(static_cast<unsigned char>(c))) continue;
+        if (c == '-' && i + 1 < text.size() && text[i + 1] == '-') {
+            i = text.find('\n', i);
+            if (i == std::string::npos) return false;
+            continue;
+        }
+        if (c == '/' && i + 1 < text.size() && text[i + 1] == '*') {
+            i = text.find("*/", i + 2);
+            if (i == std::string::npos) return false;
+            ++i;
+            continue;
+        }
+        return true;
+    }
+    return false;
+}
+
+// Split a script into complete statements (quote-, comment- and
+// trigger-aware via sqlite3_complete). Fails on an unterminated quote,
+// comment or trigger body.
+inline bool split_sql_statements(const std::string& sql,
+                                 std::vector<std::string>& out,
+                                 std::string& error) {
+    out.clear();
+    std::string current;
+    for (char c : sql) {
+        current.push_back(c);
+        if (c == ';' && sqlite3_complete(current.c_str())) {
+            if (has_sql_tokens(current)) out.push_back(std::move(current));
+            current.clear();
+        }
+    }
+    if (has_sql_tokens(current)) {
+        if (!sqlite3_complete((current + ";").c_str())) {
+            error = "Incomplete SQL: unterminated quote, comment or trigger body";
+            out.clear();
+            return false;
+        }
+        out.push_back(std::move(current));
+    }
+    return true;
+}
+
+// Wrap a script as PRAGMA idasql.explain_cost = '<sql>' so explain-only
+// requests (HTTP explain=1, MCP "explain") price it without running it.
+inline std::string explain_cost_sql(const std::string& sql) {
+    std::string out = "PRAGMA idasql.explain_cost = '";
+    for (char c : sql) {
+        if (c == '\'') out.push_back('\'');
+        out.push_back(c);
+    }
+    out.push_back('\'');
+    return out;
+}
+
+struct TypedStatementResult {
+    std::string sql;
+    QueryResult result;
+};
+
+struct TypedScriptResult {
+    std::vector<TypedStatementResult> statements;
+    bool success = true;
+    int first_error_index = -1;
+    std::string parse_error;
+};
+
+using TypedExecutor = std::function<QueryResult(const std::string& sql, const QueryParams& params)>;
+
+// Appends one statement's result; false when the script stops there.
+inline bool record_typed_statement(TypedScriptResult& script, std::string sql,
+                                   QueryResult result, bool continue_on_error)
+{
+    TypedStatementResult item;
+    item.result = std::move(result);
+    item.sql = std::move(sql);
+    const bool ok = item.result.success;
+    script.statements.push_back(std::move(item));
+    if (!ok) {
+        if (script.first_error_index < 0) {
+            script.first_error_index = static_cast<int>(script.statements.size() - 1);
+        }
+        script.success = false;
+        return continue_on_error;
+    }
+    return true;
+}
+
+inline TypedScriptResult run_typed_script(const std::string& sql,
+                                          const QueryParams& params,
+                                          const TypedExecutor& exec,
+                                          bool continue_on_error = false)
+{
+    TypedScriptResult script;
+    std::vector<std::string> statements;
+    if (!split_sql_statements(sql, statements, script.parse_error)) {
+        script.success = false;
+        return script;
+    }
+    for (auto& stmt : statements) {
+        QueryResult result = exec(stmt, params);
+        if (!record_typed_statement(script, std::move(stmt), std::move(result), continue_on_error)) {
+            break;
+        }
+    }
+    return script;
+}
+
+// Runs work on the thread that owns the database and returns when it is
+// done (the plugin's execute_sync).
+using ScriptSliceRunner = std::function<void(const std::function<void()>& work)>;
+
+// run_typed_script() in as few thread hops as possible: each run_slice
+// call executes statements until slice_ms has passed (at least one; 0 =
+// the whole script), then returns so the owning thread can serve its own
+// events before the next slice. exec runs inside the slice and must not
+// hop threads itself.
+inline TypedScriptResult run_typed_script_sliced(const std::string& sql,
+                                                 const QueryParams& params,
+                                                 const TypedExecutor& exec,
+                                                 const ScriptSliceRunner& run_slice,
+                                                 int slice_ms,
+                                                 bool continue_on_error = false)
+{
+    TypedScriptResult script;
+    std::vector<std::string> statements;
+    if (!split_sql_statements(sql, statements, script.parse_error)) {
+        script.success = false;
+        return script;
+    }
+    size_t next = 0;
+    bool stopped = false;
+    while (next < statements.size() && !stopped) {
+        const size_t first = next;
+        run_slice([&]() {
+            const auto slice_end = std::chrono::steady_clock::now() + std::chrono::milliseconds(slice_ms);
+            do {
+                std::string& stmt = statements[next++];
+                QueryResult result = exec(stmt, params);
+                stopped = !record_typed_statement(script, std::move(stmt), std::move(result),
+                                                  continue_on_error);
+            } while (!stopped && next < statements.size() &&
+                     (slice_ms <= 0 || std::chrono::steady_clock::now() < slice_end));
+        });
+        if (next == first) {
+            // The runner dropped the slice (e.g. IDA is closing).
+            QueryResult skipped;
+            skipped.success = false;
+            skipped.error = "Statement was not run";
+            record_typed_statement(script, std::move(statements[next]), std::move(skipped), false);
+            break;
+        }
+    }
+    return script;
+}
+
+// TypedExecutor answering from the snapshot file (PRAGMA idasql.snapshot)
+// on a pool worker; never touches IDA, so it may run on any thread.
+inline QueryResult run_on_snapshot(const std::string& sql, const QueryParams& params) {
+    return snapshot_pool().query(sql, params);
+}
+
+inline std::string format_typed_script_json(const TypedScriptResult& script, bool include_sql = false) {
+    std::string out;
+    out.reserve(256);
+    out += "{\"success\":";
+    out += script.success ? "true" : "false";
+    out += ",\"statement_count\":";
+    out += std::to_string(script.statements.size());
+    out += ",\"results\":[";
+
+    size_t row_total = 0;
+    long long elapsed_total = 0;
+    for (size_t i = 0; i < script.statements.size(); ++i) {
+        const auto& stmt = script.statements[i];
+        const QueryResult& r = stmt.result;
+        if (i != 0) out.push_back(',');
+        out += "{\"statement_index\":";
+        out += std::to_string(i);
+        if (include_sql) {
+            out += ",\"sql\":";
+            append_json_string(out, stmt.sql);
+        }
+        out += ",\"success\":";
+        out += r.success ? "true" : "false";
+        out.push_back(',');
+        append_query_result_json_payload(out, r);
+        if (r.elapsed_ms <= 0) {
+            out += ",\"elapsed_ms\":0";
+        }
+        out += ",\"error\":";
+        if (r.success) {
+            out += "null";
+        } else {
+            append_json_string(out, r.error);
+        }
+        out.push_back('}');
+        row_total += r.row_count();
+        elapsed_total += r.elapsed_ms;
+    }
+
+    out += "],\"row_count_total\":";
+    out += std::to_string(row_total);
+    out += ",\"elapsed_ms_total\":";
+    out += std::to_string(elapsed_total);
+    out += ",\"first_error_index\":";
+    out += script.first_error_index < 0 ? "null" : std::to_string(script.first_error_index);
+    if (!script.parse_error.empty()) {
+        out += ",\"parse_error\":";
+        append_json_string(out, script.parse_error);
+    }
+    out.push_back('}');
+    if (tracing()) flush_trace();  // serialization runs after the query spans
+    return out;
+}
+
+inline std::string format_typed_script_text(const TypedScriptResult& script) {
+    if (!script.parse_error.empty()) {
+        return "Error: " + script.parse_error;
+    }
+    std::string out;
+    for (size_t i = 0; i < script.statements.size(); ++i) {
+        const QueryResult& r = script.statements[i].result;
+        if (!out.empty()) out += "\n\n";
+        if (!r.success) {
+            out += "Error in statement " + std::to_string(i + 1) + ": " + r.error;
+        } else if (r.columns.empty()) {
+            out += "OK";
+        } else {
+            out += r.to_string();
+        }
+    }
+    return out;
+}
+
+// One columnar frame per statement (columnar.hpp); a script that fails to
+// parse becomes a single failed frame.
+inline std::string format_typed_script_columnar(const TypedScriptResult& script) {
+    std::string out;
+    const ColumnarSink sink = [&out](const char* data, size_t size) {
+        out.append(data, size);
+        return true;
+    };
+    if (!script.parse_error.empty()) {
+        QueryResult failed;
+        failed.error = script.parse_error;
+        write_columnar_header(sink, 1);
+        write_columnar_frame(sink, 0, "", failed);
+        return out;
+    }
+    write_columnar_header(sink, static_cast<uint32_t>(script.statements.size()));
+    for (size_t i = 0; i < script.statements.size(); ++i) {
+        write_columnar_frame(sink, static_cast<uint32_t>(i), "", script.statements[i].result);
+    }
+    return out;
+}
+
+// CSV (RFC 4180 quoting) or TSV (tabs/newlines in cells become spaces).
+inline void append_delimited_cell(std::string& out, std::string_view cell, char sep) {
+    if (sep == '\t') {
+        for (char c : cell) out.push_back((c == '\t' || c == '\n' || c == '\r') ? ' ' : c);
+        return;
+    }
+    if (cell.find_first_of(",\"\r\n") == std::string_view::npos) {
+        out.append(cell.data(), cell.size());
+        return;
+    }
+    out.push_back('"');
+    for (char c : cell) {
+        if (c == '"') out.push_back('"');
+        out.push_back(c);
+    }
+    out.push_back('"');
+}
+
+inline std::string format_typed_script_delimited(const TypedScriptResult& script, char sep) {
+    auto append_cell = [sep](std::string& out, std::string_view cell) {
+        append_delimited_cell(out, cell, sep);
+    };
+
+    std::string out;
+    std::string scratch;
+    for (const auto& stmt : script.statements) {
+        const QueryResult& r = stmt.result;
+        if (!r.success || r.columns.empty()) continue;
+        if (!out.empty()) out += "\n";
+        for (size_t c = 0; c < r.columns.size(); ++c) {
+            if (c != 0) out.push_back(sep);
+            append_cell(out, r.columns[c]);
+        }
+        out += "\n";
+        for (const auto& row : r) {
+            for (size_t c = 0; c < row.size(); ++c) {
+                if (c != 0) out.push_back(sep);
+                scratch.clear();
+                row.cell(c).append_to(scratch);
+                append_cell(out, scratch);
+            }
+            out += "\n";
+        }
+    }
+    return out;
+}
+
 } // namespace idasql
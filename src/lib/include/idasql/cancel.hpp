@@ -0,0 +1,119 @@
+// Copyright (c) 2024-2026 Elias Bachaalany
+// SPDX-License-Identifier: MPL-2.0
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+/**
+ * cancel.hpp - Cooperative cancellation for long-running table callbacks
+ *
+ * SQLite's progress handler only runs between VM instructions, so a
+ * generator that decompiles every function or a cache builder that walks
+ * every head runs to completion inside a single xFilter/xNext call before a
+ * timeout can take effect. Those loops poll query_cancelled() instead and
+ * stop producing rows as soon as it returns true.
+ *
+ * Each QueryCursor owns a CancelToken carrying its deadline
+ * (PRAGMA idasql.query_timeout_ms) and installs it while SQLite runs. A
+ * token may chain to a parent, so a server can create one token per
+ * request, install it with CancelScope around the request's work, and
+ * cancel() it from another thread (client gone, server stopping): every
+ * cursor opened under it stops within one poll interval.
+ *
+ * Example (generator):
+ *   bool next() override {
+ *       if (query_cancelled()) return false;   // per function
+ *       ...
+ *   }
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+
+namespace idasql {
+
+bool query_cancelled();
+
+class CancelToken {
+public:
+    using clock = std::chrono::steady_clock;
+
+    explicit CancelToken(std::shared_ptr<CancelToken> parent = nullptr);
+
+    // Thread-safe; sticky.
+    void cancel();
+
+    // Cancelled directly or through a parent.
+    bool cancelled() const;
+
+    void set_deadline(clock::time_point deadline);
+    void clear_deadline();
+    bool deadline_passed() const;
+
+    // Cancelled or past the deadline.
+    bool expired() const { return cancelled() || deadline_passed(); }
+
+    // A table callback saw query_cancelled() return true for this token,
+    // i.e. some rows were not produced.
+    bool tripped() const { return tripped_.load(std::memory_order_relaxed); }
+
+private:
+    friend bool query_cancelled();
+
+    std::shared_ptr<CancelToken> parent_;
+    std::atomic<bool> cancelled_{false};
+    mutable std::atomic<bool> tripped_{false};
+    std::atomic<int64_t> deadline_ticks_{0};  // clock ticks since epoch; 0 = none
+};
+
+using CancelTokenPtr = std::shared_ptr<CancelToken>;
+
+// Token installed on this thread, or nullptr.
+CancelTokenPtr current_cancel_token();
+
+// Install token as the current one for the scope's lifetime.
+class CancelScope {
+public:
+    explicit CancelScope(CancelTokenPtr token);
+    ~CancelScope();
+
+    CancelScope(const CancelScope&) = delete;
+    CancelScope& operator=(const CancelScope&) = delete;
+
+private:
+    CancelTokenPtr previous_;
+};
+
+// True when the query running on this thread should stop producing rows:
+// cancelled, past its deadline, or over PRAGMA idasql.max_query_memory.
+// Cheap enough to call once per function or segment chunk.
+bool query_cancelled();
+
+/**
+ * Throttled poll for per-item loops (heads, operands, xrefs): checks the
+ * token every `every` calls and stays true once it fired.
+ */
+class CancelPoll {
+public:
+    explicit CancelPoll(uint32_t every = 256) : every_(every ? every : 1) {}
+
+    bool operator()() {
+        if (fired_) return true;
+        if (++count_ < every_) return false;
+        count_ = 0;
+        fired_ = query_cancelled();
+        return fired_;
+    }
+
+private:
+    uint32_t every_;
+    uint32_t count_ = 0;
+    bool fired_ = false;
+};
+
+} // namespace idasql
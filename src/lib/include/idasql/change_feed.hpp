@@ -0,0 +1,69 @@
+// Copyright (c) 2024-2026 Elias Bachaalany
+// SPDX-License-Identifier: MPL-2.0
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+/**
+ * change_feed.hpp - Blocking reads of the idb_changes feed for push clients
+ *
+ * The same ring that backs the idb_changes table, for servers that push
+ * changes to subscribers (HTTP /changes, MCP idasql_changes). Each
+ * subscriber keeps its own cursor (the last seq it saw), so a slow one
+ * never holds back IDA or other subscribers: it reads later, and if the
+ * ring has moved past its cursor the batch says so (gap) instead of
+ * buffering without bound. Repeated events for the same kind/address/
+ * target within a batch are coalesced into the newest one.
+ *
+ * Example:
+ *   uint64_t seq = last_change_seq();
+ *   for (;;) {
+ *       ChangeBatch batch = wait_for_changes(seq, 256, 1000, stop);
+ *       for (const auto& ev : batch.events) send(ev);
+ *       seq = batch.last_seq;
+ *   }
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace idasql {
+
+struct ChangeEvent {
+    uint64_t seq = 0;
+    int64_t time_ms = 0;        // Unix time
+    std::string kind;           // renamed, cmt_changed, func_added, ...
+    uint64_t address = 0;
+    uint64_t func_addr = 0;     // containing function (0 = none)
+    uint64_t target = 0;        // xref destination (0 = none)
+    std::string detail;
+};
+
+struct ChangeBatch {
+    std::vector<ChangeEvent> events;
+    // Cursor for the next call: covers coalesced records too.
+    uint64_t last_seq = 0;
+    // Records after the requested seq were dropped from the ring.
+    bool gap = false;
+    // Records folded into a newer event for the same kind/address/target.
+    size_t coalesced = 0;
+};
+
+// Seq of the newest change (0 = none yet).
+uint64_t last_change_seq();
+
+/**
+ * Changes with seq > after, reading at most max_records ring records.
+ * Blocks up to timeout_ms for the first one (0 = don't wait); stop is polled
+ * while waiting and ends the wait early. Thread-safe.
+ */
+ChangeBatch wait_for_changes(uint64_t after, size_t max_records, int timeout_ms,
+                             const std::function<bool()>& stop = {});
+
+} // namespace idasql
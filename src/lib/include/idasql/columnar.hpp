@@ -0,0 +1,71 @@
+// Copyright (c) 2024-2026 Elias Bachaalany
+// SPDX-License-Identifier: MPL-2.0
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+/**
+ * columnar.hpp - Binary columnar encoding of query results
+ *
+ * Large numeric results (bytes, instructions, xrefs) cost more to print and
+ * parse as JSON than to compute. This format keeps each column in one typed,
+ * 8-byte aligned buffer so readers can map int64/double columns directly
+ * (numpy.frombuffer, Arrow buffers) without parsing.
+ * Used by HTTP /query?format=columnar and export_tables(..., Columnar).
+ *
+ * All integers are little-endian; every section is padded with zero bytes
+ * to a multiple of 8.
+ *
+ *   stream  := header frame*
+ *   header  := "IDASQLC1" u32 version(=1) u32 frame_count
+ *   frame   := u32 index u32 success(0/1) u64 row_count u32 column_count
+ *              u32 name_len name[pad] u32 error_len u32 reserved error[pad]
+ *              column*
+ *   column  := u32 type u32 name_len name[pad]
+ *              validity: ceil(row_count / 8) bytes [pad], bit r (LSB first)
+ *                        set when row r is not NULL
+ *              type 1 int64 / 2 double: row_count * 8 bytes (NULL rows = 0)
+ *              type 3 text / 4 blob:    u64 offsets[row_count + 1],
+ *                                       then offsets[row_count] bytes [pad]
+ *              type 0 (every row NULL): no data after the validity bitmap
+ *
+ * A frame is one result: a statement of a /query script (name empty) or an
+ * exported table (name = table). Failed statements have success = 0, the
+ * error text and no columns. A column's type is the narrowest that holds
+ * every non-NULL cell: integer-only columns stay int64, integer/real mixes
+ * become double, anything with text becomes text (numbers rendered as
+ * SQLite would), blob/number mixes become blob.
+ */
+
+#pragma once
+
+#include <idasql/query_result.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+
+namespace idasql {
+
+// Column type codes in the columnar format.
+enum class ColumnarType : uint32_t {
+    Null = 0,
+    Int64 = 1,
+    Double = 2,
+    Text = 3,
+    Blob = 4
+};
+
+// Receives encoded bytes in order; false aborts the encoding.
+using ColumnarSink = std::function<bool(const char* data, size_t size)>;
+
+constexpr const char* kColumnarContentType = "application/vnd.idasql.columnar";
+
+bool write_columnar_header(const ColumnarSink& sink, uint32_t frame_count);
+
+bool write_columnar_frame(const ColumnarSink& sink, uint32_t index, const std::string& name,
+                          const QueryResult& result);
+
+} // namespace idasql
@@ -37,6 +37,8 @@
 #include <xsql/json.hpp>
 #include <xsql/script.hpp>
 #include <idasql/runtime_settings.hpp>
+#include <idasql/query_result.hpp>
+#include <idasql/query_cursor.hpp>
 #include <idasql/fwd.hpp>
 #include <string>
 #include <vector>
@@ -51,82 +53,26 @@ namespace idasql {
 // ============================================================================
 
 /**
- * Single row from a query result
+ * Single row from a query result, copied out as strings
+ *
+ * Kept for embedders written against the string results; results now
+ * iterate as RowView (query_result.hpp), which reads cells in place and
+ * formats them only when asked. A RowView converts to a Row.
  */
-struct Row {
+struct [[deprecated("use RowView; Row copies every cell as a string")]] Row {
     std::vector<std::string> values;
 
+    Row() = default;
+    Row(const RowView& view) : values(view.values()) {}
+
     const std::string& operator[](size_t i) const { return values[i]; }
     size_t size() const { return values.size(); }
 };
 
-/**
- * Query result set
- */
-struct QueryResult {
-    std::vector<std::string> columns;
-    std::vector<Row> rows;
-    std::string error;
-    std::vector<std::string> warnings;
-    bool success = false;
-    bool timed_out = false;
-    bool partial = false;
-    int elapsed_ms = 0;
-
-    // Convenience accessors
-    size_t row_count() const { return rows.size(); }
-    size_t column_count() const { return columns.size(); }
-    bool empty() const { return rows.empty(); }
-
-    // Get first cell as scalar (for single-value queries)
-    std::string scalar() const {
-        return (!empty() && rows[0].size() > 0) ? rows[0][0] : "";
-    }
-
-    // Iterator support
-    auto begin() { return rows.begin(); }
-    auto end() { return rows.end(); }
-    auto begin() const { return rows.begin(); }
-    auto end() const { return rows.end(); }
-
-    // Format as string for display
-    std::string to_string() const {
-        if (!success) return error;
-        if (empty()) return "(0 rows)";
-
-        std::string result;
-        // Header
-        for (size_t i = 0; i < columns.size(); ++i) {
-            if (i > 0) result += " | ";
-            result += columns[i];
-        }
-        result += "\n";
-        // Separator
-        for (size_t i = 0; i < columns.size(); ++i) {
-            if (i > 0) result += "-+-";
-            result += std::string(columns[i].size(), '-');
-        }
-        result += "\n";
-        // Rows
-        for (const auto& row : rows) {
-            for (size_t i = 0; i < row.size(); ++i) {
-                if (i > 0) result += " | ";
-                result += row[i];
-            }
-            result += "\n";
-        }
-        result += "(" + std::to_string(row_count()) + " rows)";
-        if (!warnings.empty()) {
-            result += "\nWarnings:";
-            for (const auto& warning : warnings) {
-                result += "\n  - " + warning;
-            }
-        }
-        if (timed_out) {
-            result += "\n(timed out after " + std::to_string(elapsed_ms) + " ms)";
-        }
-        return result;
-    }
+// File format of export_tables().
+enum class ExportFormat {
+    Sql,        // CREATE TABLE + INSERT statements
+    Columnar    // typed column buffers, one frame per table (columnar.hpp)
 };
 
 // ============================================================================
@@ -144,7 +90,7 @@ struct QueryResult {
  *   idasql::QueryEngine qe;
  *   auto result = qe.query("SELECT name, size FROM funcs LIMIT 10");
  *   for (const auto& row : result) {
- *       msg("%s: %s\n", row[0].c_str(), row[1].c_str());
+ *       msg("%s: %" PRId64 "\n", row[0].c_str(), row.cell(1).as_int64());
  *   }
  */
 class QueryEngine {
@@ -165,6 +111,42 @@ public:
     QueryResult query(const std::string& sql) { return query(sql.c_str()); }
     QueryResult query(const char* sql);
 
+    /**
+     * Execute SQL with bound parameters (?, ?NNN, :name). Single-statement
+     * texts reuse a cached prepared statement keyed by normalized SQL.
+     *
+     * Example:
+     *   qe.query("SELECT line FROM pseudocode WHERE func_addr = ?", {ea});
+     */
+    QueryResult query(const std::string& sql, const QueryParams& params) {
+        return query(sql.c_str(), params);
+    }
+    QueryResult query(const char* sql, const QueryParams& params);
+
+    /**
+     * Stream rows one at a time (see query_cursor.hpp). The cursor must not
+     * outlive this engine.
+     */
+    QueryCursor open_cursor(const std::string& sql, const QueryParams& params = {}) {
+        return open_cursor(sql.c_str(), params);
+    }
+    QueryCursor open_cursor(const char* sql, const QueryParams& params = {});
+
+    /**
+     * Stream rows to a callback; return false from it to stop early.
+     */
+    StreamSummary for_each(const std::string& sql, const RowCallback& on_row) {
+        return for_each(sql.c_str(), {}, on_row);
+    }
+    StreamSummary for_each(const char* sql, const QueryParams& params, const RowCallback& on_row);
+
+    /**
+     * Price sql without running it: one row per virtual-table scan
+     * (table, access, loops, rows, functions, cost) plus a total row.
+     * Same as PRAGMA idasql.explain_cost = '<sql>'.
+     */
+    QueryResult explain_cost(const char* sql);
+
     /**
      * Execute SQL, ignoring rows
      */
@@ -183,11 +165,29 @@ public:
                         std::string& error);
 
     /**
-     * Export tables to a SQL file.
+     * Export tables to a SQL or columnar file. An empty list exports every
+     * table (SQL) or the snapshot's core tables (columnar).
      */
     bool export_tables(const std::vector<std::string>& tables,
                        const std::string& output_path,
-                       std::string& error);
+                       std::string& error,
+                       ExportFormat format = ExportFormat::Sql);
+
+    /**
+     * Copy the core tables into a native SQLite file at path and serve
+     * read-only queries from it on snapshot_pool() (see snapshot.hpp).
+     * One row per table (table, rows, elapsed_ms).
+     * Same as PRAGMA idasql.snapshot = '<path>'.
+     */
+    QueryResult export_snapshot(const std::string& path);
+
+    /**
+     * Rewrite the rows of the open snapshot that IDB changes made stale
+     * since it was exported or last refreshed (re-exports when too much
+     * changed). One row per table rewritten (table, rows, elapsed_ms).
+     * Same as PRAGMA idasql.snapshot_refresh.
+     */
+    QueryResult refresh_snapshot();
 
     /**
      * Get single value (first column of first row)
@@ -220,7 +220,11 @@ private:
     static QueryResult make_pragma_result(const std::string& key, const std::string& value);
     static QueryResult make_pragma_error(const std::string& error);
     bool handle_runtime_pragma(const char* sql, QueryResult& out);
-    void append_query_hints(const std::string& sql, QueryResult& result) const;
+    void append_query_hints(QueryResult& result) const;
+    bool admit_query(const char* sql, std::string& error);
+    bool export_columnar(const std::vector<std::string>& tables,
+                         const std::string& output_path, std::string& error);
+    void run_statements(const char* sql, const QueryParams& params, QueryResult& result);
 
     xsql::Database db_;
     std::string error_;
@@ -233,6 +237,9 @@ private:
     std::unique_ptr<debugger::DebuggerRegistry> debugger_;
     std::unique_ptr<decompiler::DecompilerRegistry> decompiler_;
 
+    // Prepared statements; declared last so they are finalized first.
+    std::unique_ptr<StatementCache> statements_;
+
     void init();
 };
 
@@ -327,6 +334,21 @@ public:
     QueryResult query(const std::string& sql) { return query(sql.c_str()); }
     QueryResult query(const char* sql);
 
+    QueryResult query(const std::string& sql, const QueryParams& params) {
+        return query(sql.c_str(), params);
+    }
+    QueryResult query(const char* sql, const QueryParams& params);
+
+    QueryCursor open_cursor(const std::string& sql, const QueryParams& params = {}) {
+        return open_cursor(sql.c_str(), params);
+    }
+    QueryCursor open_cursor(const char* sql, const QueryParams& params = {});
+
+    StreamSummary for_each(const std::string& sql, const RowCallback& on_row) {
+        return for_each(sql.c_str(), {}, on_row);
+    }
+    StreamSummary for_each(const char* sql, const QueryParams& params, const RowCallback& on_row);
+
     xsql::Status exec(const char* sql);
 
     bool execute(const std::string& sql) { return execute(sql.c_str()); }
@@ -338,7 +360,8 @@ public:
 
     bool export_tables(const std::vector<std::string>& tables,
                        const std::string& output_path,
-                       std::string& error);
+                       std::string& error,
+                       ExportFormat format = ExportFormat::Sql);
 
     std::string scalar(const std::string& sql) { return scalar(sql.c_str()); }
     std::string scalar(const char* sql);
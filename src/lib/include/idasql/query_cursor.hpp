@@ -0,0 +1,232 @@
+// Copyright (c) 2024-2026 Elias Bachaalany
+// SPDX-License-Identifier: MPL-2.0
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+/**
+ * query_cursor.hpp - Streaming (pull) access to query rows
+ *
+ * QueryCursor steps SQLite statements one row at a time instead of
+ * buffering a whole QueryResult. Memory stays constant for generator-backed
+ * tables (bytes, ctree, ctree_call_args, ...) and the first row is
+ * available as soon as SQLite produces it.
+ *
+ * The query timeout (PRAGMA idasql.query_timeout_ms) is charged only for
+ * time spent inside SQLite, so a slow consumer does not time out a query.
+ * Long-running table callbacks poll the cursor's CancelToken (cancel.hpp),
+ * so the timeout also interrupts a single expensive xFilter/xNext.
+ *
+ * Example (pull):
+ *   auto cursor = qe.open_cursor("SELECT address, value FROM bytes");
+ *   while (cursor.next()) {
+ *       const auto& row = cursor.row();
+ *       process(row.int64(0), row.int64(1));
+ *   }
+ *   if (!cursor.ok()) msg("%s\n", cursor.error().c_str());
+ *
+ * Example (callback, early abort):
+ *   qe.for_each("SELECT name FROM funcs", [&](const CursorRow& row) {
+ *       names.emplace_back(row.text(0));
+ *       return names.size() < 100;     // false stops the query
+ *   });
+ */
+
+#pragma once
+
+#include <idasql/query_result.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+struct sqlite3;
+struct sqlite3_stmt;
+
+namespace idasql {
+
+class StatementCache;
+
+/**
+ * Current row of a cursor. Cell views are valid until the next step.
+ */
+class CursorRow {
+public:
+    size_t size() const;
+    const std::string& column_name(size_t col) const { return (*columns_)[col]; }
+
+    CellView cell(size_t col) const;
+    CellType type(size_t col) const { return cell(col).type(); }
+    bool is_null(size_t col) const { return type(col) == CellType::Null; }
+
+    int64_t int64(size_t col) const { return cell(col).as_int64(); }
+    double real(size_t col) const { return cell(col).as_double(); }
+
+    // Raw bytes of a text/blob cell (empty for other types).
+    std::string_view text(size_t col) const { return cell(col).bytes(); }
+
+    // Formatted text of any cell.
+    std::string operator[](size_t col) const { return cell(col).to_string(); }
+
+    // Zero-based row number within the current statement.
+    size_t index() const { return index_; }
+
+private:
+    friend class QueryCursor;
+
+    sqlite3_stmt* stmt_ = nullptr;        // live statement, or
+    const ResultTable* table_ = nullptr;  // buffered rows (runtime pragmas)
+    size_t index_ = 0;
+    const std::vector<std::string>* columns_ = nullptr;
+};
+
+/**
+ * Pull cursor over one SQL text (which may hold several statements).
+ *
+ * Statements run in order; rows of every row-returning statement are
+ * streamed, and columns()/statement_index() switch at statement boundaries.
+ * Destroying or close()-ing the cursor finalizes the statement early.
+ */
+class QueryCursor {
+public:
+    QueryCursor();
+    ~QueryCursor();
+
+    QueryCursor(QueryCursor&&) noexcept;
+    QueryCursor& operator=(QueryCursor&&) noexcept;
+
+    QueryCursor(const QueryCursor&) = delete;
+    QueryCursor& operator=(const QueryCursor&) = delete;
+
+    /**
+     * Advance to the next row. Returns false at end, on error, on timeout
+     * or after close().
+     */
+    bool next();
+
+    /**
+     * Current row (valid after next() returned true)
+     */
+    const CursorRow& row() const;
+
+    /**
+     * Columns of the most recently prepared row-returning statement
+     */
+    const std::vector<std::string>& columns() const;
+
+    /**
+     * Index of the statement that owns columns()
+     */
+    size_t statement_index() const;
+
+    /**
+     * Rows delivered so far, across all statements
+     */
+    size_t rows_read() const;
+
+    /**
+     * Stop early and release the statement
+     */
+    void close();
+
+    /**
+     * Charge rows the caller buffered from this cursor (e.g. a QueryResult
+     * of `bytes`) to the query's memory account. Over
+     * PRAGMA idasql.max_query_memory the cursor fails and false is returned.
+     */
+    bool note_buffered_bytes(uint64_t bytes);
+
+    /**
+     * Ask the running step to stop (callable from another thread). Table
+     * callbacks stop at their next poll and next() fails with
+     * "Query cancelled".
+     */
+    void cancel();
+
+    /**
+     * Start charging the query timeout from zero again. Server-side cursors
+     * call this before each page, so every page gets the full timeout.
+     */
+    void restart_timeout();
+
+    bool done() const;
+    bool ok() const { return error().empty() && !timed_out(); }
+    const std::string& error() const;
+    bool timed_out() const;
+    int elapsed_ms() const;
+
+    /**
+     * Tables touched so far and how (full scan vs pushdown)
+     */
+    const QueryPlan& plan() const;
+
+private:
+    friend class QueryEngine;
+    friend class Session;
+    friend class SnapshotPool;
+
+    struct Impl;
+    std::unique_ptr<Impl> impl_;
+
+    // Stream live statements from db, binding params to each statement
+    // that takes parameters. Single-statement texts go through cache.
+    QueryCursor(sqlite3* db, const char* sql, QueryParams params,
+                int timeout_ms, StatementCache* cache);
+    // Replay an already materialized result (runtime pragmas, errors).
+    explicit QueryCursor(QueryResult buffered);
+};
+
+/**
+ * Row callback for QueryEngine::for_each(). Return false to stop.
+ */
+using RowCallback = std::function<bool(const CursorRow& row)>;
+
+/**
+ * Outcome of a callback-driven query
+ */
+struct StreamSummary {
+    std::vector<std::string> columns;
+    std::string error;
+    size_t rows = 0;
+    bool success = false;
+    bool timed_out = false;
+    bool aborted = false;    // callback returned false
+    int elapsed_ms = 0;
+    QueryPlan plan;
+};
+
+/**
+ * Drain cursor into result the way QueryEngine::query() does: rows of the
+ * last row-returning statement, charged to the query's memory account and
+ * spilled past PRAGMA idasql.spill_threshold_mb.
+ */
+void collect_cursor(QueryCursor& cursor, QueryResult& result);
+
+/**
+ * Where a paged cursor stands between collect_cursor_page() calls.
+ */
+struct CursorPagePosition {
+    bool pending = false;        // a stepped row starts the next page
+    size_t statement_index = 0;  // statement of the last page's rows
+    uint64_t offset = 0;         // rows of that statement before the last page
+};
+
+/**
+ * Buffer the next page of at most max_rows rows into page (server-side
+ * cursors). A page holds rows of one statement. The row after the page is
+ * stepped to learn whether more follow; it stays in the cursor, marked
+ * pending in position, and starts the next page. Returns true while rows
+ * remain.
+ */
+bool collect_cursor_page(QueryCursor& cursor, QueryResult& page, size_t max_rows,
+                         CursorPagePosition& position);
+
+// "Query timed out after N ms (...)" for results that timed out empty.
+std::string query_timeout_error(int elapsed_ms);
+
+} // namespace idasql
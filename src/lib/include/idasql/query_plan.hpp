@@ -0,0 +1,152 @@
+// Copyright (c) 2024-2026 Elias Bachaalany
+// SPDX-License-Identifier: MPL-2.0
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+/**
+ * query_plan.hpp - What a query actually did to each virtual table
+ *
+ * While a QueryCursor steps, the vtable wrappers (vtable_stats.hpp) record
+ * into the cursor's QueryPlan: which tables were fully scanned (cache build,
+ * unconstrained generator or index-table count) versus served by a pushdown
+ * filter or rowid lookup, how many rows each produced and how many
+ * functions each decompiled. The plan is returned on QueryResult, drives
+ * the warnings from append_query_hints, and is serialized as "plan" in the
+ * HTTP/MCP JSON envelope.
+ *
+ * The plan also carries the query's memory account (QueryMemory): bytes of
+ * the table caches it built, rows buffered into its QueryResult and the
+ * growth of its own SQLite connection's page caches and statements, plus
+ * process-wide SQLite heap growth (sorters, temp b-trees) while it is the
+ * only cursor running. Over PRAGMA idasql.max_query_memory the cursor
+ * stops: cache builders notice through query_cancelled() (cancel.hpp),
+ * SQLite through the progress handler, and the query fails with
+ * QueryMemory::error().
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <string>
+
+namespace idasql {
+
+enum class TableAccessKind {
+    FullScan,   // whole table materialized, generated or counted
+    Pushdown,   // filter_eq / constraint / parametric filter / rowid lookup
+    Index,      // rows read with no recorded filter (decompile attribution)
+};
+
+const char* table_access_name(TableAccessKind kind);
+
+struct TableAccess {
+    std::string table;
+    TableAccessKind kind = TableAccessKind::FullScan;
+    uint64_t filter_calls = 0;
+    uint64_t rows = 0;
+    uint64_t functions = 0;  // decompiles while this table was producing
+    uint64_t bytes = 0;      // largest cache this access built
+};
+
+struct QueryMemory {
+    uint64_t limit = 0;     // bytes; 0 = unlimited
+    uint64_t caches = 0;    // finished table caches (sum of TableAccess::bytes)
+    uint64_t building = 0;  // cache being filled right now
+    uint64_t results = 0;   // rows buffered into a QueryResult
+    uint64_t sqlite = 0;    // SQLite growth charged to this query
+    uint64_t peak = 0;
+    std::string exceeded_by;  // what crossed the limit; empty while within it
+
+    uint64_t total() const { return caches + building + results + sqlite; }
+    bool exceeded() const { return !exceeded_by.empty(); }
+
+    // Update peak; true when over the limit (the first crossing records
+    // `what` for the error message).
+    bool check(const std::string& what);
+
+    // "Query exceeded idasql.max_query_memory ..." with the largest holder.
+    std::string error() const;
+};
+
+struct QueryPlan {
+    // deque: recorders hold TableAccess pointers across appends.
+    std::deque<TableAccess> tables;
+    uint64_t functions_decompiled = 0;
+    QueryMemory memory;
+
+    bool empty() const { return tables.empty() && functions_decompiled == 0; }
+
+    // Find or append the (table, kind) entry.
+    TableAccess& access(const std::string& table, TableAccessKind kind);
+};
+
+// ============================================================================
+// Recording (thread-local; set by QueryCursor and the vtable wrappers)
+// ============================================================================
+
+// The plan being recorded on this thread, or nullptr.
+QueryPlan* current_query_plan();
+
+// Install plan as the current one for the scope's lifetime.
+class QueryPlanScope {
+public:
+    explicit QueryPlanScope(QueryPlan* plan);
+    ~QueryPlanScope();
+
+    QueryPlanScope(const QueryPlanScope&) = delete;
+    QueryPlanScope& operator=(const QueryPlanScope&) = delete;
+
+private:
+    QueryPlan* previous_;
+};
+
+// Name of the table whose callback is running (for decompile attribution).
+class ActiveTableScope {
+public:
+    explicit ActiveTableScope(const std::string* table);
+    ~ActiveTableScope();
+
+    ActiveTableScope(const ActiveTableScope&) = delete;
+    ActiveTableScope& operator=(const ActiveTableScope&) = delete;
+
+private:
+    const std::string* previous_;
+};
+
+// Record an access on the current plan; nullptr when nothing is recording.
+TableAccess* note_table_access(const std::string& table, TableAccessKind kind);
+
+// Charge one decompile to the current plan and the active table.
+void note_decompile();
+
+// Bytes held by the cache a builder is filling (vtable_stats.hpp).
+class MemoryProbe {
+public:
+    virtual ~MemoryProbe() = default;
+    virtual uint64_t bytes() = 0;
+};
+
+// Install probe while a cache is built on this thread.
+class MemoryProbeScope {
+public:
+    explicit MemoryProbeScope(MemoryProbe* probe);
+    ~MemoryProbeScope();
+
+    MemoryProbeScope(const MemoryProbeScope&) = delete;
+    MemoryProbeScope& operator=(const MemoryProbeScope&) = delete;
+
+private:
+    MemoryProbe* previous_;
+};
+
+// Sample the active probe into the current plan's memory account; true
+// when the query is over PRAGMA idasql.max_query_memory.
+bool query_memory_exceeded();
+
+// A table access finished building a cache of `bytes`.
+void note_cache_bytes(TableAccess* access, uint64_t bytes);
+
+} // namespace idasql
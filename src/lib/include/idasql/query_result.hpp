@@ -0,0 +1,289 @@
+// Copyright (c) 2024-2026 Elias Bachaalany
+// SPDX-License-Identifier: MPL-2.0
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+/**
+ * query_result.hpp - Typed, columnar query results
+ *
+ * QueryResult keeps every cell in its native SQLite storage class
+ * (int64/double/text/blob/null). Cells live in per-column vectors of
+ * fixed-size slots; text and blob bytes are appended to one shared arena,
+ * so a result set costs one allocation per column plus the arena instead
+ * of one std::string per cell.
+ *
+ * String access is a lazy compatibility layer: row[i] formats the cell on
+ * demand, exactly as sqlite3_column_text() would have.
+ *
+ * Large results can spill (ResultTable::spill, driven by
+ * PRAGMA idasql.spill_threshold_mb): rows move row-major into a temporary
+ * memory-mapped file and later appends go there too, so resident memory
+ * stays at a write buffer and a sparse row index. Cells read the same;
+ * sequential reads decode each row once.
+ *
+ * Example:
+ *   auto result = qe.query("SELECT address, name FROM funcs");
+ *   for (const auto& row : result) {
+ *       int64_t ea = row.cell(0).as_int64();   // no formatting
+ *       std::string name = row[1];             // string view of the cell
+ *   }
+ */
+
+#pragma once
+
+#include <idasql/query_plan.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+namespace idasql {
+
+// ============================================================================
+// Cells
+// ============================================================================
+
+/**
+ * SQLite storage class of a single result cell
+ */
+enum class CellType : uint8_t {
+    Null = 0,
+    Integer,
+    Real,
+    Text,
+    Blob
+};
+
+const char* cell_type_name(CellType type);
+
+/**
+ * Read-only view of one cell. Valid while the owning result is alive.
+ */
+class CellView {
+public:
+    CellView() = default;
+    CellView(CellType type, int64_t i, double d, std::string_view bytes)
+        : type_(type), int_(i), real_(d), bytes_(bytes) {}
+
+    CellType type() const { return type_; }
+    bool is_null() const { return type_ == CellType::Null; }
+
+    // Numeric accessors coerce like sqlite3_column_int64/double.
+    int64_t as_int64() const;
+    double as_double() const;
+
+    // Raw bytes of a text/blob cell (empty for other types).
+    std::string_view bytes() const { return bytes_; }
+
+    // Text form of the cell, as sqlite3_column_text() would render it.
+    std::string to_string() const;
+    void append_to(std::string& out) const;
+
+private:
+    CellType type_ = CellType::Null;
+    int64_t int_ = 0;
+    double real_ = 0.0;
+    std::string_view bytes_;
+};
+
+// ============================================================================
+// Bound parameters
+// ============================================================================
+
+/**
+ * Value bound to a statement parameter (?, ?NNN, :name, @name, $name).
+ * Default-constructed values bind NULL.
+ *
+ * Example:
+ *   qe.query("SELECT * FROM pseudocode WHERE func_addr = ?", {func_ea});
+ */
+class SqlValue {
+public:
+    SqlValue() = default;
+    SqlValue(std::nullptr_t) {}
+
+    template <typename T, std::enable_if_t<std::is_integral_v<T>, int> = 0>
+    SqlValue(T value) : type_(CellType::Integer), int_(static_cast<int64_t>(value)) {}
+
+    template <typename T, std::enable_if_t<std::is_floating_point_v<T>, int> = 0>
+    SqlValue(T value) : type_(CellType::Real), real_(static_cast<double>(value)) {}
+
+    SqlValue(std::string value) : type_(CellType::Text), bytes_(std::move(value)) {}
+    SqlValue(std::string_view value) : type_(CellType::Text), bytes_(value) {}
+    SqlValue(const char* value) : type_(value ? CellType::Text : CellType::Null),
+                                  bytes_(value ? value : "") {}
+
+    static SqlValue blob(std::string bytes) {
+        SqlValue v(std::move(bytes));
+        v.type_ = CellType::Blob;
+        return v;
+    }
+
+    CellType type() const { return type_; }
+    int64_t int64() const { return int_; }
+    double real() const { return real_; }
+    const std::string& bytes() const { return bytes_; }
+
+private:
+    CellType type_ = CellType::Null;
+    int64_t int_ = 0;
+    double real_ = 0.0;
+    std::string bytes_;
+};
+
+using QueryParams = std::vector<SqlValue>;
+
+// ============================================================================
+// Columnar storage
+// ============================================================================
+
+/**
+ * Column-major cell store backed by a single byte arena for text/blob data.
+ */
+class ResultTable {
+public:
+    void reset(size_t column_count);
+    void reserve_rows(size_t rows);
+    void clear();
+
+    size_t row_count() const { return rows_; }
+    size_t column_count() const { return columns_.size(); }
+
+    // Appenders: fill every column once per row, then call end_row().
+    // Once spilled, columns must be appended in order.
+    void append_null(size_t col);
+    void append_int64(size_t col, int64_t value);
+    void append_double(size_t col, double value);
+    void append_text(size_t col, std::string_view value);
+    void append_blob(size_t col, const void* data, size_t size);
+    void end_row();
+
+    // Cell views of a spilled table stay valid until the next append.
+    CellView at(size_t row, size_t col) const;
+
+    // Approximate resident size (slots + arena, or the spill buffers), for
+    // accounting.
+    size_t byte_size() const;
+
+    // Move all rows to a temporary memory-mapped file and append there from
+    // now on. False (table unchanged) if the file cannot be created.
+    // Copies of a spilled table share the file; append through one only.
+    bool spill(std::string* error = nullptr);
+    bool spilled() const { return spill_ != nullptr; }
+
+private:
+    struct Slot {
+        CellType type = CellType::Null;
+        uint32_t size = 0;       // text/blob length
+        union {
+            int64_t i;
+            double d;
+            uint64_t offset;     // text/blob offset into arena_
+        };
+        Slot() : i(0) {}
+    };
+
+    struct SpillState;
+
+    void append_bytes(size_t col, CellType type, const char* data, size_t size);
+
+    std::vector<std::vector<Slot>> columns_;
+    std::string arena_;
+    size_t rows_ = 0;
+    std::shared_ptr<SpillState> spill_;
+};
+
+// ============================================================================
+// Row view (string compatibility layer)
+// ============================================================================
+
+class RowView {
+public:
+    RowView(const ResultTable* table, size_t row) : table_(table), row_(row) {}
+
+    size_t size() const { return table_->column_count(); }
+    CellView cell(size_t col) const { return table_->at(row_, col); }
+
+    // Lazily formatted text of the cell.
+    std::string operator[](size_t col) const { return cell(col).to_string(); }
+
+    // Materialize the whole row as strings (legacy Row::values).
+    std::vector<std::string> values() const;
+
+    size_t index() const { return row_; }
+
+private:
+    const ResultTable* table_;
+    size_t row_;
+};
+
+// ============================================================================
+// QueryResult
+// ============================================================================
+
+/**
+ * Query result set
+ */
+struct QueryResult {
+    std::vector<std::string> columns;
+    ResultTable table;
+    std::string error;
+    std::vector<std::string> warnings;
+    bool success = false;
+    bool timed_out = false;
+    bool partial = false;
+    int elapsed_ms = 0;
+    QueryPlan plan;  // what the statement did to each virtual table
+
+    // Convenience accessors
+    size_t row_count() const { return table.row_count(); }
+    size_t column_count() const { return columns.size(); }
+    bool empty() const { return table.row_count() == 0; }
+
+    RowView row(size_t i) const { return RowView(&table, i); }
+    CellView cell(size_t row, size_t col) const { return table.at(row, col); }
+
+    // Get first cell as scalar (for single-value queries)
+    std::string scalar() const {
+        return (!empty() && column_count() > 0) ? cell(0, 0).to_string() : "";
+    }
+
+    // Append one row of text cells (pragma results, synthetic rows).
+    void add_text_row(const std::vector<std::string>& values);
+
+    // Iterator support
+    class const_iterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = RowView;
+        using difference_type = std::ptrdiff_t;
+        using pointer = void;
+        using reference = RowView;
+
+        const_iterator(const ResultTable* table, size_t row) : table_(table), row_(row) {}
+        RowView operator*() const { return RowView(table_, row_); }
+        const_iterator& operator++() { ++row_; return *this; }
+        const_iterator operator++(int) { const_iterator tmp = *this; ++row_; return tmp; }
+        bool operator==(const const_iterator& other) const { return row_ == other.row_; }
+        bool operator!=(const const_iterator& other) const { return row_ != other.row_; }
+
+    private:
+        const ResultTable* table_;
+        size_t row_;
+    };
+
+    const_iterator begin() const { return const_iterator(&table, 0); }
+    const_iterator end() const { return const_iterator(&table, table.row_count()); }
+
+    // Format as string for display
+    std::string to_string() const;
+};
+
+} // namespace idasql
@@ -0,0 +1,176 @@
+// Copyright (c) 2024-2026 Elias Bachaalany
+// SPDX-License-Identifier: MPL-2.0
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+/**
+ * result_cache.hpp - Serialized query results reused until the IDB changes
+ *
+ * Agents and dashboards send byte-identical reads against an unchanged
+ * database. With PRAGMA idasql.result_cache_mb = N the HTTP and MCP servers
+ * look a read up here before queueing it, so a repeat is answered from the
+ * server thread without waiting for (or touching) the IDA thread.
+ *
+ * Validity is tracked by one process-wide IDB epoch. It moves on every
+ * IDB/IDP/Hex-Rays change hook (change_journal.hpp), on every statement
+ * that writes (UPDATE/INSERT/DELETE, temp tables) and on every
+ * PRAGMA idasql.* assignment; when it moves, the whole cache is dropped.
+ * A result is only stored if the epoch did not move while it was computed.
+ *
+ * Identical reads that arrive while one is already running (an agent fleet
+ * starting up) share its execution through SingleFlight instead of each
+ * taking a turn on the IDA thread; this needs no cache budget.
+ *
+ * Only texts whose every statement is a SELECT/WITH/VALUES get a key, and
+ * not when they name something that changes without an IDB event (debugger
+ * state, UI context, idasql_stats, random(), 'now') or a function with side
+ * effects outside the hooks. Servers store only successful results.
+ *
+ * Example:
+ *   const std::string key = result_cache_key("json", sql, params);
+ *   if (auto body = result_cache().find(key)) return *body;
+ *   const uint64_t epoch = idb_epoch();
+ *   std::string body = run(sql, params);
+ *   if (ok) result_cache().store(key, epoch, body);
+ */
+
+#pragma once
+
+#include <idasql/query_result.hpp>
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace idasql {
+
+// Current IDB modification epoch. Thread-safe.
+uint64_t idb_epoch();
+
+// Something that queries can observe changed.
+void bump_idb_epoch();
+
+/**
+ * Cache key for sql with params, in the given output variant (format and
+ * options that shape the stored body). Empty when the text is not
+ * cacheable (see above).
+ */
+std::string result_cache_key(std::string_view variant, const std::string& sql,
+                             const QueryParams& params);
+
+struct ResultCacheStats {
+    size_t entries = 0;
+    size_t bytes = 0;
+    size_t capacity_bytes = 0;
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+};
+
+class ResultCache {
+public:
+    static ResultCache& instance();
+
+    ResultCache(const ResultCache&) = delete;
+    ResultCache& operator=(const ResultCache&) = delete;
+
+    // Body stored for key at the current epoch, or nullptr. Empty keys and
+    // a disabled cache (result_cache_mb = 0) always miss without counting.
+    std::shared_ptr<const std::string> find(const std::string& key);
+
+    // Keep body for key if the epoch is still the one the run started at
+    // and the body fits (at most 1/8 of the budget); least recently used
+    // entries make room.
+    void store(const std::string& key, uint64_t epoch, std::string body);
+    void store(const std::string& key, uint64_t epoch, std::shared_ptr<const std::string> body);
+
+    void clear();
+    ResultCacheStats stats() const;
+
+private:
+    ResultCache() = default;
+
+    struct Entry {
+        std::string key;
+        std::shared_ptr<const std::string> body;
+        size_t bytes = 0;
+    };
+
+    // Callers hold mutex_.
+    void drop_stale();
+    void trim_to(size_t capacity);
+
+    mutable std::mutex mutex_;
+    std::list<Entry> lru_;  // most recently used first
+    std::unordered_map<std::string, std::list<Entry>::iterator> index_;
+    size_t bytes_ = 0;
+    uint64_t epoch_ = 0;  // epoch the entries were computed at
+    uint64_t hits_ = 0;
+    uint64_t misses_ = 0;
+};
+
+inline ResultCache& result_cache() {
+    return ResultCache::instance();
+}
+
+struct FlightResult {
+    // The body to send; nullptr when this caller led and compute() declined
+    // to share, or when it gave up waiting (stop).
+    std::shared_ptr<const std::string> body;
+    bool led = false;  // compute() ran in this call
+};
+
+/**
+ * Single-flight execution of identical reads. The first caller for a key
+ * at the current epoch runs compute(); callers arriving while it runs wait
+ * and get the same body. compute() returns nullptr for results that must
+ * not be shared (errors, timeouts, a cancelled leader); waiters then run
+ * the query themselves. An empty key always runs compute().
+ */
+class SingleFlight {
+public:
+    using Compute = std::function<std::shared_ptr<const std::string>()>;
+
+    static SingleFlight& instance();
+
+    SingleFlight(const SingleFlight&) = delete;
+    SingleFlight& operator=(const SingleFlight&) = delete;
+
+    // stop is polled while waiting; true gives up (client gone, server
+    // stopping).
+    FlightResult run(const std::string& key, const Compute& compute,
+                     const std::function<bool()>& stop = {});
+
+    // Waiters served by another caller's run since startup.
+    uint64_t coalesced() const;
+
+private:
+    SingleFlight() = default;
+
+    struct Flight {
+        bool landed = false;
+        std::shared_ptr<const std::string> body;
+    };
+
+    void land(const std::string& flight_key, const std::shared_ptr<Flight>& flight,
+              std::shared_ptr<const std::string> body);
+
+    mutable std::mutex mutex_;
+    std::condition_variable landed_;
+    std::unordered_map<std::string, std::shared_ptr<Flight>> flights_;
+    uint64_t coalesced_ = 0;
+};
+
+inline SingleFlight& single_flight() {
+    return SingleFlight::instance();
+}
+
+} // namespace idasql
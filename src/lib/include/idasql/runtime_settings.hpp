@@ -17,6 +17,17 @@ struct RuntimeSettingsSnapshot {
     int query_timeout_ms = 60000;
     int queue_admission_timeout_ms = 120000;
     size_t max_queue = 64;
+    int demote_after_ms = 5000;
+    int script_slice_ms = 50;
+    size_t statement_cache_size = 64;
+    size_t max_query_cost = 0;
+    size_t max_query_memory_mb = 0;
+    size_t spill_threshold_mb = 0;
+    size_t snapshot_workers = 0;
+    int cursor_idle_ms = 300000;
+    size_t max_cursors = 8;
+    size_t result_cache_mb = 0;
+    bool snapshot_pseudocode = false;
     bool hints_enabled = true;
     bool enable_idapython = false;
     size_t timeout_stack_depth = 0;
@@ -35,6 +46,17 @@ public:
         snap.query_timeout_ms = query_timeout_ms_;
         snap.queue_admission_timeout_ms = queue_admission_timeout_ms_;
         snap.max_queue = max_queue_;
+        snap.demote_after_ms = demote_after_ms_;
+        snap.script_slice_ms = script_slice_ms_;
+        snap.statement_cache_size = statement_cache_size_;
+        snap.max_query_cost = max_query_cost_;
+        snap.max_query_memory_mb = max_query_memory_mb_;
+        snap.spill_threshold_mb = spill_threshold_mb_;
+        snap.snapshot_workers = snapshot_workers_;
+        snap.cursor_idle_ms = cursor_idle_ms_;
+        snap.max_cursors = max_cursors_;
+        snap.result_cache_mb = result_cache_mb_;
+        snap.snapshot_pseudocode = snapshot_pseudocode_;
         snap.hints_enabled = hints_enabled_;
         snap.enable_idapython = enable_idapython_;
         snap.timeout_stack_depth = timeout_stack_.size();
@@ -56,6 +78,61 @@ public:
         return max_queue_;
     }
 
+    int demote_after_ms() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return demote_after_ms_;
+    }
+
+    int script_slice_ms() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return script_slice_ms_;
+    }
+
+    size_t statement_cache_size() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return statement_cache_size_;
+    }
+
+    size_t max_query_cost() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return max_query_cost_;
+    }
+
+    size_t max_query_memory_mb() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return max_query_memory_mb_;
+    }
+
+    size_t spill_threshold_mb() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return spill_threshold_mb_;
+    }
+
+    size_t snapshot_workers() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return snapshot_workers_;
+    }
+
+    int cursor_idle_ms() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return cursor_idle_ms_;
+    }
+
+    size_t max_cursors() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return max_cursors_;
+    }
+
+    size_t result_cache_mb() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return result_cache_mb_;
+    }
+
+    bool snapshot_pseudocode() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return snapshot_pseudocode_;
+    }
+
     bool hints_enabled() const {
         std::lock_guard<std::mutex> lock(mutex_);
         return hints_enabled_;
@@ -94,6 +171,95 @@ public:
         return true;
     }
 
+    bool set_demote_after_ms(int value) {
+        // 0 never demotes interactive clients.
+        if (!is_valid_timeout(value)) {
+            return false;
+        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        demote_after_ms_ = value;
+        return true;
+    }
+
+    bool set_script_slice_ms(int value) {
+        // 0 runs a whole script in one main-thread slice.
+        if (!is_valid_timeout(value)) {
+            return false;
+        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        script_slice_ms_ = value;
+        return true;
+    }
+
+    bool set_statement_cache_size(size_t value) {
+        // 0 disables statement caching.
+        if (value > kMaxStatementCacheSize) {
+            return false;
+        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        statement_cache_size_ = value;
+        return true;
+    }
+
+    void set_max_query_cost(size_t value) {
+        // 0 disables cost admission.
+        std::lock_guard<std::mutex> lock(mutex_);
+        max_query_cost_ = value;
+    }
+
+    void set_max_query_memory_mb(size_t value) {
+        // 0 disables per-query memory accounting limits.
+        std::lock_guard<std::mutex> lock(mutex_);
+        max_query_memory_mb_ = value;
+    }
+
+    void set_spill_threshold_mb(size_t value) {
+        // 0 keeps every result in memory.
+        std::lock_guard<std::mutex> lock(mutex_);
+        spill_threshold_mb_ = value;
+    }
+
+    bool set_snapshot_workers(size_t value) {
+        // 0 means one per core.
+        if (value > kMaxSnapshotWorkers) {
+            return false;
+        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        snapshot_workers_ = value;
+        return true;
+    }
+
+    bool set_cursor_idle_ms(int value) {
+        // 0 closes a cursor as soon as another cursor call sees it idle.
+        if (!is_valid_timeout(value)) {
+            return false;
+        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        cursor_idle_ms_ = value;
+        return true;
+    }
+
+    bool set_max_cursors(size_t value) {
+        // Per client; 0 disables server-side cursors.
+        if (value > kMaxCursorsLimit) {
+            return false;
+        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        max_cursors_ = value;
+        return true;
+    }
+
+    void set_result_cache_mb(size_t value) {
+        // 0 disables the result cache.
+        std::lock_guard<std::mutex> lock(mutex_);
+        result_cache_mb_ = value;
+    }
+
+    void set_snapshot_pseudocode(bool enabled) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        snapshot_pseudocode_ = enabled;
+    }
+
     void set_hints_enabled(bool enabled) {
         std::lock_guard<std::mutex> lock(mutex_);
         hints_enabled_ = enabled;
@@ -133,6 +299,9 @@ public:
 private:
     static constexpr int kMaxTimeoutMs = 3600 * 1000;  // 1 hour
     static constexpr size_t kMaxQueueLimit = 10000;
+    static constexpr size_t kMaxStatementCacheSize = 4096;
+    static constexpr size_t kMaxSnapshotWorkers = 64;
+    static constexpr size_t kMaxCursorsLimit = 1024;
 
     static bool is_valid_timeout(int value) {
         return value >= 0 && value <= kMaxTimeoutMs;
@@ -144,6 +313,17 @@ private:
     int query_timeout_ms_ = 60000;
     int queue_admission_timeout_ms_ = 120000;
     size_t max_queue_ = 64;
+    int demote_after_ms_ = 5000;
+    int script_slice_ms_ = 50;
+    size_t statement_cache_size_ = 64;
+    size_t max_query_cost_ = 0;
+    size_t max_query_memory_mb_ = 0;
+    size_t spill_threshold_mb_ = 0;
+    size_t snapshot_workers_ = 0;
+    int cursor_idle_ms_ = 300000;
+    size_t max_cursors_ = 8;
+    size_t result_cache_mb_ = 0;
+    bool snapshot_pseudocode_ = false;
     bool hints_enabled_ = true;
     bool enable_idapython_ = false;
     std::vector<int> timeout_stack_;
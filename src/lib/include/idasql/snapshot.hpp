@@ -0,0 +1,155 @@
+// Copyright (c) 2024-2026 Elias Bachaalany
+// SPDX-License-Identifier: MPL-2.0
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+/**
+ * snapshot.hpp - Native SQLite copy of the core tables, served off-thread
+ *
+ * Every live query goes through IDA's single-threaded API, so reads are
+ * capped at one core. PRAGMA idasql.snapshot = 'path.db' copies funcs,
+ * names, segments, xrefs, instructions, strings, types, blocks (and
+ * pseudocode with PRAGMA idasql.snapshot_pseudocode = 1) into a regular
+ * indexed SQLite file in one transaction on the IDA thread, then opens a
+ * SnapshotPool on it: worker threads with their own read-only connections
+ * that answer queries without touching IDA, leaving the main thread free
+ * for writes and decompilation.
+ *
+ * The file is built next to path and renamed into place, so readers never
+ * see a half-written snapshot. It is in WAL mode and carries a
+ * snapshot_info(key, value) table (created_at, refreshed_at, tables).
+ *
+ * While a snapshot is open, IDB/IDP/Hex-Rays hooks journal which functions,
+ * addresses and type ordinals change (change_journal.hpp).
+ * PRAGMA idasql.snapshot_refresh rewrites only those rows in one write
+ * transaction; pool readers keep reading the previous state until it
+ * commits.
+ *
+ * Example:
+ *   qe.query("PRAGMA idasql.snapshot = '/tmp/app.snapshot.db'");
+ *   auto r = snapshot_pool().query("SELECT count(*) FROM xrefs", {});
+ */
+
+#pragma once
+
+#include <idasql/query_result.hpp>
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct sqlite3;
+
+namespace idasql {
+
+struct SnapshotTable {
+    std::string name;
+    int64_t rows = 0;
+    int elapsed_ms = 0;
+};
+
+struct SnapshotReport {
+    std::vector<SnapshotTable> tables;
+    int elapsed_ms = 0;
+};
+
+// Rows of an existing snapshot that no longer match the IDB.
+struct SnapshotChanges {
+    // Rows belonging to the function: funcs, instructions, blocks, xrefs
+    // (from_func) and pseudocode.
+    std::set<uint64_t> functions;
+    // Rows at the address: names, strings, instructions, xrefs (from_ea).
+    std::set<uint64_t> addresses;
+    std::set<uint32_t> type_ordinals;
+    bool all_types = false;
+    bool segments = false;
+    // Too much changed to track row by row; export again instead.
+    bool full = false;
+
+    bool empty() const {
+        return functions.empty() && addresses.empty() && type_ordinals.empty() &&
+               !all_types && !segments && !full;
+    }
+};
+
+// Tables exported by default, in export order.
+const std::vector<std::string>& default_snapshot_tables();
+
+/**
+ * Copy tables from db (the live connection, on the IDA thread) into a new
+ * SQLite file at path, replacing any previous one. Tables missing from db
+ * (e.g. pseudocode without a decompiler) are skipped. Fails if the running
+ * query is cancelled, since a cut-short table would be silently partial.
+ */
+bool export_snapshot(sqlite3* db, const std::string& path,
+                     const std::vector<std::string>& tables,
+                     SnapshotReport& report, std::string& error);
+
+/**
+ * Rewrite the rows named by changes in the snapshot at path from db (the
+ * live connection, on the IDA thread), in one transaction. report lists the
+ * rows written per table. changes.full is not handled here: re-export.
+ */
+bool refresh_snapshot(sqlite3* db, const std::string& path, const SnapshotChanges& changes,
+                      SnapshotReport& report, std::string& error);
+
+/**
+ * Read-only query workers over a snapshot file. Thread-safe; query() blocks
+ * the caller until a worker has run the SQL. Queries honour
+ * PRAGMA idasql.query_timeout_ms and the caller's CancelToken; `abandon`,
+ * when given, is polled by the waiting caller and cancels the job once it
+ * returns true (client disconnected, server stopping).
+ */
+class SnapshotPool {
+public:
+    static SnapshotPool& instance();
+
+    ~SnapshotPool();
+
+    SnapshotPool(const SnapshotPool&) = delete;
+    SnapshotPool& operator=(const SnapshotPool&) = delete;
+
+    // (Re)open on path with `workers` connections: 0 = one per core, capped
+    // at 8; explicit counts go up to 64 (PRAGMA idasql.snapshot_workers).
+    bool open(const std::string& path, size_t workers, std::string& error);
+
+    // Finish running queries, fail queued ones, close the connections.
+    void close();
+
+    bool is_open() const;
+    std::string path() const;
+    size_t workers() const;
+
+    QueryResult query(const std::string& sql, const QueryParams& params,
+                      const std::function<bool()>& abandon = {});
+
+private:
+    struct Job;
+
+    SnapshotPool() = default;
+
+    void run_worker(sqlite3* db);
+
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<std::shared_ptr<Job>> jobs_;
+    std::vector<std::thread> threads_;
+    std::string path_;
+    bool stopping_ = false;
+};
+
+inline SnapshotPool& snapshot_pool() {
+    return SnapshotPool::instance();
+}
+
+} // namespace idasql
@@ -50,4 +50,15 @@ inline std::string trim_copy(const std::string& s) {
     return s.substr(begin, end - begin);
 }
 
+// "name" with embedded quotes doubled, for table/column names in SQL text.
+inline std::string quote_sql_identifier(const std::string& name) {
+    std::string out = "\"";
+    for (char c : name) {
+        out.push_back(c);
+        if (c == '"') out.push_back('"');
+    }
+    out.push_back('"');
+    return out;
+}
+
 } // namespace idasql
@@ -0,0 +1,93 @@
+// Copyright (c) 2024-2026 Elias Bachaalany
+// SPDX-License-Identifier: MPL-2.0
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+/**
+ * trace.hpp - Chrome trace-event timeline for query execution
+ *
+ * PRAGMA idasql.trace = 'path.json' starts recording scoped spans (query,
+ * prepare, vtable filter / next batches / cache builds, decompile,
+ * flowchart, result serialization). The file is rewritten after every
+ * query in Chrome trace-event format ({"traceEvents": [...]}) so it can be
+ * loaded into chrome://tracing or Perfetto at any time.
+ * PRAGMA idasql.trace = '' stops recording.
+ *
+ * When tracing is off a span costs one relaxed atomic load.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace idasql {
+
+namespace detail {
+inline std::atomic<bool>& trace_enabled_flag() {
+    static std::atomic<bool> enabled{false};
+    return enabled;
+}
+} // namespace detail
+
+inline bool tracing() {
+    return detail::trace_enabled_flag().load(std::memory_order_relaxed);
+}
+
+// Start recording into path (events so far are discarded). Returns false
+// and sets error if the file cannot be created.
+bool start_trace(const std::string& path, std::string& error);
+
+// Write the file one last time and stop recording.
+void stop_trace();
+
+// Current trace file, empty when tracing is off.
+std::string trace_path();
+
+// Rewrite the trace file with everything recorded so far.
+void flush_trace();
+
+// Microseconds on the trace clock.
+int64_t trace_now_us();
+
+class TraceSpan {
+public:
+    TraceSpan(const char* category, std::string_view name) {
+        if (tracing()) {
+            active_ = true;
+            category_ = category;
+            name_.assign(name.data(), name.size());
+            start_us_ = trace_now_us();
+        }
+    }
+    ~TraceSpan() { end(); }
+
+    TraceSpan(const TraceSpan&) = delete;
+    TraceSpan& operator=(const TraceSpan&) = delete;
+
+    bool active() const { return active_; }
+
+    void arg(const char* key, int64_t value) {
+        if (active_) args_.emplace_back(key, std::to_string(value));
+    }
+    void arg(const char* key, std::string_view value);  // JSON-escaped
+    void arg_hex(const char* key, uint64_t value);
+
+    // Record the span now instead of at scope exit.
+    void end();
+
+private:
+    bool active_ = false;
+    const char* category_ = "";
+    std::string name_;
+    int64_t start_us_ = 0;
+    std::vector<std::pair<std::string, std::string>> args_;  // raw JSON values
+};
+
+} // namespace idasql
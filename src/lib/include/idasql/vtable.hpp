@@ -9,7 +9,8 @@
  * vtable.hpp - SQLite Virtual Table framework for IDA
  *
  * This file re-exports the xsql virtual table framework types into the idasql
- * namespace for convenience.
+ * namespace for convenience. The table()/cached_table()/generator_table()
+ * entry points return instrumented builders that feed idasql_stats.
  *
  * Two table patterns are available:
  *
@@ -42,6 +43,8 @@
 
 #include <xsql/xsql.hpp>
 
+#include <idasql/vtable_stats.hpp>
+
 namespace idasql {
 
 // ============================================================================
@@ -66,9 +69,12 @@ using xsql::Cursor;
 using xsql::register_vtable;
 using xsql::create_vtable;
 
-// Index-based table builder
+// Index-based table builder (instrumented, see vtable_stats.hpp)
 using xsql::VTableBuilder;
-using xsql::table;
+
+inline StatsBuilder<VTableBuilder> table(const char* name) {
+    return StatsBuilder<VTableBuilder>(xsql::table(name), name);
+}
 
 // ============================================================================
 // Cached Table API (query-scoped cache, freed after query)
@@ -99,8 +105,8 @@ template<typename RowData>
 using CachedTableBuilder = xsql::CachedTableBuilder<RowData>;
 
 template<typename RowData>
-inline CachedTableBuilder<RowData> cached_table(const char* name) {
-    return xsql::cached_table<RowData>(name);
+inline StatsBuilder<CachedTableBuilder<RowData>> cached_table(const char* name) {
+    return StatsBuilder<CachedTableBuilder<RowData>>(xsql::cached_table<RowData>(name), name);
 }
 
 // ============================================================================
@@ -122,8 +128,8 @@ template<typename RowData>
 using GeneratorTableBuilder = xsql::GeneratorTableBuilder<RowData>;
 
 template<typename RowData>
-inline GeneratorTableBuilder<RowData> generator_table(const char* name) {
-    return xsql::generator_table<RowData>(name);
+inline StatsBuilder<GeneratorTableBuilder<RowData>> generator_table(const char* name) {
+    return StatsBuilder<GeneratorTableBuilder<RowData>>(xsql::generator_table<RowData>(name), name);
 }
 
 } // namespace idasql
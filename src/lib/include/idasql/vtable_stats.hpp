@@ -0,0 +1,678 @@
+// Copyright (c) 2024-2026 Elias Bachaalany
+// SPDX-License-Identifier: MPL-2.0
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+/**
+ * vtable_stats.hpp - Execution counters for idasql virtual tables
+ *
+ * Every table defined through idasql::table / cached_table / generator_table
+ * is built through StatsBuilder, which wraps the callbacks handed to the
+ * xsql builder:
+ *
+ *   cache_builder          -> cache_builds, cache_build_us, rows, cache_bytes
+ *   generator / filters    -> filter_calls, rows, next_calls, next_us
+ *   count / row_lookup     -> filter_calls, rows
+ *   column getters         -> per-column calls, us
+ *
+ * next_us and per-column us cost two clock reads per row or cell, so they
+ * are only measured while PRAGMA idasql.stats = 1 (off by default); call
+ * and row counts are always kept.
+ *
+ * Engine-wide counters (Hex-Rays decompiles, flowchart builds, statement
+ * cache, time inside SQLite) live in engine_stats(). Everything is exposed
+ * through the idasql_stats table and cleared by PRAGMA idasql.stats_reset.
+ *
+ * Counters are process-wide and relaxed-atomic; they are diagnostics, not
+ * accounting. The same wrappers emit trace.hpp spans (filter, next batches,
+ * cache builds) while PRAGMA idasql.trace is on, and record full-scan vs
+ * pushdown accesses into the running cursor's QueryPlan (query_plan.hpp).
+ */
+
+#pragma once
+
+#include <idasql/query_plan.hpp>
+#include <idasql/trace.hpp>
+#include <xsql/xsql.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace idasql {
+
+// ============================================================================
+// Counters
+// ============================================================================
+
+struct StatCounter {
+    std::atomic<uint64_t> calls{0};
+    std::atomic<uint64_t> ns{0};
+
+    void add(uint64_t elapsed_ns) {
+        calls.fetch_add(1, std::memory_order_relaxed);
+        ns.fetch_add(elapsed_ns, std::memory_order_relaxed);
+    }
+    void count() {
+        calls.fetch_add(1, std::memory_order_relaxed);
+    }
+    void reset() {
+        calls.store(0, std::memory_order_relaxed);
+        ns.store(0, std::memory_order_relaxed);
+    }
+};
+
+// Charges the lifetime of the scope to a counter.
+class StatTimer {
+public:
+    explicit StatTimer(StatCounter& counter)
+        : counter_(counter), started_(std::chrono::steady_clock::now()) {}
+    ~StatTimer() {
+        counter_.add(static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - started_).count()));
+    }
+
+    StatTimer(const StatTimer&) = delete;
+    StatTimer& operator=(const StatTimer&) = delete;
+
+private:
+    StatCounter& counter_;
+    std::chrono::steady_clock::time_point started_;
+};
+
+namespace detail {
+inline std::atomic<bool>& stats_timing_flag() {
+    static std::atomic<bool> enabled{false};
+    return enabled;
+}
+} // namespace detail
+
+// PRAGMA idasql.stats: time per-row and per-cell callbacks.
+inline bool stats_timing() {
+    return detail::stats_timing_flag().load(std::memory_order_relaxed);
+}
+
+inline void set_stats_timing(bool enabled) {
+    detail::stats_timing_flag().store(enabled, std::memory_order_relaxed);
+}
+
+// StatTimer for per-row and per-cell callbacks: only counts the call
+// unless stats_timing() is on.
+class OptionalStatTimer {
+public:
+    explicit OptionalStatTimer(StatCounter& counter) : counter_(counter), timed_(stats_timing()) {
+        if (timed_) {
+            started_ = std::chrono::steady_clock::now();
+        }
+    }
+    ~OptionalStatTimer() {
+        if (!timed_) {
+            counter_.count();
+            return;
+        }
+        counter_.add(static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - started_).count()));
+    }
+
+    OptionalStatTimer(const OptionalStatTimer&) = delete;
+    OptionalStatTimer& operator=(const OptionalStatTimer&) = delete;
+
+private:
+    StatCounter& counter_;
+    bool timed_;
+    std::chrono::steady_clock::time_point started_;
+};
+
+struct ColumnStats {
+    std::string name;
+    StatCounter getter;
+};
+
+struct TableStats {
+    std::string name;
+    std::atomic<uint64_t> filter_calls{0};
+    std::atomic<uint64_t> rows{0};
+    StatCounter cache_build;
+    StatCounter next;
+    std::atomic<uint64_t> cache_bytes{0};      // most recent cache build
+    std::atomic<uint64_t> cache_bytes_max{0};  // largest cache build
+
+    // Columns in definition order (hidden ones included, untimed), so a
+    // RowIterator's column index maps back to a name.
+    std::vector<std::unique_ptr<ColumnStats>> columns;
+
+    // Cost model for admission control (query_cost.cpp), captured at
+    // definition time: rows of a full scan, and functions a full scan has
+    // to decompile (empty for tables that never decompile).
+    std::function<size_t()> estimate_rows;
+    std::function<size_t()> scan_decompiles;
+
+    // Find or append; the returned reference stays valid.
+    ColumnStats& column(const char* column_name);
+    ColumnStats* column_at(int index);
+    void reset();
+};
+
+struct EngineStats {
+    StatCounter decompile;
+    std::atomic<uint64_t> decompile_cache_hits{0};
+    std::atomic<uint64_t> decompile_cache_misses{0};
+    StatCounter flowchart;
+    StatCounter sqlite;  // time inside sqlite3_prepare/step, vtables included
+    std::atomic<uint64_t> statement_cache_hits{0};
+    std::atomic<uint64_t> statement_cache_misses{0};
+    std::atomic<uint64_t> result_cache_hits{0};
+    std::atomic<uint64_t> result_cache_misses{0};
+    std::atomic<uint64_t> queries_coalesced{0};  // served by an identical running read
+    std::atomic<uint64_t> query_bytes_max{0};  // largest QueryMemory peak
+    std::atomic<uint64_t> memory_limit_hits{0};
+    std::atomic<uint64_t> rows_returned{0};   // rows handed out by finished cursors
+    std::atomic<uint64_t> query_timeouts{0};  // cursors stopped by a timeout or deadline
+
+    void reset();
+};
+
+// Find-or-create by table name. Entries are never removed, so references
+// stay valid for the process lifetime (definitions hold raw pointers).
+TableStats& table_stats(const std::string& name);
+
+// Lookup without creating; nullptr for tables never defined.
+TableStats* find_table_stats(const std::string& name);
+
+EngineStats& engine_stats();
+
+// Zero every counter (PRAGMA idasql.stats_reset).
+void reset_stats();
+
+// One (scope, column, counter, value) sample per row of idasql_stats.
+struct StatSample {
+    std::string scope;    // table name, or "hexrays" / "flowchart" / "sqlite" /
+                          // "statement_cache" / "memory" / "queries"
+    std::string column;   // empty for table-level counters
+    std::string counter;
+    int64_t value = 0;
+};
+
+std::vector<StatSample> collect_stats();
+
+// Raise a high-water mark.
+inline void update_max(std::atomic<uint64_t>& slot, uint64_t value) {
+    uint64_t seen = slot.load(std::memory_order_relaxed);
+    while (value > seen && !slot.compare_exchange_weak(seen, value, std::memory_order_relaxed)) {
+    }
+}
+
+// Heap bytes owned by a std::string beyond its inline buffer.
+inline size_t heap_bytes(const std::string& text) {
+    return text.capacity() > std::string().capacity() ? text.capacity() + 1 : 0;
+}
+
+// Run fn and charge it to counter.
+template <typename Fn>
+decltype(auto) timed_stat(StatCounter& counter, Fn&& fn) {
+    StatTimer timer(counter);
+    return std::forward<Fn>(fn)();
+}
+
+namespace detail {
+
+// Signature of a non-generic callable, so wrappers keep the exact parameter
+// types the xsql builder overloads on.
+template <typename F>
+struct callable_signature : callable_signature<decltype(&F::operator())> {};
+
+template <typename R, typename... A>
+struct callable_signature<R (*)(A...)> {
+    using result = R;
+    template <template <typename, typename...> class T>
+    using apply = T<R, A...>;
+};
+
+template <typename C, typename R, typename... A>
+struct callable_signature<R (C::*)(A...) const> : callable_signature<R (*)(A...)> {};
+
+template <typename C, typename R, typename... A>
+struct callable_signature<R (C::*)(A...)> : callable_signature<R (*)(A...)> {};
+
+template <typename R, typename... A>
+struct TimedCallable {
+    template <typename F>
+    static auto wrap(F fn, StatCounter* counter, const std::string* table) {
+        return [fn = std::move(fn), counter, table](A... args) mutable -> R {
+            ActiveTableScope active(table);
+            OptionalStatTimer timer(*counter);
+            return fn(std::forward<A>(args)...);
+        };
+    }
+};
+
+template <typename F>
+auto timed_callable(F&& fn, StatCounter* counter, const std::string* table) {
+    using Fn = std::decay_t<F>;
+    using Sig = typename callable_signature<Fn>::template apply<TimedCallable>;
+    return Sig::wrap(Fn(std::forward<F>(fn)), counter, table);
+}
+
+// Rows per "next" trace span; one span per row would swamp the viewer.
+constexpr int64_t kTraceBatchRows = 256;
+
+// Groups consecutive rows of one cursor into a single trace span.
+class TraceBatch {
+public:
+    ~TraceBatch() { flush(); }
+
+    void row(const TableStats& stats) {
+        if (!span_) {
+            if (!tracing()) return;
+            span_ = std::make_unique<TraceSpan>("vtable", "next " + stats.name);
+        }
+        if (++rows_ >= kTraceBatchRows) flush();
+    }
+    void flush() {
+        if (!span_) return;
+        span_->arg("rows", rows_);
+        span_.reset();
+        rows_ = 0;
+    }
+
+private:
+    std::unique_ptr<TraceSpan> span_;
+    int64_t rows_ = 0;
+};
+
+// Counts rows and advance time of a generator; column access goes through
+// the (already timed) column getters.
+template <typename Row>
+class CountingGenerator : public xsql::Generator<Row> {
+public:
+    CountingGenerator(std::unique_ptr<xsql::Generator<Row>> inner, TableStats* stats,
+                      TableAccess* access)
+        : inner_(std::move(inner)), stats_(stats), access_(access) {}
+
+    bool next() override {
+        ActiveTableScope active(&stats_->name);
+        OptionalStatTimer timer(stats_->next);
+        const bool ok = inner_->next();
+        if (ok) {
+            stats_->rows.fetch_add(1, std::memory_order_relaxed);
+            if (access_) ++access_->rows;
+            batch_.row(*stats_);
+        } else {
+            batch_.flush();
+        }
+        return ok;
+    }
+    const Row& current() const override { return inner_->current(); }
+    int64_t rowid() const override { return inner_->rowid(); }
+
+private:
+    std::unique_ptr<xsql::Generator<Row>> inner_;
+    TableStats* stats_;
+    TableAccess* access_;  // owned by the cursor's QueryPlan; may be null
+    TraceBatch batch_;
+};
+
+// Same for pushdown RowIterators, which also produce their own columns.
+class CountingRowIterator : public xsql::RowIterator {
+public:
+    CountingRowIterator(std::unique_ptr<xsql::RowIterator> inner, TableStats* stats,
+                        TableAccess* access)
+        : inner_(std::move(inner)), stats_(stats), access_(access) {}
+
+    bool next() override {
+        ActiveTableScope active(&stats_->name);
+        OptionalStatTimer timer(stats_->next);
+        const bool ok = inner_->next();
+        if (ok) {
+            stats_->rows.fetch_add(1, std::memory_order_relaxed);
+            if (access_) ++access_->rows;
+            batch_.row(*stats_);
+        } else {
+            batch_.flush();
+        }
+        return ok;
+    }
+    bool eof() const override { return inner_->eof(); }
+    void column(xsql::FunctionContext& ctx, int col) override {
+        ActiveTableScope active(&stats_->name);
+        ColumnStats* column = stats_->column_at(col);
+        if (!column) {
+            inner_->column(ctx, col);
+            return;
+        }
+        OptionalStatTimer timer(column->getter);
+        inner_->column(ctx, col);
+    }
+    int64_t rowid() const override { return inner_->rowid(); }
+
+private:
+    std::unique_ptr<xsql::RowIterator> inner_;
+    TableStats* stats_;
+    TableAccess* access_;
+    TraceBatch batch_;
+};
+
+// Wrap a factory returning unique_ptr<Generator<T>> or unique_ptr<RowIterator>
+// (or a subclass of either): each call is one filter invocation of the given
+// access kind, and the product is counted.
+template <typename Product, bool = std::is_base_of_v<xsql::RowIterator, Product>>
+struct counted_product {
+    using type = xsql::RowIterator;
+    using wrapper = CountingRowIterator;
+};
+
+template <typename Product>
+struct counted_product<Product, false> {
+    using Row = std::decay_t<decltype(std::declval<const Product&>().current())>;
+    using type = xsql::Generator<Row>;
+    using wrapper = CountingGenerator<Row>;
+};
+
+template <typename R, typename... A>
+struct CountingFactory {
+    using Product = counted_product<typename R::element_type>;
+    using Out = std::unique_ptr<typename Product::type>;
+
+    template <typename F>
+    static auto wrap(F fn, TableStats* stats, TableAccessKind kind) {
+        return [fn = std::move(fn), stats, kind](A... args) mutable -> Out {
+            stats->filter_calls.fetch_add(1, std::memory_order_relaxed);
+            TableAccess* access = note_table_access(stats->name, kind);
+            if (access) ++access->filter_calls;
+            ActiveTableScope active(&stats->name);
+            TraceSpan span("vtable", tracing() ? "filter " + stats->name : std::string());
+            Out product = fn(std::forward<A>(args)...);
+            if (!product) return product;
+            return std::make_unique<typename Product::wrapper>(std::move(product), stats, access);
+        };
+    }
+};
+
+template <typename F>
+auto counting_factory(F&& fn, TableStats* stats, TableAccessKind kind) {
+    using Fn = std::decay_t<F>;
+    using Sig = typename callable_signature<Fn>::template apply<CountingFactory>;
+    return Sig::wrap(Fn(std::forward<F>(fn)), stats, kind);
+}
+
+// Row types with owned strings or vectors declare
+//   size_t row_heap_bytes(const Row&);
+// next to the type (found by ADL); others count as sizeof(Row).
+template <typename Row>
+auto row_heap_bytes_of(const Row& row, int) -> decltype(row_heap_bytes(row)) {
+    return row_heap_bytes(row);
+}
+
+template <typename Row>
+size_t row_heap_bytes_of(const Row&, long) {
+    return 0;
+}
+
+// Approximate size of a cache vector; rows are visited once as it grows.
+template <typename Row>
+class CacheProbe final : public MemoryProbe {
+public:
+    explicit CacheProbe(const std::vector<Row>& cache) : cache_(cache) {}
+
+    uint64_t bytes() override {
+        for (; counted_ < cache_.size(); ++counted_) {
+            heap_ += row_heap_bytes_of(cache_[counted_], 0);
+        }
+        return cache_.capacity() * sizeof(Row) + heap_;
+    }
+
+private:
+    const std::vector<Row>& cache_;
+    size_t counted_ = 0;
+    uint64_t heap_ = 0;
+};
+
+// A cache build is always a full scan of the table.
+template <typename F>
+auto timed_cache_builder(F&& fn, TableStats* stats) {
+    return [fn = std::decay_t<F>(std::forward<F>(fn)), stats](auto& cache) mutable {
+        using Row = typename std::decay_t<decltype(cache)>::value_type;
+        TableAccess* access = note_table_access(stats->name, TableAccessKind::FullScan);
+        ActiveTableScope active(&stats->name);
+        TraceSpan span("vtable", tracing() ? "cache_build " + stats->name : std::string());
+        CacheProbe<Row> probe(cache);
+        uint64_t bytes = 0;
+        {
+            MemoryProbeScope probing(&probe);
+            StatTimer timer(stats->cache_build);
+            fn(cache);
+            bytes = probe.bytes();
+        }
+        stats->rows.fetch_add(cache.size(), std::memory_order_relaxed);
+        stats->cache_bytes.store(bytes, std::memory_order_relaxed);
+        update_max(stats->cache_bytes_max, bytes);
+        if (access) {
+            ++access->filter_calls;
+            access->rows += cache.size();
+        }
+        note_cache_bytes(access, bytes);
+        span.arg("rows", static_cast<int64_t>(cache.size()));
+        span.arg("bytes", static_cast<int64_t>(bytes));
+    };
+}
+
+// Index-based tables call count() once per xFilter and then read rows
+// 0..count-1 through their getters, so every call is a full scan.
+template <typename F>
+auto counted_scan(F&& fn, TableStats* stats) {
+    return [fn = std::decay_t<F>(std::forward<F>(fn)), stats]() mutable -> size_t {
+        stats->filter_calls.fetch_add(1, std::memory_order_relaxed);
+        TableAccess* access = note_table_access(stats->name, TableAccessKind::FullScan);
+        ActiveTableScope active(&stats->name);
+        const size_t rows = static_cast<size_t>(fn());
+        stats->rows.fetch_add(rows, std::memory_order_relaxed);
+        if (access) {
+            ++access->filter_calls;
+            access->rows += rows;
+        }
+        return rows;
+    };
+}
+
+// A rowid lookup serves `WHERE rowid = ?` without touching the cache.
+template <typename F>
+auto counted_lookup(F&& fn, TableStats* stats) {
+    return [fn = std::decay_t<F>(std::forward<F>(fn)), stats](auto& row, int64_t rowid) mutable -> bool {
+        stats->filter_calls.fetch_add(1, std::memory_order_relaxed);
+        TableAccess* access = note_table_access(stats->name, TableAccessKind::Pushdown);
+        ActiveTableScope active(&stats->name);
+        const bool found = fn(row, rowid);
+        if (access) ++access->filter_calls;
+        if (found) {
+            stats->rows.fetch_add(1, std::memory_order_relaxed);
+            if (access) ++access->rows;
+        }
+        return found;
+    };
+}
+
+} // namespace detail
+
+// ============================================================================
+// StatsBuilder: xsql table builder with instrumented callbacks
+// ============================================================================
+
+template <typename Base>
+class StatsBuilder {
+public:
+    StatsBuilder(Base base, const char* name)
+        : base_(std::move(base)), stats_(&table_stats(name ? name : "")) {}
+
+    auto build() { return base_.build(); }
+
+#define IDASQL_STATS_FORWARD(method)                          \
+    template <typename... Args>                               \
+    StatsBuilder& method(Args&&... args) {                    \
+        base_.method(std::forward<Args>(args)...);            \
+        return *this;                                         \
+    }
+
+    IDASQL_STATS_FORWARD(no_shared_cache)
+    IDASQL_STATS_FORWARD(deletable)
+    IDASQL_STATS_FORWARD(insertable)
+    IDASQL_STATS_FORWARD(row_populator)
+    IDASQL_STATS_FORWARD(order_by_consumed)
+    IDASQL_STATS_FORWARD(index_on)
+    IDASQL_STATS_FORWARD(full_scan_error)
+#undef IDASQL_STATS_FORWARD
+
+    // Getter-first column overloads: (name, getter, [setter...]).
+#define IDASQL_STATS_COLUMN(method)                                              \
+    template <typename Getter, typename... Rest>                                 \
+    StatsBuilder& method(const char* name, Getter&& getter, Rest&&... rest) {    \
+        base_.method(name,                                                       \
+                     detail::timed_callable(std::forward<Getter>(getter),        \
+                                            &stats_->column(name).getter, \
+                                            &stats_->name),              \
+                     std::forward<Rest>(rest)...);                               \
+        return *this;                                                            \
+    }
+
+    IDASQL_STATS_COLUMN(column_int)
+    IDASQL_STATS_COLUMN(column_int64)
+    IDASQL_STATS_COLUMN(column_text)
+    IDASQL_STATS_COLUMN(column_double)
+    IDASQL_STATS_COLUMN(column_blob)
+    IDASQL_STATS_COLUMN(column_int_rw)
+    IDASQL_STATS_COLUMN(column_int64_rw)
+    IDASQL_STATS_COLUMN(column_text_rw)
+    IDASQL_STATS_COLUMN(column_text_nullable_rw)
+#undef IDASQL_STATS_COLUMN
+
+    // Hidden (parameter) columns carry no getter; record them for ordering.
+#define IDASQL_STATS_HIDDEN(method)                                   \
+    template <typename... Rest>                                       \
+    StatsBuilder& method(const char* name, Rest&&... rest) {          \
+        stats_->column(name);                                         \
+        base_.method(name, std::forward<Rest>(rest)...);              \
+        return *this;                                                 \
+    }
+
+    IDASQL_STATS_HIDDEN(hidden_column_int)
+    IDASQL_STATS_HIDDEN(hidden_column_int64)
+    IDASQL_STATS_HIDDEN(hidden_column_text)
+#undef IDASQL_STATS_HIDDEN
+
+    // Typed column overloads: (name, type, getter, [setter...]).
+    template <typename Getter, typename... Rest>
+    StatsBuilder& column(const char* name, xsql::ColumnType type, Getter&& getter,
+                         Rest&&... rest) {
+        base_.column(name, type,
+                     detail::timed_callable(std::forward<Getter>(getter),
+                                            &stats_->column(name).getter,
+                                            &stats_->name),
+                     std::forward<Rest>(rest)...);
+        return *this;
+    }
+
+    template <typename Getter, typename... Rest>
+    StatsBuilder& column_rw(const char* name, xsql::ColumnType type, Getter&& getter,
+                            Rest&&... rest) {
+        base_.column_rw(name, type,
+                        detail::timed_callable(std::forward<Getter>(getter),
+                                               &stats_->column(name).getter,
+                                               &stats_->name),
+                        std::forward<Rest>(rest)...);
+        return *this;
+    }
+
+    template <typename F>
+    StatsBuilder& estimate_rows(F&& fn) {
+        stats_->estimate_rows = fn;
+        base_.estimate_rows(std::forward<F>(fn));
+        return *this;
+    }
+
+    // idasql-only: how many functions a full scan decompiles. Not passed
+    // to xsql; feeds the pre-execution cost estimate.
+    template <typename F>
+    StatsBuilder& scan_decompiles(F&& fn) {
+        stats_->scan_decompiles = std::forward<F>(fn);
+        return *this;
+    }
+
+    template <typename F>
+    StatsBuilder& count(F&& fn) {
+        base_.count(detail::counted_scan(std::forward<F>(fn), stats_));
+        return *this;
+    }
+
+    template <typename F>
+    StatsBuilder& row_lookup(F&& fn) {
+        base_.row_lookup(detail::counted_lookup(std::forward<F>(fn), stats_));
+        return *this;
+    }
+
+    template <typename F>
+    StatsBuilder& cache_builder(F&& fn) {
+        base_.cache_builder(detail::timed_cache_builder(std::forward<F>(fn), stats_));
+        return *this;
+    }
+
+    template <typename F>
+    StatsBuilder& generator(F&& factory) {
+        base_.generator(detail::counting_factory(std::forward<F>(factory), stats_,
+                                                 TableAccessKind::FullScan));
+        return *this;
+    }
+
+    template <typename F, typename... Rest>
+    StatsBuilder& filter_eq(const char* column, F&& factory, Rest&&... rest) {
+        base_.filter_eq(column, pushdown(std::forward<F>(factory)),
+                        std::forward<Rest>(rest)...);
+        return *this;
+    }
+
+    template <typename F, typename... Rest>
+    StatsBuilder& filter_eq_text(const char* column, F&& factory, Rest&&... rest) {
+        base_.filter_eq_text(column, pushdown(std::forward<F>(factory)),
+                             std::forward<Rest>(rest)...);
+        return *this;
+    }
+
+    template <typename Spec, typename F, typename... Rest>
+    StatsBuilder& constraint_filter(std::initializer_list<Spec> specs, F&& factory,
+                                    Rest&&... rest) {
+        base_.constraint_filter(specs,
+                                pushdown(std::forward<F>(factory)),
+                                std::forward<Rest>(rest)...);
+        return *this;
+    }
+
+    template <typename F, typename... Rest>
+    StatsBuilder& parametric_filter(std::vector<std::string> params, F&& factory,
+                                    Rest&&... rest) {
+        base_.parametric_filter(std::move(params),
+                                pushdown(std::forward<F>(factory)),
+                                std::forward<Rest>(rest)...);
+        return *this;
+    }
+
+private:
+    template <typename F>
+    auto pushdown(F&& factory) {
+        return detail::counting_factory(std::forward<F>(factory), stats_,
+                                        TableAccessKind::Pushdown);
+    }
+
+    Base base_;
+    TableStats* stats_;
+};
+
+} // namespace idasql
@@ -0,0 +1,89 @@
+// Copyright (c) 2024-2026 Elias Bachaalany
+// SPDX-License-Identifier: MPL-2.0
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#include <idasql/cancel.hpp>
+#include <idasql/query_plan.hpp>
+
+#include <utility>
+
+namespace idasql {
+
+namespace {
+
+// The shared_ptr keeps the token alive; the raw pointer makes polling a
+// plain thread-local load.
+thread_local CancelTokenPtr t_token;
+thread_local const CancelToken* t_token_raw = nullptr;
+
+} // namespace
+
+CancelToken::CancelToken(std::shared_ptr<CancelToken> parent)
+    : parent_(std::move(parent)) {}
+
+void CancelToken::cancel() {
+    cancelled_.store(true, std::memory_order_relaxed);
+}
+
+bool CancelToken::cancelled() const {
+    for (const CancelToken* t = this; t; t = t->parent_.get()) {
+        if (t->cancelled_.load(std::memory_order_relaxed)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void CancelToken::set_deadline(clock::time_point deadline) {
+    // Never store the "no deadline" sentinel for a real deadline.
+    const int64_t ticks = deadline.time_since_epoch().count();
+    deadline_ticks_.store(ticks != 0 ? ticks : 1, std::memory_order_relaxed);
+}
+
+void CancelToken::clear_deadline() {
+    deadline_ticks_.store(0, std::memory_order_relaxed);
+}
+
+bool CancelToken::deadline_passed() const {
+    int64_t now = 0;
+    for (const CancelToken* t = this; t; t = t->parent_.get()) {
+        const int64_t deadline = t->deadline_ticks_.load(std::memory_order_relaxed);
+        if (deadline == 0) {
+            continue;
+        }
+        if (now == 0) {
+            now = clock::now().time_since_epoch().count();
+        }
+        if (now >= deadline) {
+            return true;
+        }
+    }
+    return false;
+}
+
+CancelTokenPtr current_cancel_token() {
+    return t_token;
+}
+
+CancelScope::CancelScope(CancelTokenPtr token) : previous_(std::move(t_token)) {
+    t_token = std::move(token);
+    t_token_raw = t_token.get();
+}
+
+CancelScope::~CancelScope() {
+    t_token = std::move(previous_);
+    t_token_raw = t_token.get();
+}
+
+bool query_cancelled() {
+    if (!t_token_raw || (!t_token_raw->expired() && !query_memory_exceeded())) {
+        return false;
+    }
+    t_token_raw->tripped_.store(true, std::memory_order_relaxed);
+    return true;
+}
+
+} // namespace idasql
@@ -0,0 +1,572 @@
+// Copyright (c) 2024-2026 Elias Bachaalany
+// SPDX-License-Identifier: MPL-2.0
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#include "change_journal.hpp"
+
+#include <idasql/result_cache.hpp>
+#include <idasql/runtime_settings.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <string_view>
+#include <tuple>
+
+#include "decompiler.hpp"
+
+namespace idasql {
+
+namespace {
+
+// Keys one batch may hold before it falls back to a full export.
+constexpr size_t kMaxJournalKeys = 200000;
+
+// Larger undefine/convert ranges are not tracked byte by byte.
+constexpr ea_t kMaxRangeBytes = 4096;
+
+// idb_changes keeps this many of the newest records.
+constexpr size_t kChangeLogCapacity = 65536;
+
+int64_t unix_time_ms() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+uint64_t ea_or_zero(ea_t ea) {
+    return ea != BADADDR ? static_cast<uint64_t>(ea) : 0;
+}
+
+ChangeEvent to_event(const ChangeRecord& record) {
+    ChangeEvent event;
+    event.seq = record.seq;
+    event.time_ms = record.time_ms;
+    event.kind = record.kind;
+    event.address = ea_or_zero(record.address);
+    event.func_addr = ea_or_zero(record.func);
+    event.target = ea_or_zero(record.target);
+    event.detail = record.detail;
+    return event;
+}
+
+std::string comment_at(ea_t ea, bool repeatable) {
+    qstring cmt;
+    return get_cmt(&cmt, ea, repeatable) > 0 ? std::string(cmt.c_str()) : std::string();
+}
+
+} // namespace
+
+ChangeJournal& ChangeJournal::instance() {
+    static ChangeJournal journal;
+    return journal;
+}
+
+void ChangeJournal::attach() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (attached_++ > 0) {
+        return;
+    }
+    hook_event_listener(HT_IDB, &idb_listener_, nullptr);
+    hook_event_listener(HT_IDP, &idp_listener_, nullptr);
+    if (decompiler::hexrays_available()) {
+        hexrays_hooked_ = install_hexrays_callback(&ChangeJournal::hexrays_callback, this);
+    }
+}
+
+void ChangeJournal::detach() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (attached_ == 0 || --attached_ > 0) {
+        return;
+    }
+    unhook_event_listener(HT_IDB, &idb_listener_);
+    unhook_event_listener(HT_IDP, &idp_listener_);
+    if (hexrays_hooked_) {
+        remove_hexrays_callback(&ChangeJournal::hexrays_callback, this);
+        hexrays_hooked_ = false;
+    }
+}
+
+std::vector<ChangeRecord> ChangeJournal::changes_since(uint64_t after) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<ChangeRecord> out;
+    const uint64_t oldest = next_seq_ - ring_.size();
+    for (uint64_t seq = std::max(after + 1, oldest); seq < next_seq_; ++seq) {
+        out.push_back(ring_[(seq - 1) % kChangeLogCapacity]);
+    }
+    return out;
+}
+
+uint64_t ChangeJournal::last_seq() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return next_seq_ - 1;
+}
+
+ChangeBatch ChangeJournal::wait(uint64_t after, size_t max_records, int timeout_ms,
+                                const std::function<bool()>& stop) {
+    using clock = std::chrono::steady_clock;
+    std::unique_lock<std::mutex> lock(mutex_);
+    const auto deadline = clock::now() + std::chrono::milliseconds(std::max(timeout_ms, 0));
+    // Short slices so stop() is noticed without a wakeup from log().
+    while (next_seq_ - 1 <= after && clock::now() < deadline && !(stop && stop())) {
+        logged_.wait_until(lock, std::min(deadline, clock::now() + std::chrono::milliseconds(100)));
+    }
+
+    ChangeBatch batch;
+    const uint64_t newest = next_seq_ - 1;
+    if (after > newest) {
+        // Cursor from before a restart: nothing it saw is still here.
+        batch.gap = newest > 0;
+        batch.last_seq = newest;
+        return batch;
+    }
+    uint64_t first = after + 1;
+    const uint64_t oldest = next_seq_ - ring_.size();
+    if (first < oldest) {
+        batch.gap = true;
+        first = oldest;
+    }
+    const uint64_t end = std::min(next_seq_, first + std::max<size_t>(max_records, 1));
+    batch.last_seq = end - 1;
+
+    // Keep only the newest record per kind/address/target.
+    using Key = std::tuple<std::string_view, ea_t, ea_t>;
+    std::map<Key, uint64_t> newest_seq;
+    for (uint64_t seq = first; seq < end; ++seq) {
+        const ChangeRecord& record = ring_[(seq - 1) % kChangeLogCapacity];
+        newest_seq[Key(record.kind, record.address, record.target)] = seq;
+    }
+    for (uint64_t seq = first; seq < end; ++seq) {
+        const ChangeRecord& record = ring_[(seq - 1) % kChangeLogCapacity];
+        if (newest_seq[Key(record.kind, record.address, record.target)] == seq) {
+            batch.events.push_back(to_event(record));
+        } else {
+            ++batch.coalesced;
+        }
+    }
+    return batch;
+}
+
+void ChangeJournal::start() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    changes_ = SnapshotChanges();
+    active_ = true;
+}
+
+void ChangeJournal::stop() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    changes_ = SnapshotChanges();
+    active_ = false;
+}
+
+bool ChangeJournal::active() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return active_;
+}
+
+SnapshotChanges ChangeJournal::take() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    SnapshotChanges taken = std::move(changes_);
+    changes_ = SnapshotChanges();
+    return taken;
+}
+
+size_t ChangeJournal::pending() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return changes_.functions.size() + changes_.addresses.size() +
+        changes_.type_ordinals.size() + (changes_.all_types ? 1 : 0) +
+        (changes_.segments ? 1 : 0) + (changes_.full ? 1 : 0);
+}
+
+void ChangeJournal::require_full() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    changes_ = SnapshotChanges();
+    changes_.full = true;
+}
+
+void ChangeJournal::log(const char* kind, ea_t address, ea_t target, std::string detail) {
+    ChangeRecord record;
+    record.seq = next_seq_++;
+    record.time_ms = unix_time_ms();
+    record.kind = kind;
+    record.address = address;
+    if (func_t* pfn = address != BADADDR ? get_func(address) : nullptr) {
+        record.func = pfn->start_ea;
+    }
+    record.target = target;
+    record.detail = std::move(detail);
+    if (ring_.size() < kChangeLogCapacity) {
+        ring_.push_back(std::move(record));
+    } else {
+        ring_[(record.seq - 1) % kChangeLogCapacity] = std::move(record);
+    }
+    logged_.notify_all();
+}
+
+void ChangeJournal::mark_function(ea_t start) {
+    if (start != BADADDR) {
+        changes_.functions.insert(static_cast<uint64_t>(start));
+    }
+}
+
+void ChangeJournal::mark_function_at(ea_t ea) {
+    if (func_t* pfn = get_func(ea)) {
+        mark_function(pfn->start_ea);
+    }
+}
+
+void ChangeJournal::mark_address(ea_t ea) {
+    if (ea != BADADDR) {
+        changes_.addresses.insert(static_cast<uint64_t>(ea));
+    }
+}
+
+void ChangeJournal::mark_range(ea_t start, ea_t end) {
+    if (end <= start) {
+        return;
+    }
+    if (end - start > kMaxRangeBytes) {
+        changes_.full = true;
+        return;
+    }
+    // Every byte: the old heads are gone, but their rows are keyed by them.
+    for (ea_t ea = start; ea < end; ++ea) {
+        mark_address(ea);
+    }
+    mark_function_at(start);
+}
+
+// Item heads of code a function now covers: their instructions and xrefs
+// rows were exported with another func_addr/from_func. Rows a function
+// stops covering are found in the snapshot by refresh_snapshot.
+void ChangeJournal::mark_heads(ea_t start, ea_t end) {
+    for (ea_t ea = start; ea != BADADDR && ea < end; ea = next_head(ea, end)) {
+        mark_address(ea);
+    }
+}
+
+// Operand text (and pseudocode) of instructions that reference ea shows
+// its name.
+void ChangeJournal::mark_referrers(ea_t ea) {
+    const bool pseudocode = runtime_settings().snapshot_pseudocode();
+    xrefblk_t xb;
+    for (bool ok = xb.first_to(ea, XREF_ALL); ok; ok = xb.next_to()) {
+        mark_address(xb.from);
+        if (pseudocode) {
+            mark_function_at(xb.from);
+        }
+    }
+}
+
+void ChangeJournal::check_overflow() {
+    if (changes_.full ||
+        changes_.functions.size() + changes_.addresses.size() + changes_.type_ordinals.size() >
+            kMaxJournalKeys) {
+        changes_ = SnapshotChanges();
+        changes_.full = true;
+    }
+}
+
+void ChangeJournal::on_idb_event(ssize_t code, va_list va) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    // Snapshot dirty set; the idb_changes feed is always recorded.
+    const bool track = active_ && !changes_.full;
+    switch (static_cast<idb_event::event_code_t>(code)) {
+        case idb_event::renamed: {
+            const ea_t ea = va_arg(va, ea_t);
+            const char* new_name = va_arg(va, const char*);
+            log("renamed", ea, BADADDR, new_name ? new_name : "");
+            if (track) {
+                mark_address(ea);
+                func_t* pfn = get_func(ea);
+                if (pfn && pfn->start_ea == ea) {
+                    mark_function(ea);
+                }
+                mark_referrers(ea);
+            }
+            break;
+        }
+        case idb_event::cmt_changed: {
+            const ea_t ea = va_arg(va, ea_t);
+            const bool repeatable = va_arg(va, int) != 0;
+            log("cmt_changed", ea, BADADDR, comment_at(ea, repeatable));
+            if (track) {
+                mark_address(ea);
+                if (runtime_settings().snapshot_pseudocode()) {
+                    mark_function_at(ea);
+                }
+            }
+            break;
+        }
+        case idb_event::extra_cmt_changed:
+        case idb_event::op_type_changed: {
+            const ea_t ea = va_arg(va, ea_t);
+            if (track) {
+                mark_address(ea);
+                if (runtime_settings().snapshot_pseudocode()) {
+                    mark_function_at(ea);
+                }
+            }
+            break;
+        }
+        case idb_event::range_cmt_changed: {
+            const auto kind = static_cast<range_kind_t>(va_arg(va, int));
+            const range_t* range = va_arg(va, const range_t*);
+            if (track && kind == RANGE_KIND_FUNC && range) {
+                mark_function(range->start_ea);
+            }
+            break;
+        }
+        case idb_event::func_added:
+        case idb_event::deleting_func: {
+            func_t* pfn = va_arg(va, func_t*);
+            if (pfn) {
+                log(code == idb_event::func_added ? "func_added" : "func_deleted", pfn->start_ea);
+                if (track) {
+                    mark_function(pfn->start_ea);
+                    if (code == idb_event::func_added) {
+                        mark_heads(pfn->start_ea, pfn->end_ea);
+                    }
+                }
+            }
+            break;
+        }
+        case idb_event::func_updated:
+        case idb_event::func_tail_deleted: {
+            func_t* pfn = va_arg(va, func_t*);
+            if (track && pfn) {
+                mark_function(pfn->start_ea);
+            }
+            break;
+        }
+        case idb_event::func_tail_appended: {
+            func_t* pfn = va_arg(va, func_t*);
+            func_t* tail = va_arg(va, func_t*);
+            if (track && pfn) {
+                mark_function(pfn->start_ea);
+                if (tail) {
+                    mark_heads(tail->start_ea, tail->end_ea);
+                }
+            }
+            break;
+        }
+        case idb_event::set_func_end: {
+            // Sent before the change: the chunk still has its old end.
+            func_t* pfn = va_arg(va, func_t*);
+            const ea_t new_end = va_arg(va, ea_t);
+            if (track && pfn) {
+                mark_function(is_func_tail(pfn) ? pfn->owner : pfn->start_ea);
+                mark_heads(std::min(pfn->end_ea, new_end), std::max(pfn->end_ea, new_end));
+            }
+            break;
+        }
+        case idb_event::set_func_start: {
+            func_t* pfn = va_arg(va, func_t*);
+            const ea_t new_start = va_arg(va, ea_t);
+            if (track) {
+                if (pfn) {
+                    mark_function(pfn->start_ea);
+                    mark_heads(std::min(pfn->start_ea, new_start),
+                               std::max(pfn->start_ea, new_start));
+                }
+                mark_function(new_start);
+            }
+            break;
+        }
+        case idb_event::ti_changed: {
+            const ea_t ea = va_arg(va, ea_t);
+            log("ti_changed", ea);
+            if (track) {
+                mark_address(ea);
+                func_t* pfn = get_func(ea);
+                if (pfn && pfn->start_ea == ea) {
+                    mark_function(ea);
+                }
+            }
+            break;
+        }
+        case idb_event::local_types_changed: {
+            (void)va_arg(va, int);  // local_type_change_t
+            const uint32 ordinal = va_arg(va, uint32);
+            if (!track) {
+                break;
+            }
+            if (ordinal == 0) {
+                changes_.all_types = true;
+            } else {
+                changes_.type_ordinals.insert(ordinal);
+            }
+            break;
+        }
+        case idb_event::byte_patched: {
+            const ea_t ea = va_arg(va, ea_t);
+            const uint32 old_value = va_arg(va, uint32);
+            char old_text[16];
+            qsnprintf(old_text, sizeof(old_text), "0x%02X", old_value);
+            log("byte_patched", ea, BADADDR, old_text);
+            if (track) {
+                mark_address(get_item_head(ea));
+                mark_function_at(ea);
+            }
+            break;
+        }
+        case idb_event::make_code: {
+            const insn_t* insn = va_arg(va, const insn_t*);
+            if (track && insn) {
+                mark_address(insn->ea);
+                mark_function_at(insn->ea);
+            }
+            break;
+        }
+        case idb_event::make_data: {
+            const ea_t ea = va_arg(va, ea_t);
+            (void)va_arg(va, flags64_t);
+            (void)va_arg(va, tid_t);
+            const asize_t len = va_arg(va, asize_t);
+            if (track) {
+                mark_range(ea, ea + len);
+            }
+            break;
+        }
+        case idb_event::destroyed_items: {
+            const ea_t ea1 = va_arg(va, ea_t);
+            const ea_t ea2 = va_arg(va, ea_t);
+            if (track) {
+                mark_range(ea1, ea2);
+            }
+            break;
+        }
+        case idb_event::segm_added:
+        case idb_event::segm_start_changed:
+        case idb_event::segm_end_changed:
+        case idb_event::segm_name_changed:
+        case idb_event::segm_class_changed:
+        case idb_event::segm_attrs_updated:
+            if (track) {
+                changes_.segments = true;
+            }
+            break;
+        case idb_event::segm_deleted:
+        case idb_event::segm_moved:
+            if (track) {
+                changes_.full = true;
+            }
+            break;
+        // Modifications no snapshot row depends on: cached results only.
+        case idb_event::op_ti_changed:
+        case idb_event::func_noret_changed:
+        case idb_event::stkpnt_changed:
+        case idb_event::tail_owner_changed:
+        case idb_event::thunk_func_created:
+        case idb_event::frame_deleted:
+        case idb_event::tryblks_updated:
+        case idb_event::sgr_changed:
+        case idb_event::item_color_changed:
+        case idb_event::callee_addr_changed:
+        case idb_event::bookmark_changed:
+        case idb_event::compiler_changed:
+        case idb_event::allsegs_moved:
+            break;
+        default:
+            // savebase, auto-analysis progress and other notifications
+            // that change nothing keep cached results.
+            return;
+    }
+    bump_idb_epoch();
+    if (track) {
+        check_overflow();
+    }
+}
+
+void ChangeJournal::on_idp_event(ssize_t code, va_list va) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const bool track = active_ && !changes_.full;
+    switch (static_cast<processor_t::event_t>(code)) {
+        case processor_t::ev_add_cref:
+        case processor_t::ev_add_dref:
+        case processor_t::ev_del_cref:
+        case processor_t::ev_del_dref: {
+            const ea_t from = va_arg(va, ea_t);
+            const ea_t to = va_arg(va, ea_t);
+            const bool added = code == processor_t::ev_add_cref || code == processor_t::ev_add_dref;
+            const bool is_code = code == processor_t::ev_add_cref || code == processor_t::ev_del_cref;
+            bump_idb_epoch();
+            log(added ? "xref_added" : "xref_deleted", from, to, is_code ? "code" : "data");
+            if (track) {
+                mark_address(from);
+                check_overflow();
+            }
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+void ChangeJournal::on_hexrays_event(hexrays_event_t event, va_list va) {
+    switch (event) {
+        case lxe_lvar_name_changed:
+        case lxe_lvar_type_changed:
+        case lxe_lvar_cmt_changed:
+        case lxe_lvar_mapping_changed:
+        case hxe_cmt_changed:
+            bump_idb_epoch();
+            break;
+        default:
+            break;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!active_ || changes_.full) {
+        return;
+    }
+    switch (event) {
+        case lxe_lvar_name_changed:
+        case lxe_lvar_type_changed:
+        case lxe_lvar_cmt_changed:
+        case lxe_lvar_mapping_changed: {
+            vdui_t* vu = va_arg(va, vdui_t*);
+            if (vu && vu->cfunc) {
+                mark_function(vu->cfunc->entry_ea);
+            }
+            break;
+        }
+        case hxe_cmt_changed: {
+            cfunc_t* cfunc = va_arg(va, cfunc_t*);
+            if (cfunc) {
+                mark_function(cfunc->entry_ea);
+            }
+            break;
+        }
+        default:
+            break;
+    }
+    check_overflow();
+}
+
+ssize_t idaapi ChangeJournal::IdbListener::on_event(ssize_t code, va_list va) {
+    ChangeJournal::instance().on_idb_event(code, va);
+    return 0;
+}
+
+ssize_t idaapi ChangeJournal::IdpListener::on_event(ssize_t code, va_list va) {
+    ChangeJournal::instance().on_idp_event(code, va);
+    return 0;
+}
+
+ssize_t idaapi ChangeJournal::hexrays_callback(void* ud, hexrays_event_t event, va_list va) {
+    static_cast<ChangeJournal*>(ud)->on_hexrays_event(event, va);
+    return 0;
+}
+
+uint64_t last_change_seq() {
+    return ChangeJournal::instance().last_seq();
+}
+
+ChangeBatch wait_for_changes(uint64_t after, size_t max_records, int timeout_ms,
+                             const std::function<bool()>& stop) {
+    return ChangeJournal::instance().wait(after, max_records, timeout_ms, stop);
+}
+
+} // namespace idasql
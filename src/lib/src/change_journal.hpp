@@ -0,0 +1,130 @@
+// Copyright (c) 2024-2026 Elias Bachaalany
+// SPDX-License-Identifier: MPL-2.0
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+/**
+ * change_journal.hpp - Journal of IDB changes: idb_changes feed and
+ * snapshot dirty set
+ *
+ * IDB, IDP and Hex-Rays hooks are installed while a QueryEngine is alive
+ * (attach/detach). Every rename, comment, function add/delete, prototype
+ * change, patch and xref add/delete is appended to a bounded ring of
+ * ChangeRecords with a monotonically increasing seq; the idb_changes table
+ * reads it so clients can sync with WHERE seq > ? instead of rescanning.
+ * Once the ring holds kChangeLogCapacity records the oldest are dropped; a
+ * client whose last seq is older than min(seq) - 1 has missed changes.
+ * wait() blocks until records arrive, for push subscribers (change_feed.hpp).
+ *
+ * While a snapshot is open (start/stop), the same hooks also record which
+ * functions, addresses and local-type ordinals changed (renames, comments,
+ * prototypes, patches, code/data conversion, xrefs, segments, lvar edits).
+ * take() hands the accumulated SnapshotChanges to refresh_snapshot() and
+ * starts a new batch. Past kMaxJournalKeys keys the journal gives up on
+ * row-level tracking and asks for a full export instead.
+ *
+ * Hooks fire on the IDA thread; the readers may be called from any thread.
+ */
+
+#pragma once
+
+#include <idasql/platform.hpp>
+#include <idasql/change_feed.hpp>
+#include <idasql/snapshot.hpp>
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "ida_headers.hpp"
+
+namespace idasql {
+
+// One idb_changes row.
+struct ChangeRecord {
+    uint64_t seq = 0;
+    int64_t time_ms = 0;        // Unix time
+    const char* kind = "";      // renamed, cmt_changed, func_added, ...
+    ea_t address = BADADDR;
+    ea_t func = BADADDR;        // function containing address
+    ea_t target = BADADDR;      // xref destination
+    std::string detail;         // new name, comment text, old byte, xref kind
+};
+
+class ChangeJournal {
+public:
+    static ChangeJournal& instance();
+
+    // Install the hooks (IDA thread). Counted: one per QueryEngine.
+    void attach();
+    void detach();
+
+    // Records with seq > after, oldest first.
+    std::vector<ChangeRecord> changes_since(uint64_t after) const;
+    // Seq of the newest record (0 = none yet).
+    uint64_t last_seq() const;
+    // See wait_for_changes() in change_feed.hpp.
+    ChangeBatch wait(uint64_t after, size_t max_records, int timeout_ms,
+                     const std::function<bool()>& stop);
+
+    // Start journaling snapshot changes with an empty batch.
+    void start();
+    // Stop journaling snapshot changes and drop the batch.
+    void stop();
+    bool active() const;
+
+    // Current batch; the journal keeps recording into a new one.
+    SnapshotChanges take();
+
+    // Keys recorded in the current batch.
+    size_t pending() const;
+
+    // Make the next take() ask for a full export (a refresh failed after
+    // its batch was taken).
+    void require_full();
+
+    // Hook handlers.
+    void on_idb_event(ssize_t code, va_list va);
+    void on_idp_event(ssize_t code, va_list va);
+    void on_hexrays_event(hexrays_event_t event, va_list va);
+
+private:
+    ChangeJournal() = default;
+
+    struct IdbListener : public event_listener_t {
+        ssize_t idaapi on_event(ssize_t code, va_list va) override;
+    };
+    struct IdpListener : public event_listener_t {
+        ssize_t idaapi on_event(ssize_t code, va_list va) override;
+    };
+    static ssize_t idaapi hexrays_callback(void* ud, hexrays_event_t event, va_list va);
+
+    // Callers hold mutex_.
+    void log(const char* kind, ea_t address, ea_t target = BADADDR, std::string detail = {});
+    void mark_function(ea_t start);
+    void mark_function_at(ea_t ea);
+    void mark_address(ea_t ea);
+    void mark_range(ea_t start, ea_t end);
+    void mark_heads(ea_t start, ea_t end);
+    void mark_referrers(ea_t ea);
+    void check_overflow();
+
+    mutable std::mutex mutex_;
+    std::condition_variable logged_;
+    std::vector<ChangeRecord> ring_;
+    uint64_t next_seq_ = 1;
+    SnapshotChanges changes_;
+    bool active_ = false;
+    int attached_ = 0;
+    bool hexrays_hooked_ = false;
+    IdbListener idb_listener_;
+    IdpListener idp_listener_;
+};
+
+} // namespace idasql
@@ -7,6 +7,8 @@
 
 #include "code_blocks.hpp"
 
+#include <idasql/cancel.hpp>
+
 using namespace idasql::core;
 
 namespace idasql {
@@ -19,7 +21,7 @@ namespace code {
 BlocksInFuncIterator::BlocksInFuncIterator(ea_t func_ea) : func_ea_(func_ea) {
   func_t *pfn = get_func(func_ea);
   if (pfn) {
-    fc_.create("", pfn, pfn->start_ea, pfn->end_ea, FC_NOEXT);
+    create_flowchart(fc_, pfn, pfn->start_ea, pfn->end_ea);
   }
 }
 
@@ -71,13 +73,13 @@ CachedTableDef<BlockInfo> define_blocks() {
       })
       .cache_builder([](std::vector<BlockInfo> &cache) {
         size_t func_qty = get_func_qty();
-        for (size_t i = 0; i < func_qty; i++) {
+        for (size_t i = 0; i < func_qty && !query_cancelled(); i++) {
           func_t *func = getn_func(i);
           if (!func)
             continue;
 
           qflow_chart_t fc;
-          fc.create("", func, func->start_ea, func->end_ea, FC_NOEXT);
+          create_flowchart(fc, func, func->start_ea, func->end_ea);
 
           for (int j = 0; j < fc.size(); j++) {
             const qbasic_block_t &bb = fc.blocks[j];
@@ -139,7 +141,7 @@ CachedTableDef<FunctionChunkInfo> define_function_chunks() {
           row.total_size = chunk->size();
 
           qflow_chart_t fc;
-          fc.create("", owner, chunk->start_ea, chunk->end_ea, FC_NOEXT);
+          create_flowchart(fc, owner, chunk->start_ea, chunk->end_ea);
           row.block_count = fc.size();
 
           cache.push_back(row);
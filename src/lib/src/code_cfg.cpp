@@ -27,7 +27,7 @@ public:
       return;
 
     qflow_chart_t fc;
-    fc.create("", pfn, pfn->start_ea, pfn->end_ea, FC_NOEXT);
+    create_flowchart(fc, pfn, pfn->start_ea, pfn->end_ea);
 
     for (int i = 0; i < fc.size(); i++) {
       int nsucc = fc.nsucc(i);
@@ -115,7 +115,7 @@ class CfgEdgesGenerator : public xsql::Generator<CfgEdgeInfo> {
 
       current_edges_.clear();
       qflow_chart_t fc;
-      fc.create("", pfn, pfn->start_ea, pfn->end_ea, FC_NOEXT);
+      create_flowchart(fc, pfn, pfn->start_ea, pfn->end_ea);
 
       for (int i = 0; i < fc.size(); i++) {
         int nsucc = fc.nsucc(i);
@@ -166,7 +166,7 @@ public:
 };
 
 GeneratorTableDef<CfgEdgeInfo> define_cfg_edges() {
-  return xsql::generator_table<CfgEdgeInfo>("cfg_edges")
+  return generator_table<CfgEdgeInfo>("cfg_edges")
       .column_int64("func_ea",
                     [](const CfgEdgeInfo &r) -> int64_t {
                       return static_cast<int64_t>(r.func_ea);
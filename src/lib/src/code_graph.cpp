@@ -176,7 +176,7 @@ make_call_graph_generator(ea_t start, const char *direction, int max_depth) {
 }
 
 GeneratorTableDef<CallGraphRow> define_call_graph() {
-  return xsql::generator_table<CallGraphRow>("call_graph")
+  return generator_table<CallGraphRow>("call_graph")
       .column_int64("func_addr",
                     [](const CallGraphRow &r) -> int64_t {
                       return static_cast<int64_t>(r.func_addr);
@@ -377,7 +377,7 @@ make_shortest_path_generator(ea_t from_addr, ea_t to_addr, int max_depth) {
 }
 
 GeneratorTableDef<ShortestPathRow> define_shortest_path() {
-  return xsql::generator_table<ShortestPathRow>("shortest_path")
+  return generator_table<ShortestPathRow>("shortest_path")
       .column_int("step",
                   [](const ShortestPathRow &r) -> int { return r.step; })
       .column_int64("func_addr",
@@ -7,6 +7,8 @@
 
 #include "code_instructions.hpp"
 
+#include <idasql/cancel.hpp>
+
 using namespace idasql::core;
 
 namespace idasql {
@@ -169,7 +171,8 @@ void collect_instruction_rows(std::vector<InstructionRow> &rows) {
 
   ea_t ea = inf_get_min_ea();
   ea_t max_ea = inf_get_max_ea();
-  while (ea < max_ea && ea != BADADDR) {
+  CancelPoll cancelled;
+  while (ea < max_ea && ea != BADADDR && !cancelled()) {
     if (is_code(get_flags(ea))) {
       rows.push_back({ea});
     }
@@ -608,7 +611,8 @@ void collect_instruction_operand_rows(std::vector<InstructionOperandRow> &rows)
 
   ea_t ea = inf_get_min_ea();
   ea_t max_ea = inf_get_max_ea();
-  while (ea < max_ea && ea != BADADDR) {
+  CancelPoll cancelled;
+  while (ea < max_ea && ea != BADADDR && !cancelled()) {
     if (is_code(get_flags(ea))) {
       insn_t insn;
       if (decode_insn(&insn, ea) > 0) {
@@ -20,7 +20,7 @@ void collect_loops_for_func(std::vector<LoopInfo> &loops, func_t *pfn) {
     return;
 
   qflow_chart_t fc;
-  fc.create("", pfn, pfn->start_ea, pfn->end_ea, FC_NOEXT);
+  create_flowchart(fc, pfn, pfn->start_ea, pfn->end_ea);
 
   for (int i = 0; i < fc.size(); i++) {
     const qbasic_block_t &block = fc.blocks[i];
@@ -0,0 +1,176 @@
+// Copyright (c) 2024-2026 Elias Bachaalany
+// SPDX-License-Identifier: MPL-2.0
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#include <idasql/columnar.hpp>
+
+#include <cstring>
+#include <vector>
+
+namespace idasql {
+
+namespace {
+
+constexpr uint32_t kColumnarVersion = 1;
+
+// Sink calls are batched into writes of this size.
+constexpr size_t kColumnarBufferBytes = 64 * 1024;
+
+class ColumnarBuffer {
+public:
+    explicit ColumnarBuffer(const ColumnarSink& sink) : sink_(sink) {
+        buffer_.reserve(kColumnarBufferBytes);
+    }
+
+    void bytes(const void* data, size_t size) {
+        if (failed_) return;
+        written_ += size;
+        if (buffer_.size() + size > kColumnarBufferBytes && !flush()) return;
+        if (size >= kColumnarBufferBytes) {
+            failed_ = !sink_(static_cast<const char*>(data), size);
+            return;
+        }
+        buffer_.append(static_cast<const char*>(data), size);
+    }
+
+    template <typename T>
+    void value(T v) {
+        bytes(&v, sizeof(v));
+    }
+
+    void pad() {
+        static const char zeros[8] = {};
+        const size_t rem = written_ % 8;
+        if (rem != 0) bytes(zeros, 8 - rem);
+    }
+
+    // u32 length, bytes, padding.
+    void string(const std::string& text) {
+        value(static_cast<uint32_t>(text.size()));
+        bytes(text.data(), text.size());
+        pad();
+    }
+
+    bool flush() {
+        if (!failed_ && !buffer_.empty()) {
+            failed_ = !sink_(buffer_.data(), buffer_.size());
+        }
+        buffer_.clear();
+        return !failed_;
+    }
+
+private:
+    const ColumnarSink& sink_;
+    std::string buffer_;
+    uint64_t written_ = 0;
+    bool failed_ = false;
+};
+
+ColumnarType column_type(const QueryResult& result, size_t col) {
+    bool ints = false, reals = false, texts = false, blobs = false;
+    for (const auto& row : result) {
+        switch (row.cell(col).type()) {
+            case CellType::Integer: ints = true; break;
+            case CellType::Real: reals = true; break;
+            case CellType::Text: texts = true; break;
+            case CellType::Blob: blobs = true; break;
+            case CellType::Null: break;
+        }
+    }
+    if (texts) return ColumnarType::Text;
+    if (blobs) return ColumnarType::Blob;
+    if (reals) return ColumnarType::Double;
+    if (ints) return ColumnarType::Int64;
+    return ColumnarType::Null;
+}
+
+void write_column(ColumnarBuffer& out, const QueryResult& result, size_t col) {
+    const ColumnarType type = column_type(result, col);
+    const size_t rows = result.row_count();
+    out.value(static_cast<uint32_t>(type));
+    out.string(result.columns[col]);
+
+    std::vector<uint8_t> validity((rows + 7) / 8, 0);
+    for (const auto& row : result) {
+        if (!row.cell(col).is_null()) {
+            validity[row.index() / 8] |= static_cast<uint8_t>(1u << (row.index() % 8));
+        }
+    }
+    out.bytes(validity.data(), validity.size());
+    out.pad();
+
+    switch (type) {
+        case ColumnarType::Null:
+            return;
+        case ColumnarType::Int64:
+            for (const auto& row : result) {
+                out.value<int64_t>(row.cell(col).as_int64());
+            }
+            return;
+        case ColumnarType::Double:
+            for (const auto& row : result) {
+                out.value<double>(row.cell(col).as_double());
+            }
+            return;
+        case ColumnarType::Text:
+        case ColumnarType::Blob:
+            break;
+    }
+
+    // Offsets first, then the bytes they index; numbers in a text/blob
+    // column take their SQLite text form.
+    std::string scratch;
+    auto cell_bytes = [&scratch](const CellView& cell) -> std::string_view {
+        if (cell.type() == CellType::Text || cell.type() == CellType::Blob) {
+            return cell.bytes();
+        }
+        scratch.clear();
+        if (!cell.is_null()) cell.append_to(scratch);
+        return scratch;
+    };
+    uint64_t offset = 0;
+    out.value<uint64_t>(0);
+    for (const auto& row : result) {
+        offset += cell_bytes(row.cell(col)).size();
+        out.value<uint64_t>(offset);
+    }
+    for (const auto& row : result) {
+        const std::string_view data = cell_bytes(row.cell(col));
+        out.bytes(data.data(), data.size());
+    }
+    out.pad();
+}
+
+} // namespace
+
+bool write_columnar_header(const ColumnarSink& sink, uint32_t frame_count) {
+    ColumnarBuffer out(sink);
+    out.bytes("IDASQLC1", 8);
+    out.value<uint32_t>(kColumnarVersion);
+    out.value<uint32_t>(frame_count);
+    return out.flush();
+}
+
+bool write_columnar_frame(const ColumnarSink& sink, uint32_t index, const std::string& name,
+                          const QueryResult& result) {
+    ColumnarBuffer out(sink);
+    const size_t columns = result.success ? result.columns.size() : 0;
+    out.value<uint32_t>(index);
+    out.value<uint32_t>(result.success ? 1 : 0);
+    out.value<uint64_t>(result.success ? result.row_count() : 0);
+    out.value<uint32_t>(static_cast<uint32_t>(columns));
+    out.string(name);
+    out.value<uint32_t>(static_cast<uint32_t>(result.error.size()));
+    out.value<uint32_t>(0);
+    out.bytes(result.error.data(), result.error.size());
+    out.pad();
+    for (size_t col = 0; col < columns; ++col) {
+        write_column(out, result, col);
+    }
+    return out.flush();
+}
+
+} // namespace idasql
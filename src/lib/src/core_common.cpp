@@ -16,6 +16,14 @@ ea_t normalize_sql_ea(int64_t value) {
   return static_cast<ea_t>(static_cast<uint64_t>(value));
 }
 
+void create_flowchart(qflow_chart_t &fc, func_t *pfn, ea_t start, ea_t end) {
+  TraceSpan span("ida", "flowchart");
+  span.arg_hex("func", static_cast<uint64_t>(pfn ? pfn->start_ea : start));
+  StatTimer timer(engine_stats().flowchart);
+  fc.create("", pfn, start, end, FC_NOEXT);
+  span.arg("blocks", static_cast<int64_t>(fc.size()));
+}
+
 // ============================================================================
 // Helper: Safe string extraction from IDA
 // ============================================================================
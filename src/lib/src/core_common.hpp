@@ -59,6 +59,14 @@ bool get_func_tinfo(ea_t ea, tinfo_t &tif);
 bool get_func_type_details(ea_t ea, func_type_data_t &fi);
 const char *get_cc_name(callcnv_t cc);
 
+// ============================================================================
+// Flowcharts
+// ============================================================================
+
+// qflow_chart_t::create(FC_NOEXT) over [start, end) of pfn, counted in
+// idasql_stats and traced under PRAGMA idasql.trace.
+void create_flowchart(qflow_chart_t &fc, func_t *pfn, ea_t start, ea_t end);
+
 // ============================================================================
 // Parsing helpers (trim_copy is in <idasql/string_utils.hpp>)
 // ============================================================================
@@ -10,6 +10,7 @@
 #include <idasql/platform.hpp>
 
 #include <cctype>
+#include <fstream>
 #include <limits>
 #include <algorithm>
 
@@ -25,7 +26,17 @@
 #include "types.hpp"
 #include "search_bytes.hpp"
 #include "metadata.hpp"
+#include "query_cost.hpp"
+#include "statement_cache.hpp"
+#include "change_journal.hpp"
+#include <idasql/columnar.hpp>
+#include <idasql/result_cache.hpp>
+#include <idasql/snapshot.hpp>
+#include <idasql/trace.hpp>
 #include <idasql/ui_context_provider.hpp>
+#include <idasql/vtable_stats.hpp>
+
+#include <sqlite3.h>
 
 namespace idasql {
 
@@ -37,9 +48,15 @@ QueryEngine::QueryEngine() {
     init();
 }
 
-QueryEngine::~QueryEngine() = default;
+QueryEngine::~QueryEngine() {
+    ChangeJournal::instance().detach();
+}
 
 QueryResult QueryEngine::query(const char* sql) {
+    return query(sql, QueryParams{});
+}
+
+QueryResult QueryEngine::query(const char* sql, const QueryParams& params) {
     QueryResult result;
 
     if (!db_.is_open()) {
@@ -52,28 +69,72 @@ QueryResult QueryEngine::query(const char* sql) {
         return result;
     }
 
-    xsql::QueryOptions options;
-    options.timeout_ms = runtime_settings().query_timeout_ms();
-    xsql::Result raw = db_.query(sql, options);
-    result.columns = std::move(raw.columns);
-    result.rows.reserve(raw.rows.size());
-    for (auto& raw_row : raw.rows) {
-        Row row;
-        row.values = std::move(raw_row.values);
-        result.rows.push_back(std::move(row));
-    }
-    result.error = std::move(raw.error);
-    result.warnings = std::move(raw.warnings);
-    result.timed_out = raw.timed_out;
-    result.partial = raw.partial;
-    result.elapsed_ms = raw.elapsed_ms;
-    append_query_hints(sql ? std::string(sql) : std::string(), result);
+    if (!admit_query(sql, result.error)) {
+        error_ = result.error;
+        return result;
+    }
+
+    run_statements(sql, params, result);
+    append_query_hints(result);
     result.success = result.error.empty();
     error_ = result.success ? "" : result.error;
 
     return result;
 }
 
+void QueryEngine::run_statements(const char* sql, const QueryParams& params, QueryResult& result) {
+    QueryCursor cursor(db_.handle(), sql, params, runtime_settings().query_timeout_ms(),
+                       statements_.get());
+    collect_cursor(cursor, result);
+}
+
+QueryCursor QueryEngine::open_cursor(const char* sql, const QueryParams& params) {
+    if (!db_.is_open()) {
+        error_ = "QueryEngine not initialized";
+        return QueryCursor(make_pragma_error(error_));
+    }
+
+    QueryResult pragma_result;
+    if (handle_runtime_pragma(sql, pragma_result)) {
+        error_ = pragma_result.success ? "" : pragma_result.error;
+        return QueryCursor(std::move(pragma_result));
+    }
+
+    if (!admit_query(sql, error_)) {
+        return QueryCursor(make_pragma_error(error_));
+    }
+
+    error_.clear();
+    return QueryCursor(db_.handle(), sql, params, runtime_settings().query_timeout_ms(),
+                       statements_.get());
+}
+
+StreamSummary QueryEngine::for_each(const char* sql, const QueryParams& params,
+                                    const RowCallback& on_row) {
+    StreamSummary summary;
+    QueryCursor cursor = open_cursor(sql, params);
+    while (cursor.next()) {
+        ++summary.rows;
+        if (on_row && !on_row(cursor.row())) {
+            summary.aborted = true;
+            cursor.close();
+            break;
+        }
+    }
+
+    summary.columns = cursor.columns();
+    summary.error = cursor.error();
+    summary.timed_out = cursor.timed_out();
+    summary.elapsed_ms = cursor.elapsed_ms();
+    summary.plan = cursor.plan();
+    if (summary.timed_out && summary.rows == 0) {
+        summary.error = query_timeout_error(summary.elapsed_ms);
+    }
+    summary.success = summary.error.empty();
+    error_ = summary.error;
+    return summary;
+}
+
 xsql::Status QueryEngine::exec(const char* sql) {
     if (!db_.is_open()) {
         error_ = "QueryEngine not initialized";
@@ -85,10 +146,16 @@ xsql::Status QueryEngine::exec(const char* sql) {
         error_ = pragma_result.success ? "" : pragma_result.error;
         return pragma_result.success ? xsql::Status::ok : xsql::Status::error;
     }
+    if (!admit_query(sql, error_)) {
+        return xsql::Status::error;
+    }
 
-    xsql::Status rc = db_.exec(sql);
-    error_ = db_.last_error();
-    return rc;
+    QueryCursor cursor(db_.handle(), sql, {}, runtime_settings().query_timeout_ms(),
+                       statements_.get());
+    while (cursor.next()) {
+    }
+    error_ = cursor.timed_out() ? query_timeout_error(cursor.elapsed_ms()) : cursor.error();
+    return error_.empty() ? xsql::Status::ok : xsql::Status::error;
 }
 
 bool QueryEngine::execute(const char* sql) {
@@ -111,24 +178,130 @@ bool QueryEngine::execute_script(const std::string& script,
 
 bool QueryEngine::export_tables(const std::vector<std::string>& tables,
                                  const std::string& output_path,
-                                 std::string& error) {
+                                 std::string& error,
+                                 ExportFormat format) {
     if (!db_.is_open()) {
         error_ = "QueryEngine not initialized";
         error = error_;
         return false;
     }
 
-    bool ok = db_.export_tables(tables, output_path, error);
+    bool ok = format == ExportFormat::Columnar
+        ? export_columnar(tables, output_path, error)
+        : db_.export_tables(tables, output_path, error);
     error_ = ok ? "" : error;
     return ok;
 }
 
+// One frame per table, each read with SELECT * and written as it completes.
+bool QueryEngine::export_columnar(const std::vector<std::string>& tables,
+                                  const std::string& output_path,
+                                  std::string& error) {
+    const std::vector<std::string>& names = tables.empty() ? default_snapshot_tables() : tables;
+    std::ofstream out(output_path, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        error = "Cannot open " + output_path + " for writing";
+        return false;
+    }
+    const ColumnarSink sink = [&out](const char* data, size_t size) {
+        out.write(data, static_cast<std::streamsize>(size));
+        return static_cast<bool>(out);
+    };
+    if (!write_columnar_header(sink, static_cast<uint32_t>(names.size()))) {
+        error = "Write to " + output_path + " failed";
+        return false;
+    }
+    for (size_t i = 0; i < names.size(); ++i) {
+        const QueryResult result = query("SELECT * FROM " + quote_sql_identifier(names[i]));
+        if (!result.success) {
+            error = names[i] + ": " + result.error;
+            return false;
+        }
+        if (!write_columnar_frame(sink, static_cast<uint32_t>(i), names[i], result)) {
+            error = "Write to " + output_path + " failed";
+            return false;
+        }
+    }
+    out.close();
+    if (!out) {
+        error = "Write to " + output_path + " failed";
+        return false;
+    }
+    return true;
+}
+
+namespace {
+
+QueryResult make_snapshot_result(const SnapshotReport& report) {
+    QueryResult result;
+    result.columns = {"table", "rows", "elapsed_ms"};
+    result.table.reset(result.columns.size());
+    for (const auto& entry : report.tables) {
+        result.table.append_text(0, entry.name);
+        result.table.append_int64(1, entry.rows);
+        result.table.append_int64(2, entry.elapsed_ms);
+        result.table.end_row();
+    }
+    result.elapsed_ms = report.elapsed_ms;
+    result.success = true;
+    return result;
+}
+
+} // namespace
+
+QueryResult QueryEngine::export_snapshot(const std::string& path) {
+    QueryResult result;
+    if (!db_.is_open()) {
+        result.error = "QueryEngine not initialized";
+        return result;
+    }
+
+    auto& settings = runtime_settings();
+    std::vector<std::string> tables = default_snapshot_tables();
+    if (settings.snapshot_pseudocode()) {
+        tables.push_back("pseudocode");
+    }
+    SnapshotReport report;
+    if (!idasql::export_snapshot(db_.handle(), path, tables, report, result.error) ||
+        !snapshot_pool().open(path, settings.snapshot_workers(), result.error)) {
+        ChangeJournal::instance().stop();
+        return result;
+    }
+    // Track what goes stale from here on, for refresh_snapshot().
+    ChangeJournal::instance().start();
+    return make_snapshot_result(report);
+}
+
+QueryResult QueryEngine::refresh_snapshot() {
+    QueryResult result;
+    if (!db_.is_open()) {
+        result.error = "QueryEngine not initialized";
+        return result;
+    }
+    const std::string path = snapshot_pool().path();
+    if (path.empty() || !ChangeJournal::instance().active()) {
+        result.error = "No snapshot open (PRAGMA idasql.snapshot = 'path.db')";
+        return result;
+    }
+
+    const SnapshotChanges changes = ChangeJournal::instance().take();
+    if (changes.full) {
+        return export_snapshot(path);
+    }
+    SnapshotReport report;
+    if (!changes.empty() &&
+        !idasql::refresh_snapshot(db_.handle(), path, changes, report, result.error)) {
+        // Rolled back: those rows are still stale but no longer journaled.
+        ChangeJournal::instance().require_full();
+        result.error += " (the next refresh re-exports the snapshot)";
+        return result;
+    }
+    return make_snapshot_result(report);
+}
+
 std::string QueryEngine::scalar(const char* sql) {
     auto result = query(sql);
-    if (result.success && !result.empty()) {
-        return result.rows[0].values[0];
-    }
-    return "";
+    return result.success ? result.scalar() : "";
 }
 
 // trim_copy is now in <idasql/string_utils.hpp>
@@ -185,9 +358,7 @@ bool QueryEngine::parse_bool_value(const std::string& text, bool& value) {
 QueryResult QueryEngine::make_pragma_result(const std::string& key, const std::string& value) {
     QueryResult result;
     result.columns = {"name", "value"};
-    Row row;
-    row.values = {key, value};
-    result.rows.push_back(std::move(row));
+    result.add_text_row({key, value});
     result.success = true;
     return result;
 }
@@ -228,15 +399,20 @@ bool QueryEngine::handle_runtime_pragma(const char* sql, QueryResult& out) {
 
     std::string key_expr = trim_copy(body.substr(idasql_prefix.size()));
     std::string value_expr;
+    bool value_quoted = false;
     size_t eq_pos = key_expr.find('=');
     if (eq_pos != std::string::npos) {
         value_expr = trim_copy(key_expr.substr(eq_pos + 1));
         key_expr = trim_copy(key_expr.substr(0, eq_pos));
+        const std::string raw_value = value_expr;
         value_expr = strip_optional_quotes(value_expr);
+        value_quoted = value_expr.size() != raw_value.size();
     }
 
     const std::string key = to_lower_copy(key_expr);
     auto& settings = runtime_settings();
+    // Only settings that shape what later queries return (limits, hints,
+    // cost and memory caps) move the IDB epoch: it clears the result cache.
 
     if (key == "query_timeout_ms") {
         if (value_expr.empty()) {
@@ -248,6 +424,7 @@ bool QueryEngine::handle_runtime_pragma(const char* sql, QueryResult& out) {
             out = make_pragma_error("Invalid idasql.query_timeout_ms value");
             return true;
         }
+        bump_idb_epoch();
         out = make_pragma_result("query_timeout_ms", std::to_string(settings.query_timeout_ms()));
         return true;
     }
@@ -284,6 +461,278 @@ bool QueryEngine::handle_runtime_pragma(const char* sql, QueryResult& out) {
         return true;
     }
 
+    if (key == "demote_after_ms") {
+        if (value_expr.empty()) {
+            out = make_pragma_result("demote_after_ms", std::to_string(settings.demote_after_ms()));
+            return true;
+        }
+        int demote_ms = 0;
+        if (!parse_int_value(value_expr, demote_ms) || !settings.set_demote_after_ms(demote_ms)) {
+            out = make_pragma_error("Invalid idasql.demote_after_ms value");
+            return true;
+        }
+        out = make_pragma_result("demote_after_ms", std::to_string(settings.demote_after_ms()));
+        return true;
+    }
+
+    if (key == "script_slice_ms") {
+        if (value_expr.empty()) {
+            out = make_pragma_result("script_slice_ms", std::to_string(settings.script_slice_ms()));
+            return true;
+        }
+        int slice_ms = 0;
+        if (!parse_int_value(value_expr, slice_ms) || !settings.set_script_slice_ms(slice_ms)) {
+            out = make_pragma_error("Invalid idasql.script_slice_ms value");
+            return true;
+        }
+        out = make_pragma_result("script_slice_ms", std::to_string(settings.script_slice_ms()));
+        return true;
+    }
+
+    if (key == "statement_cache_size") {
+        if (value_expr.empty()) {
+            out = make_pragma_result("statement_cache_size",
+                                     std::to_string(settings.statement_cache_size()));
+            return true;
+        }
+        int cache_size = 0;
+        if (!parse_int_value(value_expr, cache_size) || cache_size < 0 ||
+            !settings.set_statement_cache_size(static_cast<size_t>(cache_size))) {
+            out = make_pragma_error("Invalid idasql.statement_cache_size value");
+            return true;
+        }
+        if (cache_size == 0 && statements_) {
+            statements_->clear();
+        }
+        out = make_pragma_result("statement_cache_size",
+                                 std::to_string(settings.statement_cache_size()));
+        return true;
+    }
+
+    if (key == "trace") {
+        if (eq_pos == std::string::npos) {
+            out = make_pragma_result("trace", trace_path());
+            return true;
+        }
+        const std::string lower_value = to_lower_copy(value_expr);
+        if (value_expr.empty() || lower_value == "off" || lower_value == "0") {
+            stop_trace();
+            out = make_pragma_result("trace", "");
+            return true;
+        }
+        std::string trace_error;
+        if (!start_trace(value_expr, trace_error)) {
+            out = make_pragma_error(trace_error);
+            return true;
+        }
+        out = make_pragma_result("trace", trace_path());
+        return true;
+    }
+
+    if (key == "stats") {
+        if (value_expr.empty()) {
+            out = make_pragma_result("stats", stats_timing() ? "1" : "0");
+            return true;
+        }
+        bool enabled = false;
+        if (!parse_bool_value(value_expr, enabled)) {
+            out = make_pragma_error("Invalid idasql.stats value");
+            return true;
+        }
+        set_stats_timing(enabled);
+        out = make_pragma_result("stats", stats_timing() ? "1" : "0");
+        return true;
+    }
+
+    if (key == "stats_reset") {
+        if (!value_expr.empty()) {
+            out = make_pragma_error("idasql.stats_reset takes no value");
+            return true;
+        }
+        reset_stats();
+        out = make_pragma_result("stats_reset", "1");
+        return true;
+    }
+
+    if (key == "max_query_cost") {
+        if (value_expr.empty()) {
+            out = make_pragma_result("max_query_cost", std::to_string(settings.max_query_cost()));
+            return true;
+        }
+        int max_cost = 0;
+        if (!parse_int_value(value_expr, max_cost) || max_cost < 0) {
+            out = make_pragma_error("Invalid idasql.max_query_cost value");
+            return true;
+        }
+        settings.set_max_query_cost(static_cast<size_t>(max_cost));
+        bump_idb_epoch();
+        out = make_pragma_result("max_query_cost", std::to_string(settings.max_query_cost()));
+        return true;
+    }
+
+    if (key == "max_query_memory") {
+        if (value_expr.empty()) {
+            out = make_pragma_result("max_query_memory",
+                                     std::to_string(settings.max_query_memory_mb()));
+            return true;
+        }
+        int max_mb = 0;
+        if (!parse_int_value(value_expr, max_mb) || max_mb < 0) {
+            out = make_pragma_error("Invalid idasql.max_query_memory value (megabytes)");
+            return true;
+        }
+        settings.set_max_query_memory_mb(static_cast<size_t>(max_mb));
+        bump_idb_epoch();
+        // Let SQLite spill sorts and temp b-trees to disk well before the
+        // per-query limit fails the query.
+        sqlite3_soft_heap_limit64(static_cast<sqlite3_int64>(max_mb) * 1024 * 1024 / 2);
+        out = make_pragma_result("max_query_memory",
+                                 std::to_string(settings.max_query_memory_mb()));
+        return true;
+    }
+
+    if (key == "spill_threshold_mb") {
+        if (value_expr.empty()) {
+            out = make_pragma_result("spill_threshold_mb",
+                                     std::to_string(settings.spill_threshold_mb()));
+            return true;
+        }
+        int threshold_mb = 0;
+        if (!parse_int_value(value_expr, threshold_mb) || threshold_mb < 0) {
+            out = make_pragma_error("Invalid idasql.spill_threshold_mb value (megabytes)");
+            return true;
+        }
+        settings.set_spill_threshold_mb(static_cast<size_t>(threshold_mb));
+        out = make_pragma_result("spill_threshold_mb",
+                                 std::to_string(settings.spill_threshold_mb()));
+        return true;
+    }
+
+    if (key == "snapshot") {
+        if (eq_pos == std::string::npos) {
+            out = make_pragma_result("snapshot", snapshot_pool().path());
+            return true;
+        }
+        const std::string lower_value = to_lower_copy(value_expr);
+        if (value_expr.empty() || lower_value == "off" || lower_value == "0") {
+            snapshot_pool().close();
+            ChangeJournal::instance().stop();
+            out = make_pragma_result("snapshot", "");
+            return true;
+        }
+        out = export_snapshot(value_expr);
+        return true;
+    }
+
+    if (key == "snapshot_refresh") {
+        if (!value_expr.empty()) {
+            out = make_pragma_error("idasql.snapshot_refresh takes no value");
+            return true;
+        }
+        out = refresh_snapshot();
+        return true;
+    }
+
+    if (key == "snapshot_workers") {
+        if (value_expr.empty()) {
+            out = make_pragma_result("snapshot_workers",
+                                     std::to_string(settings.snapshot_workers()));
+            return true;
+        }
+        int workers = 0;
+        if (!parse_int_value(value_expr, workers) || workers < 0 ||
+            !settings.set_snapshot_workers(static_cast<size_t>(workers))) {
+            out = make_pragma_error("Invalid idasql.snapshot_workers value");
+            return true;
+        }
+        out = make_pragma_result("snapshot_workers", std::to_string(settings.snapshot_workers()));
+        return true;
+    }
+
+    if (key == "snapshot_pseudocode") {
+        if (value_expr.empty()) {
+            out = make_pragma_result("snapshot_pseudocode",
+                                     settings.snapshot_pseudocode() ? "1" : "0");
+            return true;
+        }
+        bool enabled = false;
+        if (!parse_bool_value(value_expr, enabled)) {
+            out = make_pragma_error("Invalid idasql.snapshot_pseudocode value");
+            return true;
+        }
+        settings.set_snapshot_pseudocode(enabled);
+        out = make_pragma_result("snapshot_pseudocode",
+                                 settings.snapshot_pseudocode() ? "1" : "0");
+        return true;
+    }
+
+    if (key == "cursor_idle_ms") {
+        if (value_expr.empty()) {
+            out = make_pragma_result("cursor_idle_ms", std::to_string(settings.cursor_idle_ms()));
+            return true;
+        }
+        int idle_ms = 0;
+        if (!parse_int_value(value_expr, idle_ms) || !settings.set_cursor_idle_ms(idle_ms)) {
+            out = make_pragma_error("Invalid idasql.cursor_idle_ms value");
+            return true;
+        }
+        out = make_pragma_result("cursor_idle_ms", std::to_string(settings.cursor_idle_ms()));
+        return true;
+    }
+
+    if (key == "max_cursors") {
+        if (value_expr.empty()) {
+            out = make_pragma_result("max_cursors", std::to_string(settings.max_cursors()));
+            return true;
+        }
+        int cursor_limit = 0;
+        if (!parse_int_value(value_expr, cursor_limit) || cursor_limit < 0 ||
+            !settings.set_max_cursors(static_cast<size_t>(cursor_limit))) {
+            out = make_pragma_error("Invalid idasql.max_cursors value");
+            return true;
+        }
+        out = make_pragma_result("max_cursors", std::to_string(settings.max_cursors()));
+        return true;
+    }
+
+    if (key == "result_cache_mb") {
+        if (value_expr.empty()) {
+            out = make_pragma_result("result_cache_mb", std::to_string(settings.result_cache_mb()));
+            return true;
+        }
+        int cache_mb = 0;
+        if (!parse_int_value(value_expr, cache_mb) || cache_mb < 0) {
+            out = make_pragma_error("Invalid idasql.result_cache_mb value (megabytes)");
+            return true;
+        }
+        settings.set_result_cache_mb(static_cast<size_t>(cache_mb));
+        if (cache_mb == 0) {
+            result_cache().clear();
+        }
+        out = make_pragma_result("result_cache_mb", std::to_string(settings.result_cache_mb()));
+        return true;
+    }
+
+    if (key == "explain_cost") {
+        if (value_expr.empty()) {
+            out = make_pragma_error("idasql.explain_cost requires a SQL text value");
+            return true;
+        }
+        std::string target = value_expr;
+        if (value_quoted) {
+            // Undo SQL string escaping ('' -> ').
+            std::string unescaped;
+            unescaped.reserve(target.size());
+            for (size_t i = 0; i < target.size(); ++i) {
+                unescaped.push_back(target[i]);
+                if (target[i] == '\'' && i + 1 < target.size() && target[i + 1] == '\'') ++i;
+            }
+            target = std::move(unescaped);
+        }
+        out = explain_cost(target.c_str());
+        return true;
+    }
+
     if (key == "hints_enabled") {
         if (value_expr.empty()) {
             out = make_pragma_result("hints_enabled", settings.hints_enabled() ? "1" : "0");
@@ -295,6 +744,7 @@ bool QueryEngine::handle_runtime_pragma(const char* sql, QueryResult& out) {
             return true;
         }
         settings.set_hints_enabled(enabled);
+        bump_idb_epoch();
         out = make_pragma_result("hints_enabled", settings.hints_enabled() ? "1" : "0");
         return true;
     }
@@ -310,6 +760,7 @@ bool QueryEngine::handle_runtime_pragma(const char* sql, QueryResult& out) {
             return true;
         }
         settings.set_enable_idapython(enabled);
+        bump_idb_epoch();
         out = make_pragma_result("enable_idapython", settings.enable_idapython() ? "1" : "0");
         return true;
     }
@@ -329,6 +780,7 @@ bool QueryEngine::handle_runtime_pragma(const char* sql, QueryResult& out) {
             out = make_pragma_error("Invalid idasql.timeout_push value");
             return true;
         }
+        bump_idb_epoch();
         out = make_pragma_result("query_timeout_ms", std::to_string(effective_timeout));
         return true;
     }
@@ -339,6 +791,7 @@ bool QueryEngine::handle_runtime_pragma(const char* sql, QueryResult& out) {
             out = make_pragma_error("idasql.timeout_pop stack is empty");
             return true;
         }
+        bump_idb_epoch();
         out = make_pragma_result("query_timeout_ms", std::to_string(effective_timeout));
         return true;
     }
@@ -347,20 +800,83 @@ bool QueryEngine::handle_runtime_pragma(const char* sql, QueryResult& out) {
     return true;
 }
 
-void QueryEngine::append_query_hints(const std::string& sql, QueryResult& result) const {
+QueryResult QueryEngine::explain_cost(const char* sql) {
+    QueryResult result;
+    if (!db_.is_open()) {
+        result.error = "QueryEngine not initialized";
+        return result;
+    }
+
+    const QueryCostEstimate estimate = estimate_query_cost(db_.handle(), sql);
+    result.columns = {"table", "access", "loops", "rows", "functions", "cost"};
+    result.table.reset(result.columns.size());
+    auto add_row = [&result](const std::string& table, const char* access,
+                             double loops, double rows, double functions, double cost) {
+        result.table.append_text(0, table);
+        result.table.append_text(1, access);
+        result.table.append_double(2, loops);
+        result.table.append_double(3, rows);
+        result.table.append_double(4, functions);
+        result.table.append_double(5, cost);
+        result.table.end_row();
+    };
+    double functions_total = 0;
+    for (const auto& entry : estimate.tables) {
+        add_row(entry.table, table_access_name(entry.kind), entry.loops, entry.rows,
+                entry.functions, entry.cost);
+        functions_total += entry.functions;
+    }
+    add_row("(total)", "", 1, 0, functions_total, estimate.total);
+
+    const size_t budget = runtime_settings().max_query_cost();
+    if (budget > 0 && estimate.total > static_cast<double>(budget)) {
+        result.warnings.push_back("Over idasql.max_query_cost (" + std::to_string(budget) +
+                                  "); this query would be rejected.");
+    }
+    result.success = true;
+    return result;
+}
+
+// Reject before execution when the planned cost exceeds the budget, so one
+// unfiltered decompiler scan cannot hold the executor for a full timeout.
+bool QueryEngine::admit_query(const char* sql, std::string& error) {
+    const size_t budget = runtime_settings().max_query_cost();
+    if (budget == 0) {
+        return true;
+    }
+    const QueryCostEstimate estimate = estimate_query_cost(db_.handle(), sql);
+    if (estimate.total <= static_cast<double>(budget)) {
+        return true;
+    }
+
+    error = "Estimated query cost " + std::to_string(static_cast<long long>(estimate.total)) +
+            " exceeds idasql.max_query_cost " + std::to_string(budget);
+    if (const TableCostEstimate* top = estimate.dominant()) {
+        error += " (" + std::string(table_access_name(top->kind)) + " of " + top->table;
+        if (top->functions > 0) {
+            error += ", ~" + std::to_string(static_cast<long long>(top->functions)) +
+                     " functions to decompile";
+        } else {
+            error += ", ~" + std::to_string(static_cast<long long>(top->loops * top->rows)) +
+                     " rows";
+        }
+        error += ")";
+        if (top->functions > 0) {
+            error += "; add WHERE func_addr = <addr>";
+        }
+    }
+    error += "; see PRAGMA idasql.explain_cost";
+    return false;
+}
+
+// Hints come from the recorded plan, not the SQL text: a table is only
+// flagged when it really was scanned in full, and aliases, views or
+// comments mentioning func_addr cannot hide or fake a scan.
+void QueryEngine::append_query_hints(QueryResult& result) const {
     if (!runtime_settings().hints_enabled()) {
         return;
     }
 
-    const std::string lower = to_lower_copy(sql);
-    const bool touches_decompiler_table =
-        lower.find("ctree_lvars") != std::string::npos ||
-        lower.find("ctree_call_args") != std::string::npos ||
-        lower.find("ctree ") != std::string::npos ||
-        lower.find("ctree\n") != std::string::npos ||
-        lower.find("pseudocode") != std::string::npos;
-    const bool has_func_filter = lower.find("func_addr") != std::string::npos;
-
     auto add_warning_once = [&result](const std::string& warning) {
         for (const auto& existing : result.warnings) {
             if (existing == warning) {
@@ -370,11 +886,22 @@ void QueryEngine::append_query_hints(const std::string& sql, QueryResult& result
         result.warnings.push_back(warning);
     };
 
-    if (touches_decompiler_table && !has_func_filter) {
-        add_warning_once(
-            "Decompiler tables are expensive without func_addr filtering; add WHERE func_addr = <addr> and LIMIT.");
+    for (const auto& access : result.plan.tables) {
+        if (access.kind != TableAccessKind::FullScan) {
+            continue;
+        }
+        if (access.functions > 0) {
+            add_warning_once(
+                "Full scan of " + access.table + " decompiled " + std::to_string(access.functions) +
+                " function(s) for " + std::to_string(access.rows) +
+                " row(s); add WHERE func_addr = <addr> and LIMIT.");
+        } else if (result.timed_out) {
+            add_warning_once(
+                "Query timed out during a full scan of " + access.table + " (" +
+                std::to_string(access.rows) + " row(s) read); constrain it with an equality filter.");
+        }
     }
-    if (result.timed_out && touches_decompiler_table) {
+    if (result.timed_out && result.plan.functions_decompiled > 0) {
         add_warning_once(
             "Decompiler query timed out; resolve candidate functions first, then query ctree_* per function.");
     }
@@ -382,6 +909,7 @@ void QueryEngine::append_query_hints(const std::string& sql, QueryResult& result
 
 void QueryEngine::init() {
     // db_ auto-opens :memory: via xsql::Database constructor
+    statements_ = std::make_unique<StatementCache>();
 
     // Register all virtual tables
     core_ = std::make_unique<core::CoreRegistry>();
@@ -410,6 +938,10 @@ void QueryEngine::init() {
     // get_ui_context_json(): registered for every runtime. Returns live UI
     // state in the GUI plugin; a "not applicable" stub under idalib/CLI.
     ui_context::register_ui_context_sql_functions(db_);
+
+    // Feeds idb_changes and the snapshot dirty set; after the decompiler
+    // registry so the Hex-Rays hooks are installed when available.
+    ChangeJournal::instance().attach();
 }
 
 // ============================================================================
@@ -7,7 +7,9 @@
 
 #include "decompiler.hpp"
 
+#include <idasql/cancel.hpp>
 #include <idasql/string_utils.hpp>
+#include <idasql/vtable_stats.hpp>
 
 #include <xsql/json.hpp>
 
@@ -202,6 +204,21 @@ bool init_hexrays() {
     return hexrays_available();
 }
 
+cfuncptr_t decompile_function(func_t* f, hexrays_failure_t* hf) {
+    EngineStats& stats = engine_stats();
+    TraceSpan span("hexrays", "decompile");
+    if (f != nullptr) {
+        const bool cached = has_cached_cfunc(f->start_ea);
+        auto& counter = cached ? stats.decompile_cache_hits : stats.decompile_cache_misses;
+        counter.fetch_add(1, std::memory_order_relaxed);
+        span.arg_hex("func", static_cast<uint64_t>(f->start_ea));
+        span.arg("cached", cached ? 1 : 0);
+        note_decompile();
+    }
+    StatTimer timer(stats.decompile);
+    return decompile(f, hf);
+}
+
 void invalidate_decompiler_cache(ea_t ea) {
     if (!hexrays_available()) return;
     func_t* f = get_func(ea);
@@ -426,7 +443,7 @@ bool collect_pseudocode(std::vector<PseudocodeLine>& lines, ea_t func_addr) {
     if (!f) return false;
 
     hexrays_failure_t hf;
-    cfuncptr_t cfunc = decompile(f, &hf);
+    cfuncptr_t cfunc = decompile_function(f, &hf);
     if (!cfunc) return false;
 
     const strvec_t& sv = cfunc->get_pseudocode();
@@ -482,6 +499,7 @@ void collect_all_pseudocode(std::vector<PseudocodeLine>& lines) {
 
     size_t func_qty = get_func_qty();
     for (size_t i = 0; i < func_qty; i++) {
+        if (query_cancelled()) break;
         func_t* f = getn_func(i);
         if (!f) continue;
 
@@ -501,7 +519,7 @@ bool collect_orphan_comments(std::vector<OrphanCommentInfo>& rows, ea_t func_add
     if (!f) return false;
 
     hexrays_failure_t hf;
-    cfuncptr_t cfunc = decompile(f, &hf);
+    cfuncptr_t cfunc = decompile_function(f, &hf);
     if (!cfunc) return false;
     if (!cfunc->has_orphan_cmts()) return true;
 
@@ -529,6 +547,7 @@ void collect_all_orphan_comments(std::vector<OrphanCommentInfo>& rows) {
     rows.reserve(get_func_qty());
     size_t func_qty = get_func_qty();
     for (size_t i = 0; i < func_qty; i++) {
+        if (query_cancelled()) break;
         func_t* f = getn_func(i);
         if (!f) continue;
 
@@ -568,6 +587,7 @@ void collect_all_orphan_comment_groups(std::vector<OrphanCommentGroupInfo>& rows
     rows.reserve(get_func_qty() / 4 + 1);
     size_t func_qty = get_func_qty();
     for (size_t i = 0; i < func_qty; i++) {
+        if (query_cancelled()) break;
         func_t* f = getn_func(i);
         if (!f) continue;
 
@@ -591,7 +611,7 @@ bool collect_lvars(std::vector<LvarInfo>& vars, ea_t func_addr) {
     if (!f) return false;
 
     hexrays_failure_t hf;
-    cfuncptr_t cfunc = decompile(f, &hf);
+    cfuncptr_t cfunc = decompile_function(f, &hf);
     if (!cfunc) return false;
 
     lvars_t* lvars = cfunc->get_lvars();
@@ -631,6 +651,7 @@ void collect_all_lvars(std::vector<LvarInfo>& vars) {
 
     size_t func_qty = get_func_qty();
     for (size_t i = 0; i < func_qty; i++) {
+        if (query_cancelled()) break;
         func_t* f = getn_func(i);
         if (!f) continue;
 
@@ -857,7 +878,7 @@ bool collect_ctree(std::vector<CtreeItem>& items, ea_t func_addr) {
     if (!f) return false;
 
     hexrays_failure_t hf;
-    cfuncptr_t cfunc = decompile(f, &hf);
+    cfuncptr_t cfunc = decompile_function(f, &hf);
     if (!cfunc) return false;
 
     ctree_collector_t collector(items, &*cfunc, func_addr);
@@ -874,6 +895,7 @@ void collect_all_ctree(std::vector<CtreeItem>& items) {
 
     size_t func_qty = get_func_qty();
     for (size_t i = 0; i < func_qty; i++) {
+        if (query_cancelled()) break;
         func_t* f = getn_func(i);
         if (!f) continue;
 
@@ -897,7 +919,7 @@ bool collect_ctree_labels(std::vector<CtreeLabelInfo>& rows, ea_t func_addr) {
     if (!f) return false;
 
     hexrays_failure_t hf;
-    cfuncptr_t cfunc = decompile(f, &hf);
+    cfuncptr_t cfunc = decompile_function(f, &hf);
     if (!cfunc) return false;
 
     std::vector<CtreeItem> items;
@@ -971,6 +993,7 @@ void collect_all_ctree_labels(std::vector<CtreeLabelInfo>& rows) {
 
     size_t func_qty = get_func_qty();
     for (size_t i = 0; i < func_qty; i++) {
+        if (query_cancelled()) break;
         func_t* f = getn_func(i);
         if (!f) continue;
 
@@ -1077,7 +1100,7 @@ bool collect_call_args(std::vector<CallArgInfo>& args, ea_t func_addr) {
     if (!f) return false;
 
     hexrays_failure_t hf;
-    cfuncptr_t cfunc = decompile(f, &hf);
+    cfuncptr_t cfunc = decompile_function(f, &hf);
     if (!cfunc) return false;
 
     call_args_collector_t collector(args, &*cfunc, func_addr);
@@ -1093,6 +1116,7 @@ void collect_all_call_args(std::vector<CallArgInfo>& args) {
 
     size_t func_qty = get_func_qty();
     for (size_t i = 0; i < func_qty; i++) {
+        if (query_cancelled()) break;
         func_t* f = getn_func(i);
         if (!f) continue;
 
@@ -1206,6 +1230,7 @@ PseudocodeLineNumIterator::PseudocodeLineNumIterator(int line_num) {
 
     size_t func_qty = get_func_qty();
     for (size_t i = 0; i < func_qty; ++i) {
+        if (query_cancelled()) break;
         func_t* f = getn_func(i);
         if (!f) continue;
 
@@ -1585,6 +1610,7 @@ bool CtreeGenerator::load_next_func() {
 
     size_t func_qty = get_func_qty();
     while (func_idx_ < func_qty) {
+        if (query_cancelled()) return false;
         func_t* f = getn_func(func_idx_++);
         if (!f) continue;
 
@@ -1626,6 +1652,7 @@ bool CallArgsGenerator::load_next_func() {
 
     size_t func_qty = get_func_qty();
     while (func_idx_ < func_qty) {
+        if (query_cancelled()) return false;
         func_t* f = getn_func(func_idx_++);
         if (!f) continue;
 
@@ -1685,7 +1712,7 @@ bool set_decompiler_comment(ea_t func_addr, ea_t target_ea, const char* comment,
     }
 
     hexrays_failure_t hf;
-    cfuncptr_t cfunc = decompile(f, &hf);
+    cfuncptr_t cfunc = decompile_function(f, &hf);
     if (!cfunc) {
         xsql::set_vtab_error(
             "cannot write pseudocode comment: " + describe_hexrays_failure(hf) +
@@ -1733,7 +1760,7 @@ bool clear_decompiler_comment_all_placements(ea_t func_addr, ea_t target_ea) {
     }
 
     hexrays_failure_t hf;
-    cfuncptr_t cfunc = decompile(f, &hf);
+    cfuncptr_t cfunc = decompile_function(f, &hf);
     if (!cfunc) {
         xsql::set_vtab_error(
             "cannot clear pseudocode comment: " + describe_hexrays_failure(hf) +
@@ -1935,7 +1962,7 @@ LvarRenameResult rename_lvar_at_ex(ea_t func_addr, int lvar_idx, const char* new
     }
 
     hexrays_failure_t hf;
-    cfuncptr_t cfunc = decompile(f, &hf);
+    cfuncptr_t cfunc = decompile_function(f, &hf);
     if (!cfunc) {
         result.success = false;
         result.reason = "decompile_failed";
@@ -2100,7 +2127,7 @@ LabelRenameResult rename_label_ex(ea_t func_addr, int label_num, const char* new
     }
 
     hexrays_failure_t hf;
-    cfuncptr_t cfunc = decompile(f, &hf);
+    cfuncptr_t cfunc = decompile_function(f, &hf);
     if (!cfunc) {
         result.success = false;
         result.reason = "decompile_failed";
@@ -2182,7 +2209,7 @@ bool set_lvar_type_at(ea_t func_addr, int lvar_idx, const char* type_str) {
     }
 
     hexrays_failure_t hf;
-    cfuncptr_t cfunc = decompile(f, &hf);
+    cfuncptr_t cfunc = decompile_function(f, &hf);
     if (!cfunc) {
         xsql::set_vtab_error("cannot set lvar type: decompilation failed (" + ctx + ")");
         return false;
@@ -2249,7 +2276,7 @@ bool set_lvar_comment_at(ea_t func_addr, int lvar_idx, const char* comment) {
     }
 
     hexrays_failure_t hf;
-    cfuncptr_t cfunc = decompile(f, &hf);
+    cfuncptr_t cfunc = decompile_function(f, &hf);
     if (!cfunc) {
         xsql::set_vtab_error("cannot set lvar comment: decompilation failed (" + ctx + ")");
         return false;
@@ -2289,6 +2316,7 @@ CachedTableDef<PseudocodeLine> define_pseudocode() {
     return cached_table<PseudocodeLine>("pseudocode")
         .no_shared_cache()
         .estimate_rows([]() -> size_t { return get_func_qty() * 20; })
+        .scan_decompiles([]() -> size_t { return get_func_qty(); })
         .cache_builder([](std::vector<PseudocodeLine>& cache) {
             collect_all_pseudocode(cache);
         })
@@ -2389,6 +2417,7 @@ CachedTableDef<OrphanCommentInfo> define_pseudocode_orphan_comments() {
     return cached_table<OrphanCommentInfo>("pseudocode_orphan_comments")
         .no_shared_cache()
         .estimate_rows([]() -> size_t { return get_func_qty() * 3; })
+        .scan_decompiles([]() -> size_t { return get_func_qty(); })
         .cache_builder([](std::vector<OrphanCommentInfo>& rows) {
             collect_all_orphan_comments(rows);
         })
@@ -2451,6 +2480,7 @@ CachedTableDef<OrphanCommentGroupInfo> define_pseudocode_orphan_comment_groups()
             const size_t func_qty = get_func_qty();
             return func_qty > 0 ? (func_qty / 4) + 1 : 1;
         })
+        .scan_decompiles([]() -> size_t { return get_func_qty(); })
         .cache_builder([](std::vector<OrphanCommentGroupInfo>& rows) {
             collect_all_orphan_comment_groups(rows);
         })
@@ -2476,6 +2506,7 @@ CachedTableDef<LvarInfo> define_ctree_lvars() {
     return cached_table<LvarInfo>("ctree_lvars")
         .no_shared_cache()
         .estimate_rows([]() -> size_t { return get_func_qty() * 20; })
+        .scan_decompiles([]() -> size_t { return get_func_qty(); })
         .cache_builder([](std::vector<LvarInfo>& rows) {
             collect_all_lvars(rows);
         })
@@ -2552,6 +2583,7 @@ CachedTableDef<CtreeLabelInfo> define_ctree_labels() {
     return cached_table<CtreeLabelInfo>("ctree_labels")
         .no_shared_cache()
         .estimate_rows([]() -> size_t { return get_func_qty() * 8; })
+        .scan_decompiles([]() -> size_t { return get_func_qty(); })
         .cache_builder([](std::vector<CtreeLabelInfo>& rows) {
             collect_all_ctree_labels(rows);
         })
@@ -2623,6 +2655,7 @@ GeneratorTableDef<CtreeItem> define_ctree() {
             // Heuristic: ~50 AST items per function
             return get_func_qty() * 50;
         })
+        .scan_decompiles([]() -> size_t { return get_func_qty(); })
         // Full scan generator (decompiles one function at a time)
         .generator([]() -> std::unique_ptr<xsql::Generator<CtreeItem>> {
             return std::make_unique<CtreeGenerator>();
@@ -2670,6 +2703,7 @@ GeneratorTableDef<CallArgInfo> define_ctree_call_args() {
             // Heuristic: ~20 call args per function
             return get_func_qty() * 20;
         })
+        .scan_decompiles([]() -> size_t { return get_func_qty(); })
         // Full scan generator (decompiles one function at a time)
         .generator([]() -> std::unique_ptr<xsql::Generator<CallArgInfo>> {
             return std::make_unique<CallArgsGenerator>();
@@ -55,6 +55,10 @@ inline bool& hexrays_available() {
 // Returns true if decompiler is available.
 bool init_hexrays();
 
+// Decompile f (served from Hex-Rays' cfunc cache when possible), charging
+// the call to the hexrays counters in idasql_stats.
+cfuncptr_t decompile_function(func_t* f, hexrays_failure_t* hf);
+
 // Invalidate decompiler cache for the function containing ea.
 // Safe to call even if Hex-Rays is unavailable or ea is not in a function.
 void invalidate_decompiler_cache(ea_t ea);
@@ -224,6 +228,41 @@ struct CallArgInfo {
                     arg_obj_ea(BADADDR), arg_num_value(0) {}
 };
 
+// ============================================================================
+// Cache accounting: heap owned by each row (vtable_stats.hpp CacheProbe)
+// ============================================================================
+
+inline size_t row_heap_bytes(const PseudocodeLine& r) {
+    return heap_bytes(r.text) + heap_bytes(r.comment);
+}
+
+inline size_t row_heap_bytes(const OrphanCommentInfo& r) {
+    return heap_bytes(r.func_name) + heap_bytes(r.orphan_comment);
+}
+
+inline size_t row_heap_bytes(const OrphanCommentGroupInfo& r) {
+    return heap_bytes(r.func_name) + heap_bytes(r.orphan_comments_json);
+}
+
+inline size_t row_heap_bytes(const LvarInfo& r) {
+    return heap_bytes(r.name) + heap_bytes(r.type) + heap_bytes(r.comment);
+}
+
+inline size_t row_heap_bytes(const CtreeItem& r) {
+    return heap_bytes(r.op_name) + heap_bytes(r.str_value) + heap_bytes(r.helper_name) +
+           heap_bytes(r.var_name) + heap_bytes(r.obj_name);
+}
+
+inline size_t row_heap_bytes(const CtreeLabelInfo& r) {
+    return heap_bytes(r.name);
+}
+
+inline size_t row_heap_bytes(const CallArgInfo& r) {
+    return heap_bytes(r.call_obj_name) + heap_bytes(r.call_helper_name) +
+           heap_bytes(r.arg_op) + heap_bytes(r.arg_var_name) + heap_bytes(r.arg_obj_name) +
+           heap_bytes(r.arg_str_value);
+}
+
 // ============================================================================
 // Helper Functions
 // ============================================================================
@@ -576,7 +576,7 @@ static void sql_decompile(xsql::FunctionContext& ctx, int argc, xsql::FunctionAr
     }
 
     hexrays_failure_t hf;
-    cfuncptr_t cfunc = decompile(func, &hf);
+    cfuncptr_t cfunc = decompiler::decompile_function(func, &hf);
     if (!cfunc) {
         std::string err = "Decompilation failed: " + std::string(hf.desc().c_str());
         ctx.result_error(err);
@@ -618,7 +618,7 @@ static void sql_decompile_2(xsql::FunctionContext& ctx, int argc, xsql::Function
     }
 
     hexrays_failure_t hf;
-    cfuncptr_t cfunc = decompile(func, &hf);
+    cfuncptr_t cfunc = decompiler::decompile_function(func, &hf);
     if (!cfunc) {
         std::string err = "Decompilation failed: " + std::string(hf.desc().c_str());
         ctx.result_error(err);
@@ -682,7 +682,7 @@ static void sql_gen_cfg_dot(xsql::FunctionContext& ctx, int argc, xsql::Function
 
     // Build DOT representation using FlowChart
     qflow_chart_t fc;
-    fc.create("", func, func->start_ea, func->end_ea, FC_NOEXT);
+    core::create_flowchart(fc, func, func->start_ea, func->end_ea);
 
     qstring func_name;
     get_func_name(&func_name, func->start_ea);
@@ -744,7 +744,7 @@ static void sql_gen_cfg_dot_file(xsql::FunctionContext& ctx, int argc, xsql::Fun
 
     // Build DOT using FlowChart
     qflow_chart_t fc;
-    fc.create("", func, func->start_ea, func->end_ea, FC_NOEXT);
+    core::create_flowchart(fc, func, func->start_ea, func->end_ea);
 
     qstring func_name;
     get_func_name(&func_name, func->start_ea);
@@ -7,6 +7,8 @@
 
 #include "memory_heads.hpp"
 
+#include <idasql/cancel.hpp>
+
 using namespace idasql::core;
 
 namespace idasql {
@@ -21,8 +23,9 @@ void collect_head_rows(std::vector<HeadRow> &rows) {
 
   ea_t ea = inf_get_min_ea();
   ea_t max_ea = inf_get_max_ea();
+  CancelPoll cancelled;
 
-  while (ea < max_ea && ea != BADADDR) {
+  while (ea < max_ea && ea != BADADDR && !cancelled()) {
     rows.push_back({ea});
     ea = next_head(ea, max_ea);
   }
@@ -116,12 +116,69 @@ static CachedTableDef<MetadataItem> define_ida_info() {
         .build();
 }
 
+// Built on the raw xsql builder so reading the counters does not count.
+static CachedTableDef<StatSample> define_idasql_stats() {
+    return xsql::cached_table<StatSample>("idasql_stats")
+        .no_shared_cache()
+        .estimate_rows([]() -> size_t { return 256; })
+        .cache_builder([](std::vector<StatSample>& rows) {
+            rows = collect_stats();
+        })
+        .column_text("scope", [](const StatSample& row) -> std::string {
+            return row.scope;
+        })
+        .column_text("column_name", [](const StatSample& row) -> std::string {
+            return row.column;
+        })
+        .column_text("counter", [](const StatSample& row) -> std::string {
+            return row.counter;
+        })
+        .column_int64("value", [](const StatSample& row) -> int64_t {
+            return row.value;
+        })
+        .build();
+}
+
+// Ring of recent IDB modifications (change_journal.hpp), oldest first.
+static CachedTableDef<ChangeRecord> define_idb_changes() {
+    return cached_table<ChangeRecord>("idb_changes")
+        .no_shared_cache()
+        .estimate_rows([]() -> size_t { return 1024; })
+        .cache_builder([](std::vector<ChangeRecord>& rows) {
+            rows = ChangeJournal::instance().changes_since(0);
+        })
+        .column_int64("seq", [](const ChangeRecord& row) -> int64_t {
+            return static_cast<int64_t>(row.seq);
+        })
+        .column_int64("timestamp_ms", [](const ChangeRecord& row) -> int64_t {
+            return row.time_ms;
+        })
+        .column_text("kind", [](const ChangeRecord& row) -> std::string {
+            return row.kind;
+        })
+        .column_int64("address", [](const ChangeRecord& row) -> int64_t {
+            return row.address != BADADDR ? static_cast<int64_t>(row.address) : 0;
+        })
+        .column_int64("func_addr", [](const ChangeRecord& row) -> int64_t {
+            return row.func != BADADDR ? static_cast<int64_t>(row.func) : 0;
+        })
+        .column_int64("target", [](const ChangeRecord& row) -> int64_t {
+            return row.target != BADADDR ? static_cast<int64_t>(row.target) : 0;
+        })
+        .column_text("detail", [](const ChangeRecord& row) -> std::string {
+            return row.detail;
+        })
+        .build();
+}
+
 } // namespace
 
 MetadataRegistry::MetadataRegistry()
     : db_info(define_db_info())
     , ida_info(define_ida_info())
-    , welcome(define_welcome()) {}
+    , welcome(define_welcome())
+    , stats(define_idasql_stats())
+    , changes(define_idb_changes()) {}
 
 void MetadataRegistry::register_all(xsql::Database& db) {
     db.register_cached_table("ida_db_info", &db_info);
@@ -132,6 +189,12 @@ void MetadataRegistry::register_all(xsql::Database& db) {
 
     db.register_cached_table("ida_welcome", &welcome);
     db.create_table("welcome", "ida_welcome");
+
+    db.register_cached_table("ida_idasql_stats", &stats);
+    db.create_table("idasql_stats", "ida_idasql_stats");
+
+    db.register_cached_table("ida_idb_changes", &changes);
+    db.create_table("idb_changes", "ida_idb_changes");
 }
 
 } // namespace metadata
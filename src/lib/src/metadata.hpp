@@ -8,13 +8,15 @@
 /**
  * metadata.hpp - IDA database metadata as virtual tables
  *
- * Tables: db_info, ida_info, welcome
+ * Tables: db_info, ida_info, welcome, idasql_stats, idb_changes
  */
 
 #pragma once
 
+#include "change_journal.hpp"
 #include "metadata_welcome.hpp"
 #include <idasql/vtable.hpp>
+#include <idasql/vtable_stats.hpp>
 #include <xsql/database.hpp>
 
 #include <string>
@@ -32,6 +34,8 @@ struct MetadataRegistry {
     CachedTableDef<MetadataItem> db_info;
     CachedTableDef<MetadataItem> ida_info;
     CachedTableDef<WelcomeRow> welcome;
+    CachedTableDef<StatSample> stats;
+    CachedTableDef<ChangeRecord> changes;
 
     MetadataRegistry();
     void register_all(xsql::Database& db);
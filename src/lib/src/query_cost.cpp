@@ -0,0 +1,243 @@
+// Copyright (c) 2024-2026 Elias Bachaalany
+// SPDX-License-Identifier: MPL-2.0
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#include "query_cost.hpp"
+
+#include <idasql/vtable_stats.hpp>
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+#include <unordered_map>
+
+#include <sqlite3.h>
+
+namespace idasql {
+
+namespace {
+
+const char kExplainPrefix[] = "EXPLAIN QUERY PLAN ";
+
+// Rows assumed for a table defined without estimate_rows.
+constexpr double kUnknownScanRows = 1000.0;
+
+std::string lower_copy(std::string value) {
+    for (char& c : value) {
+        c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    }
+    return value;
+}
+
+// Lowercased identifiers and keywords of sql, string literals skipped.
+void append_word_tokens(const std::string& sql, std::vector<std::string>& out) {
+    for (size_t i = 0; i < sql.size();) {
+        const char c = sql[i];
+        if (c == '\'') {
+            const size_t end = sql.find('\'', i + 1);
+            i = end == std::string::npos ? sql.size() : end + 1;
+        } else if (c == '"' || c == '`' || c == '[') {
+            const char close = c == '[' ? ']' : c;
+            const size_t end = sql.find(close, i + 1);
+            if (end == std::string::npos) break;
+            out.push_back(lower_copy(sql.substr(i + 1, end - i - 1)));
+            i = end + 1;
+        } else if (std::isalnum(static_cast<unsigned char>(c)) || c == '_') {
+            size_t end = i;
+            while (end < sql.size() &&
+                   (std::isalnum(static_cast<unsigned char>(sql[end])) || sql[end] == '_')) {
+                ++end;
+            }
+            out.push_back(lower_copy(sql.substr(i, end - i)));
+            i = end;
+        } else {
+            ++i;
+        }
+    }
+}
+
+// Newer SQLite prints the alias instead of the table name; map it back by
+// looking for "<table> [AS] <alias>" in the statement and in view bodies.
+TableStats* resolve_table(const std::string& name, const std::vector<std::string>& tokens) {
+    if (TableStats* stats = find_table_stats(name)) {
+        return stats;
+    }
+    for (size_t i = 1; i < tokens.size(); ++i) {
+        if (tokens[i] != name) continue;
+        size_t j = i - 1;
+        if (tokens[j] == "as" && j > 0) --j;
+        if (TableStats* stats = find_table_stats(tokens[j])) {
+            return stats;
+        }
+    }
+    return nullptr;
+}
+
+struct ScanLine {
+    std::string name;
+    bool virtual_table = false;
+    bool pushdown = false;
+};
+
+// "SCAN [TABLE] <name> [AS <alias>] VIRTUAL TABLE INDEX <num>:<str>"
+bool parse_scan_line(const std::string& detail, ScanLine& out) {
+    std::istringstream in(detail);
+    std::string word;
+    in >> word;
+    if (word != "SCAN" && word != "SEARCH") {
+        return false;
+    }
+    in >> out.name;
+    if (out.name == "TABLE") in >> out.name;
+    out.name = lower_copy(out.name);
+
+    static const char kVtabMarker[] = "VIRTUAL TABLE INDEX ";
+    const size_t pos = detail.find(kVtabMarker);
+    if (pos == std::string::npos) {
+        return true;
+    }
+    out.virtual_table = true;
+    const char* num = detail.c_str() + pos + sizeof(kVtabMarker) - 1;
+    char* end = nullptr;
+    const long idx_num = std::strtol(num, &end, 10);
+    // idxStr directly follows ':'; " LEFT-JOIN" and friends come after a space.
+    const bool has_idx_str = end && end[0] == ':' && end[1] != '\0' &&
+                             !std::isspace(static_cast<unsigned char>(end[1]));
+    out.pushdown = idx_num != 0 || has_idx_str;
+    return true;
+}
+
+std::vector<std::string> view_tokens(sqlite3* db) {
+    std::vector<std::string> tokens;
+    sqlite3_stmt* stmt = nullptr;
+    if (sqlite3_prepare_v2(db, "SELECT sql FROM sqlite_master WHERE type = 'view'", -1,
+                           &stmt, nullptr) != SQLITE_OK) {
+        return tokens;
+    }
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        const auto* text = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0));
+        if (text) append_word_tokens(text, tokens);
+    }
+    sqlite3_finalize(stmt);
+    return tokens;
+}
+
+void price_plan(sqlite3_stmt* stmt, const std::vector<std::string>& tokens,
+                QueryCostEstimate& out) {
+    // Loop multiplier per plan node: scans under the same parent nest.
+    std::unordered_map<int, double> loops;
+    auto loops_of = [&loops](int id) {
+        auto it = loops.find(id);
+        return it == loops.end() ? 1.0 : it->second;
+    };
+
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        const int id = sqlite3_column_int(stmt, 0);
+        const int parent = sqlite3_column_int(stmt, 1);
+        const auto* text = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 3));
+        const std::string detail = text ? text : "";
+
+        ScanLine scan;
+        if (!parse_scan_line(detail, scan)) {
+            // Correlated subqueries run per outer row; others once.
+            loops[id] = detail.rfind("CORRELATED", 0) == 0 ? loops_of(parent) : 1.0;
+            continue;
+        }
+        if (!scan.virtual_table) {
+            continue;
+        }
+        TableStats* stats = resolve_table(scan.name, tokens);
+        if (!stats) {
+            continue;
+        }
+
+        const double full_rows = stats->estimate_rows
+            ? static_cast<double>(stats->estimate_rows()) : kUnknownScanRows;
+        const double full_functions = stats->scan_decompiles
+            ? static_cast<double>(stats->scan_decompiles()) : 0.0;
+
+        TableCostEstimate entry;
+        entry.table = stats->name;
+        entry.loops = loops_of(parent);
+        if (scan.pushdown) {
+            // One probe: a single function's worth of rows for decompiler
+            // tables, a handful otherwise.
+            entry.kind = TableAccessKind::Pushdown;
+            entry.functions = full_functions > 0 ? 1.0 : 0.0;
+            entry.rows = full_functions > 0 ? std::max(1.0, full_rows / full_functions) : 1.0;
+        } else {
+            entry.kind = TableAccessKind::FullScan;
+            entry.rows = full_rows;
+            entry.functions = full_functions;
+        }
+        // Repeated probes of one function hit the cfunc cache, so a table
+        // never decompiles more functions than a full scan would.
+        entry.functions = std::min(entry.loops * entry.functions, full_functions);
+        entry.cost = entry.loops * entry.rows + kDecompileCost * entry.functions;
+        loops[parent] = entry.loops * std::max(1.0, entry.rows);
+        out.total += entry.cost;
+        out.tables.push_back(std::move(entry));
+    }
+}
+
+} // namespace
+
+const TableCostEstimate* QueryCostEstimate::dominant() const {
+    const TableCostEstimate* best = nullptr;
+    for (const auto& entry : tables) {
+        if (!best || entry.cost > best->cost) best = &entry;
+    }
+    return best;
+}
+
+QueryCostEstimate estimate_query_cost(sqlite3* db, const char* sql) {
+    QueryCostEstimate out;
+    if (!db || !sql) {
+        return out;
+    }
+
+    const std::string script = sql;
+    std::vector<std::string> views;
+    bool views_loaded = false;
+    const size_t prefix_len = sizeof(kExplainPrefix) - 1;
+    size_t offset = 0;
+    while (offset < script.size()) {
+        const char c = script[offset];
+        if (c == ';' || std::isspace(static_cast<unsigned char>(c))) {
+            ++offset;
+            continue;
+        }
+
+        const std::string text = kExplainPrefix + script.substr(offset);
+        sqlite3_stmt* stmt = nullptr;
+        const char* tail = nullptr;
+        if (sqlite3_prepare_v2(db, text.c_str(), -1, &stmt, &tail) != SQLITE_OK) {
+            // Not plannable yet; the real run reports any genuine error.
+            sqlite3_finalize(stmt);
+            break;
+        }
+        const size_t consumed = tail
+            ? static_cast<size_t>(tail - text.c_str()) - prefix_len
+            : script.size() - offset;
+        if (stmt) {
+            if (!views_loaded) {
+                views = view_tokens(db);
+                views_loaded = true;
+            }
+            std::vector<std::string> tokens;
+            append_word_tokens(script.substr(offset, consumed), tokens);
+            tokens.insert(tokens.end(), views.begin(), views.end());
+            price_plan(stmt, tokens, out);
+            sqlite3_finalize(stmt);
+        }
+        offset += std::max<size_t>(consumed, 1);
+    }
+    return out;
+}
+
+} // namespace idasql
@@ -0,0 +1,61 @@
+// Copyright (c) 2024-2026 Elias Bachaalany
+// SPDX-License-Identifier: MPL-2.0
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+/**
+ * query_cost.hpp - Pre-execution cost estimate for QueryEngine admission
+ *
+ * Each statement is planned with EXPLAIN QUERY PLAN (no xFilter runs, no
+ * rows are produced). Every virtual-table scan in the plan is classified
+ * as a full scan (idxNum 0, no idxStr) or a pushdown, and priced from the
+ * table's definition-time cost model (TableStats::estimate_rows and
+ * scan_decompiles):
+ *
+ *   full scan : all rows and all functions, per outer loop
+ *   pushdown  : one function's rows (decompiler tables) or 1 row, and one
+ *               function, per outer loop
+ *
+ * Nested loops multiply rows; decompiles are capped at what a full scan
+ * would need since repeats hit the cfunc cache. Units are "rows
+ * materialized"; one decompile is priced as kDecompileCost rows.
+ */
+
+#pragma once
+
+#include <idasql/query_plan.hpp>
+
+#include <string>
+#include <vector>
+
+struct sqlite3;
+
+namespace idasql {
+
+constexpr double kDecompileCost = 1000.0;
+
+struct TableCostEstimate {
+    std::string table;
+    TableAccessKind kind = TableAccessKind::FullScan;
+    double loops = 1;      // times the scan runs (outer loop rows)
+    double rows = 0;       // rows per run
+    double functions = 0;  // distinct functions decompiled, all runs
+    double cost = 0;       // loops * rows + kDecompileCost * functions
+};
+
+struct QueryCostEstimate {
+    std::vector<TableCostEstimate> tables;
+    double total = 0;
+
+    // The entry that contributes most, or nullptr.
+    const TableCostEstimate* dominant() const;
+};
+
+// Plan every statement of sql and price its virtual-table scans.
+// Statements that cannot be planned yet (e.g. they use a table created by
+// an earlier statement of the same script) contribute nothing.
+QueryCostEstimate estimate_query_cost(sqlite3* db, const char* sql);
+
+} // namespace idasql
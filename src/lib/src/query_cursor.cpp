@@ -0,0 +1,691 @@
+// Copyright (c) 2024-2026 Elias Bachaalany
+// SPDX-License-Identifier: MPL-2.0
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#include <idasql/query_cursor.hpp>
+#include <idasql/cancel.hpp>
+#include <idasql/result_cache.hpp>
+#include <idasql/runtime_settings.hpp>
+#include <idasql/trace.hpp>
+#include <idasql/vtable_stats.hpp>
+
+#include "statement_cache.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <initializer_list>
+
+#include <sqlite3.h>
+
+namespace idasql {
+
+namespace {
+
+using steady_clock = std::chrono::steady_clock;
+
+// How many SQLite VM instructions run between deadline/cancel checks.
+constexpr int kProgressCheckOps = 1000;
+
+// SQL text kept on a "query" trace span.
+constexpr size_t kTraceSqlChars = 256;
+
+const std::vector<std::string> kNoColumns;
+
+// True when only whitespace and statement separators remain.
+bool is_blank_tail(const char* tail) {
+    for (; tail && *tail; ++tail) {
+        if (*tail != ';' && !std::isspace(static_cast<unsigned char>(*tail))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Copy the cursor's current row into the typed result table, without
+// converting any cell to text.
+void append_cursor_row(const CursorRow& row, ResultTable& table) {
+    for (size_t col = 0; col < row.size(); ++col) {
+        const CellView cell = row.cell(col);
+        switch (cell.type()) {
+            case CellType::Integer: table.append_int64(col, cell.as_int64()); break;
+            case CellType::Real:    table.append_double(col, cell.as_double()); break;
+            case CellType::Text:    table.append_text(col, cell.bytes()); break;
+            case CellType::Blob:
+                table.append_blob(col, cell.bytes().data(), cell.bytes().size());
+                break;
+            case CellType::Null:    table.append_null(col); break;
+        }
+    }
+    table.end_row();
+}
+
+// Buffered rows between charges against PRAGMA idasql.max_query_memory
+// (and checks against PRAGMA idasql.spill_threshold_mb).
+constexpr size_t kMemoryCheckRows = 1024;
+
+// Cursors inside sqlite3_step/prepare right now, on any connection (the
+// engine's and the snapshot workers').
+std::atomic<int> g_running_cursors{0};
+
+// Heap this connection holds: its page caches and prepared statements.
+// Sorter lists and ephemeral b-trees are not part of either.
+int64_t connection_memory(sqlite3* db) {
+    int64_t total = 0;
+    for (int op : {SQLITE_DBSTATUS_CACHE_USED, SQLITE_DBSTATUS_STMT_USED}) {
+        int current = 0;
+        int highwater = 0;
+        if (sqlite3_db_status(db, op, &current, &highwater, 0) == SQLITE_OK) {
+            total += current;
+        }
+    }
+    return total;
+}
+
+} // namespace
+
+// ============================================================================
+// CursorRow
+// ============================================================================
+
+size_t CursorRow::size() const {
+    return columns_ ? columns_->size() : 0;
+}
+
+CellView CursorRow::cell(size_t col) const {
+    if (table_) {
+        return table_->at(index_, col);
+    }
+
+    const int i = static_cast<int>(col);
+    switch (sqlite3_column_type(stmt_, i)) {
+        case SQLITE_INTEGER:
+            return CellView(CellType::Integer, sqlite3_column_int64(stmt_, i), 0.0, {});
+        case SQLITE_FLOAT:
+            return CellView(CellType::Real, 0, sqlite3_column_double(stmt_, i), {});
+        case SQLITE_TEXT: {
+            const auto* text = reinterpret_cast<const char*>(sqlite3_column_text(stmt_, i));
+            const auto size = static_cast<size_t>(sqlite3_column_bytes(stmt_, i));
+            return CellView(CellType::Text, 0, 0.0, std::string_view(text ? text : "", size));
+        }
+        case SQLITE_BLOB: {
+            const auto* data = static_cast<const char*>(sqlite3_column_blob(stmt_, i));
+            const auto size = static_cast<size_t>(sqlite3_column_bytes(stmt_, i));
+            return CellView(CellType::Blob, 0, 0.0, std::string_view(data ? data : "", size));
+        }
+        default:
+            return CellView();
+    }
+}
+
+// ============================================================================
+// QueryCursor
+// ============================================================================
+
+struct QueryCursor::Impl {
+    sqlite3* db = nullptr;
+    std::string sql;
+    const char* tail = nullptr;
+    sqlite3_stmt* stmt = nullptr;
+    size_t statement_index = 0;
+    size_t prepared = 0;
+
+    // Bound parameters and the statement cache (single-statement texts only).
+    QueryParams params;
+    StatementCache* cache = nullptr;
+    std::string cache_key;
+
+    // Timeout accounting: only time spent inside SQLite counts.
+    int timeout_ms = 0;
+    steady_clock::duration spent{};
+    steady_clock::time_point deadline;
+    bool deadline_fired = false;
+
+    // Polled by table callbacks; carries the deadline and chains to the
+    // token of the request that opened the cursor.
+    CancelTokenPtr cancel;
+
+    // Buffered mode (runtime pragmas, engine errors).
+    QueryResult buffered;
+    bool use_buffered = false;
+
+    std::vector<std::string> columns;
+    CursorRow row;
+    size_t rows_read = 0;
+    size_t rows_in_statement = 0;
+    std::string error;
+    bool timed_out = false;
+    bool done = false;
+
+    // Table accesses recorded by the vtable wrappers while SQLite runs,
+    // and the query's memory account.
+    QueryPlan plan;
+    int64_t connection_baseline = 0;  // connection_memory() at the start
+    int64_t heap_baseline = 0;        // sqlite3_memory_used() at this step
+    bool memory_recorded = false;
+    bool outcome_recorded = false;
+
+    // Whole-cursor span under PRAGMA idasql.trace; ended (and the trace
+    // file rewritten) once the cursor is exhausted or closed.
+    std::unique_ptr<TraceSpan> trace;
+
+    static int progress(void* ctx) {
+        auto* self = static_cast<Impl*>(ctx);
+        if (self->cancel->cancelled()) {
+            return 1;
+        }
+        // Its own timeout, or a deadline of the request it runs under
+        // (e.g. an MCP batch budget).
+        if ((self->timeout_ms > 0 && steady_clock::now() >= self->deadline) ||
+            self->cancel->deadline_passed()) {
+            self->deadline_fired = true;
+            return 1;
+        }
+        QueryMemory& memory = self->plan.memory;
+        if (memory.limit > 0) {
+            int64_t grown = connection_memory(self->db) - self->connection_baseline;
+            // The process-wide counter also sees sorters and temp b-trees,
+            // but is only this query's while no other cursor is running;
+            // otherwise the per-connection figure is all that is charged.
+            if (g_running_cursors.load(std::memory_order_relaxed) == 1) {
+                grown = std::max<int64_t>(grown, sqlite3_memory_used() - self->heap_baseline);
+            }
+            memory.sqlite = grown > 0 ? static_cast<uint64_t>(grown) : 0;
+            if (memory.check("SQLite sort/temp storage")) {
+                return 1;
+            }
+        }
+        return 0;
+    }
+
+    void finalize() {
+        if (stmt) {
+            if (cache && !cache_key.empty()) {
+                cache->checkin(cache_key, stmt);
+            } else {
+                sqlite3_finalize(stmt);
+            }
+            stmt = nullptr;
+        }
+        cache_key.clear();
+    }
+
+    void record_memory() {
+        if (memory_recorded || use_buffered) {
+            return;
+        }
+        memory_recorded = true;
+        update_max(engine_stats().query_bytes_max, plan.memory.peak);
+        if (plan.memory.exceeded()) {
+            engine_stats().memory_limit_hits.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    void record_outcome() {
+        if (outcome_recorded) {
+            return;
+        }
+        outcome_recorded = true;
+        engine_stats().rows_returned.fetch_add(rows_read, std::memory_order_relaxed);
+        if (timed_out) {
+            engine_stats().query_timeouts.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    void finish_trace() {
+        if (!trace) {
+            return;
+        }
+        trace->arg("rows", static_cast<int64_t>(rows_read));
+        if (!error.empty()) trace->arg("error", error);
+        if (timed_out) trace->arg("timed_out", 1);
+        trace.reset();
+        flush_trace();
+    }
+
+    bool bind_params() {
+        const int count = sqlite3_bind_parameter_count(stmt);
+        if (count == 0) {
+            return true;
+        }
+        // An unbound placeholder would silently read as NULL.
+        if (params.size() < static_cast<size_t>(count)) {
+            fail("Statement expects " + std::to_string(count) + " parameter(s), got " +
+                 std::to_string(params.size()));
+            return false;
+        }
+        for (int i = 1; i <= count; ++i) {
+            const SqlValue& value = params[static_cast<size_t>(i - 1)];
+            int rc = SQLITE_OK;
+            switch (value.type()) {
+                case CellType::Integer:
+                    rc = sqlite3_bind_int64(stmt, i, value.int64());
+                    break;
+                case CellType::Real:
+                    rc = sqlite3_bind_double(stmt, i, value.real());
+                    break;
+                case CellType::Text:
+                    rc = sqlite3_bind_text(stmt, i, value.bytes().data(),
+                                           static_cast<int>(value.bytes().size()), SQLITE_STATIC);
+                    break;
+                case CellType::Blob:
+                    rc = sqlite3_bind_blob(stmt, i, value.bytes().data(),
+                                           static_cast<int>(value.bytes().size()), SQLITE_STATIC);
+                    break;
+                case CellType::Null:
+                    rc = sqlite3_bind_null(stmt, i);
+                    break;
+            }
+            if (rc != SQLITE_OK) {
+                fail(sqlite3_errmsg(db));
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void fail(std::string message) {
+        error = std::move(message);
+        finalize();
+        done = true;
+    }
+
+    // Stop after the token fired: a cancel or the memory limit is an error,
+    // a deadline is a timeout (rows delivered so far stay valid).
+    void stop_cancelled() {
+        if (plan.memory.exceeded()) {
+            fail(plan.memory.error());
+            return;
+        }
+        if (cancel->cancelled()) {
+            fail("Query cancelled");
+            return;
+        }
+        timed_out = true;
+        finalize();
+        done = true;
+    }
+
+    // Run fn with the deadline/cancel handler and the cancel token
+    // installed; the handler is removed again so other queries on the same
+    // connection are unaffected.
+    template <typename Fn>
+    int timed(Fn&& fn) {
+        const auto started = steady_clock::now();
+        if (timeout_ms > 0) {
+            deadline = started + (std::chrono::milliseconds(timeout_ms) - spent);
+            cancel->set_deadline(deadline);
+        }
+        if (plan.memory.limit > 0) {
+            heap_baseline = sqlite3_memory_used();
+        }
+        sqlite3_progress_handler(db, kProgressCheckOps, &Impl::progress, this);
+        int rc;
+        g_running_cursors.fetch_add(1, std::memory_order_relaxed);
+        {
+            QueryPlanScope recording(&plan);
+            CancelScope cancelling(cancel);
+            rc = fn();
+        }
+        g_running_cursors.fetch_sub(1, std::memory_order_relaxed);
+        sqlite3_progress_handler(db, 0, nullptr, nullptr);
+        const auto elapsed = steady_clock::now() - started;
+        spent += elapsed;
+        engine_stats().sqlite.add(static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()));
+        return rc;
+    }
+
+    // Prepare the next non-empty statement. Returns false when the text is
+    // exhausted or on error.
+    bool prepare_next() {
+        while (tail && *tail != '\0') {
+            // A whole single-statement text may come from the cache.
+            std::string key;
+            if (cache && tail == sql.c_str()) {
+                key = StatementCache::normalize(sql);
+                stmt = key.empty() ? nullptr : cache->checkout(key);
+                if (stmt) {
+                    tail = sql.c_str() + sql.size();
+                    cache_key = std::move(key);
+                    return start_statement();
+                }
+            }
+
+            const char* next_tail = nullptr;
+            TraceSpan span("sqlite", "prepare");
+            const int rc = timed([&] {
+                return sqlite3_prepare_v2(db, tail, -1, &stmt, &next_tail);
+            });
+            span.end();
+            if (rc != SQLITE_OK) {
+                fail(sqlite3_errmsg(db));
+                return false;
+            }
+            if (!key.empty() && stmt != nullptr && is_blank_tail(next_tail)) {
+                cache_key = std::move(key);
+            }
+            tail = next_tail;
+            if (stmt == nullptr) {
+                continue;  // whitespace or comment
+            }
+            return start_statement();
+        }
+        return false;
+    }
+
+    bool start_statement() {
+        if (!bind_params()) {
+            return false;
+        }
+        if (!sqlite3_stmt_readonly(stmt)) {
+            // Writes the change hooks may not see (temp tables, netnode_kv).
+            bump_idb_epoch();
+        }
+
+        const int column_count = sqlite3_column_count(stmt);
+        if (column_count > 0) {
+            columns.clear();
+            columns.reserve(static_cast<size_t>(column_count));
+            for (int i = 0; i < column_count; ++i) {
+                const char* name = sqlite3_column_name(stmt, i);
+                columns.emplace_back(name ? name : "");
+            }
+            statement_index = prepared;
+            rows_in_statement = 0;
+        }
+        ++prepared;
+        return true;
+    }
+
+    bool next() {
+        if (done) {
+            return false;
+        }
+        if (use_buffered) {
+            if (rows_read < buffered.row_count()) {
+                row.index_ = rows_read++;
+                return true;
+            }
+            done = true;
+            return false;
+        }
+
+        for (;;) {
+            if (cancel->cancelled()) {
+                stop_cancelled();
+                return false;
+            }
+            if (!stmt && !prepare_next()) {
+                done = true;
+                return false;
+            }
+
+            const int rc = timed([&] { return sqlite3_step(stmt); });
+            if ((rc == SQLITE_ROW || rc == SQLITE_DONE) &&
+                (cancel->tripped() || plan.memory.exceeded())) {
+                // A table callback stopped early (or a cache went over the
+                // memory limit), so this statement's rows are truncated;
+                // report why instead of a short result.
+                stop_cancelled();
+                return false;
+            }
+            if (rc == SQLITE_ROW) {
+                row.stmt_ = stmt;
+                row.index_ = rows_in_statement++;
+                ++rows_read;
+                return true;
+            }
+            if (rc == SQLITE_DONE) {
+                finalize();
+                continue;
+            }
+            if (rc == SQLITE_INTERRUPT &&
+                (deadline_fired || cancel->cancelled() || plan.memory.exceeded())) {
+                stop_cancelled();
+                return false;
+            }
+            fail(sqlite3_errmsg(db));
+            return false;
+        }
+    }
+};
+
+QueryCursor::QueryCursor() : impl_(std::make_unique<Impl>()) {
+    impl_->done = true;
+}
+
+QueryCursor::QueryCursor(sqlite3* db, const char* sql, QueryParams params,
+                         int timeout_ms, StatementCache* cache)
+    : impl_(std::make_unique<Impl>()) {
+    impl_->db = db;
+    impl_->sql = sql ? sql : "";
+    impl_->tail = impl_->sql.c_str();
+    impl_->params = std::move(params);
+    impl_->cache = cache;
+    impl_->timeout_ms = timeout_ms;
+    impl_->cancel = std::make_shared<CancelToken>(current_cancel_token());
+    impl_->plan.memory.limit =
+        static_cast<uint64_t>(runtime_settings().max_query_memory_mb()) * 1024 * 1024;
+    if (impl_->plan.memory.limit > 0) {
+        impl_->connection_baseline = connection_memory(db);
+    }
+    impl_->row.columns_ = &impl_->columns;
+    if (tracing()) {
+        impl_->trace = std::make_unique<TraceSpan>("query", "query");
+        impl_->trace->arg("sql", std::string_view(impl_->sql).substr(0, kTraceSqlChars));
+    }
+}
+
+QueryCursor::QueryCursor(QueryResult buffered)
+    : impl_(std::make_unique<Impl>()) {
+    impl_->use_buffered = true;
+    impl_->buffered = std::move(buffered);
+    impl_->columns = impl_->buffered.columns;
+    impl_->error = impl_->buffered.success ? "" : impl_->buffered.error;
+    impl_->done = !impl_->error.empty();
+    impl_->row.table_ = &impl_->buffered.table;
+    impl_->row.columns_ = &impl_->columns;
+}
+
+QueryCursor::~QueryCursor() {
+    close();
+}
+
+QueryCursor::QueryCursor(QueryCursor&&) noexcept = default;
+
+QueryCursor& QueryCursor::operator=(QueryCursor&& other) noexcept {
+    if (this != &other) {
+        close();
+        impl_ = std::move(other.impl_);
+    }
+    return *this;
+}
+
+bool QueryCursor::next() {
+    if (!impl_) {
+        return false;
+    }
+    if (impl_->next()) {
+        return true;
+    }
+    impl_->record_memory();
+    impl_->record_outcome();
+    impl_->finish_trace();
+    return false;
+}
+
+const CursorRow& QueryCursor::row() const {
+    return impl_->row;
+}
+
+const std::vector<std::string>& QueryCursor::columns() const {
+    return impl_ ? impl_->columns : kNoColumns;
+}
+
+size_t QueryCursor::statement_index() const {
+    return impl_ ? impl_->statement_index : 0;
+}
+
+size_t QueryCursor::rows_read() const {
+    return impl_ ? impl_->rows_read : 0;
+}
+
+void QueryCursor::close() {
+    if (impl_) {
+        impl_->finalize();
+        impl_->done = true;
+        impl_->record_memory();
+        impl_->record_outcome();
+        impl_->finish_trace();
+    }
+}
+
+bool QueryCursor::done() const {
+    return !impl_ || impl_->done;
+}
+
+const std::string& QueryCursor::error() const {
+    static const std::string kNone;
+    return impl_ ? impl_->error : kNone;
+}
+
+bool QueryCursor::note_buffered_bytes(uint64_t bytes) {
+    if (!impl_ || impl_->use_buffered) {
+        return true;
+    }
+    QueryMemory& memory = impl_->plan.memory;
+    memory.results = bytes;
+    if (!memory.check("buffered result rows")) {
+        return true;
+    }
+    if (!impl_->done) {
+        impl_->fail(memory.error());
+    }
+    return false;
+}
+
+void QueryCursor::cancel() {
+    if (impl_ && impl_->cancel) {
+        impl_->cancel->cancel();
+    }
+}
+
+void QueryCursor::restart_timeout() {
+    if (impl_) {
+        impl_->spent = {};
+    }
+}
+
+bool QueryCursor::timed_out() const {
+    return impl_ && impl_->timed_out;
+}
+
+const QueryPlan& QueryCursor::plan() const {
+    static const QueryPlan kNoPlan;
+    if (!impl_) return kNoPlan;
+    return impl_->use_buffered ? impl_->buffered.plan : impl_->plan;
+}
+
+int QueryCursor::elapsed_ms() const {
+    if (!impl_) return 0;
+    if (impl_->use_buffered) return impl_->buffered.elapsed_ms;
+    return static_cast<int>(
+        std::chrono::duration_cast<std::chrono::milliseconds>(impl_->spent).count());
+}
+
+std::string query_timeout_error(int elapsed_ms) {
+    return "Query timed out after " + std::to_string(elapsed_ms) +
+        " ms (raise PRAGMA idasql.query_timeout_ms)";
+}
+
+void collect_cursor(QueryCursor& cursor, QueryResult& result) {
+    const size_t spill_bytes = runtime_settings().spill_threshold_mb() * 1024 * 1024;
+
+    // Every statement runs; the last one that returns columns is the result.
+    size_t owner = static_cast<size_t>(-1);
+    bool spill_failed = false;
+    while (cursor.next()) {
+        if (cursor.statement_index() != owner) {
+            owner = cursor.statement_index();
+            result.table.reset(cursor.columns().size());
+        }
+        append_cursor_row(cursor.row(), result.table);
+        if (result.table.row_count() % kMemoryCheckRows != 0) {
+            continue;
+        }
+        if (spill_bytes != 0 && !spill_failed && !result.table.spilled() &&
+            result.table.byte_size() > spill_bytes) {
+            std::string spill_error;
+            if (!result.table.spill(&spill_error)) {
+                // Keep buffering in memory; max_query_memory still applies.
+                spill_failed = true;
+                result.warnings.push_back("Spill to disk failed: " + spill_error);
+            }
+        }
+        if (!cursor.note_buffered_bytes(result.table.byte_size())) {
+            // Failed: release what was buffered rather than return it.
+            result.table = ResultTable();
+            result.table.reset(cursor.columns().size());
+            break;
+        }
+    }
+    if (!cursor.columns().empty() && cursor.statement_index() != owner) {
+        result.table.reset(cursor.columns().size());
+    }
+
+    result.columns = cursor.columns();
+    result.error = cursor.error();
+    result.timed_out = cursor.timed_out();
+    result.partial = result.timed_out && !result.empty();
+    result.elapsed_ms = cursor.elapsed_ms();
+    result.plan = cursor.plan();
+    if (result.timed_out && !result.partial) {
+        result.error = query_timeout_error(result.elapsed_ms);
+    }
+}
+
+bool collect_cursor_page(QueryCursor& cursor, QueryResult& page, size_t max_rows,
+                         CursorPagePosition& position) {
+    bool have = position.pending || cursor.next();
+    position.pending = false;
+
+    // Columns and statement of the page's first row; a later statement
+    // starts the next page.
+    const size_t owner = cursor.statement_index();
+    position.statement_index = owner;
+    position.offset = have ? cursor.row().index() : 0;
+    page.columns = cursor.columns();
+    page.table.reset(page.columns.size());
+    while (have) {
+        if (cursor.statement_index() != owner || page.table.row_count() >= max_rows) {
+            position.pending = true;
+            break;
+        }
+        append_cursor_row(cursor.row(), page.table);
+        if (page.table.row_count() % kMemoryCheckRows == 0 &&
+            !cursor.note_buffered_bytes(page.table.byte_size())) {
+            page.table = ResultTable();
+            page.table.reset(page.columns.size());
+            break;
+        }
+        have = cursor.next();
+    }
+
+    page.error = cursor.error();
+    page.timed_out = cursor.timed_out();
+    page.partial = page.timed_out && !page.empty();
+    page.elapsed_ms = cursor.elapsed_ms();
+    page.plan = cursor.plan();
+    if (page.timed_out && !page.partial) {
+        page.error = query_timeout_error(page.elapsed_ms);
+    }
+    page.success = page.error.empty();
+    return position.pending;
+}
+
+} // namespace idasql
@@ -0,0 +1,152 @@
+// Copyright (c) 2024-2026 Elias Bachaalany
+// SPDX-License-Identifier: MPL-2.0
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#include <idasql/query_plan.hpp>
+
+#include <cstdio>
+
+namespace idasql {
+
+namespace {
+
+thread_local QueryPlan* t_plan = nullptr;
+thread_local const std::string* t_active_table = nullptr;
+thread_local MemoryProbe* t_probe = nullptr;
+
+std::string format_mb(uint64_t bytes) {
+    char text[32];
+    std::snprintf(text, sizeof(text), "%.1f MB", static_cast<double>(bytes) / (1024.0 * 1024.0));
+    return text;
+}
+
+} // namespace
+
+const char* table_access_name(TableAccessKind kind) {
+    switch (kind) {
+        case TableAccessKind::FullScan: return "full_scan";
+        case TableAccessKind::Pushdown: return "pushdown";
+        case TableAccessKind::Index: return "index";
+    }
+    return "unknown";
+}
+
+TableAccess& QueryPlan::access(const std::string& table, TableAccessKind kind) {
+    for (auto& entry : tables) {
+        if (entry.kind == kind && entry.table == table) {
+            return entry;
+        }
+    }
+    tables.push_back(TableAccess{table, kind});
+    return tables.back();
+}
+
+bool QueryMemory::check(const std::string& what) {
+    const uint64_t now = total();
+    if (now > peak) peak = now;
+    if (limit == 0 || now <= limit) {
+        return exceeded();
+    }
+    if (exceeded_by.empty()) {
+        exceeded_by = what;
+    }
+    return true;
+}
+
+std::string QueryMemory::error() const {
+    return "Query exceeded idasql.max_query_memory (" + format_mb(limit) + "): ~" +
+        format_mb(peak) + " held, crossed by " + exceeded_by +
+        "; narrow it (WHERE func_addr = <addr>, LIMIT), stream rows with a cursor, "
+        "or raise PRAGMA idasql.max_query_memory";
+}
+
+QueryPlan* current_query_plan() {
+    return t_plan;
+}
+
+QueryPlanScope::QueryPlanScope(QueryPlan* plan) : previous_(t_plan) {
+    t_plan = plan;
+}
+
+QueryPlanScope::~QueryPlanScope() {
+    t_plan = previous_;
+}
+
+ActiveTableScope::ActiveTableScope(const std::string* table) : previous_(t_active_table) {
+    t_active_table = table;
+}
+
+ActiveTableScope::~ActiveTableScope() {
+    t_active_table = previous_;
+}
+
+TableAccess* note_table_access(const std::string& table, TableAccessKind kind) {
+    return t_plan ? &t_plan->access(table, kind) : nullptr;
+}
+
+void note_decompile() {
+    if (!t_plan) {
+        return;
+    }
+    ++t_plan->functions_decompiled;
+    if (!t_active_table) {
+        return;
+    }
+    // Charge whichever access of the active table is already recorded;
+    // a table read with no recorded filter only shows up here.
+    for (auto& entry : t_plan->tables) {
+        if (entry.table == *t_active_table) {
+            ++entry.functions;
+            return;
+        }
+    }
+    ++t_plan->access(*t_active_table, TableAccessKind::Index).functions;
+}
+
+MemoryProbeScope::MemoryProbeScope(MemoryProbe* probe) : previous_(t_probe) {
+    t_probe = probe;
+}
+
+MemoryProbeScope::~MemoryProbeScope() {
+    t_probe = previous_;
+    if (t_plan) {
+        t_plan->memory.building = 0;
+    }
+}
+
+bool query_memory_exceeded() {
+    if (!t_plan || t_plan->memory.limit == 0) {
+        return false;
+    }
+    QueryMemory& memory = t_plan->memory;
+    if (memory.exceeded()) {
+        return true;
+    }
+    if (t_probe) {
+        memory.building = t_probe->bytes();
+    }
+    return memory.check(t_active_table ? "the " + *t_active_table + " cache" : "a table cache");
+}
+
+void note_cache_bytes(TableAccess* access, uint64_t bytes) {
+    if (!t_plan || !access) {
+        return;
+    }
+    // A cursor rebuilding its cache drops the previous one, so each access
+    // holds at most its largest build.
+    if (bytes <= access->bytes) {
+        return;
+    }
+    access->bytes = bytes;
+    QueryMemory& memory = t_plan->memory;
+    memory.caches = 0;
+    for (const auto& entry : t_plan->tables) {
+        memory.caches += entry.bytes;
+    }
+    memory.check("the " + access->table + " cache");
+}
+
+} // namespace idasql
@@ -0,0 +1,422 @@
+// Copyright (c) 2024-2026 Elias Bachaalany
+// SPDX-License-Identifier: MPL-2.0
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#include <idasql/query_result.hpp>
+
+#include "spill_file.hpp"
+
+#include <charconv>
+#include <cstdlib>
+#include <cstring>
+
+#include <sqlite3.h>
+
+namespace idasql {
+
+const char* cell_type_name(CellType type) {
+    switch (type) {
+        case CellType::Null:    return "null";
+        case CellType::Integer: return "integer";
+        case CellType::Real:    return "real";
+        case CellType::Text:    return "text";
+        case CellType::Blob:    return "blob";
+    }
+    return "null";
+}
+
+// ============================================================================
+// CellView
+// ============================================================================
+
+int64_t CellView::as_int64() const {
+    switch (type_) {
+        case CellType::Integer: return int_;
+        case CellType::Real:    return static_cast<int64_t>(real_);
+        case CellType::Text:
+        case CellType::Blob: {
+            // Decimal prefix only, like SQLite: "010" is 10 and "0x10" is 0.
+            std::string tmp(bytes_);
+            return std::strtoll(tmp.c_str(), nullptr, 10);
+        }
+        case CellType::Null:
+            break;
+    }
+    return 0;
+}
+
+double CellView::as_double() const {
+    switch (type_) {
+        case CellType::Integer: return static_cast<double>(int_);
+        case CellType::Real:    return real_;
+        case CellType::Text:
+        case CellType::Blob: {
+            std::string tmp(bytes_);
+            return std::strtod(tmp.c_str(), nullptr);
+        }
+        case CellType::Null:
+            break;
+    }
+    return 0.0;
+}
+
+void CellView::append_to(std::string& out) const {
+    switch (type_) {
+        case CellType::Integer: {
+            char buf[24];
+            auto res = std::to_chars(buf, buf + sizeof(buf), int_);
+            out.append(buf, res.ptr);
+            break;
+        }
+        case CellType::Real: {
+            // Same rendering SQLite uses for REAL -> TEXT conversion.
+            char buf[40];
+            sqlite3_snprintf(sizeof(buf), buf, "%!.15g", real_);
+            out += buf;
+            break;
+        }
+        case CellType::Text:
+        case CellType::Blob:
+            out.append(bytes_.data(), bytes_.size());
+            break;
+        case CellType::Null:
+            break;
+    }
+}
+
+std::string CellView::to_string() const {
+    std::string out;
+    append_to(out);
+    return out;
+}
+
+// ============================================================================
+// ResultTable spill file
+// ============================================================================
+
+// Row-major encoding, per cell: one CellType byte, then 8 bytes for
+// Integer/Real, or a uint32 length and the bytes for Text/Blob.
+struct ResultTable::SpillState {
+    // Rows between entries of the offset index.
+    static constexpr size_t kIndexStride = 64;
+
+    std::unique_ptr<SpillFile> file;
+    std::vector<uint64_t> index;  // offset of row k * kIndexStride
+    size_t column_count = 0;
+
+    // Decoded row, reused while reads stay on it.
+    const char* base = nullptr;
+    size_t row = static_cast<size_t>(-1);
+    uint64_t next = 0;  // offset just past `row`
+    std::vector<CellView> cells;
+
+    void write_cell(CellType type, int64_t i, double d, std::string_view bytes) {
+        const auto tag = static_cast<uint8_t>(type);
+        file->append(&tag, 1);
+        switch (type) {
+            case CellType::Integer: file->append(&i, sizeof(i)); break;
+            case CellType::Real:    file->append(&d, sizeof(d)); break;
+            case CellType::Text:
+            case CellType::Blob: {
+                const auto size = static_cast<uint32_t>(bytes.size());
+                file->append(&size, sizeof(size));
+                file->append(bytes.data(), bytes.size());
+                break;
+            }
+            case CellType::Null:
+                break;
+        }
+    }
+
+    void end_row(size_t rows_done) {
+        if (rows_done % kIndexStride == 0) {
+            index.push_back(file->size());
+        }
+    }
+
+    // Decode the row starting at offset into cells; returns the next offset.
+    uint64_t decode(uint64_t offset) {
+        const char* p = base + offset;
+        for (size_t col = 0; col < column_count; ++col) {
+            const auto type = static_cast<CellType>(static_cast<uint8_t>(*p++));
+            switch (type) {
+                case CellType::Integer: {
+                    int64_t i;
+                    std::memcpy(&i, p, sizeof(i));
+                    p += sizeof(i);
+                    cells[col] = CellView(type, i, 0.0, {});
+                    break;
+                }
+                case CellType::Real: {
+                    double d;
+                    std::memcpy(&d, p, sizeof(d));
+                    p += sizeof(d);
+                    cells[col] = CellView(type, 0, d, {});
+                    break;
+                }
+                case CellType::Text:
+                case CellType::Blob: {
+                    uint32_t size;
+                    std::memcpy(&size, p, sizeof(size));
+                    p += sizeof(size);
+                    cells[col] = CellView(type, 0, 0.0, std::string_view(p, size));
+                    p += size;
+                    break;
+                }
+                case CellType::Null:
+                    cells[col] = CellView();
+                    break;
+            }
+        }
+        return static_cast<uint64_t>(p - base);
+    }
+
+    bool seek(size_t target) {
+        const char* mapped = file->map();
+        if (!mapped) {
+            return false;
+        }
+        if (mapped != base) {
+            base = mapped;
+            row = static_cast<size_t>(-1);
+        }
+        if (target == row) {
+            return true;
+        }
+
+        size_t r;
+        uint64_t offset;
+        if (row != static_cast<size_t>(-1) && target > row && target - row <= kIndexStride) {
+            r = row + 1;
+            offset = next;
+        } else {
+            r = target - target % kIndexStride;
+            offset = index[target / kIndexStride];
+        }
+        cells.resize(column_count);
+        for (;; ++r) {
+            offset = decode(offset);
+            if (r == target) break;
+        }
+        row = target;
+        next = offset;
+        return true;
+    }
+};
+
+// ============================================================================
+// ResultTable
+// ============================================================================
+
+void ResultTable::reset(size_t column_count) {
+    columns_.assign(column_count, {});
+    arena_.clear();
+    rows_ = 0;
+    spill_.reset();
+}
+
+void ResultTable::reserve_rows(size_t rows) {
+    for (auto& col : columns_) {
+        col.reserve(rows);
+    }
+}
+
+void ResultTable::clear() {
+    columns_.clear();
+    arena_.clear();
+    rows_ = 0;
+    spill_.reset();
+}
+
+void ResultTable::append_null(size_t col) {
+    if (spill_) {
+        spill_->write_cell(CellType::Null, 0, 0.0, {});
+        return;
+    }
+    columns_[col].emplace_back();
+}
+
+void ResultTable::append_int64(size_t col, int64_t value) {
+    if (spill_) {
+        spill_->write_cell(CellType::Integer, value, 0.0, {});
+        return;
+    }
+    Slot& slot = columns_[col].emplace_back();
+    slot.type = CellType::Integer;
+    slot.i = value;
+}
+
+void ResultTable::append_double(size_t col, double value) {
+    if (spill_) {
+        spill_->write_cell(CellType::Real, 0, value, {});
+        return;
+    }
+    Slot& slot = columns_[col].emplace_back();
+    slot.type = CellType::Real;
+    slot.d = value;
+}
+
+void ResultTable::append_text(size_t col, std::string_view value) {
+    append_bytes(col, CellType::Text, value.data(), value.size());
+}
+
+void ResultTable::append_blob(size_t col, const void* data, size_t size) {
+    append_bytes(col, CellType::Blob, static_cast<const char*>(data), size);
+}
+
+void ResultTable::append_bytes(size_t col, CellType type, const char* data, size_t size) {
+    if (spill_) {
+        spill_->write_cell(type, 0, 0.0, std::string_view(data, size));
+        return;
+    }
+    Slot& slot = columns_[col].emplace_back();
+    slot.type = type;
+    slot.size = static_cast<uint32_t>(size);
+    slot.offset = arena_.size();
+    if (size > 0) {
+        arena_.append(data, size);
+    }
+}
+
+void ResultTable::end_row() {
+    ++rows_;
+    if (spill_) {
+        spill_->end_row(rows_);
+    }
+}
+
+CellView ResultTable::at(size_t row, size_t col) const {
+    if (spill_) {
+        return spill_->seek(row) ? spill_->cells[col] : CellView();
+    }
+    const Slot& slot = columns_[col][row];
+    switch (slot.type) {
+        case CellType::Integer:
+            return CellView(slot.type, slot.i, 0.0, {});
+        case CellType::Real:
+            return CellView(slot.type, 0, slot.d, {});
+        case CellType::Text:
+        case CellType::Blob:
+            return CellView(slot.type, 0, 0.0,
+                            std::string_view(arena_.data() + slot.offset, slot.size));
+        case CellType::Null:
+            break;
+    }
+    return CellView();
+}
+
+size_t ResultTable::byte_size() const {
+    if (spill_) {
+        return spill_->file->buffered_bytes() + spill_->index.capacity() * sizeof(uint64_t) +
+               spill_->cells.capacity() * sizeof(CellView);
+    }
+    size_t total = arena_.capacity();
+    for (const auto& col : columns_) {
+        total += col.capacity() * sizeof(Slot);
+    }
+    return total;
+}
+
+bool ResultTable::spill(std::string* error) {
+    if (spill_) {
+        return true;
+    }
+    std::string why;
+    auto state = std::make_shared<SpillState>();
+    state->file = SpillFile::create(why);
+    if (!state->file) {
+        if (error) *error = why;
+        return false;
+    }
+    state->column_count = columns_.size();
+    state->index.push_back(0);
+
+    for (size_t row = 0; row < rows_; ++row) {
+        for (size_t col = 0; col < columns_.size(); ++col) {
+            const CellView cell = at(row, col);
+            state->write_cell(cell.type(), cell.as_int64(), cell.as_double(), cell.bytes());
+        }
+        state->end_row(row + 1);
+    }
+    if (!state->file->error().empty()) {
+        if (error) *error = state->file->error();
+        return false;
+    }
+
+    // Release the in-memory copy; column_count() keeps working.
+    const size_t column_count = columns_.size();
+    std::vector<std::vector<Slot>>(column_count).swap(columns_);
+    std::string().swap(arena_);
+    spill_ = std::move(state);
+    return true;
+}
+
+// ============================================================================
+// RowView / QueryResult
+// ============================================================================
+
+std::vector<std::string> RowView::values() const {
+    std::vector<std::string> out;
+    out.reserve(size());
+    for (size_t i = 0; i < size(); ++i) {
+        out.push_back(cell(i).to_string());
+    }
+    return out;
+}
+
+void QueryResult::add_text_row(const std::vector<std::string>& values) {
+    if (table.column_count() != columns.size()) {
+        table.reset(columns.size());
+    }
+    for (size_t i = 0; i < columns.size(); ++i) {
+        if (i < values.size()) {
+            table.append_text(i, values[i]);
+        } else {
+            table.append_null(i);
+        }
+    }
+    table.end_row();
+}
+
+std::string QueryResult::to_string() const {
+    if (!success) return error;
+    if (empty()) return "(0 rows)";
+
+    std::string result;
+    // Header
+    for (size_t i = 0; i < columns.size(); ++i) {
+        if (i > 0) result += " | ";
+        result += columns[i];
+    }
+    result += "\n";
+    // Separator
+    for (size_t i = 0; i < columns.size(); ++i) {
+        if (i > 0) result += "-+-";
+        result += std::string(columns[i].size(), '-');
+    }
+    result += "\n";
+    // Rows
+    for (const auto& row : *this) {
+        for (size_t i = 0; i < row.size(); ++i) {
+            if (i > 0) result += " | ";
+            row.cell(i).append_to(result);
+        }
+        result += "\n";
+    }
+    result += "(" + std::to_string(row_count()) + " rows)";
+    if (!warnings.empty()) {
+        result += "\nWarnings:";
+        for (const auto& warning : warnings) {
+            result += "\n  - " + warning;
+        }
+    }
+    if (timed_out) {
+        result += "\n(timed out after " + std::to_string(elapsed_ms) + " ms)";
+    }
+    return result;
+}
+
+} // namespace idasql
@@ -0,0 +1,359 @@
+// Copyright (c) 2024-2026 Elias Bachaalany
+// SPDX-License-Identifier: MPL-2.0
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#include <idasql/result_cache.hpp>
+#include <idasql/runtime_settings.hpp>
+#include <idasql/vtable_stats.hpp>
+
+#include "statement_cache.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cctype>
+#include <unordered_set>
+
+namespace idasql {
+
+namespace {
+
+std::atomic<uint64_t> g_idb_epoch{1};
+
+// Bookkeeping charged per entry on top of key and body.
+constexpr size_t kEntryOverhead = 128;
+
+// Names that make a text uncacheable: state that changes without an IDB
+// event, functions whose effects the hooks do not see, and write verbs
+// that can follow a WITH clause.
+const std::unordered_set<std::string>& uncacheable_words() {
+    static const std::unordered_set<std::string> words = {
+        "random", "randomblob", "changes", "total_changes", "last_insert_rowid",
+        "current_date", "current_time", "current_timestamp",
+        "idasql_stats", "breakpoints", "get_ui_context_json",
+        "idapython_snippet", "idapython_file", "load_file_bytes", "save_database",
+        "gen_cfg_dot_file", "rebuild_strings", "make_code", "make_code_range", "parse_decls",
+        "set_numform", "set_numform_ea_arg", "set_numform_ea_expr", "set_numform_item",
+        "set_union_selection", "set_union_selection_ea_arg", "set_union_selection_ea_expr",
+        "set_union_selection_item",
+        "insert", "update", "delete", "replace",
+    };
+    return words;
+}
+
+std::string lower(std::string_view text) {
+    std::string out(text);
+    for (char& c : out) {
+        c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    }
+    return out;
+}
+
+bool is_word_char(char c) {
+    return std::isalnum(static_cast<unsigned char>(c)) || c == '_' || c == '$';
+}
+
+// Every statement starts with SELECT, WITH or VALUES and nothing in the
+// text is uncacheable. Comments are skipped; quoted identifiers count as
+// names, string literals only matter when they are 'now'.
+bool is_cacheable_sql(std::string_view sql) {
+    bool statement_start = true;
+    bool any = false;
+    size_t i = 0;
+    while (i < sql.size()) {
+        const char c = sql[i];
+        if (std::isspace(static_cast<unsigned char>(c))) {
+            ++i;
+            continue;
+        }
+        if (c == '-' && i + 1 < sql.size() && sql[i + 1] == '-') {
+            const size_t end = sql.find('\n', i);
+            i = end == std::string_view::npos ? sql.size() : end + 1;
+            continue;
+        }
+        if (c == '/' && i + 1 < sql.size() && sql[i + 1] == '*') {
+            const size_t end = sql.find("*/", i + 2);
+            i = end == std::string_view::npos ? sql.size() : end + 2;
+            continue;
+        }
+        if (c == ';') {
+            statement_start = true;
+            ++i;
+            continue;
+        }
+
+        std::string_view word;
+        if (c == '\'' || c == '"' || c == '`' || c == '[') {
+            const char close = c == '[' ? ']' : c;
+            size_t end = i + 1;
+            for (;;) {
+                end = sql.find(close, end);
+                if (end == std::string_view::npos) {
+                    return false;  // unterminated; let SQLite report it
+                }
+                if (close != ']' && end + 1 < sql.size() && sql[end + 1] == close) {
+                    end += 2;  // doubled quote
+                    continue;
+                }
+                break;
+            }
+            word = sql.substr(i + 1, end - i - 1);
+            i = end + 1;
+            if (c == '\'') {
+                if (statement_start || lower(word) == "now") {
+                    return false;
+                }
+                continue;
+            }
+        } else if (is_word_char(c)) {
+            size_t end = i;
+            while (end < sql.size() && is_word_char(sql[end])) ++end;
+            word = sql.substr(i, end - i);
+            i = end;
+        } else {
+            if (statement_start) {
+                return false;
+            }
+            ++i;
+            continue;
+        }
+
+        const std::string name = lower(word);
+        if (statement_start) {
+            if (name != "select" && name != "with" && name != "values") {
+                return false;
+            }
+            statement_start = false;
+            any = true;
+        }
+        if (uncacheable_words().count(name) != 0) {
+            return false;
+        }
+    }
+    return any;
+}
+
+void append_param(std::string& out, const SqlValue& value) {
+    out.push_back(static_cast<char>('0' + static_cast<int>(value.type())));
+    switch (value.type()) {
+        case CellType::Integer: {
+            const int64_t v = value.int64();
+            out.append(reinterpret_cast<const char*>(&v), sizeof(v));
+            break;
+        }
+        case CellType::Real: {
+            const double v = value.real();
+            out.append(reinterpret_cast<const char*>(&v), sizeof(v));
+            break;
+        }
+        case CellType::Text:
+        case CellType::Blob: {
+            const uint64_t size = value.bytes().size();
+            out.append(reinterpret_cast<const char*>(&size), sizeof(size));
+            out += value.bytes();
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+} // namespace
+
+uint64_t idb_epoch() {
+    return g_idb_epoch.load(std::memory_order_acquire);
+}
+
+void bump_idb_epoch() {
+    g_idb_epoch.fetch_add(1, std::memory_order_acq_rel);
+}
+
+std::string result_cache_key(std::string_view variant, const std::string& sql,
+                             const QueryParams& params) {
+    if (!is_cacheable_sql(sql)) {
+        return {};
+    }
+    std::string key(variant);
+    key.push_back('\0');
+    key += StatementCache::normalize(sql);
+    key.push_back('\0');
+    for (const SqlValue& value : params) {
+        append_param(key, value);
+    }
+    return key;
+}
+
+// ============================================================================
+// ResultCache
+// ============================================================================
+
+ResultCache& ResultCache::instance() {
+    static ResultCache cache;
+    return cache;
+}
+
+std::shared_ptr<const std::string> ResultCache::find(const std::string& key) {
+    if (key.empty()) {
+        return nullptr;
+    }
+    const size_t capacity = runtime_settings().result_cache_mb() * 1024 * 1024;
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (capacity == 0) {
+        trim_to(0);
+        return nullptr;
+    }
+    drop_stale();
+    auto it = index_.find(key);
+    if (it == index_.end()) {
+        ++misses_;
+        engine_stats().result_cache_misses.fetch_add(1, std::memory_order_relaxed);
+        return nullptr;
+    }
+    ++hits_;
+    engine_stats().result_cache_hits.fetch_add(1, std::memory_order_relaxed);
+    lru_.splice(lru_.begin(), lru_, it->second);
+    return it->second->body;
+}
+
+void ResultCache::store(const std::string& key, uint64_t epoch, std::string body) {
+    if (!key.empty()) {
+        store(key, epoch, std::make_shared<const std::string>(std::move(body)));
+    }
+}
+
+void ResultCache::store(const std::string& key, uint64_t epoch,
+                        std::shared_ptr<const std::string> body) {
+    if (key.empty() || !body) {
+        return;
+    }
+    const size_t capacity = runtime_settings().result_cache_mb() * 1024 * 1024;
+    const size_t bytes = key.size() + body->size() + kEntryOverhead;
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (capacity == 0 || bytes > capacity / 8) {
+        trim_to(capacity);
+        return;
+    }
+    drop_stale();
+    if (epoch != epoch_ || index_.count(key) != 0) {
+        return;  // computed across a change, or a concurrent run got there first
+    }
+    lru_.push_front(Entry{key, std::move(body), bytes});
+    index_[key] = lru_.begin();
+    bytes_ += bytes;
+    trim_to(capacity);
+}
+
+void ResultCache::clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    trim_to(0);
+}
+
+ResultCacheStats ResultCache::stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ResultCacheStats out;
+    // Entries of an older epoch are dropped on the next lookup.
+    const bool stale = epoch_ != idb_epoch();
+    out.entries = stale ? 0 : lru_.size();
+    out.bytes = stale ? 0 : bytes_;
+    out.capacity_bytes = runtime_settings().result_cache_mb() * 1024 * 1024;
+    out.hits = hits_;
+    out.misses = misses_;
+    return out;
+}
+
+void ResultCache::drop_stale() {
+    const uint64_t now = idb_epoch();
+    if (now != epoch_) {
+        trim_to(0);
+        epoch_ = now;
+    }
+}
+
+void ResultCache::trim_to(size_t capacity) {
+    while (bytes_ > capacity && !lru_.empty()) {
+        Entry& victim = lru_.back();
+        bytes_ -= victim.bytes;
+        index_.erase(victim.key);
+        lru_.pop_back();
+    }
+}
+
+// ============================================================================
+// SingleFlight
+// ============================================================================
+
+SingleFlight& SingleFlight::instance() {
+    static SingleFlight flights;
+    return flights;
+}
+
+FlightResult SingleFlight::run(const std::string& key, const Compute& compute,
+                               const std::function<bool()>& stop) {
+    FlightResult out;
+    if (key.empty()) {
+        out.body = compute();
+        out.led = true;
+        return out;
+    }
+
+    for (;;) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        // A run that started before a change must not serve requests after it.
+        const std::string flight_key = key + '\0' + std::to_string(idb_epoch());
+        auto it = flights_.find(flight_key);
+        if (it == flights_.end()) {
+            auto flight = std::make_shared<Flight>();
+            flights_.emplace(flight_key, flight);
+            lock.unlock();
+            std::shared_ptr<const std::string> body;
+            try {
+                body = compute();
+            } catch (...) {
+                land(flight_key, flight, nullptr);
+                throw;
+            }
+            land(flight_key, flight, body);
+            out.body = std::move(body);
+            out.led = true;
+            return out;
+        }
+
+        const std::shared_ptr<Flight> flight = it->second;
+        while (!flight->landed) {
+            if (stop && stop()) {
+                return out;
+            }
+            landed_.wait_for(lock, std::chrono::milliseconds(100));
+        }
+        if (flight->body) {
+            ++coalesced_;
+            engine_stats().queries_coalesced.fetch_add(1, std::memory_order_relaxed);
+            out.body = flight->body;
+            return out;
+        }
+        // The leader's result was not shareable: run it here.
+    }
+}
+
+uint64_t SingleFlight::coalesced() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return coalesced_;
+}
+
+void SingleFlight::land(const std::string& flight_key, const std::shared_ptr<Flight>& flight,
+                        std::shared_ptr<const std::string> body) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        flight->landed = true;
+        flight->body = std::move(body);
+        auto it = flights_.find(flight_key);
+        if (it != flights_.end() && it->second == flight) {
+            flights_.erase(it);
+        }
+    }
+    landed_.notify_all();
+}
+
+} // namespace idasql
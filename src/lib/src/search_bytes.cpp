@@ -7,6 +7,8 @@
 
 #include "search_bytes.hpp"
 
+#include <idasql/cancel.hpp>
+
 #include <algorithm>
 #include <iomanip>
 #include <limits>
@@ -27,6 +29,10 @@ constexpr int BYTE_SEARCH_START_EA = 5;
 constexpr int BYTE_SEARCH_END_EA = 6;
 constexpr int BYTE_SEARCH_MAX_RESULTS = 7;
 
+// bin_search runs one chunk at a time so a cancel or timeout takes effect
+// between chunks instead of after the whole range.
+constexpr ea_t kSearchChunkBytes = 4 * 1024 * 1024;
+
 std::string format_matched_hex(const std::vector<uchar>& bytes) {
     std::ostringstream hex;
     hex << std::hex << std::setfill('0');
@@ -99,16 +105,26 @@ public:
     bool next() override {
         if (!valid_) return false;
         if (max_results_ > 0 && emitted_ >= max_results_) return false;
-        if (next_ea_ >= end_ea_) return false;
 
-        ea_t found = bin_search(next_ea_, end_ea_, binpat_, BIN_SEARCH_FORWARD);
-        if (found == BADADDR) return false;
-
-        fill_match_result(current_, found, pattern_len_);
-        next_ea_ = saturating_next_ea(found);
-        emitted_++;
-        rowid_++;
-        return true;
+        while (next_ea_ < end_ea_) {
+            if (query_cancelled()) return false;
+
+            const ea_t chunk_end = end_ea_ - next_ea_ > kSearchChunkBytes
+                ? next_ea_ + kSearchChunkBytes : end_ea_;
+            ea_t found = bin_search(next_ea_, chunk_end, binpat_, BIN_SEARCH_FORWARD);
+            if (found != BADADDR) {
+                fill_match_result(current_, found, pattern_len_);
+                next_ea_ = saturating_next_ea(found);
+                emitted_++;
+                rowid_++;
+                return true;
+            }
+            if (chunk_end >= end_ea_) break;
+            // Overlap chunks so a match straddling the boundary is found.
+            next_ea_ = chunk_end - std::min<ea_t>(pattern_len_ - 1, kSearchChunkBytes / 2);
+        }
+        next_ea_ = end_ea_;
+        return false;
     }
 
     const ByteSearchResult& current() const override {
@@ -205,7 +221,7 @@ size_t find_byte_pattern(
 }
 
 xsql::GeneratorTableDef<ByteSearchResult> define_byte_search() {
-    return xsql::generator_table<ByteSearchResult>("byte_search")
+    return generator_table<ByteSearchResult>("byte_search")
         .column_int64("address", [](const ByteSearchResult& row) {
             return static_cast<int64_t>(row.address);
         })
@@ -206,12 +206,34 @@ void Session::close() {
 }
 
 QueryResult Session::query(const char* sql) {
+    return query(sql, QueryParams{});
+}
+
+QueryResult Session::query(const char* sql, const QueryParams& params) {
     if (!engine_) {
         QueryResult r;
         r.error = "Session not open";
         return r;
     }
-    return engine_->query(sql);
+    return engine_->query(sql, params);
+}
+
+QueryCursor Session::open_cursor(const char* sql, const QueryParams& params) {
+    if (!engine_) {
+        QueryResult r;
+        r.error = "Session not open";
+        return QueryCursor(std::move(r));
+    }
+    return engine_->open_cursor(sql, params);
+}
+
+StreamSummary Session::for_each(const char* sql, const QueryParams& params, const RowCallback& on_row) {
+    if (!engine_) {
+        StreamSummary s;
+        s.error = "Session not open";
+        return s;
+    }
+    return engine_->for_each(sql, params, on_row);
 }
 
 xsql::Status Session::exec(const char* sql) {
@@ -234,12 +256,13 @@ bool Session::execute_script(const std::string& script,
 
 bool Session::export_tables(const std::vector<std::string>& tables,
                              const std::string& output_path,
-                             std::string& error) {
+                             std::string& error,
+                             ExportFormat format) {
     if (!engine_) {
         error = "Session not open";
         return false;
     }
-    return engine_->export_tables(tables, output_path, error);
+    return engine_->export_tables(tables, output_path, error, format);
 }
 
 std::string Session::scalar(const char* sql) {
@@ -0,0 +1,640 @@
+// Copyright (c) 2024-2026 Elias Bachaalany
+// SPDX-License-Identifier: MPL-2.0
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#include <idasql/snapshot.hpp>
+#include <idasql/cancel.hpp>
+#include <idasql/query_cursor.hpp>
+#include <idasql/runtime_settings.hpp>
+#include <idasql/string_utils.hpp>
+#include <idasql/trace.hpp>
+
+#include "statement_cache.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <utility>
+
+#include <sqlite3.h>
+
+namespace idasql {
+
+namespace {
+
+using steady_clock = std::chrono::steady_clock;
+
+// Schema name the snapshot file is attached under while it is built.
+constexpr const char* kSnapshotSchema = "idasql_snapshot";
+
+// Most connections a pool opens when asked for "one per core".
+constexpr size_t kMaxDefaultWorkers = 8;
+
+// Columns indexed in the snapshot, when the table has them.
+struct SnapshotIndex {
+    const char* table;
+    const char* column;
+};
+
+constexpr SnapshotIndex kSnapshotIndexes[] = {
+    {"funcs", "address"},
+    {"names", "address"},
+    {"names", "name"},
+    {"segments", "start_ea"},
+    {"xrefs", "from_ea"},
+    {"xrefs", "to_ea"},
+    {"xrefs", "from_func"},
+    {"instructions", "address"},
+    {"instructions", "func_addr"},
+    {"strings", "address"},
+    {"types", "ordinal"},
+    {"types", "name"},
+    {"blocks", "func_ea"},
+    {"blocks", "start_ea"},
+    {"pseudocode", "func_addr"},
+};
+
+int ms_since(steady_clock::time_point start) {
+    return static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(
+        steady_clock::now() - start).count());
+}
+
+
+bool exec_sql(sqlite3* db, const std::string& sql, std::string& error) {
+    char* message = nullptr;
+    if (sqlite3_exec(db, sql.c_str(), nullptr, nullptr, &message) == SQLITE_OK) {
+        return true;
+    }
+    error = message ? message : sqlite3_errmsg(db);
+    sqlite3_free(message);
+    return false;
+}
+
+// Run sql with text bindings; true if it produced a row (first column in
+// *value when given).
+bool query_row(sqlite3* db, const std::string& sql, const std::vector<std::string>& binds,
+               int64_t* value, std::string& error) {
+    sqlite3_stmt* stmt = nullptr;
+    if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK) {
+        error = sqlite3_errmsg(db);
+        return false;
+    }
+    for (size_t i = 0; i < binds.size(); ++i) {
+        sqlite3_bind_text(stmt, static_cast<int>(i + 1), binds[i].c_str(), -1, SQLITE_TRANSIENT);
+    }
+    const int rc = sqlite3_step(stmt);
+    if (rc == SQLITE_ROW && value) {
+        *value = sqlite3_column_int64(stmt, 0);
+    } else if (rc != SQLITE_ROW && rc != SQLITE_DONE) {
+        error = sqlite3_errmsg(db);
+    }
+    sqlite3_finalize(stmt);
+    return rc == SQLITE_ROW;
+}
+
+bool export_cancelled() {
+    const CancelTokenPtr token = current_cancel_token();
+    return token && (token->tripped() || token->expired());
+}
+
+void remove_file_set(const std::string& path) {
+    std::error_code ec;
+    std::filesystem::remove(path, ec);
+    std::filesystem::remove(path + "-wal", ec);
+    std::filesystem::remove(path + "-shm", ec);
+    std::filesystem::remove(path + "-journal", ec);
+}
+
+// Fill the attached snapshot schema inside the caller's transaction.
+bool copy_tables(sqlite3* db, const std::vector<std::string>& tables,
+                 SnapshotReport& report, std::string& error) {
+    const std::string schema = kSnapshotSchema;
+    std::vector<std::string> exported;
+    for (const auto& table : tables) {
+        if (!query_row(db,
+                       "SELECT 1 FROM main.sqlite_master "
+                       "WHERE name = ?1 AND type IN ('table', 'view')",
+                       {table}, nullptr, error)) {
+            if (!error.empty()) return false;
+            continue;  // not registered in this session
+        }
+
+        const auto start = steady_clock::now();
+        TraceSpan span("snapshot", table);
+        const std::string target = schema + "." + quote_sql_identifier(table);
+        if (!exec_sql(db, "CREATE TABLE " + target + " AS SELECT * FROM main." +
+                          quote_sql_identifier(table), error)) {
+            error = table + ": " + error;
+            return false;
+        }
+        if (export_cancelled()) {
+            error = "Snapshot cancelled while exporting " + table;
+            return false;
+        }
+
+        for (const auto& index : kSnapshotIndexes) {
+            if (table != index.table) continue;
+            const std::string column = index.column;
+            if (!query_row(db, "SELECT 1 FROM pragma_table_info(?1, ?2) WHERE name = ?3",
+                           {table, schema, column}, nullptr, error)) {
+                if (!error.empty()) return false;
+                continue;
+            }
+            const std::string name = quote_sql_identifier(table + "_" + column);
+            if (!exec_sql(db, "CREATE INDEX " + schema + "." + name + " ON " +
+                              quote_sql_identifier(table) + "(" + quote_sql_identifier(column) + ")", error)) {
+                return false;
+            }
+        }
+
+        SnapshotTable info;
+        info.name = table;
+        query_row(db, "SELECT count(*) FROM " + target, {}, &info.rows, error);
+        if (!error.empty()) return false;
+        info.elapsed_ms = ms_since(start);
+        span.arg("rows", info.rows);
+        report.tables.push_back(std::move(info));
+        exported.push_back(table);
+    }
+
+    std::string list;
+    for (const auto& table : exported) {
+        if (!list.empty()) list.push_back(',');
+        list += table;
+    }
+    if (!exec_sql(db, "CREATE TABLE " + schema + ".snapshot_info(key TEXT PRIMARY KEY, value)",
+                  error)) {
+        return false;
+    }
+    query_row(db, "INSERT INTO " + schema + ".snapshot_info VALUES "
+                  "('created_at', CAST(strftime('%s', 'now') AS INTEGER)), ('tables', ?1)",
+              {list}, nullptr, error);
+    return error.empty();
+}
+
+bool attach_snapshot(sqlite3* db, const std::string& file, std::string& error) {
+    // ATTACH takes an expression, so the path can be bound.
+    query_row(db, std::string("ATTACH DATABASE ?1 AS ") + kSnapshotSchema, {file}, nullptr,
+              error);
+    if (!error.empty()) {
+        error = "Cannot attach snapshot file " + file + ": " + error;
+        return false;
+    }
+    return true;
+}
+
+// Dirty keys, as temp tables the refresh statements select from.
+constexpr const char* kDirtyFunctions = "temp.idasql_dirty_functions";
+constexpr const char* kDirtyAddresses = "temp.idasql_dirty_addresses";
+constexpr const char* kDirtyTypes = "temp.idasql_dirty_types";
+
+template <typename Set>
+bool fill_dirty_table(sqlite3* db, const char* table, const Set& keys, std::string& error) {
+    if (!exec_sql(db, std::string("CREATE TEMP TABLE IF NOT EXISTS ") +
+                      (std::strchr(table, '.') + 1) + "(key INTEGER PRIMARY KEY)", error) ||
+        !exec_sql(db, std::string("DELETE FROM ") + table, error)) {
+        return false;
+    }
+    sqlite3_stmt* insert = nullptr;
+    const std::string sql = std::string("INSERT INTO ") + table + " VALUES (?1)";
+    if (sqlite3_prepare_v2(db, sql.c_str(), -1, &insert, nullptr) != SQLITE_OK) {
+        error = sqlite3_errmsg(db);
+        return false;
+    }
+    for (const auto key : keys) {
+        sqlite3_bind_int64(insert, 1, static_cast<sqlite3_int64>(key));
+        if (sqlite3_step(insert) != SQLITE_DONE) {
+            error = sqlite3_errmsg(db);
+            sqlite3_finalize(insert);
+            return false;
+        }
+        sqlite3_reset(insert);
+    }
+    sqlite3_finalize(insert);
+    return true;
+}
+
+// Which rows of a table a change touches. "$F", "$A" and "$T" stand for
+// the dirty function, address and type-ordinal key sets.
+struct RefreshRule {
+    const char* table;
+    const char* stale;                 // rows to delete
+    std::vector<const char*> fresh;    // disjoint filters to re-insert; each
+                                       // one pushes down to the live table
+};
+
+const std::vector<RefreshRule>& refresh_rules() {
+    static const std::vector<RefreshRule> rules = {
+        {"funcs", "address IN $F", {"address IN $F"}},
+        {"names", "address IN $A", {"address IN $A"}},
+        {"strings", "address IN $A", {"address IN $A"}},
+        {"instructions", "address IN $A OR func_addr IN $F",
+         {"func_addr IN $F", "address IN $A AND func_addr NOT IN $F"}},
+        {"xrefs", "from_ea IN $A OR from_func IN $F",
+         {"from_func IN $F", "from_ea IN $A AND from_func NOT IN $F"}},
+        {"blocks", "func_ea IN $F", {"func_ea IN $F"}},
+        {"pseudocode", "func_addr IN $F", {"func_addr IN $F"}},
+        {"types", "ordinal IN $T", {"ordinal IN $T"}},
+    };
+    return rules;
+}
+
+std::string expand_keys(std::string where, bool all_types) {
+    const std::pair<const char*, std::string> sets[] = {
+        {"$F", std::string("(SELECT key FROM ") + kDirtyFunctions + ")"},
+        {"$A", std::string("(SELECT key FROM ") + kDirtyAddresses + ")"},
+        {"$T", std::string("(SELECT key FROM ") + kDirtyTypes + ")"},
+    };
+    if (all_types && where == "ordinal IN $T") {
+        return "1";
+    }
+    for (const auto& [token, select] : sets) {
+        for (size_t pos; (pos = where.find(token)) != std::string::npos;) {
+            where.replace(pos, 2, select);
+        }
+    }
+    return where;
+}
+
+// `carried`: rows of dirty functions were added to $A (carry_function_rows).
+bool uses_keys(const char* where, const SnapshotChanges& changes, bool carried) {
+    const std::string text = where;
+    return (text.find("$F") != std::string::npos && !changes.functions.empty()) ||
+           (text.find("$A") != std::string::npos && (!changes.addresses.empty() || carried)) ||
+           (text.find("$T") != std::string::npos &&
+            (changes.all_types || !changes.type_ordinals.empty()));
+}
+
+bool snapshot_has_table(sqlite3* db, const std::string& table, std::string& error) {
+    return query_row(db, std::string("SELECT 1 FROM ") + kSnapshotSchema +
+                         ".sqlite_master WHERE type = 'table' AND name = ?1",
+                     {table}, nullptr, error);
+}
+
+// Address-keyed rows the snapshot attributes to a dirty function. When the
+// function was deleted or lost a chunk, the rows still exist but no longer
+// match func_addr/from_func IN $F; adding their addresses to $A re-inserts
+// them. `carried` tells whether any address was added.
+bool carry_function_rows(sqlite3* db, bool& carried, std::string& error) {
+    struct FunctionRows {
+        const char* table;
+        const char* address;
+        const char* func;
+    };
+    static const FunctionRows kFunctionRows[] = {
+        {"instructions", "address", "func_addr"},
+        {"xrefs", "from_ea", "from_func"},
+    };
+    carried = false;
+    for (const auto& rows : kFunctionRows) {
+        if (!snapshot_has_table(db, rows.table, error)) {
+            if (!error.empty()) return false;
+            continue;
+        }
+        if (!exec_sql(db, std::string("INSERT OR IGNORE INTO ") + kDirtyAddresses + " SELECT " +
+                          rows.address + " FROM " + kSnapshotSchema + "." + rows.table +
+                          " WHERE " + rows.func + " IN (SELECT key FROM " + kDirtyFunctions + ")",
+                      error)) {
+            return false;
+        }
+        carried = carried || sqlite3_changes(db) > 0;
+    }
+    return true;
+}
+
+// Rewrite one table's rows: delete `stale`, insert each `fresh` filter.
+bool rewrite_rows(sqlite3* db, const std::string& table, const std::string& stale,
+                  const std::vector<std::string>& fresh, SnapshotReport& report,
+                  std::string& error) {
+    const auto start = steady_clock::now();
+    TraceSpan span("snapshot", table);
+    const std::string target = std::string(kSnapshotSchema) + "." + quote_sql_identifier(table);
+    if (!exec_sql(db, "DELETE FROM " + target + " WHERE " + stale, error)) {
+        error = table + ": " + error;
+        return false;
+    }
+    SnapshotTable info;
+    info.name = table;
+    for (const auto& where : fresh) {
+        if (!exec_sql(db, "INSERT INTO " + target + " SELECT * FROM main." +
+                          quote_sql_identifier(table) + " WHERE " + where, error)) {
+            error = table + ": " + error;
+            return false;
+        }
+        info.rows += sqlite3_changes(db);
+    }
+    if (export_cancelled()) {
+        error = "Snapshot refresh cancelled while updating " + table;
+        return false;
+    }
+    info.elapsed_ms = ms_since(start);
+    span.arg("rows", info.rows);
+    report.tables.push_back(std::move(info));
+    return true;
+}
+
+bool refresh_tables(sqlite3* db, const SnapshotChanges& changes, SnapshotReport& report,
+                    std::string& error) {
+    if (!fill_dirty_table(db, kDirtyFunctions, changes.functions, error) ||
+        !fill_dirty_table(db, kDirtyAddresses, changes.addresses, error) ||
+        !fill_dirty_table(db, kDirtyTypes, changes.type_ordinals, error)) {
+        return false;
+    }
+    bool carried = false;
+    if (!changes.functions.empty() && !carry_function_rows(db, carried, error)) {
+        return false;
+    }
+
+    for (const auto& rule : refresh_rules()) {
+        if (!uses_keys(rule.stale, changes, carried)) continue;
+        if (!snapshot_has_table(db, rule.table, error)) {
+            if (!error.empty()) return false;
+            continue;
+        }
+        std::vector<std::string> fresh;
+        for (const char* where : rule.fresh) {
+            if (uses_keys(where, changes, carried)) {
+                fresh.push_back(expand_keys(where, changes.all_types));
+            }
+        }
+        if (!rewrite_rows(db, rule.table, expand_keys(rule.stale, changes.all_types), fresh,
+                          report, error)) {
+            return false;
+        }
+    }
+    // Segments are few; any change rewrites them all.
+    if (changes.segments && snapshot_has_table(db, "segments", error) &&
+        !rewrite_rows(db, "segments", "1", {"1"}, report, error)) {
+        return false;
+    }
+    if (!error.empty()) {
+        return false;
+    }
+
+    query_row(db, std::string("INSERT OR REPLACE INTO ") + kSnapshotSchema +
+                  ".snapshot_info VALUES ('refreshed_at', CAST(strftime('%s', 'now') AS INTEGER))",
+              {}, nullptr, error);
+    return error.empty();
+}
+
+} // namespace
+
+const std::vector<std::string>& default_snapshot_tables() {
+    static const std::vector<std::string> tables = {
+        "funcs", "names", "segments", "xrefs", "instructions",
+        "strings", "types", "blocks",
+    };
+    return tables;
+}
+
+bool export_snapshot(sqlite3* db, const std::string& path,
+                     const std::vector<std::string>& tables,
+                     SnapshotReport& report, std::string& error) {
+    if (path.empty()) {
+        error = "Snapshot path is empty";
+        return false;
+    }
+    const auto start = steady_clock::now();
+    TraceSpan span("snapshot", "export");
+    report = SnapshotReport();
+
+    // Build beside the target and swap it in at the end.
+    const std::string building = path + ".tmp";
+    remove_file_set(building);
+
+    if (!attach_snapshot(db, building, error)) {
+        return false;
+    }
+
+    const std::string schema = kSnapshotSchema;
+    // WAL lets snapshot readers keep going while the file is refreshed.
+    bool ok = exec_sql(db, "PRAGMA " + schema + ".journal_mode = WAL", error) &&
+              exec_sql(db, "BEGIN", error);
+    if (ok) {
+        ok = copy_tables(db, tables, report, error);
+        std::string ignored;
+        ok = ok ? exec_sql(db, "COMMIT", error) : (exec_sql(db, "ROLLBACK", ignored), false);
+    }
+    std::string ignored;
+    exec_sql(db, "DETACH DATABASE " + schema, ignored);
+    if (!ok) {
+        remove_file_set(building);
+        return false;
+    }
+
+    // Readers of the old file must let go before it is replaced; a stale
+    // -wal beside the target would otherwise be replayed into the new file.
+    if (snapshot_pool().path() == path) {
+        snapshot_pool().close();
+    }
+    remove_file_set(path);
+    std::error_code ec;
+    std::filesystem::rename(building, path, ec);
+    if (ec) {
+        error = "Cannot move snapshot into place at " + path + ": " + ec.message();
+        remove_file_set(building);
+        return false;
+    }
+    report.elapsed_ms = ms_since(start);
+    return true;
+}
+
+bool refresh_snapshot(sqlite3* db, const std::string& path, const SnapshotChanges& changes,
+                      SnapshotReport& report, std::string& error) {
+    report = SnapshotReport();
+    if (changes.full) {
+        error = "Too many changes to refresh row by row; export the snapshot again";
+        return false;
+    }
+    const auto start = steady_clock::now();
+    TraceSpan span("snapshot", "refresh");
+    std::error_code ec;
+    if (!std::filesystem::exists(path, ec)) {
+        error = "Snapshot file not found: " + path;
+        return false;
+    }
+    if (!attach_snapshot(db, path, error)) {
+        return false;
+    }
+
+    // One write transaction: pool readers (WAL) see the old rows until
+    // COMMIT, then all of the new ones.
+    bool ok = exec_sql(db, "BEGIN IMMEDIATE", error);
+    if (ok) {
+        ok = refresh_tables(db, changes, report, error);
+        std::string ignored;
+        ok = ok ? exec_sql(db, "COMMIT", error) : (exec_sql(db, "ROLLBACK", ignored), false);
+    }
+    std::string ignored;
+    exec_sql(db, std::string("DETACH DATABASE ") + kSnapshotSchema, ignored);
+    report.elapsed_ms = ms_since(start);
+    return ok;
+}
+
+// ============================================================================
+// SnapshotPool
+// ============================================================================
+
+struct SnapshotPool::Job {
+    std::string sql;
+    QueryParams params;
+    CancelTokenPtr cancel;
+    QueryResult result;
+    bool done = false;
+    std::mutex mutex;
+    std::condition_variable cv;
+
+    void finish() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            done = true;
+        }
+        cv.notify_one();
+    }
+};
+
+SnapshotPool& SnapshotPool::instance() {
+    static SnapshotPool pool;
+    return pool;
+}
+
+SnapshotPool::~SnapshotPool() {
+    close();
+}
+
+bool SnapshotPool::open(const std::string& path, size_t workers, std::string& error) {
+    close();
+    if (workers == 0) {
+        workers = std::min<size_t>(std::max(1u, std::thread::hardware_concurrency()),
+                                   kMaxDefaultWorkers);
+    }
+
+    // Open every connection up front so a bad path fails here, not per query.
+    std::vector<sqlite3*> connections;
+    for (size_t i = 0; i < workers; ++i) {
+        sqlite3* db = nullptr;
+        const int rc = sqlite3_open_v2(path.c_str(), &db,
+                                       SQLITE_OPEN_READONLY | SQLITE_OPEN_NOMUTEX, nullptr);
+        if (rc != SQLITE_OK) {
+            error = "Cannot open snapshot " + path + ": " +
+                (db ? sqlite3_errmsg(db) : sqlite3_errstr(rc));
+            sqlite3_close(db);
+            for (sqlite3* opened : connections) sqlite3_close(opened);
+            return false;
+        }
+        sqlite3_busy_timeout(db, 5000);
+        connections.push_back(db);
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    path_ = path;
+    stopping_ = false;
+    for (sqlite3* db : connections) {
+        threads_.emplace_back([this, db]() { run_worker(db); });
+    }
+    return true;
+}
+
+void SnapshotPool::close() {
+    std::deque<std::shared_ptr<Job>> queued;
+    std::vector<std::thread> threads;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+        std::swap(queued, jobs_);
+        std::swap(threads, threads_);
+        path_.clear();
+    }
+    cv_.notify_all();
+    for (auto& job : queued) {
+        job->result.error = "Snapshot closed";
+        job->finish();
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
+
+bool SnapshotPool::is_open() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return !threads_.empty();
+}
+
+std::string SnapshotPool::path() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return path_;
+}
+
+size_t SnapshotPool::workers() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return threads_.size();
+}
+
+QueryResult SnapshotPool::query(const std::string& sql, const QueryParams& params,
+                                const std::function<bool()>& abandon) {
+    auto job = std::make_shared<Job>();
+    job->sql = sql;
+    job->params = params;
+    // A child token, so abandoning this job leaves the caller's token alone.
+    job->cancel = abandon ? std::make_shared<CancelToken>(current_cancel_token())
+                          : current_cancel_token();
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (threads_.empty()) {
+            job->result.error = "No snapshot open (PRAGMA idasql.snapshot = 'path.db')";
+            return std::move(job->result);
+        }
+        jobs_.push_back(job);
+    }
+    cv_.notify_one();
+
+    std::unique_lock<std::mutex> lock(job->mutex);
+    if (!abandon) {
+        job->cv.wait(lock, [&job]() { return job->done; });
+        return std::move(job->result);
+    }
+    // The waiting caller polls; the worker sees the cancel through the token.
+    bool abandoned = false;
+    while (!job->cv.wait_for(lock, std::chrono::milliseconds(100),
+                             [&job]() { return job->done; })) {
+        if (!abandoned && abandon()) {
+            abandoned = true;
+            job->cancel->cancel();
+        }
+    }
+    return std::move(job->result);
+}
+
+void SnapshotPool::run_worker(sqlite3* db) {
+    {
+        // Per-connection statements; finalized before the connection closes.
+        StatementCache statements;
+        for (;;) {
+            std::shared_ptr<Job> job;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                cv_.wait(lock, [this]() { return stopping_ || !jobs_.empty(); });
+                if (stopping_) break;
+                job = jobs_.front();
+                jobs_.pop_front();
+            }
+
+            {
+                // The caller's token, so its cancel() reaches this worker.
+                CancelScope cancelling(job->cancel);
+                QueryCursor cursor(db, job->sql.c_str(), job->params,
+                                   runtime_settings().query_timeout_ms(), &statements);
+                collect_cursor(cursor, job->result);
+            }
+            job->result.success = job->result.error.empty();
+            job->finish();
+        }
+    }
+    sqlite3_close(db);
+}
+
+} // namespace idasql
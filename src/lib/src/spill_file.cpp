@@ -0,0 +1,179 @@
+// Copyright (c) 2024-2026 Elias Bachaalany
+// SPDX-License-Identifier: MPL-2.0
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#include "spill_file.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace idasql {
+
+namespace {
+
+// Appends are batched into writes of this size.
+constexpr size_t kWriteBufferBytes = 1024 * 1024;
+
+#ifndef _WIN32
+std::string errno_text(const char* what) {
+    return std::string(what) + ": " + std::strerror(errno);
+}
+#else
+std::string last_error_text(const char* what) {
+    return std::string(what) + " failed (error " + std::to_string(GetLastError()) + ")";
+}
+#endif
+
+} // namespace
+
+std::unique_ptr<SpillFile> SpillFile::create(std::string& error) {
+    std::error_code ec;
+    const std::filesystem::path dir = std::filesystem::temp_directory_path(ec);
+    if (ec) {
+        error = "No temp directory for spill file: " + ec.message();
+        return nullptr;
+    }
+
+    std::unique_ptr<SpillFile> file(new SpillFile());
+#ifdef _WIN32
+    wchar_t name[MAX_PATH];
+    if (GetTempFileNameW(dir.wstring().c_str(), L"iqs", 0, name) == 0) {
+        error = last_error_text("GetTempFileName");
+        return nullptr;
+    }
+    HANDLE handle = CreateFileW(name, GENERIC_READ | GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS,
+                                FILE_ATTRIBUTE_TEMPORARY | FILE_FLAG_DELETE_ON_CLOSE, nullptr);
+    if (handle == INVALID_HANDLE_VALUE) {
+        error = last_error_text("CreateFile");
+        DeleteFileW(name);
+        return nullptr;
+    }
+    file->file_ = handle;
+#else
+    std::string name = (dir / "idasql-spill-XXXXXX").string();
+    const int fd = mkstemp(name.data());
+    if (fd < 0) {
+        error = errno_text("mkstemp");
+        return nullptr;
+    }
+    // Anonymous from here on: the data lives until the descriptor closes.
+    unlink(name.c_str());
+    file->fd_ = fd;
+#endif
+    file->buffer_.reserve(kWriteBufferBytes);
+    return file;
+}
+
+SpillFile::~SpillFile() {
+    unmap();
+#ifdef _WIN32
+    if (file_) CloseHandle(static_cast<HANDLE>(file_));
+#else
+    if (fd_ >= 0) close(fd_);
+#endif
+}
+
+bool SpillFile::append(const void* data, size_t size) {
+    if (!error_.empty()) {
+        return false;
+    }
+    unmap();
+    if (buffer_.size() + size > kWriteBufferBytes && !flush()) {
+        return false;
+    }
+    buffer_.append(static_cast<const char*>(data), size);
+    return true;
+}
+
+bool SpillFile::flush() {
+    const char* p = buffer_.data();
+    size_t left = buffer_.size();
+    while (left > 0) {
+#ifdef _WIN32
+        DWORD chunk = 0;
+        const DWORD want = left > 0x40000000 ? 0x40000000 : static_cast<DWORD>(left);
+        if (!WriteFile(static_cast<HANDLE>(file_), p, want, &chunk, nullptr)) {
+            error_ = last_error_text("WriteFile");
+            return false;
+        }
+#else
+        const ssize_t chunk = write(fd_, p, left);
+        if (chunk < 0) {
+            if (errno == EINTR) continue;
+            error_ = errno_text("write to spill file");
+            return false;
+        }
+#endif
+        p += chunk;
+        left -= static_cast<size_t>(chunk);
+        written_ += static_cast<uint64_t>(chunk);
+    }
+    buffer_.clear();
+    return true;
+}
+
+void SpillFile::unmap() {
+    if (!view_) {
+        return;
+    }
+#ifdef _WIN32
+    UnmapViewOfFile(view_);
+    CloseHandle(static_cast<HANDLE>(mapping_));
+    mapping_ = nullptr;
+#else
+    munmap(const_cast<char*>(view_), static_cast<size_t>(view_size_));
+#endif
+    view_ = nullptr;
+    view_size_ = 0;
+}
+
+const char* SpillFile::map() {
+    if (view_) {
+        return view_;
+    }
+    if (!error_.empty() || !flush() || written_ == 0) {
+        return nullptr;
+    }
+#ifdef _WIN32
+    HANDLE mapping = CreateFileMappingW(static_cast<HANDLE>(file_), nullptr, PAGE_READONLY,
+                                        0, 0, nullptr);
+    if (!mapping) {
+        error_ = last_error_text("CreateFileMapping");
+        return nullptr;
+    }
+    void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!view) {
+        error_ = last_error_text("MapViewOfFile");
+        CloseHandle(mapping);
+        return nullptr;
+    }
+    mapping_ = mapping;
+#else
+    void* view = mmap(nullptr, static_cast<size_t>(written_), PROT_READ, MAP_SHARED, fd_, 0);
+    if (view == MAP_FAILED) {
+        error_ = errno_text("mmap spill file");
+        return nullptr;
+    }
+    // Rows are read back front to back.
+    madvise(view, static_cast<size_t>(written_), MADV_SEQUENTIAL);
+#endif
+    view_ = static_cast<const char*>(view);
+    view_size_ = written_;
+    return view_;
+}
+
+} // namespace idasql
@@ -0,0 +1,75 @@
+// Copyright (c) 2024-2026 Elias Bachaalany
+// SPDX-License-Identifier: MPL-2.0
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+/**
+ * spill_file.hpp - Temporary append-only file, read back through mmap
+ *
+ * Backs ResultTable once a result crosses PRAGMA idasql.spill_threshold_mb.
+ * Writes are buffered and appended; map() flushes and maps the whole file
+ * read-only, so readers get plain pointers and the OS pages rows in and out
+ * instead of the process holding them. The file is deleted when closed
+ * (unlinked right after creation on POSIX, FILE_FLAG_DELETE_ON_CLOSE on
+ * Windows), so a crash leaves nothing behind.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace idasql {
+
+class SpillFile {
+public:
+    // New empty file in the system temp directory; nullptr and error set on
+    // failure.
+    static std::unique_ptr<SpillFile> create(std::string& error);
+
+    ~SpillFile();
+
+    SpillFile(const SpillFile&) = delete;
+    SpillFile& operator=(const SpillFile&) = delete;
+
+    // Buffered append; invalidates pointers from map().
+    bool append(const void* data, size_t size);
+
+    // Bytes appended so far (written or buffered).
+    uint64_t size() const { return written_ + buffer_.size(); }
+
+    // Bytes held in memory (write buffer), for accounting.
+    size_t buffered_bytes() const { return buffer_.capacity(); }
+
+    // Flush and map the whole file read-only; nullptr on failure or when
+    // empty. Valid until the next append().
+    const char* map();
+
+    const std::string& error() const { return error_; }
+
+private:
+    SpillFile() = default;
+
+    bool flush();
+    void unmap();
+
+    std::string buffer_;
+    uint64_t written_ = 0;
+    std::string error_;
+
+    const char* view_ = nullptr;
+    uint64_t view_size_ = 0;
+
+#ifdef _WIN32
+    void* file_ = nullptr;     // HANDLE
+    void* mapping_ = nullptr;  // HANDLE
+#else
+    int fd_ = -1;
+#endif
+};
+
+} // namespace idasql
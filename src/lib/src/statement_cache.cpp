@@ -0,0 +1,113 @@
+// Copyright (c) 2024-2026 Elias Bachaalany
+// SPDX-License-Identifier: MPL-2.0
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#include "statement_cache.hpp"
+
+#include <idasql/runtime_settings.hpp>
+#include <idasql/vtable_stats.hpp>
+
+#include <cctype>
+
+#include <sqlite3.h>
+
+namespace idasql {
+
+StatementCache::~StatementCache() {
+    clear();
+}
+
+sqlite3_stmt* StatementCache::checkout(const std::string& key) {
+    auto it = index_.find(key);
+    if (it == index_.end()) {
+        ++misses_;
+        engine_stats().statement_cache_misses.fetch_add(1, std::memory_order_relaxed);
+        return nullptr;
+    }
+    ++hits_;
+    engine_stats().statement_cache_hits.fetch_add(1, std::memory_order_relaxed);
+    sqlite3_stmt* stmt = it->second->stmt;
+    lru_.erase(it->second);
+    index_.erase(it);
+    return stmt;
+}
+
+void StatementCache::checkin(const std::string& key, sqlite3_stmt* stmt) {
+    if (stmt == nullptr) {
+        return;
+    }
+    const size_t capacity = runtime_settings().statement_cache_size();
+    if (capacity == 0 || index_.count(key) != 0) {
+        sqlite3_finalize(stmt);
+        trim_to(capacity);
+        return;
+    }
+
+    sqlite3_reset(stmt);
+    sqlite3_clear_bindings(stmt);
+    lru_.push_front(Entry{key, stmt});
+    index_[key] = lru_.begin();
+    trim_to(capacity);
+}
+
+void StatementCache::clear() {
+    trim_to(0);
+}
+
+void StatementCache::trim_to(size_t capacity) {
+    while (lru_.size() > capacity) {
+        Entry& victim = lru_.back();
+        index_.erase(victim.key);
+        sqlite3_finalize(victim.stmt);
+        lru_.pop_back();
+    }
+}
+
+std::string StatementCache::normalize(std::string_view sql) {
+    std::string out;
+    out.reserve(sql.size());
+
+    char quote = 0;
+    bool line_comment = false;
+    bool pending_space = false;
+    for (size_t i = 0; i < sql.size(); ++i) {
+        const char c = sql[i];
+        if (quote != 0) {
+            out.push_back(c);
+            if (c == quote) quote = 0;
+            continue;
+        }
+        if (line_comment) {
+            // Keep the newline that ends a -- comment; it is significant.
+            out.push_back(c);
+            if (c == '\n') line_comment = false;
+            continue;
+        }
+        if (std::isspace(static_cast<unsigned char>(c))) {
+            pending_space = !out.empty();
+            continue;
+        }
+        if (pending_space) {
+            out.push_back(' ');
+            pending_space = false;
+        }
+        if (c == '\'' || c == '"' || c == '`') {
+            quote = c;
+        } else if (c == '[') {
+            quote = ']';
+        } else if (c == '-' && i + 1 < sql.size() && sql[i + 1] == '-') {
+            line_comment = true;
+        }
+        out.push_back(c);
+    }
+
+    while (!out.empty() && (out.back() == ';' || out.back() == ' ')) {
+        out.pop_back();
+    }
+    return out;
+}
+
+} // namespace idasql
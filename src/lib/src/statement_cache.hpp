@@ -0,0 +1,68 @@
+// Copyright (c) 2024-2026 Elias Bachaalany
+// SPDX-License-Identifier: MPL-2.0
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+/**
+ * statement_cache.hpp - LRU of prepared statements for QueryEngine
+ *
+ * Keyed by normalized SQL text (whitespace runs outside literals collapsed,
+ * trailing semicolons dropped). A cursor checks a statement out for the
+ * duration of its run and returns it reset with bindings cleared, so one
+ * statement is never shared by two live cursors.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+struct sqlite3_stmt;
+
+namespace idasql {
+
+class StatementCache {
+public:
+    StatementCache() = default;
+    ~StatementCache();
+
+    StatementCache(const StatementCache&) = delete;
+    StatementCache& operator=(const StatementCache&) = delete;
+
+    // Remove and return a cached statement, or nullptr on miss.
+    sqlite3_stmt* checkout(const std::string& key);
+
+    // Reset stmt and keep it for reuse (finalized if the cache is disabled
+    // or already holds one for key).
+    void checkin(const std::string& key, sqlite3_stmt* stmt);
+
+    // Finalize everything (schema teardown, capacity changes).
+    void clear();
+
+    size_t size() const { return lru_.size(); }
+    uint64_t hits() const { return hits_; }
+    uint64_t misses() const { return misses_; }
+
+    static std::string normalize(std::string_view sql);
+
+private:
+    struct Entry {
+        std::string key;
+        sqlite3_stmt* stmt;
+    };
+
+    void trim_to(size_t capacity);
+
+    std::list<Entry> lru_;  // most recently used first
+    std::unordered_map<std::string, std::list<Entry>::iterator> index_;
+    uint64_t hits_ = 0;
+    uint64_t misses_ = 0;
+};
+
+} // namespace idasql
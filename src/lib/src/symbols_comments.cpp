@@ -7,6 +7,8 @@
 
 #include "symbols_comments.hpp"
 
+#include <idasql/cancel.hpp>
+
 using namespace idasql::core;
 
 namespace idasql {
@@ -22,7 +24,8 @@ void collect_comment_rows(std::vector<CommentRow> &rows) {
   ea_t ea = inf_get_min_ea();
   ea_t max_ea = inf_get_max_ea();
 
-  while (ea < max_ea) {
+  CancelPoll cancelled;
+  while (ea < max_ea && !cancelled()) {
     qstring cmt;
     qstring rpt;
     bool has_cmt = get_cmt(&cmt, ea, false) > 0;
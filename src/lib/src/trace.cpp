@@ -0,0 +1,192 @@
+// Copyright (c) 2024-2026 Elias Bachaalany
+// SPDX-License-Identifier: MPL-2.0
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#include <idasql/trace.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+namespace idasql {
+
+namespace {
+
+// Past this many events new spans are dropped (and counted) so a runaway
+// trace cannot eat the process.
+constexpr size_t kMaxTraceEvents = 500000;
+
+struct TraceState {
+    std::mutex mutex;
+    std::string path;
+    std::string events;  // comma-separated JSON objects
+    size_t event_count = 0;
+    size_t dropped = 0;
+    std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+};
+
+TraceState& trace_state() {
+    static TraceState state;
+    return state;
+}
+
+void append_escaped(std::string& out, std::string_view text) {
+    out.push_back('"');
+    for (char c : text) {
+        const auto uc = static_cast<unsigned char>(c);
+        switch (c) {
+            case '"': out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\n': out += "\\n"; break;
+            case '\r': out += "\\r"; break;
+            case '\t': out += "\\t"; break;
+            default:
+                if (uc < 0x20) {
+                    char buf[8];
+                    std::snprintf(buf, sizeof(buf), "\\u%04x", uc);
+                    out += buf;
+                } else {
+                    out.push_back(c);
+                }
+        }
+    }
+    out.push_back('"');
+}
+
+uint64_t thread_tid() {
+    return static_cast<uint64_t>(std::hash<std::thread::id>{}(std::this_thread::get_id()) & 0xffff);
+}
+
+bool write_trace_file(const TraceState& state, std::string& error) {
+    FILE* f = std::fopen(state.path.c_str(), "wb");
+    if (!f) {
+        error = "Cannot open trace file: " + state.path;
+        return false;
+    }
+    std::string head = "{\"traceEvents\":[";
+    std::string tail = "],\"displayTimeUnit\":\"ms\",\"otherData\":{\"producer\":\"idasql\",\"dropped_events\":" +
+                       std::to_string(state.dropped) + "}}\n";
+    std::fwrite(head.data(), 1, head.size(), f);
+    std::fwrite(state.events.data(), 1, state.events.size(), f);
+    std::fwrite(tail.data(), 1, tail.size(), f);
+    std::fclose(f);
+    return true;
+}
+
+} // namespace
+
+bool start_trace(const std::string& path, std::string& error) {
+    TraceState& state = trace_state();
+    std::lock_guard<std::mutex> lock(state.mutex);
+    state.path = path;
+    state.events.clear();
+    state.event_count = 0;
+    state.dropped = 0;
+    state.epoch = std::chrono::steady_clock::now();
+    if (!write_trace_file(state, error)) {
+        state.path.clear();
+        detail::trace_enabled_flag().store(false, std::memory_order_relaxed);
+        return false;
+    }
+    detail::trace_enabled_flag().store(true, std::memory_order_relaxed);
+    return true;
+}
+
+void stop_trace() {
+    if (!tracing()) {
+        return;
+    }
+    flush_trace();
+    TraceState& state = trace_state();
+    std::lock_guard<std::mutex> lock(state.mutex);
+    detail::trace_enabled_flag().store(false, std::memory_order_relaxed);
+    state.path.clear();
+    state.events.clear();
+    state.event_count = 0;
+}
+
+std::string trace_path() {
+    TraceState& state = trace_state();
+    std::lock_guard<std::mutex> lock(state.mutex);
+    return state.path;
+}
+
+void flush_trace() {
+    TraceState& state = trace_state();
+    std::lock_guard<std::mutex> lock(state.mutex);
+    if (state.path.empty()) {
+        return;
+    }
+    std::string ignored;
+    write_trace_file(state, ignored);
+}
+
+int64_t trace_now_us() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - trace_state().epoch).count();
+}
+
+// ============================================================================
+// TraceSpan
+// ============================================================================
+
+void TraceSpan::arg(const char* key, std::string_view value) {
+    if (!active_) return;
+    std::string json;
+    append_escaped(json, value);
+    args_.emplace_back(key, std::move(json));
+}
+
+void TraceSpan::arg_hex(const char* key, uint64_t value) {
+    if (!active_) return;
+    char buf[32];
+    std::snprintf(buf, sizeof(buf), "\"0x%llx\"", static_cast<unsigned long long>(value));
+    args_.emplace_back(key, buf);
+}
+
+void TraceSpan::end() {
+    if (!active_) {
+        return;
+    }
+    active_ = false;
+    const int64_t dur_us = trace_now_us() - start_us_;
+
+    std::string event = "{\"name\":";
+    append_escaped(event, name_);
+    event += ",\"cat\":";
+    append_escaped(event, category_);
+    event += ",\"ph\":\"X\",\"pid\":1,\"tid\":" + std::to_string(thread_tid()) +
+             ",\"ts\":" + std::to_string(start_us_) +
+             ",\"dur\":" + std::to_string(dur_us < 0 ? 0 : dur_us);
+    if (!args_.empty()) {
+        event += ",\"args\":{";
+        for (size_t i = 0; i < args_.size(); ++i) {
+            if (i > 0) event.push_back(',');
+            append_escaped(event, args_[i].first);
+            event.push_back(':');
+            event += args_[i].second;
+        }
+        event.push_back('}');
+    }
+    event.push_back('}');
+
+    TraceState& state = trace_state();
+    std::lock_guard<std::mutex> lock(state.mutex);
+    if (state.path.empty()) {
+        return;  // tracing stopped while the span was open
+    }
+    if (state.event_count >= kMaxTraceEvents) {
+        ++state.dropped;
+        return;
+    }
+    if (state.event_count > 0) state.events.push_back(',');
+    state.events += event;
+    ++state.event_count;
+}
+
+} // namespace idasql
@@ -0,0 +1,188 @@
+// Copyright (c) 2024-2026 Elias Bachaalany
+// SPDX-License-Identifier: MPL-2.0
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#include <idasql/vtable_stats.hpp>
+
+#include <map>
+#include <mutex>
+
+namespace idasql {
+
+namespace {
+
+std::mutex& stats_mutex() {
+    static std::mutex mutex;
+    return mutex;
+}
+
+// Ordered by name so idasql_stats reads stably.
+std::map<std::string, std::unique_ptr<TableStats>>& stats_tables() {
+    static std::map<std::string, std::unique_ptr<TableStats>> tables;
+    return tables;
+}
+
+int64_t as_us(const std::atomic<uint64_t>& ns) {
+    return static_cast<int64_t>(ns.load(std::memory_order_relaxed) / 1000);
+}
+
+int64_t as_value(const std::atomic<uint64_t>& v) {
+    return static_cast<int64_t>(v.load(std::memory_order_relaxed));
+}
+
+void add_sample(std::vector<StatSample>& out, const std::string& scope,
+                const std::string& column, const char* counter, int64_t value) {
+    out.push_back(StatSample{scope, column, counter, value});
+}
+
+void add_timed(std::vector<StatSample>& out, const std::string& scope,
+               const std::string& column, const char* calls_counter,
+               const char* us_counter, const StatCounter& counter) {
+    add_sample(out, scope, column, calls_counter, as_value(counter.calls));
+    add_sample(out, scope, column, us_counter, as_us(counter.ns));
+}
+
+} // namespace
+
+// ============================================================================
+// TableStats
+// ============================================================================
+
+ColumnStats& TableStats::column(const char* column_name) {
+    const std::string key = column_name ? column_name : "";
+    std::lock_guard<std::mutex> lock(stats_mutex());
+    for (auto& existing : columns) {
+        if (existing->name == key) {
+            return *existing;
+        }
+    }
+    columns.push_back(std::make_unique<ColumnStats>());
+    columns.back()->name = key;
+    return *columns.back();
+}
+
+ColumnStats* TableStats::column_at(int index) {
+    if (index < 0 || static_cast<size_t>(index) >= columns.size()) {
+        return nullptr;
+    }
+    return columns[static_cast<size_t>(index)].get();
+}
+
+void TableStats::reset() {
+    filter_calls.store(0, std::memory_order_relaxed);
+    rows.store(0, std::memory_order_relaxed);
+    cache_build.reset();
+    next.reset();
+    cache_bytes.store(0, std::memory_order_relaxed);
+    cache_bytes_max.store(0, std::memory_order_relaxed);
+    for (auto& column : columns) {
+        column->getter.reset();
+    }
+}
+
+void EngineStats::reset() {
+    decompile.reset();
+    decompile_cache_hits.store(0, std::memory_order_relaxed);
+    decompile_cache_misses.store(0, std::memory_order_relaxed);
+    flowchart.reset();
+    sqlite.reset();
+    statement_cache_hits.store(0, std::memory_order_relaxed);
+    statement_cache_misses.store(0, std::memory_order_relaxed);
+    result_cache_hits.store(0, std::memory_order_relaxed);
+    result_cache_misses.store(0, std::memory_order_relaxed);
+    queries_coalesced.store(0, std::memory_order_relaxed);
+    query_bytes_max.store(0, std::memory_order_relaxed);
+    memory_limit_hits.store(0, std::memory_order_relaxed);
+    rows_returned.store(0, std::memory_order_relaxed);
+    query_timeouts.store(0, std::memory_order_relaxed);
+}
+
+// ============================================================================
+// Registry
+// ============================================================================
+
+TableStats& table_stats(const std::string& name) {
+    std::lock_guard<std::mutex> lock(stats_mutex());
+    auto& slot = stats_tables()[name];
+    if (!slot) {
+        slot = std::make_unique<TableStats>();
+        slot->name = name;
+    }
+    return *slot;
+}
+
+TableStats* find_table_stats(const std::string& name) {
+    std::lock_guard<std::mutex> lock(stats_mutex());
+    auto it = stats_tables().find(name);
+    return it == stats_tables().end() ? nullptr : it->second.get();
+}
+
+EngineStats& engine_stats() {
+    static EngineStats stats;
+    return stats;
+}
+
+void reset_stats() {
+    {
+        std::lock_guard<std::mutex> lock(stats_mutex());
+        for (auto& [name, table] : stats_tables()) {
+            table->reset();
+        }
+    }
+    engine_stats().reset();
+}
+
+std::vector<StatSample> collect_stats() {
+    std::vector<StatSample> out;
+    const EngineStats& engine = engine_stats();
+
+    add_timed(out, "sqlite", "", "calls", "us", engine.sqlite);
+    add_sample(out, "statement_cache", "", "hits", as_value(engine.statement_cache_hits));
+    add_sample(out, "statement_cache", "", "misses", as_value(engine.statement_cache_misses));
+    add_sample(out, "result_cache", "", "hits", as_value(engine.result_cache_hits));
+    add_sample(out, "result_cache", "", "misses", as_value(engine.result_cache_misses));
+    add_sample(out, "result_cache", "", "coalesced", as_value(engine.queries_coalesced));
+    add_timed(out, "hexrays", "", "decompile_calls", "decompile_us", engine.decompile);
+    add_sample(out, "hexrays", "", "cache_hits", as_value(engine.decompile_cache_hits));
+    add_sample(out, "hexrays", "", "cache_misses", as_value(engine.decompile_cache_misses));
+    add_timed(out, "flowchart", "", "builds", "build_us", engine.flowchart);
+    add_sample(out, "memory", "", "query_bytes_max", as_value(engine.query_bytes_max));
+    add_sample(out, "memory", "", "limit_hits", as_value(engine.memory_limit_hits));
+    add_sample(out, "queries", "", "rows_returned", as_value(engine.rows_returned));
+    add_sample(out, "queries", "", "timeouts", as_value(engine.query_timeouts));
+
+    std::lock_guard<std::mutex> lock(stats_mutex());
+    for (const auto& [name, table] : stats_tables()) {
+        // Untouched tables would only be noise.
+        bool touched = table->filter_calls.load(std::memory_order_relaxed) != 0 ||
+                       table->cache_build.calls.load(std::memory_order_relaxed) != 0 ||
+                       table->next.calls.load(std::memory_order_relaxed) != 0;
+        for (const auto& column : table->columns) {
+            touched = touched || column->getter.calls.load(std::memory_order_relaxed) != 0;
+        }
+        if (!touched) {
+            continue;
+        }
+
+        add_sample(out, name, "", "filter_calls", as_value(table->filter_calls));
+        add_sample(out, name, "", "rows", as_value(table->rows));
+        add_timed(out, name, "", "cache_builds", "cache_build_us", table->cache_build);
+        if (table->cache_build.calls.load(std::memory_order_relaxed) != 0) {
+            add_sample(out, name, "", "cache_bytes", as_value(table->cache_bytes));
+            add_sample(out, name, "", "cache_bytes_max", as_value(table->cache_bytes_max));
+        }
+        add_timed(out, name, "", "next_calls", "next_us", table->next);
+        for (const auto& column : table->columns) {
+            if (column->getter.calls.load(std::memory_order_relaxed) == 0) {
+                continue;
+            }
+            add_timed(out, name, column->name, "calls", "us", column->getter);
+        }
+    }
+    return out;
+}
+
+} // namespace idasql
@@ -7,6 +7,8 @@
 
 #include "xrefs.hpp"
 
+#include <idasql/cancel.hpp>
+
 using namespace idasql::core;
 
 namespace idasql {
@@ -216,7 +218,7 @@ CachedTableDef<XrefInfo> define_xrefs() {
       // Cache builder (called lazily, only if pushdown doesn't handle query)
       .cache_builder([](std::vector<XrefInfo> &cache) {
         size_t func_qty = get_func_qty();
-        for (size_t i = 0; i < func_qty; i++) {
+        for (size_t i = 0; i < func_qty && !query_cancelled(); i++) {
           func_t *func = getn_func(i);
           if (!func)
             continue;
@@ -287,7 +289,7 @@ CachedTableDef<DataRefInfo> define_data_refs() {
       .estimate_rows([]() -> size_t { return get_func_qty() * 4; })
       .cache_builder([](std::vector<DataRefInfo> &cache) {
         size_t func_qty = get_func_qty();
-        for (size_t i = 0; i < func_qty; i++) {
+        for (size_t i = 0; i < func_qty && !query_cancelled(); i++) {
           func_t *func = getn_func(i);
           if (!func)
             continue;
@@ -88,6 +88,7 @@
 #include "../common/http_server.hpp"
 #include "../common/json_utils.hpp"
 #include "../common/sql_script.hpp"
+#include <idasql/runtime_settings.hpp>
 #include <xsql/query_script.hpp>
 
 //=============================================================================
@@ -109,34 +110,74 @@ struct query_request_t : public exec_request_t
 {
     idasql::QueryEngine* engine;
     std::string sql;
+    const idasql::QueryParams& params;
     idasql::QueryResult result;
 
-    query_request_t(idasql::QueryEngine* e, const std::string& s)
-        : engine(e), sql(s) {}
+    query_request_t(idasql::QueryEngine* e, const std::string& s,
+                    const idasql::QueryParams& p)
+        : engine(e), sql(s), params(p) {}
 
     virtual ssize_t idaapi execute() override
     {
         batch_guard_t bg;
-        result = engine->query(sql);
+        result = engine->query(sql, params);
         return result.success ? 0 : -1;
     }
 };
 
+struct query_stream_request_t : public exec_request_t
+{
+    idasql::QueryEngine* engine;
+    std::string sql;
+    const idasql::QueryParams& params;
+    const idasql::RowCallback& on_row;
+    idasql::StreamSummary summary;
+
+    query_stream_request_t(idasql::QueryEngine* e, const std::string& s,
+                           const idasql::QueryParams& p, const idasql::RowCallback& cb)
+        : engine(e), sql(s), params(p), on_row(cb) {}
+
+    virtual ssize_t idaapi execute() override
+    {
+        batch_guard_t bg;
+        summary = engine->for_each(sql.c_str(), params, on_row);
+        return summary.success ? 0 : -1;
+    }
+};
+
+// Server-side cursor work (open, next page, close), idasql_batch calls and
+// script slices on the main thread.
+struct cursor_request_t : public exec_request_t
+{
+    const std::function<void()>& work;
+
+    explicit cursor_request_t(const std::function<void()>& w) : work(w) {}
+
+    virtual ssize_t idaapi execute() override
+    {
+        batch_guard_t bg;
+        work();
+        return 0;
+    }
+};
+
 struct query_script_request_t : public exec_request_t
 {
     idasql::QueryEngine* engine;
     std::string sql;
+    const idasql::QueryParams& params;
     xsql::ScriptResult result;
 
-    query_script_request_t(idasql::QueryEngine* e, const std::string& s)
-        : engine(e), sql(s) {}
+    query_script_request_t(idasql::QueryEngine* e, const std::string& s,
+                           const idasql::QueryParams& p)
+        : engine(e), sql(s), params(p) {}
 
     virtual ssize_t idaapi execute() override
     {
         batch_guard_t bg;
         result = idasql::run_sql_script(
             sql,
-            [this](const std::string& stmt) { return engine->query(stmt); });
+            [this](const std::string& stmt) { return engine->query(stmt, params); });
         return result.success ? 0 : -1;
     }
 };
@@ -163,7 +204,8 @@ struct idasql_plugmod_t : public plugmod_t
 
     idasql::IDAHTTPServer http_server_;
 
-    idasql::QueryResult run_query_sync(const std::string& sql)
+    xsql::ScriptResult run_query_script_sync(const std::string& sql,
+                                             const idasql::QueryParams& params = {})
     {
         std::lock_guard<std::mutex> exec_lock(query_exec_mutex_);
 
@@ -173,7 +215,7 @@ struct idasql_plugmod_t : public plugmod_t
             active_query_started_ = std::chrono::steady_clock::now();
         }
 
-        query_request_t req(engine_.get(), sql);
+        query_script_request_t req(engine_.get(), sql, params);
         execute_sync(req, MFF_WRITE);
 
         {
@@ -185,7 +227,12 @@ struct idasql_plugmod_t : public plugmod_t
         return req.result;
     }
 
-    xsql::ScriptResult run_query_script_sync(const std::string& sql)
+    // Typed script for the servers: statements run back to back on the main
+    // thread, one execute_sync per PRAGMA idasql.script_slice_ms slice, and
+    // IDA serves UI events between slices.
+    idasql::TypedScriptResult run_typed_script_sync(const std::string& sql,
+                                                    const idasql::QueryParams& params,
+                                                    bool continue_on_error = false)
     {
         std::lock_guard<std::mutex> exec_lock(query_exec_mutex_);
 
@@ -195,8 +242,17 @@ struct idasql_plugmod_t : public plugmod_t
             active_query_started_ = std::chrono::steady_clock::now();
         }
 
-        query_script_request_t req(engine_.get(), sql);
-        execute_sync(req, MFF_WRITE);
+        idasql::TypedScriptResult script = idasql::run_typed_script_sliced(
+            sql, params,
+            [this](const std::string& stmt, const idasql::QueryParams& p) {
+                return engine_->query(stmt, p);
+            },
+            [](const std::function<void()>& work) {
+                cursor_request_t req(work);
+                execute_sync(req, MFF_WRITE);
+            },
+            idasql::runtime_settings().script_slice_ms(),
+            continue_on_error);
 
         {
             std::lock_guard<std::mutex> lock(query_meta_mutex_);
@@ -204,7 +260,7 @@ struct idasql_plugmod_t : public plugmod_t
             active_query_started_ = std::chrono::steady_clock::time_point{};
         }
 
-        return req.result;
+        return script;
     }
 
     idasql_plugmod_t()
@@ -326,12 +382,37 @@ struct idasql_plugmod_t : public plugmod_t
             }
         }
 
-        // SQL executor that uses execute_sync for thread safety
-        auto sql_executor = [this](const std::string& sql) -> std::string {
-            xsql::ScriptResult result = run_query_script_sync(sql);
-            return xsql::script_result_to_text(result);
+        // SQL executor that uses execute_sync for thread safety; the
+        // script runs in time slices, not one hop per statement.
+        auto sql_executor = [this](const std::string& sql,
+                                   const idasql::QueryParams& params) -> std::string {
+            return idasql::format_typed_script_json(run_typed_script_sync(sql, params));
         };
 
+        // page_size cursors: opened and stepped on the main thread.
+        mcp_server_.set_cursor_executor(
+            [this](const std::string& sql, const idasql::QueryParams& params) {
+                return engine_->open_cursor(sql, params);
+            },
+            [](const std::function<void()>& work) {
+                cursor_request_t req(work);
+                execute_sync(req, MFF_WRITE);
+            });
+
+        // idasql_batch: every statement of a call in one execute_sync.
+        mcp_server_.set_batch_executor(
+            [this](const std::string& sql, const idasql::QueryParams& params) -> std::string {
+                auto script = idasql::run_typed_script(sql, params,
+                    [this](const std::string& stmt, const idasql::QueryParams& p) {
+                        return engine_->query(stmt, p);
+                    });
+                return idasql::format_typed_script_json(script);
+            },
+            [](const std::function<void()>& work) {
+                cursor_request_t req(work);
+                execute_sync(req, MFF_WRITE);
+            });
+
         // Start MCP server
         int port = mcp_server_.start(req_port, sql_executor, addr);
         if (port <= 0) {
@@ -359,24 +440,51 @@ struct idasql_plugmod_t : public plugmod_t
         }
 
         // Single-statement executor: each statement runs on IDA's main thread
-        // via execute_sync (Hex-Rays thread affinity). The thinclient owns
-        // multi-statement orchestration, options, and formatting; non-queue +
-        // serialize_requests keeps requests one-at-a-time.
+        // via execute_sync (Hex-Rays thread affinity). The server owns
+        // multi-statement orchestration, options, and formatting; non-queue
+        // mode keeps requests one-at-a-time.
         idasql::HTTPStatementExecutor sql_exec =
-            [this](const std::string& stmt, xsql::ScriptStatementResult& out) {
-                query_request_t req(engine_.get(), stmt);
+            [this](const std::string& stmt, const idasql::QueryParams& params) {
+                query_request_t req(engine_.get(), stmt, params);
                 execute_sync(req, MFF_WRITE);
-                const idasql::QueryResult& r = req.result;
-                out.columns = r.columns;
-                out.rows.reserve(r.rows.size());
-                for (const auto& row : r.rows) out.rows.push_back(row.values);
-                out.elapsed_ms = static_cast<double>(r.elapsed_ms);
-                out.success = r.success;
-                out.error = r.error;
+                return std::move(req.result);
             };
 
-        // Start HTTP server, no queue (plugin mode; execute_sync marshals each
-        // statement to the main thread).
+        // Buffered scripts: as many statements per execute_sync as fit in
+        // PRAGMA idasql.script_slice_ms.
+        http_server_.set_script_executor(
+            [this](const std::string& stmt, const idasql::QueryParams& params) {
+                return engine_->query(stmt, params);
+            },
+            [](const std::function<void()>& work) {
+                cursor_request_t req(work);
+                execute_sync(req, MFF_WRITE);
+            });
+
+        // stream=1 without a cursor executor: rows are written to the socket
+        // from the main thread as the cursor produces them. The cursor
+        // executor below takes precedence and keeps socket writes off it.
+        http_server_.set_stream_executor(
+            [this](const std::string& stmt, const idasql::QueryParams& params,
+                   const idasql::RowCallback& on_row) {
+                query_stream_request_t req(engine_.get(), stmt, params, on_row);
+                execute_sync(req, MFF_WRITE);
+                return std::move(req.summary);
+            });
+
+        // page_size cursors: opened and stepped on the main thread, one
+        // execute_sync per page.
+        http_server_.set_cursor_executor(
+            [this](const std::string& sql, const idasql::QueryParams& params) {
+                return engine_->open_cursor(sql, params);
+            },
+            [](const std::function<void()>& work) {
+                cursor_request_t req(work);
+                execute_sync(req, MFF_WRITE);
+            });
+
+        // Start HTTP server, no queue (plugin mode; execute_sync marshals
+        // statements and script slices to the main thread).
         int port = http_server_.start(req_port, sql_exec, addr, /*use_queue=*/false);
         if (port <= 0) {
             return "Error: Failed to start HTTP server";